@@ -2105,6 +2105,54 @@ cr_sel_eng_process_stylesheet ( CRSelEng * a_eng,
         return status;
 }
 
+/**
+ * cr_sel_eng_get_properties_from_rulesets:
+ *@a_rulesets: the statements that match a node, in cascade order.
+ *The specificity of each statement must be the one of the selector
+ *that matched it, as set by the selection engine.
+ *@a_len: the length of a_rulesets.
+ *@a_props: out parameter. The properties that apply to the node,
+ *once the cascade is computed.
+ *
+ *This is the last step of cr_sel_eng_get_matched_properties_from_cascade(),
+ *for callers that find the matching statements by other means.
+ *
+ *Returns CR_OK.
+ */
+enum CRStatus
+cr_sel_eng_get_properties_from_rulesets (CRStatement ** a_rulesets,
+                                         gulong a_len,
+                                         CRPropList ** a_props)
+{
+        gulong i = 0;
+
+        g_return_val_if_fail (a_props, CR_BAD_PARAM_ERROR);
+
+        /*
+         *TODO, walk down the stmts_tab and build the
+         *property_name/declaration hashtable.
+         *Make sure one can walk from the declaration to
+         *the stylesheet.
+         */
+        for (i = 0; i < a_len; i++) {
+                CRStatement *stmt = a_rulesets[i];
+                if (!stmt)
+                        continue;
+                switch (stmt->type) {
+                case RULESET_STMT:
+                        if (!stmt->parent_sheet)
+                                continue;
+                        put_css_properties_in_props_list
+                                (a_props, stmt);
+                        break;
+                default:
+                        break;
+                }
+
+        }
+        return CR_OK;
+}
+
 enum CRStatus
 cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
                                                 CRCascade * a_cascade,
@@ -2115,7 +2163,6 @@ cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
         enum CRStatus status = CR_OK;
         gulong tab_size = 0,
                 tab_len = 0,
-                i = 0,
                 index = 0;
         enum CRStyleOrigin origin;
         CRStyleSheet *sheet = NULL;
@@ -2137,29 +2184,7 @@ cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
                 }
         }
 
-        /*
-         *TODO, walk down the stmts_tab and build the
-         *property_name/declaration hashtable.
-         *Make sure one can walk from the declaration to
-         *the stylesheet.
-         */
-        for (i = 0; i < index; i++) {
-                CRStatement *stmt = stmts_tab[i];
-                if (!stmt)
-                        continue;
-                switch (stmt->type) {
-                case RULESET_STMT:
-                        if (!stmt->parent_sheet)
-                                continue;
-                        status = put_css_properties_in_props_list
-                                (a_props, stmt);
-                        break;
-                default:
-                        break;
-                }
-
-        }
-        status = CR_OK ;
+        status = cr_sel_eng_get_properties_from_rulesets (stmts_tab, index, a_props);
         if (stmts_tab) {
                 g_free (stmts_tab);
                 stmts_tab = NULL;
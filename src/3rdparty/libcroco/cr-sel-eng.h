@@ -97,6 +97,11 @@ enum CRStatus cr_sel_eng_get_matched_rulesets (CRSelEng *a_this,
                                                CRStatement ***a_rulesets,
                                                gulong *a_len) ;
 
+enum CRStatus
+cr_sel_eng_get_properties_from_rulesets (CRStatement **a_rulesets,
+                                         gulong a_len,
+                                         CRPropList **a_props) ;
+
 enum CRStatus
 cr_sel_eng_get_matched_properties_from_cascade  (CRSelEng *a_this,
                                                  CRCascade *a_cascade,
@@ -216,6 +216,20 @@ export_png_use_dithering(const Glib::VariantBase&  value, InkscapeApplication *a
     // std::cout << s.get() << std::endl;
 }
 
+void
+export_png_threads(const Glib::VariantBase&  value, InkscapeApplication *app)
+{
+    Glib::Variant<int> i = Glib::VariantBase::cast_dynamic<Glib::Variant<int> >(value);
+    app->file_export()->export_png_threads = i.get();
+}
+
+void
+export_render_profile(const Glib::VariantBase&  value, InkscapeApplication *app)
+{
+    Glib::Variant<std::string> s = Glib::VariantBase::cast_dynamic<Glib::Variant<std::string> >(value);
+    app->file_export()->export_render_profile = s.get();
+}
+
 void
 export_do(InkscapeApplication *app)
 {
@@ -261,6 +275,8 @@ std::vector<std::vector<Glib::ustring>> raw_data_output =
     {"app.export-background-opacity", N_("Export Background Opacity"), "Export",     N_("Include background opacity in exported file")        },
     {"app.export-png-color-mode",     N_("Export PNG Color Mode"),     "Export",     N_("Set color mode for PNG export")                      },
     {"app.export-png-use-dithering",  N_("Export PNG Dithering"),      "Export",     N_("Set dithering for PNG export")                       },
+    {"app.export-png-threads",        N_("Export PNG Threads"),        "Export",     N_("Set number of threads for PNG export")               },
+    {"app.export-render-profile",     N_("Export Render Profile"),     "Export",     N_("Write render time per object of bitmap exports to a JSON file")},
 
     {"app.export-do",                 N_("Do Export"),                 "Export",     N_("Do export")                                          }
     // clang-format on
@@ -295,7 +311,9 @@ std::vector<std::vector<Glib::ustring>> hint_data_output =
     {"app.export-background",         N_("Enter string for background color, e.g. #ff007f or rgb(255, 0, 128)")                 },
     {"app.export-background-opacity", N_("Enter number for background opacity, either between 0.0 and 1.0, or 1 up to 255")     },
     {"app.export-png-color-mode",     N_("Enter string for PNG Color Mode, one of Gray_1/Gray_2/Gray_4/Gray_8/Gray_16/RGB_8/RGB_16/GrayAlpha_8/GrayAlpha_16/RGBA_8/RGBA_16")},
-    {"app.export-png-use-dithering",  N_("Enter 1/0 for Yes/No to use dithering")          }
+    {"app.export-png-use-dithering",  N_("Enter 1/0 for Yes/No to use dithering")          },
+    {"app.export-png-threads",        N_("Enter integer number of threads, or 0 for one per processor")  },
+    {"app.export-render-profile",     N_("Enter string for the render profile file name")                }
     // clang-format on
 };
 
@@ -342,6 +360,8 @@ add_actions_output(InkscapeApplication* app)
     gapp->add_action_with_parameter( "export-background-opacity",Double, sigc::bind<InkscapeApplication*>(sigc::ptr_fun(&export_background_opacity), app));
     gapp->add_action_with_parameter( "export-png-color-mode",    String, sigc::bind<InkscapeApplication*>(sigc::ptr_fun(&export_png_color_mode), app));
     gapp->add_action_with_parameter( "export-png-use-dithering", Bool,   sigc::bind<InkscapeApplication*>(sigc::ptr_fun(&export_png_use_dithering), app));
+    gapp->add_action_with_parameter( "export-png-threads",       Int,    sigc::bind<InkscapeApplication*>(sigc::ptr_fun(&export_png_threads), app));
+    gapp->add_action_with_parameter( "export-render-profile",    String, sigc::bind<InkscapeApplication*>(sigc::ptr_fun(&export_render_profile), app));
 
     // Extra
     gapp->add_action(                "export-do",                        sigc::bind<InkscapeApplication*>(sigc::ptr_fun(&export_do),           app));
@@ -0,0 +1,228 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include "scheduler.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace Inkscape {
+namespace Async {
+namespace {
+
+// The scheduler and worker index of the current thread, if it is a worker.
+thread_local Scheduler const *current_scheduler = nullptr;
+thread_local int current_index = -1;
+
+int default_num_workers()
+{
+    int n = std::thread::hardware_concurrency();
+    if (n == 0) {
+        n = 4; // Sensible fallback if not reported.
+    }
+    return std::max(n - 1, 1);
+}
+
+// Shared state of a running parallel_for_ranges().
+struct ParallelFor
+{
+    std::function<void(int, int, int)> const *f;
+    int end;
+    int grain;
+
+    std::atomic<long> next;
+    std::atomic<int> slots{0};
+    std::atomic<int> active{0};
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::exception_ptr error;
+
+    ParallelFor(std::function<void(int, int, int)> const &f, int begin, int end, int grain)
+        : f(&f), end(end), grain(grain), next(begin) {}
+
+    void run()
+    {
+        // Register as active before claiming anything, so that once the range is exhausted and
+        // no one is active, no one can claim anything any more either.
+        active.fetch_add(1);
+        if (next.load() < end) {
+            int const slot = slots.fetch_add(1);
+            try {
+                for (long from; (from = next.fetch_add(grain)) < end;) {
+                    (*f)(from, std::min<long>(from + grain, end), slot);
+                }
+            } catch (...) {
+                next.store(end);
+                auto lock = std::lock_guard(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (active.fetch_sub(1) == 1) {
+            auto lock = std::lock_guard(mutex);
+            cond.notify_all();
+        }
+    }
+
+    void wait()
+    {
+        auto lock = std::unique_lock(mutex);
+        cond.wait(lock, [this] { return active.load() == 0; });
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+} // namespace
+
+Scheduler &Scheduler::get()
+{
+    // Function-local static rather than Util::Static, since the first use may be on any thread.
+    static Scheduler instance(default_num_workers());
+    return instance;
+}
+
+Scheduler::Scheduler(int num_workers)
+{
+    for (int i = 0; i < num_workers; i++) {
+        _workers.emplace_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < num_workers; i++) {
+        _workers[i]->thread = std::thread([this, i] { _run(i); });
+    }
+}
+
+Scheduler::~Scheduler()
+{
+    {
+        auto lock = std::lock_guard(_mutex);
+        _stop = true;
+    }
+    _cond.notify_all();
+    for (auto &w : _workers) {
+        w->thread.join();
+    }
+}
+
+bool Scheduler::on_worker_thread() const
+{
+    return current_scheduler == this;
+}
+
+void Scheduler::post(std::function<void()> task)
+{
+    if (on_worker_thread()) {
+        auto &w = *_workers[current_index];
+        auto lock = std::lock_guard(w.mutex);
+        w.tasks.emplace_back(std::move(task));
+    } else {
+        auto lock = std::lock_guard(_mutex);
+        _injected.emplace_back(std::move(task));
+    }
+    _queued.fetch_add(1);
+    _wake();
+}
+
+void Scheduler::_wake()
+{
+    // Synchronise with a worker that is about to sleep, so that the notification is not missed.
+    { auto lock = std::lock_guard(_mutex); }
+    _cond.notify_one();
+}
+
+bool Scheduler::_take(int index, Task &task)
+{
+    // Own tasks first, newest first, since their data is most likely still in cache.
+    {
+        auto &w = *_workers[index];
+        auto lock = std::lock_guard(w.mutex);
+        if (!w.tasks.empty()) {
+            task = std::move(w.tasks.back());
+            w.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Then tasks from outside.
+    {
+        auto lock = std::lock_guard(_mutex);
+        if (!_injected.empty()) {
+            task = std::move(_injected.front());
+            _injected.pop_front();
+            return true;
+        }
+    }
+
+    // Then steal the oldest task of another worker.
+    int const n = _workers.size();
+    for (int i = 1; i < n; i++) {
+        auto &victim = *_workers[(index + i) % n];
+        auto lock = std::lock_guard(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Scheduler::_run(int index)
+{
+    current_scheduler = this;
+    current_index = index;
+
+    while (true) {
+        Task task;
+        if (_take(index, task)) {
+            _queued.fetch_sub(1);
+            // Pass the wakeup on if there is more work than this thread can take.
+            if (_queued.load() > 0) {
+                _cond.notify_one();
+            }
+            task();
+            continue;
+        }
+
+        auto lock = std::unique_lock(_mutex);
+        _cond.wait(lock, [this] { return _stop || _queued.load() > 0; });
+        if (_stop && _queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+void Scheduler::parallel_for_ranges(int begin, int end, std::function<void(int, int, int)> const &f,
+                                    int max_threads, int grain)
+{
+    if (end <= begin) {
+        return;
+    }
+
+    int const n = end - begin;
+    max_threads = max_threads > 0 ? std::min(max_threads, concurrency()) : concurrency();
+    if (grain <= 0) {
+        grain = std::max(1, n / (4 * max_threads));
+    }
+    int const chunks = (n - 1) / grain + 1;
+    int const helpers = std::min(max_threads, chunks) - 1;
+
+    if (helpers <= 0) {
+        f(begin, end, 0);
+        return;
+    }
+
+    // Helpers that only get to run after the range is exhausted return immediately, so the
+    // caller never has to wait for them to be scheduled.
+    auto state = std::make_shared<ParallelFor>(f, begin, end, grain);
+    for (int i = 0; i < helpers; i++) {
+        post([state] { state->run(); });
+    }
+    state->run();
+    state->wait();
+}
+
+} // namespace Async
+} // namespace Inkscape
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file Scheduler
+ * Process-wide work-stealing task scheduler.
+ *
+ * All parallel rendering work (canvas redraws, tiled export, filter primitives) is submitted
+ * to a single set of worker threads, so that the total number of busy threads stays at the
+ * number of processors no matter how the parallelism is nested.
+ */
+#ifndef INKSCAPE_ASYNC_SCHEDULER_H
+#define INKSCAPE_ASYNC_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Inkscape {
+namespace Async {
+
+/**
+ * A fixed set of worker threads, one less than the number of processors since the submitting
+ * thread is usually busy too. Each worker owns a task deque: tasks posted from a worker go to
+ * the back of its own deque and are run newest-first, while idle workers steal the oldest tasks
+ * from the front of other deques. Tasks posted from other threads go to a shared queue.
+ *
+ * parallel_for() is safe to call from anywhere, including from inside another parallel_for().
+ * The calling thread always works through the range itself and only waits for iterations that
+ * other threads have already started, so nested loops never wait on queued tasks and can not
+ * deadlock, even when every worker is busy.
+ */
+class Scheduler final
+{
+public:
+    static Scheduler &get();
+
+    Scheduler(Scheduler const &) = delete;
+    Scheduler &operator=(Scheduler const &) = delete;
+    ~Scheduler();
+
+    /// The number of worker threads.
+    int num_workers() const { return _workers.size(); }
+
+    /// The number of threads that can work on a parallel_for(), including the caller.
+    int concurrency() const { return _workers.size() + 1; }
+
+    /// Whether the calling thread is one of the worker threads.
+    bool on_worker_thread() const;
+
+    /**
+     * Queue a task for execution on a worker thread. Tasks must not throw.
+     * Callers are responsible for waiting for their own tasks to finish.
+     */
+    void post(std::function<void()> task);
+
+    /**
+     * Call f(from, to, slot) on consecutive subranges of [begin, end) in parallel, and return once
+     * the whole range has been processed. At most max_threads threads take part, or concurrency()
+     * if max_threads <= 0. Each taking part gets a distinct slot in [0, max_threads), which can be
+     * used to index per-thread scratch buffers. Subranges have grain elements, except the last;
+     * if grain <= 0 then a size is picked which gives each thread several subranges.
+     * The first exception thrown by f is rethrown once all threads have stopped.
+     */
+    void parallel_for_ranges(int begin, int end, std::function<void(int, int, int)> const &f,
+                             int max_threads = 0, int grain = 0);
+
+    /// Call f(i) for every i in [begin, end) in parallel. See parallel_for_ranges().
+    template <typename F>
+    void parallel_for(int begin, int end, F &&f, int max_threads = 0, int grain = 0)
+    {
+        parallel_for_ranges(begin, end, [&f] (int from, int to, int) {
+            for (int i = from; i < to; ++i) {
+                f(i);
+            }
+        }, max_threads, grain);
+    }
+
+private:
+    using Task = std::function<void()>;
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::deque<Task> _injected; // Tasks posted from outside the workers.
+    std::atomic<int> _queued{0}; // Total number of tasks waiting in any queue.
+    bool _stop = false;
+
+    explicit Scheduler(int num_workers);
+    void _run(int index);
+    bool _take(int index, Task &task);
+    void _wake();
+};
+
+} // namespace Async
+} // namespace Inkscape
+
+#endif // INKSCAPE_ASYNC_SCHEDULER_H
+
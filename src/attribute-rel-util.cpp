@@ -20,9 +20,12 @@
 
 #include "attribute-rel-util.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <tuple>
 
 #include "attribute-rel-css.h"
 #include "attribute-rel-svg.h"
@@ -330,6 +333,119 @@ bool sp_attribute_check_attribute(Glib::ustring const &element, Glib::ustring co
     return is_useful;
 }
 
+namespace Inkscape {
+
+AttributeCleaner::AttributeCleaner(XML::Node &root, std::function<bool ()> recording)
+    : _root(root)
+    , _recording(std::move(recording))
+    , _enabled("/options/svgoutput/check_on_editing")
+{
+    _enabled.action = [this] { _observe(_enabled); };
+    _observe(_enabled);
+}
+
+AttributeCleaner::~AttributeCleaner()
+{
+    _observe(false);
+}
+
+void AttributeCleaner::_observe(bool observe)
+{
+    if (observe == _observing) {
+        return;
+    }
+    if (observe) {
+        _root.addSubtreeObserver(*this);
+    } else {
+        _root.removeSubtreeObserver(*this);
+        clear();
+    }
+    _observing = observe;
+}
+
+bool AttributeCleaner::_inTree(XML::Node const *node) const
+{
+    while (node->parent()) {
+        node = node->parent();
+    }
+    return node == &_root;
+}
+
+void AttributeCleaner::notifyChildAdded(XML::Node &, XML::Node &child, XML::Node *)
+{
+    if (!_flushing && _recording()) {
+        _changes.push_back({&child, 0});
+    }
+}
+
+void AttributeCleaner::notifyAttributeChanged(XML::Node &node, GQuark name, Util::ptr_shared, Util::ptr_shared new_value)
+{
+    // Removing an attribute never needs checking.
+    if (!_flushing && new_value && _recording()) {
+        _changes.push_back({&node, name});
+    }
+}
+
+void AttributeCleaner::flush()
+{
+    if (_changes.empty()) {
+        return;
+    }
+
+    // Cleaning changes attributes itself, which are not recorded again.
+    auto changes = std::move(_changes);
+    _changes.clear();
+    _flushing = true;
+
+    unsigned int const flags = sp_attribute_clean_get_prefs();
+    if (flags) {
+        // An attribute set many times in one transaction is checked once.
+        auto const key = [] (Change const &c) { return std::make_tuple(c.node, c.key); };
+        std::sort(changes.begin(), changes.end(), [&] (auto const &a, auto const &b) { return key(a) < key(b); });
+        changes.erase(std::unique(changes.begin(), changes.end(), [&] (auto const &a, auto const &b) { return key(a) == key(b); }),
+                      changes.end());
+
+        static GQuark const style_key = g_quark_from_static_string("style");
+
+        for (auto const &change : changes) {
+            auto const node = change.node;
+            if (!_inTree(node)) {
+                continue;
+            }
+
+            if (!change.key) {
+                sp_attribute_clean_recursive(node, flags);
+                continue;
+            }
+
+            // Only check elements in the svg namespace.
+            if (node->type() != XML::NodeType::ELEMENT_NODE || std::strncmp(node->name(), "svg:", 4) != 0 ||
+                !node->attribute(change.key)) {
+                continue;
+            }
+
+            if (flags & (SP_ATTRCLEAN_ATTR_WARN | SP_ATTRCLEAN_ATTR_REMOVE)) {
+                auto const id = node->attribute("id");
+                bool const is_useful = sp_attribute_check_attribute(node->name(), id ? id : "",
+                                                                    g_quark_to_string(change.key),
+                                                                    flags & SP_ATTRCLEAN_ATTR_WARN);
+                if (!is_useful && (flags & SP_ATTRCLEAN_ATTR_REMOVE)) {
+                    node->setAttribute(change.key, nullptr);
+                    continue;
+                }
+            }
+
+            if (change.key == style_key && flags >= SP_ATTRCLEAN_STYLE_WARN) {
+                sp_attribute_clean_style(node, flags);
+            }
+        }
+    }
+
+    _flushing = false;
+}
+
+} // namespace Inkscape
+
 /*
   Local Variables:
   mode:c++
@@ -17,8 +17,13 @@
  *      Author: tavmjong
  */
 
+#include <functional>
+#include <vector>
 #include <glibmm/ustring.h>
 
+#include "inkgc/gc-alloc.h"
+#include "preferences.h"
+#include "xml/node-observer.h"
 #include "xml/sp-css-attr.h"
 
 using Inkscape::XML::Node;
@@ -91,6 +96,58 @@ void sp_attribute_purge_default_style(SPCSSAttr *css, unsigned int flags);
 bool sp_attribute_check_attribute(Glib::ustring const &element, Glib::ustring const &id, Glib::ustring const &attribute,
                                   bool warn);
 
+namespace Inkscape {
+
+/**
+ * Checks the attributes and style properties that changed under a node, as a batch, when
+ * "/options/svgoutput/check_on_editing" is set.
+ *
+ * The changes are recorded by observing the subtree of the node, and cleaned as if by
+ * sp_attribute_clean_element() when flush() is called, i.e. when the document commits the
+ * transaction that made them. The preference is cached; while it is unset, nothing is observed.
+ * Neither are changes made while the recording callback returns false, as when the document is
+ * insensitive: those are not the user's edits, and are not committed by the next transaction.
+ */
+class AttributeCleaner : public XML::NodeObserver
+{
+public:
+    AttributeCleaner(XML::Node &root, std::function<bool ()> recording);
+    ~AttributeCleaner() override;
+    AttributeCleaner(AttributeCleaner const &) = delete;
+    AttributeCleaner &operator=(AttributeCleaner const &) = delete;
+
+    /// Check the changes recorded so far, warning about or removing what is not useful.
+    void flush();
+
+    /// Forget the changes recorded so far.
+    void clear() { _changes.clear(); }
+
+    void notifyChildAdded(XML::Node &node, XML::Node &child, XML::Node *prev) override;
+    void notifyAttributeChanged(XML::Node &node, GQuark name, Util::ptr_shared old_value,
+                                Util::ptr_shared new_value) override;
+
+private:
+    struct Change
+    {
+        XML::Node *node;
+        GQuark key; ///< The attribute that changed, or 0 if the whole subtree of node is new.
+    };
+
+    XML::Node &_root;
+    std::function<bool ()> _recording;
+    Pref<bool> _enabled;
+    bool _observing = false;
+    bool _flushing = false;
+
+    // Scanned, so that the nodes stay alive until checked even if they are deleted meanwhile.
+    std::vector<Change, GC::Alloc<Change, GC::SCANNED, GC::MANUAL>> _changes;
+
+    void _observe(bool observe);
+    bool _inTree(XML::Node const *node) const;
+};
+
+} // namespace Inkscape
+
 #endif /* __SP_ATTRIBUTE_REL_UTIL_H__ */
 
 /*
@@ -12,6 +12,7 @@
 #include "attributes.h"
 #include <cstring>
 #include <map>
+#include <unordered_map>
 
 #include <algorithm>
 #include <glib.h> // g_assert()
@@ -600,12 +601,16 @@ static_assert(n_attrs == (int)SPAttr::SPAttr_SIZE, "");
  */
 class AttributeLookupImpl {
     friend SPAttr sp_attribute_lookup(gchar const *key);
+    friend SPAttr sp_attribute_lookup(GQuark key);
+    friend GQuark sp_attribute_quark(SPAttr id);
 
     struct cstrless {
         bool operator()(char const *lhs, char const *rhs) const { return std::strcmp(lhs, rhs) < 0; }
     };
 
     std::map<char const *, SPAttr, cstrless> m_map;
+    std::unordered_map<GQuark, SPAttr> m_quark_map;
+    GQuark m_quarks[n_attrs] = {};
 
     AttributeLookupImpl()
     {
@@ -614,17 +619,26 @@ class AttributeLookupImpl {
             g_assert( (int)(props[i].code) == i);
 
             m_map[props[i].name] = props[i].code;
+            m_quarks[i] = g_quark_from_static_string(props[i].name);
+            m_quark_map[m_quarks[i]] = props[i].code;
         }
 
         // SVG 2.0 alias for xlink:href
         m_map["href"] = SPAttr::XLINK_HREF;
+        m_quark_map[g_quark_from_static_string("href")] = SPAttr::XLINK_HREF;
+    }
+
+    static AttributeLookupImpl const &get()
+    {
+        static AttributeLookupImpl const _instance;
+        return _instance;
     }
 };
 
 SPAttr
 sp_attribute_lookup(gchar const *key)
 {
-    static AttributeLookupImpl const _instance;
+    auto const &_instance = AttributeLookupImpl::get();
     auto it = _instance.m_map.find(key);
     if (it != _instance.m_map.end()) {
         return it->second;
@@ -634,6 +648,17 @@ sp_attribute_lookup(gchar const *key)
     return SPAttr::INVALID;
 }
 
+SPAttr
+sp_attribute_lookup(GQuark key)
+{
+    auto const &_instance = AttributeLookupImpl::get();
+    auto it = _instance.m_quark_map.find(key);
+    if (it != _instance.m_quark_map.end()) {
+        return it->second;
+    }
+    return SPAttr::INVALID;
+}
+
 gchar const *
 sp_attribute_name(SPAttr id)
 {
@@ -641,6 +666,13 @@ sp_attribute_name(SPAttr id)
     return props[(int)id].name;
 }
 
+GQuark
+sp_attribute_quark(SPAttr id)
+{
+    g_assert((int)id < n_attrs);
+    return AttributeLookupImpl::get().m_quarks[(int)id];
+}
+
 std::vector<Glib::ustring> sp_attribute_name_list(bool css_only)
 {
     std::vector<Glib::ustring> result;
@@ -607,11 +607,21 @@ bool SP_ATTRIBUTE_IS_CSS(SPAttr k);
  */
 SPAttr sp_attribute_lookup(gchar const *key);
 
+/**
+ * Get attribute id by interned name. Return INVALID for invalid names.
+ */
+SPAttr sp_attribute_lookup(GQuark key);
+
 /**
  * Get attribute name by id. Return NULL for invalid ids.
  */
 gchar const *sp_attribute_name(SPAttr id);
 
+/**
+ * Get the interned attribute name by id, for fast lookups in XML nodes. Return 0 for invalid ids.
+ */
+GQuark sp_attribute_quark(SPAttr id);
+
 /**
  * Get sorted attribute name list.
  * @param css_only If true, only return CSS properties
@@ -0,0 +1,515 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Vectorized pixel span kernels for Cairo ARGB32 data.
+ *
+ * The vector kernels are written once using GCC/Clang generic vector extensions and
+ * instantiated in functions compiled for SSE4.1 (4 pixels per step) and AVX2 (8 pixels per
+ * step). Pixels are split into one vector per channel, so every kernel mirrors the integer
+ * arithmetic of its scalar counterpart exactly. Divisions that the scalar code does in
+ * integers are done with a float estimate followed by an exact integer correction.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "display/cairo-simd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "display/cairo-templates.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INK_PIXELS_X86 1
+#endif
+
+namespace Inkscape {
+namespace Pixels {
+
+namespace {
+
+/*
+ * Scalar kernels. These are also used for the tails of the vector kernels.
+ */
+
+inline guint32 unpremultiply_pixel(guint32 in)
+{
+    EXTRACT_ARGB32(in, a, r, g, b)
+    if (a == 0) {
+        return in;
+    }
+    r = unpremul_alpha(r, a);
+    g = unpremul_alpha(g, a);
+    b = unpremul_alpha(b, a);
+    ASSEMBLE_ARGB32(out, a, r, g, b)
+    return out;
+}
+
+inline guint32 premultiply_pixel(guint32 in)
+{
+    EXTRACT_ARGB32(in, a, r, g, b)
+    r = premul_alpha(r, a);
+    g = premul_alpha(g, a);
+    b = premul_alpha(b, a);
+    ASSEMBLE_ARGB32(out, a, r, g, b)
+    return out;
+}
+
+void unpremultiply_scalar(guint32 const *in, guint32 *out, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        out[i] = unpremultiply_pixel(in[i]);
+    }
+}
+
+void premultiply_scalar(guint32 const *in, guint32 *out, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        out[i] = premultiply_pixel(in[i]);
+    }
+}
+
+void color_matrix_scalar(guint32 const *in, guint32 *out, int n, gint32 const v[20])
+{
+    for (int i = 0; i < n; ++i) {
+        EXTRACT_ARGB32(unpremultiply_pixel(in[i]), a, r, g, b)
+
+        gint32 ro = r*v[0]  + g*v[1]  + b*v[2]  + a*v[3]  + v[4];
+        gint32 go = r*v[5]  + g*v[6]  + b*v[7]  + a*v[8]  + v[9];
+        gint32 bo = r*v[10] + g*v[11] + b*v[12] + a*v[13] + v[14];
+        gint32 ao = r*v[15] + g*v[16] + b*v[17] + a*v[18] + v[19];
+        ro = (pxclamp(ro, 0, 255*255) + 127) / 255;
+        go = (pxclamp(go, 0, 255*255) + 127) / 255;
+        bo = (pxclamp(bo, 0, 255*255) + 127) / 255;
+        ao = (pxclamp(ao, 0, 255*255) + 127) / 255;
+
+        ro = premul_alpha(ro, ao);
+        go = premul_alpha(go, ao);
+        bo = premul_alpha(bo, ao);
+
+        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
+        out[i] = pxout;
+    }
+}
+
+void component_lut_scalar(guint32 const *in, guint32 *out, int n, guint8 const lut[4][256])
+{
+    for (int i = 0; i < n; ++i) {
+        EXTRACT_ARGB32(unpremultiply_pixel(in[i]), a, r, g, b)
+        ASSEMBLE_ARGB32(pxout, lut[3][a], lut[2][r], lut[1][g], lut[0][b])
+        out[i] = premultiply_pixel(pxout);
+    }
+}
+
+void composite_arithmetic_scalar(guint32 const *in1, guint32 const *in2, guint32 *out, int n, gint32 const k[4])
+{
+    for (int i = 0; i < n; ++i) {
+        EXTRACT_ARGB32(in1[i], aa, ra, ga, ba)
+        EXTRACT_ARGB32(in2[i], ab, rb, gb, bb)
+
+        gint32 ao = k[0]*aa*ab + k[1]*aa + k[2]*ab + k[3];
+        gint32 ro = k[0]*ra*rb + k[1]*ra + k[2]*rb + k[3];
+        gint32 go = k[0]*ga*gb + k[1]*ga + k[2]*gb + k[3];
+        gint32 bo = k[0]*ba*bb + k[1]*ba + k[2]*bb + k[3];
+
+        ao = pxclamp(ao, 0, 255*255*255); // r, g and b are premultiplied, so should be clamped to the alpha channel
+        ro = (pxclamp(ro, 0, ao) + (255*255/2)) / (255*255);
+        go = (pxclamp(go, 0, ao) + (255*255/2)) / (255*255);
+        bo = (pxclamp(bo, 0, ao) + (255*255/2)) / (255*255);
+        ao = (ao + (255*255/2)) / (255*255);
+
+        ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
+        out[i] = pxout;
+    }
+}
+
+#ifdef INK_PIXELS_X86
+
+/*
+ * Vector kernels. Everything below is force-inlined into the target-specific entry points,
+ * so the generic code is compiled with the instruction set of the caller.
+ */
+
+#define INK_PIXELS_INLINE inline __attribute__((always_inline))
+
+#if !defined(__clang__)
+// 32-byte vectors are only ever passed between force-inlined functions, never across an ABI boundary
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+typedef gint32  vi4 __attribute__((vector_size(16)));
+typedef guint32 vu4 __attribute__((vector_size(16)));
+typedef float   vf4 __attribute__((vector_size(16)));
+typedef gint32  vi8 __attribute__((vector_size(32)));
+typedef guint32 vu8 __attribute__((vector_size(32)));
+typedef float   vf8 __attribute__((vector_size(32)));
+
+template <typename VI> struct VecTraits;
+template <> struct VecTraits<vi4> { using U = vu4; using F = vf4; };
+template <> struct VecTraits<vi8> { using U = vu8; using F = vf8; };
+
+template <typename VI>
+struct Channels
+{
+    VI a, r, g, b;
+};
+
+template <typename VI>
+INK_PIXELS_INLINE VI splat(gint32 x)
+{
+    return VI{} + x;
+}
+
+template <typename VI>
+INK_PIXELS_INLINE VI load(guint32 const *p)
+{
+    VI v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template <typename VI>
+INK_PIXELS_INLINE void store(guint32 *p, VI const &v)
+{
+    std::memcpy(p, &v, sizeof(v));
+}
+
+template <typename VI>
+INK_PIXELS_INLINE Channels<VI> extract(VI const &px)
+{
+    using U = typename VecTraits<VI>::U;
+    U u = (U)px;
+    return { (VI)(u >> 24), (VI)((u >> 16) & 0xff), (VI)((u >> 8) & 0xff), (VI)(u & 0xff) };
+}
+
+template <typename VI>
+INK_PIXELS_INLINE VI assemble(VI const &a, VI const &r, VI const &g, VI const &b)
+{
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+template <typename VI>
+INK_PIXELS_INLINE VI clamp(VI const &x, VI const &lo, VI const &hi)
+{
+    VI t = x < lo ? lo : x;
+    return t > hi ? hi : t;
+}
+
+/// Exact x / d for 0 <= x < 2^24 and a constant divisor d.
+template <typename VI>
+INK_PIXELS_INLINE VI divide(VI const &x, gint32 d)
+{
+    using F = typename VecTraits<VI>::F;
+    VI q = __builtin_convertvector(__builtin_convertvector(x, F) * (1.0f / d), VI);
+    VI rem = x - q * d;
+    // comparisons yield -1 for true lanes
+    q -= (rem >= d);
+    q += (rem < 0);
+    return q;
+}
+
+/// Same as unpremul_alpha() for every lane.
+template <typename VI>
+INK_PIXELS_INLINE VI unpremul(VI const &c, VI const &a)
+{
+    using F = typename VecTraits<VI>::F;
+    VI num = c * 255 + (a >> 1);
+    VI den = a == 0 ? splat<VI>(1) : a;
+    // num < 2^16 and den < 256, so the rounded float quotient truncates to the exact result
+    VI q = __builtin_convertvector(__builtin_convertvector(num, F) / __builtin_convertvector(den, F), VI);
+    return c >= a ? splat<VI>(255) : q;
+}
+
+/// Same as premul_alpha() for every lane.
+template <typename VI>
+INK_PIXELS_INLINE VI premul(VI const &c, VI const &a)
+{
+    VI t = c * a + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+template <typename VI>
+INK_PIXELS_INLINE Channels<VI> unpremultiply_vec(VI const &px)
+{
+    auto p = extract(px);
+    VI r = unpremul(p.r, p.a);
+    VI g = unpremul(p.g, p.a);
+    VI b = unpremul(p.b, p.a);
+    // fully transparent pixels are passed through unchanged
+    VI transparent = p.a == 0;
+    return { p.a, transparent ? p.r : r, transparent ? p.g : g, transparent ? p.b : b };
+}
+
+template <typename VI>
+INK_PIXELS_INLINE void unpremultiply_span(guint32 const *in, guint32 *out, int n)
+{
+    constexpr int N = sizeof(VI) / 4;
+    int i = 0;
+    for (; i + N <= n; i += N) {
+        auto p = unpremultiply_vec(load<VI>(in + i));
+        store(out + i, assemble(p.a, p.r, p.g, p.b));
+    }
+    unpremultiply_scalar(in + i, out + i, n - i);
+}
+
+template <typename VI>
+INK_PIXELS_INLINE void premultiply_span(guint32 const *in, guint32 *out, int n)
+{
+    constexpr int N = sizeof(VI) / 4;
+    int i = 0;
+    for (; i + N <= n; i += N) {
+        auto p = extract(load<VI>(in + i));
+        store(out + i, assemble(p.a, premul(p.r, p.a), premul(p.g, p.a), premul(p.b, p.a)));
+    }
+    premultiply_scalar(in + i, out + i, n - i);
+}
+
+template <typename VI>
+INK_PIXELS_INLINE void color_matrix_span(guint32 const *in, guint32 *out, int n, gint32 const v[20])
+{
+    constexpr int N = sizeof(VI) / 4;
+    VI const lo = splat<VI>(0);
+    VI const hi = splat<VI>(255*255);
+    int i = 0;
+    for (; i + N <= n; i += N) {
+        auto p = unpremultiply_vec(load<VI>(in + i));
+
+        VI ro = p.r*v[0]  + p.g*v[1]  + p.b*v[2]  + p.a*v[3]  + v[4];
+        VI go = p.r*v[5]  + p.g*v[6]  + p.b*v[7]  + p.a*v[8]  + v[9];
+        VI bo = p.r*v[10] + p.g*v[11] + p.b*v[12] + p.a*v[13] + v[14];
+        VI ao = p.r*v[15] + p.g*v[16] + p.b*v[17] + p.a*v[18] + v[19];
+        ro = divide(clamp(ro, lo, hi) + 127, 255);
+        go = divide(clamp(go, lo, hi) + 127, 255);
+        bo = divide(clamp(bo, lo, hi) + 127, 255);
+        ao = divide(clamp(ao, lo, hi) + 127, 255);
+
+        store(out + i, assemble(ao, premul(ro, ao), premul(go, ao), premul(bo, ao)));
+    }
+    color_matrix_scalar(in + i, out + i, n - i, v);
+}
+
+template <typename VI>
+INK_PIXELS_INLINE void component_lut_span(guint32 const *in, guint32 *out, int n, guint8 const lut[4][256])
+{
+    constexpr int N = sizeof(VI) / 4;
+    int i = 0;
+    for (; i + N <= n; i += N) {
+        auto p = unpremultiply_vec(load<VI>(in + i));
+        // there is no byte gather, so the lookups themselves are scalar
+        for (int j = 0; j < N; ++j) {
+            p.a[j] = lut[3][p.a[j]];
+            p.r[j] = lut[2][p.r[j]];
+            p.g[j] = lut[1][p.g[j]];
+            p.b[j] = lut[0][p.b[j]];
+        }
+        store(out + i, assemble(p.a, premul(p.r, p.a), premul(p.g, p.a), premul(p.b, p.a)));
+    }
+    component_lut_scalar(in + i, out + i, n - i, lut);
+}
+
+template <typename VI>
+INK_PIXELS_INLINE void composite_arithmetic_span(guint32 const *in1, guint32 const *in2, guint32 *out, int n,
+                                                 gint32 const k[4])
+{
+    constexpr int N = sizeof(VI) / 4;
+    VI const lo = splat<VI>(0);
+    VI const hi = splat<VI>(255*255*255);
+    int i = 0;
+    for (; i + N <= n; i += N) {
+        auto p = extract(load<VI>(in1 + i));
+        auto q = extract(load<VI>(in2 + i));
+
+        VI ao = k[0]*p.a*q.a + k[1]*p.a + k[2]*q.a + k[3];
+        VI ro = k[0]*p.r*q.r + k[1]*p.r + k[2]*q.r + k[3];
+        VI go = k[0]*p.g*q.g + k[1]*p.g + k[2]*q.g + k[3];
+        VI bo = k[0]*p.b*q.b + k[1]*p.b + k[2]*q.b + k[3];
+
+        ao = clamp(ao, lo, hi);
+        ro = divide(clamp(ro, lo, ao) + (255*255/2), 255*255);
+        go = divide(clamp(go, lo, ao) + (255*255/2), 255*255);
+        bo = divide(clamp(bo, lo, ao) + (255*255/2), 255*255);
+        ao = divide(ao + (255*255/2), 255*255);
+
+        store(out + i, assemble(ao, ro, go, bo));
+    }
+    composite_arithmetic_scalar(in1 + i, in2 + i, out + i, n - i, k);
+}
+
+#define INK_PIXELS_ENTRY_POINTS(suffix, isa, VI)                                                        \
+    __attribute__((target(isa))) void unpremultiply_##suffix(guint32 const *in, guint32 *out, int n)    \
+    {                                                                                                      \
+        unpremultiply_span<VI>(in, out, n);                                                                \
+    }                                                                                                      \
+    __attribute__((target(isa))) void premultiply_##suffix(guint32 const *in, guint32 *out, int n)      \
+    {                                                                                                      \
+        premultiply_span<VI>(in, out, n);                                                                  \
+    }                                                                                                      \
+    __attribute__((target(isa))) void color_matrix_##suffix(guint32 const *in, guint32 *out, int n,     \
+                                                               gint32 const v[20])                         \
+    {                                                                                                      \
+        color_matrix_span<VI>(in, out, n, v);                                                              \
+    }                                                                                                      \
+    __attribute__((target(isa))) void component_lut_##suffix(guint32 const *in, guint32 *out, int n,    \
+                                                                guint8 const lut[4][256])                  \
+    {                                                                                                      \
+        component_lut_span<VI>(in, out, n, lut);                                                           \
+    }                                                                                                      \
+    __attribute__((target(isa))) void composite_arithmetic_##suffix(guint32 const *in1,                 \
+                                                                       guint32 const *in2, guint32 *out,   \
+                                                                       int n, gint32 const k[4])           \
+    {                                                                                                      \
+        composite_arithmetic_span<VI>(in1, in2, out, n, k);                                                \
+    }
+
+INK_PIXELS_ENTRY_POINTS(sse41, "sse4.1", vi4)
+INK_PIXELS_ENTRY_POINTS(avx2, "avx2", vi8)
+
+#undef INK_PIXELS_ENTRY_POINTS
+#undef INK_PIXELS_INLINE
+
+#endif // INK_PIXELS_X86
+
+struct Kernels
+{
+    void (*unpremultiply)(guint32 const *, guint32 *, int);
+    void (*premultiply)(guint32 const *, guint32 *, int);
+    void (*color_matrix)(guint32 const *, guint32 *, int, gint32 const *);
+    void (*component_lut)(guint32 const *, guint32 *, int, guint8 const (*)[256]);
+    void (*composite_arithmetic)(guint32 const *, guint32 const *, guint32 *, int, gint32 const *);
+};
+
+Kernels const kernels_scalar = {
+    unpremultiply_scalar, premultiply_scalar, color_matrix_scalar, component_lut_scalar, composite_arithmetic_scalar
+};
+
+#ifdef INK_PIXELS_X86
+Kernels const kernels_sse41 = {
+    unpremultiply_sse41, premultiply_sse41, color_matrix_sse41, component_lut_sse41, composite_arithmetic_sse41
+};
+
+Kernels const kernels_avx2 = {
+    unpremultiply_avx2, premultiply_avx2, color_matrix_avx2, component_lut_avx2, composite_arithmetic_avx2
+};
+#endif
+
+SimdLevel detect_level()
+{
+#ifdef INK_PIXELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SimdLevel::SSE41;
+    }
+#endif
+    return SimdLevel::SCALAR;
+}
+
+std::atomic<Kernels const *> current_kernels{nullptr};
+
+Kernels const *kernels_for(SimdLevel level)
+{
+    switch (level) {
+#ifdef INK_PIXELS_X86
+        case SimdLevel::AVX2:
+            return &kernels_avx2;
+        case SimdLevel::SSE41:
+            return &kernels_sse41;
+#endif
+        default:
+            return &kernels_scalar;
+    }
+}
+
+Kernels const &kernels()
+{
+    auto k = current_kernels.load(std::memory_order_relaxed);
+    if (!k) {
+        k = kernels_for(simd_level_supported());
+        current_kernels.store(k, std::memory_order_relaxed);
+    }
+    return *k;
+}
+
+} // namespace
+
+SimdLevel simd_level_supported()
+{
+    static SimdLevel const supported = detect_level();
+    return supported;
+}
+
+SimdLevel simd_level()
+{
+    auto k = &kernels();
+#ifdef INK_PIXELS_X86
+    if (k == &kernels_avx2) {
+        return SimdLevel::AVX2;
+    }
+    if (k == &kernels_sse41) {
+        return SimdLevel::SSE41;
+    }
+#endif
+    return SimdLevel::SCALAR;
+}
+
+void set_simd_level(SimdLevel level)
+{
+    current_kernels.store(kernels_for(std::min(level, simd_level_supported())), std::memory_order_relaxed);
+}
+
+char const *simd_level_name(SimdLevel level)
+{
+    switch (level) {
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::SSE41:
+            return "SSE4.1";
+        default:
+            return "scalar";
+    }
+}
+
+void unpremultiply(guint32 const *in, guint32 *out, int n)
+{
+    kernels().unpremultiply(in, out, n);
+}
+
+void premultiply(guint32 const *in, guint32 *out, int n)
+{
+    kernels().premultiply(in, out, n);
+}
+
+void color_matrix(guint32 const *in, guint32 *out, int n, gint32 const matrix[20])
+{
+    kernels().color_matrix(in, out, n, matrix);
+}
+
+void component_lut(guint32 const *in, guint32 *out, int n, guint8 const lut[4][256])
+{
+    kernels().component_lut(in, out, n, lut);
+}
+
+void composite_arithmetic(guint32 const *in1, guint32 const *in2, guint32 *out, int n, gint32 const k[4])
+{
+    kernels().composite_arithmetic(in1, in2, out, n, k);
+}
+
+} // namespace Pixels
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Vectorized pixel span kernels for Cairo ARGB32 data.
+ *
+ * Each kernel processes a run of premultiplied ARGB32 pixels and produces exactly the same
+ * result as the corresponding per-pixel functor in the filter code. The implementation is
+ * chosen once at runtime from the instruction sets supported by the CPU, with a portable
+ * scalar fallback. Input and output spans may be identical, but must not partially overlap.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+#define SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+
+#include <glib.h>
+
+namespace Inkscape {
+namespace Pixels {
+
+enum class SimdLevel
+{
+    SCALAR,
+    SSE41,
+    AVX2
+};
+
+/// The instruction set used by the span kernels.
+SimdLevel simd_level();
+
+/// The best instruction set supported by this CPU.
+SimdLevel simd_level_supported();
+
+/**
+ * Override the instruction set used by the span kernels; levels above simd_level_supported()
+ * are clamped. Intended for tests and benchmarks.
+ */
+void set_simd_level(SimdLevel level);
+
+char const *simd_level_name(SimdLevel level);
+
+/// Un-premultiply alpha, see unpremul_alpha(). Fully transparent pixels are left unchanged.
+void unpremultiply(guint32 const *in, guint32 *out, int n);
+
+/// Premultiply alpha, see premul_alpha().
+void premultiply(guint32 const *in, guint32 *out, int n);
+
+/**
+ * Apply a fixed-point feColorMatrix, with the same semantics as
+ * FilterColorMatrix::ColorMatrixMatrix: the rows are R, G, B, A; the multipliers are scaled
+ * by 255 and the offsets in columns 4, 9, 14 and 19 are scaled by 255*255.
+ */
+void color_matrix(guint32 const *in, guint32 *out, int n, gint32 const matrix[20]);
+
+/**
+ * Un-premultiply, map each channel through a lookup table and premultiply again.
+ * The tables are indexed by Cairo channel order: B = 0, G = 1, R = 2, A = 3.
+ */
+void component_lut(guint32 const *in, guint32 *out, int n, guint8 const lut[4][256]);
+
+/**
+ * feComposite arithmetic operator, with k1 scaled by 255, k2 and k3 by 255*255
+ * and k4 by 255*255*255.
+ */
+void composite_arithmetic(guint32 const *in1, guint32 const *in2, guint32 *out, int n, gint32 const k[4]);
+
+} // namespace Pixels
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -19,18 +19,63 @@
 
 #include <glib.h>
 
-#ifdef HAVE_OPENMP
-#include <omp.h>
-// single-threaded operation if the number of pixels is below this threshold
-static const int OPENMP_THRESHOLD = 2048;
-#endif
-
 #include <cmath>
 #include <algorithm>
+#include <type_traits>
+#include <utility>
 #include <cairo.h>
+#include "async/scheduler.h"
 #include "display/nr-3dutils.h"
 #include "display/cairo-utils.h"
 
+// single-threaded operation if the number of pixels is below this threshold
+static const int PARALLEL_THRESHOLD = 2048;
+
+/**
+ * Call f(i) for every i in [begin, end). If the surface has more than PARALLEL_THRESHOLD pixels,
+ * the iterations are spread over the shared render scheduler, using at most
+ * get_num_filter_threads() threads.
+ */
+template <typename F>
+void ink_cairo_parallel_for(int begin, int end, int limit, F &&f)
+{
+    if (limit > PARALLEL_THRESHOLD) {
+        Inkscape::Async::Scheduler::get().parallel_for(begin, end, std::forward<F>(f), get_num_filter_threads());
+    } else {
+        for (int i = begin; i < end; ++i) {
+            f(i);
+        }
+    }
+}
+
+/**
+ * Functors may additionally provide a span method that processes a run of ARGB32 pixels
+ * at once, typically using one of the vectorized kernels from display/cairo-simd.h:
+ *
+ *   void span(guint32 const *in, guint32 *out, int n);                      // filters
+ *   void span(guint32 const *in1, guint32 const *in2, guint32 *out, int n); // blends
+ *
+ * It must give the same result as calling operator() for every pixel, and is used instead of it
+ * whenever all the surfaces involved are ARGB32.
+ */
+template <typename F, typename = void>
+struct ink_has_filter_span : std::false_type {};
+
+template <typename F>
+struct ink_has_filter_span<F, std::void_t<decltype(std::declval<F&>().span(
+    std::declval<guint32 const *>(), std::declval<guint32 *>(), 0))>> : std::true_type {};
+
+template <typename F, typename = void>
+struct ink_has_blend_span : std::false_type {};
+
+template <typename F>
+struct ink_has_blend_span<F, std::void_t<decltype(std::declval<F&>().span(
+    std::declval<guint32 const *>(), std::declval<guint32 const *>(), std::declval<guint32 *>(), 0))>>
+    : std::true_type {};
+
+// number of pixels handed to a span method at once when the whole surface is contiguous
+static const int INK_SPAN_CHUNK = 1024;
+
 /**
  * Blend two surfaces using the supplied functor.
  * This template blends two Cairo image surfaces using a blending functor that takes
@@ -72,27 +117,31 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
     guint32 *const out_data = reinterpret_cast<guint32*>(cairo_image_surface_get_data(out));
 
     // NOTE
-    // OpenMP probably doesn't help much here.
+    // Running this in parallel probably doesn't help much here.
     // It would be better to render more than 1 tile at a time.
-    #if HAVE_OPENMP
-    int numOfThreads = get_num_filter_threads();
-    #endif
 
     // The number of code paths here is evil.
     if (bpp1 == 4) {
         if (bpp2 == 4) {
-            if (fast_path) {
-                #if HAVE_OPENMP
-                #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-                #endif
-                for (int i = 0; i < limit; ++i) {
-                    *(out_data + i) = blend(*(in1_data + i), *(in2_data + i));
+            if constexpr (ink_has_blend_span<Blend>::value) {
+                if (fast_path) {
+                    int chunks = (limit + INK_SPAN_CHUNK - 1) / INK_SPAN_CHUNK;
+                    ink_cairo_parallel_for(0, chunks, limit, [&] (int i) {
+                        int start = i * INK_SPAN_CHUNK;
+                        int n = std::min(INK_SPAN_CHUNK, limit - start);
+                        blend.span(in1_data + start, in2_data + start, out_data + start, n);
+                    });
+                } else {
+                    ink_cairo_parallel_for(0, h, limit, [&] (int i) {
+                        blend.span(in1_data + i * stride1/4, in2_data + i * stride2/4, out_data + i * strideout/4, w);
+                    });
                 }
+            } else if (fast_path) {
+                ink_cairo_parallel_for(0, limit, limit, [&] (int i) {
+                    *(out_data + i) = blend(*(in1_data + i), *(in2_data + i));
+                });
             } else {
-                #if HAVE_OPENMP
-                #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-                #endif
-                for (int i = 0; i < h; ++i) {
+                ink_cairo_parallel_for(0, h, limit, [&] (int i) {
                     guint32 *in1_p = in1_data + i * stride1/4;
                     guint32 *in2_p = in2_data + i * stride2/4;
                     guint32 *out_p = out_data + i * strideout/4;
@@ -100,14 +149,11 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
                         *out_p = blend(*in1_p, *in2_p);
                         ++in1_p; ++in2_p; ++out_p;
                     }
-                }
+                });
             }
         } else {
             // bpp2 == 1
-            #if HAVE_OPENMP
-            #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-            #endif
-            for (int i = 0; i < h; ++i) {
+            ink_cairo_parallel_for(0, h, limit, [&] (int i) {
                 guint32 *in1_p = in1_data + i * stride1/4;
                 guint8  *in2_p = reinterpret_cast<guint8*>(in2_data) + i * stride2;
                 guint32 *out_p = out_data + i * strideout/4;
@@ -117,15 +163,12 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
                     *out_p = blend(*in1_p, in2_px);
                     ++in1_p; ++in2_p; ++out_p;
                 }
-            }
+            });
         }
     } else {
         if (bpp2 == 4) {
             // bpp1 == 1
-            #if HAVE_OPENMP
-            #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-            #endif
-            for (int i = 0; i < h; ++i) {
+            ink_cairo_parallel_for(0, h, limit, [&] (int i) {
                 guint8  *in1_p = reinterpret_cast<guint8*>(in1_data) + i * stride1;
                 guint32 *in2_p = in2_data + i * stride2/4;
                 guint32 *out_p = out_data + i * strideout/4;
@@ -135,14 +178,11 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
                     *out_p = blend(in1_px, *in2_p);
                     ++in1_p; ++in2_p; ++out_p;
                 }
-            }
+            });
         } else {
             // bpp1 == 1 && bpp2 == 1
             if (fast_path) {
-                #if HAVE_OPENMP
-                #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-                #endif
-                for (int i = 0; i < limit; ++i) {
+                ink_cairo_parallel_for(0, limit, limit, [&] (int i) {
                     guint8 *in1_p = reinterpret_cast<guint8*>(in1_data) + i;
                     guint8 *in2_p = reinterpret_cast<guint8*>(in2_data) + i;
                     guint8 *out_p = reinterpret_cast<guint8*>(out_data) + i;
@@ -150,12 +190,9 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
                     guint32 in2_px = *in2_p; in2_px <<= 24;
                     guint32 out_px = blend(in1_px, in2_px);
                     *out_p = out_px >> 24;
-                }
+                });
             } else {
-                #if HAVE_OPENMP
-                #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-                #endif
-                for (int i = 0; i < h; ++i) {
+                ink_cairo_parallel_for(0, h, limit, [&] (int i) {
                     guint8 *in1_p = reinterpret_cast<guint8*>(in1_data) + i * stride1;
                     guint8 *in2_p = reinterpret_cast<guint8*>(in2_data) + i * stride2;
                     guint8 *out_p = reinterpret_cast<guint8*>(out_data) + i * strideout;
@@ -166,7 +203,7 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
                         *out_p = out_px >> 24;
                         ++in1_p; ++in2_p; ++out_p;
                     }
-                }
+                });
             }
         }
     }
@@ -200,29 +237,31 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
     guint32 *const in_data  = reinterpret_cast<guint32*>(cairo_image_surface_get_data(in));
     guint32 *const out_data = reinterpret_cast<guint32*>(cairo_image_surface_get_data(out));
 
-    #if HAVE_OPENMP
-    int numOfThreads = get_num_filter_threads();
-    #endif
 
     // this is provided just in case, to avoid problems with strict aliasing rules
     if (in == out) {
+        if constexpr (ink_has_filter_span<Filter>::value) {
+            if (bppin == 4) {
+                int chunks = (limit + INK_SPAN_CHUNK - 1) / INK_SPAN_CHUNK;
+                ink_cairo_parallel_for(0, chunks, limit, [&] (int i) {
+                    int start = i * INK_SPAN_CHUNK;
+                    filter.span(in_data + start, in_data + start, std::min(INK_SPAN_CHUNK, limit - start));
+                });
+                cairo_surface_mark_dirty(out);
+                return;
+            }
+        }
         if (bppin == 4) {
-            #if HAVE_OPENMP
-            #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-            #endif
-            for (int i = 0; i < limit; ++i) {
+            ink_cairo_parallel_for(0, limit, limit, [&] (int i) {
                 *(in_data + i) = filter(*(in_data + i));
-            }
+            });
         } else {
-            #if HAVE_OPENMP
-            #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-            #endif
-            for (int i = 0; i < limit; ++i) {
+            ink_cairo_parallel_for(0, limit, limit, [&] (int i) {
                 guint8 *in_p = reinterpret_cast<guint8*>(in_data) + i;
                 guint32 in_px = *in_p; in_px <<= 24;
                 guint32 out_px = filter(in_px);
                 *in_p = out_px >> 24;
-            }
+            });
         }
         cairo_surface_mark_dirty(out);
         return;
@@ -231,33 +270,36 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
     if (bppin == 4) {
         if (bppout == 4) {
             // bppin == 4, bppout == 4
-            if (fast_path) {
-                #if HAVE_OPENMP
-                #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-                #endif
-                for (int i = 0; i < limit; ++i) {
-                    *(out_data + i) = filter(*(in_data + i));
+            if constexpr (ink_has_filter_span<Filter>::value) {
+                if (fast_path) {
+                    int chunks = (limit + INK_SPAN_CHUNK - 1) / INK_SPAN_CHUNK;
+                    ink_cairo_parallel_for(0, chunks, limit, [&] (int i) {
+                        int start = i * INK_SPAN_CHUNK;
+                        filter.span(in_data + start, out_data + start, std::min(INK_SPAN_CHUNK, limit - start));
+                    });
+                } else {
+                    ink_cairo_parallel_for(0, h, limit, [&] (int i) {
+                        filter.span(in_data + i * stridein/4, out_data + i * strideout/4, w);
+                    });
                 }
+            } else if (fast_path) {
+                ink_cairo_parallel_for(0, limit, limit, [&] (int i) {
+                    *(out_data + i) = filter(*(in_data + i));
+                });
             } else {
-                #if HAVE_OPENMP
-                #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-                #endif
-                for (int i = 0; i < h; ++i) {
+                ink_cairo_parallel_for(0, h, limit, [&] (int i) {
                     guint32 *in_p = in_data + i * stridein/4;
                     guint32 *out_p = out_data + i * strideout/4;
                     for (int j = 0; j < w; ++j) {
                         *out_p = filter(*in_p);
                         ++in_p; ++out_p;
                     }
-                }
+                });
             }
         } else {
             // bppin == 4, bppout == 1
             // we use this path with COLORMATRIX_LUMINANCETOALPHA
-            #if HAVE_OPENMP
-            #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-            #endif
-            for (int i = 0; i < h; ++i) {
+            ink_cairo_parallel_for(0, h, limit, [&] (int i) {
                 guint32 *in_p = in_data + i * stridein/4;
                 guint8 *out_p = reinterpret_cast<guint8*>(out_data) + i * strideout;
                 for (int j = 0; j < w; ++j) {
@@ -265,26 +307,20 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
                     *out_p = out_px >> 24;
                     ++in_p; ++out_p;
                 }
-            }
+            });
         }
     } else if (bppout == 1) {
         // bppin == 1, bppout == 1
         if (fast_path) {
-            #if HAVE_OPENMP
-            #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-            #endif
-            for (int i = 0; i < limit; ++i) {
+            ink_cairo_parallel_for(0, limit, limit, [&] (int i) {
                 guint8 *in_p = reinterpret_cast<guint8*>(in_data) + i;
                 guint8 *out_p = reinterpret_cast<guint8*>(out_data) + i;
                 guint32 in_px = *in_p; in_px <<= 24;
                 guint32 out_px = filter(in_px);
                 *out_p = out_px >> 24;
-            }
+            });
         } else {
-            #if HAVE_OPENMP
-            #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-            #endif
-            for (int i = 0; i < h; ++i) {
+            ink_cairo_parallel_for(0, h, limit, [&] (int i) {
                 guint8 *in_p = reinterpret_cast<guint8*>(in_data) + i * stridein;
                 guint8 *out_p = reinterpret_cast<guint8*>(out_data) + i * strideout;
                 for (int j = 0; j < w; ++j) {
@@ -293,30 +329,24 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
                     *out_p = out_px >> 24;
                     ++in_p; ++out_p;
                 }
-            }
+            });
         }
     } else {
         // bppin == 1, bppout == 4
         // used in COLORMATRIX_MATRIX when in is NR_FILTER_SOURCEALPHA
         if (fast_path) {
-            #if HAVE_OPENMP
-            #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-            #endif
-            for (int i = 0; i < limit; ++i) {
+            ink_cairo_parallel_for(0, limit, limit, [&] (int i) {
                 guint8 in_p = reinterpret_cast<guint8*>(in_data)[i];
                 out_data[i] = filter(guint32(in_p) << 24);
-            }
+            });
         } else {
-            #if HAVE_OPENMP
-            #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-            #endif
-            for (int i = 0; i < h; ++i) {
+            ink_cairo_parallel_for(0, h, limit, [&] (int i) {
                 guint8 *in_p = reinterpret_cast<guint8*>(in_data) + i * stridein;
                 guint32 *out_p = out_data + i * strideout/4;
                 for (int j = 0; j < w; ++j) {
                     out_p[j] = filter(guint32(in_p[j]) << 24);
                 }
-            }
+            });
         }
     }
     cairo_surface_mark_dirty(out);
@@ -346,35 +376,26 @@ void ink_cairo_surface_synthesize(cairo_surface_t *out, cairo_rectangle_t const
 
     unsigned char *out_data = cairo_image_surface_get_data(out);
 
-    #if HAVE_OPENMP
     int limit = w * h;
-    int numOfThreads = get_num_filter_threads();
-    #endif
 
     if (bppout == 4) {
-        #if HAVE_OPENMP
-        #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-        #endif
-        for (int i = out_area.y; i < h; ++i) {
+        ink_cairo_parallel_for(out_area.y, h, limit, [&] (int i) {
             guint32 *out_p = reinterpret_cast<guint32*>(out_data + i * strideout);
             for (int j = out_area.x; j < w; ++j) {
                 *out_p = synth(j, i);
                 ++out_p;
             }
-        }
+        });
     } else {
         // bppout == 1
-        #if HAVE_OPENMP
-        #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
-        #endif
-        for (int i = out_area.y; i < h; ++i) {
+        ink_cairo_parallel_for(out_area.y, h, limit, [&] (int i) {
             guint8 *out_p = out_data + i * strideout;
             for (int j = out_area.x; j < w; ++j) {
                 guint32 out_px = synth(j, i);
                 *out_p = out_px >> 24;
                 ++out_p;
             }
-        }
+        });
     }
     cairo_surface_mark_dirty(out);
 }
@@ -34,6 +34,7 @@
 #include "cairo-templates.h"
 #include "document.h"
 #include "preferences.h"
+#include "display/surface-pool.h"
 #include "util/units.h"
 #include "helper/pixbuf-ops.h"
 
@@ -1097,10 +1098,11 @@ ink_cairo_surface_create_same_size(cairo_surface_t *s, cairo_content_t c)
     assert (x_scale > 0);
     assert (y_scale > 0);
 
+    // Mostly used for temporary images in filters, so draw from the surface pool.
     cairo_surface_t *ns =
-        cairo_surface_create_similar(s, c,
-                                     ink_cairo_surface_get_width(s)/x_scale,
-                                     ink_cairo_surface_get_height(s)/y_scale);
+        Inkscape::SurfacePool::create_similar(s, c,
+                                              ink_cairo_surface_get_width(s)/x_scale,
+                                              ink_cairo_surface_get_height(s)/y_scale);
     return ns;
 }
 
@@ -32,6 +32,8 @@ struct CanvasItemBuffer
     int device_scale; // For high DPI monitors.
     Cairo::RefPtr<Cairo::Context> cr;
     bool outline_pass;
+    bool draft = false;            // Quick render leaving out filters, to be refined later.
+    bool draft_incomplete = false; // Set when a draft render left out something.
 };
 
 } // namespace Inkscape
@@ -120,7 +120,10 @@ void CanvasItemDrawing::_update(bool)
 void CanvasItemDrawing::_render(Inkscape::CanvasItemBuffer &buf)
 {
     auto dc = Inkscape::DrawingContext(buf.cr->cobj(), buf.rect.min());
-    _drawing->render(dc, buf.rect, buf.outline_pass * DrawingItem::RENDER_OUTLINE);
+    unsigned flags = buf.outline_pass * DrawingItem::RENDER_OUTLINE | buf.draft * DrawingItem::RENDER_DRAFT;
+    if (!_drawing->render(dc, buf.rect, flags)) {
+        buf.draft_incomplete = true;
+    }
 }
 
 /**
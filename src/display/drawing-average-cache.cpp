@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Summed-area tables of a rendered drawing, for average colour queries.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "display/drawing-average-cache.h"
+
+#include <algorithm>
+#include <cairomm/surface.h>
+
+#include "display/cairo-utils.h"
+#include "display/drawing-context.h"
+#include "display/drawing.h"
+
+namespace Inkscape {
+namespace {
+
+int floordiv(int a, int b)
+{
+    return a / b - (a % b < 0);
+}
+
+} // namespace
+
+void DrawingAverageCache::average(Drawing &drawing, Geom::IntRect const &area, double &R, double &G, double &B, double &A)
+{
+    R = G = B = A = 0.0;
+    if (area.hasZeroArea()) {
+        return;
+    }
+
+    // Tiles rendered at another zoom level are of no use.
+    auto const affine = drawing.root() ? drawing.root()->ctm() : Geom::identity();
+    if (affine != _affine) {
+        clear();
+        _affine = affine;
+    }
+
+    std::array<std::uint64_t, 4> total{};
+    int constexpr W = TILE_SIZE + 1;
+
+    int const tx0 = floordiv(area.left(), TILE_SIZE);
+    int const ty0 = floordiv(area.top(), TILE_SIZE);
+    int const tx1 = floordiv(area.right() - 1, TILE_SIZE);
+    int const ty1 = floordiv(area.bottom() - 1, TILE_SIZE);
+
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            // The part of area within this tile, in tile coordinates.
+            int const x0 = std::max(area.left() - tx * TILE_SIZE, 0);
+            int const y0 = std::max(area.top() - ty * TILE_SIZE, 0);
+            int const x1 = std::min(area.right() - tx * TILE_SIZE, TILE_SIZE);
+            int const y1 = std::min(area.bottom() - ty * TILE_SIZE, TILE_SIZE);
+            auto const &table = _get(drawing, {tx, ty}).table;
+
+            auto const &s00 = table[y0 * W + x0];
+            auto const &s01 = table[y0 * W + x1];
+            auto const &s10 = table[y1 * W + x0];
+            auto const &s11 = table[y1 * W + x1];
+            for (int c = 0; c < 4; c++) {
+                total[c] += s11[c] - s10[c] - s01[c] + s00[c];
+            }
+        }
+    }
+
+    double const scale = 255.0 * area.width() * area.height();
+    R = std::clamp(total[0] / scale, 0.0, 1.0);
+    G = std::clamp(total[1] / scale, 0.0, 1.0);
+    B = std::clamp(total[2] / scale, 0.0, 1.0);
+    A = std::clamp(total[3] / scale, 0.0, 1.0);
+}
+
+void DrawingAverageCache::invalidate(Geom::IntRect const &area)
+{
+    for (auto it = _tiles.begin(); it != _tiles.end(); ) {
+        if (_rect(it->index).intersects(area)) {
+            _lookup.erase({it->index.x(), it->index.y()});
+            it = _tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void DrawingAverageCache::clear()
+{
+    _tiles.clear();
+    _lookup.clear();
+}
+
+Geom::IntRect DrawingAverageCache::_rect(Geom::IntPoint const &index)
+{
+    return Geom::IntRect::from_xywh(index.x() * TILE_SIZE, index.y() * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+}
+
+DrawingAverageCache::Tile &DrawingAverageCache::_get(Drawing &drawing, Geom::IntPoint const &index)
+{
+    auto const key = std::make_pair(index.x(), index.y());
+    if (auto it = _lookup.find(key); it != _lookup.end()) {
+        _tiles.splice(_tiles.begin(), _tiles, it->second);
+        return _tiles.front();
+    }
+
+    auto const rect = _rect(index);
+    auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, TILE_SIZE, TILE_SIZE);
+    auto dc = DrawingContext(surface->cobj(), rect.min());
+    drawing.render(dc, rect);
+    surface->flush();
+
+    auto &tile = _tiles.emplace_front();
+    tile.index = index;
+
+    // Each entry is the entry above it plus the running sum of its row.
+    int constexpr W = TILE_SIZE + 1;
+    tile.table.assign(W * W, Sums{});
+    auto const data = surface->get_data();
+    auto const stride = surface->get_stride();
+    for (int y = 0; y < TILE_SIZE; y++) {
+        auto const row = reinterpret_cast<guint32 const *>(data + y * stride);
+        Sums sums{};
+        for (int x = 0; x < TILE_SIZE; x++) {
+            EXTRACT_ARGB32(row[x], a, r, g, b)
+            sums[0] += r;
+            sums[1] += g;
+            sums[2] += b;
+            sums[3] += a;
+            auto const &above = tile.table[y * W + x + 1];
+            auto &entry = tile.table[(y + 1) * W + x + 1];
+            for (int c = 0; c < 4; c++) {
+                entry[c] = above[c] + sums[c];
+            }
+        }
+    }
+
+    _lookup[key] = _tiles.begin();
+    if (_tiles.size() > MAX_TILES) {
+        auto const &last = _tiles.back();
+        _lookup.erase({last.index.x(), last.index.y()});
+        _tiles.pop_back();
+    }
+
+    return tile;
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Summed-area tables of a rendered drawing, for average colour queries.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_AVERAGE_CACHE_H
+#define SEEN_INKSCAPE_DISPLAY_DRAWING_AVERAGE_CACHE_H
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+#include <2geom/affine.h>
+#include <2geom/int-rect.h>
+
+namespace Inkscape {
+
+class Drawing;
+
+/**
+ * Answers average colour queries over arbitrary rectangles of a drawing with a few table lookups,
+ * rather than rendering the rectangle every time.
+ *
+ * The drawing is rendered in square tiles as the queries first need them, and each tile is kept
+ * as a summed-area table of its premultiplied channels. Tiles are discarded when an area
+ * overlapping them is marked for rendering, when the transform of the drawing changes, and least
+ * recently used first beyond a fixed number of tiles.
+ */
+class DrawingAverageCache
+{
+public:
+    /// Compute the average premultiplied colour of area, rendering any missing tiles from drawing.
+    void average(Drawing &drawing, Geom::IntRect const &area, double &R, double &G, double &B, double &A);
+
+    /// Discard the tiles overlapping area, in the pixel coordinates of the drawing.
+    void invalidate(Geom::IntRect const &area);
+
+    /// Discard all tiles.
+    void clear();
+
+private:
+    static constexpr int TILE_SIZE = 256;
+    static constexpr std::size_t MAX_TILES = 64; // About 1 MiB each.
+
+    using Sums = std::array<std::uint32_t, 4>; // R, G, B, A; a tile's total cannot overflow these.
+
+    struct Tile
+    {
+        Geom::IntPoint index;
+        /// Sums over [0, x) x [0, y) of the tile at (TILE_SIZE + 1) * y + x.
+        std::vector<Sums> table;
+    };
+
+    std::list<Tile> _tiles; // Most recently used first.
+    std::map<std::pair<int, int>, std::list<Tile>::iterator> _lookup;
+    Geom::Affine _affine;
+
+    static Geom::IntRect _rect(Geom::IntPoint const &index);
+    Tile &_get(Drawing &drawing, Geom::IntPoint const &index);
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_DRAWING_AVERAGE_CACHE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Persistent on-disk cache of rendered drawing items.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "display/drawing-disk-cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <tuple>
+#include <vector>
+#include <boost/filesystem.hpp> // Using boost::filesystem instead of std::filesystem due to broken C++17 on MacOS.
+#include <cairo.h>
+#include <glib.h>
+
+#include "io/resource.h"
+#include "preferences.h"
+
+namespace fs = boost::filesystem;
+
+namespace Inkscape {
+namespace {
+
+// Bump the version whenever the rendering of any item changes, so that stale entries are ignored.
+constexpr char MAGIC[8] = {'I', 'N', 'K', 'R', 'C', '0', '0', '1'};
+
+struct Header
+{
+    char magic[8];
+    std::int32_t width;
+    std::int32_t height;
+};
+
+} // namespace
+
+DrawingDiskCache::DrawingDiskCache(std::string dir, std::uintmax_t max_bytes)
+    : _dir(std::move(dir))
+    , _max_bytes(max_bytes)
+{
+    boost::system::error_code ec;
+    fs::create_directories(_dir, ec);
+    _trim();
+}
+
+std::shared_ptr<DrawingDiskCache> DrawingDiskCache::get()
+{
+    auto const size = Preferences::get()->getIntLimited("/options/renderingcache/disksize", 0, 0, 1 << 20);
+    if (size == 0) {
+        return nullptr;
+    }
+
+    // Opened once per session, since trimming has to scan the whole directory.
+    static auto const cache = std::make_shared<DrawingDiskCache>(
+        IO::Resource::get_path_string(IO::Resource::CACHE, IO::Resource::NONE, "render"),
+        std::uintmax_t(size) << 20);
+    return cache;
+}
+
+std::string DrawingDiskCache::_path(std::string const &key) const
+{
+    return (fs::path(_dir) / key).string();
+}
+
+bool DrawingDiskCache::load(std::string const &key, cairo_surface_t *surface) const
+{
+    auto const path = _path(key);
+    std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+    if (!file) {
+        return false;
+    }
+
+    int const width = cairo_image_surface_get_width(surface);
+    int const height = cairo_image_surface_get_height(surface);
+    Header header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.width != width || header.height != height)
+    {
+        return false;
+    }
+
+    cairo_surface_flush(surface);
+    auto const data = cairo_image_surface_get_data(surface);
+    int const stride = cairo_image_surface_get_stride(surface);
+    for (int y = 0; y < height; y++) {
+        if (!file.read(reinterpret_cast<char *>(data + y * stride), 4 * width)) {
+            return false;
+        }
+    }
+    cairo_surface_mark_dirty(surface);
+
+    // Record the use, so that trimming removes the least recently used entries first.
+    boost::system::error_code ec;
+    fs::last_write_time(path, std::time(nullptr), ec);
+
+    return true;
+}
+
+void DrawingDiskCache::store(std::string const &key, cairo_surface_t *surface) const
+{
+    auto const path = _path(key);
+    auto const tmp = path + ".tmp" + std::to_string(g_random_int());
+
+    int const width = cairo_image_surface_get_width(surface);
+    int const height = cairo_image_surface_get_height(surface);
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.width = width;
+    header.height = height;
+
+    cairo_surface_flush(surface);
+    auto const data = cairo_image_surface_get_data(surface);
+    int const stride = cairo_image_surface_get_stride(surface);
+
+    bool ok;
+    {
+        std::ofstream file(tmp, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        for (int y = 0; y < height; y++) {
+            file.write(reinterpret_cast<char const *>(data + y * stride), 4 * width);
+        }
+        file.close();
+        ok = !file.fail();
+    }
+
+    boost::system::error_code ec;
+    if (ok) {
+        fs::rename(tmp, path, ec);
+    }
+    if (!ok || ec) {
+        fs::remove(tmp, ec);
+        return;
+    }
+
+    // A long-running process such as the render server keeps storing, so keep to the size here
+    // too. Replaced entries are counted twice, which at worst trims a little early.
+    auto const size = sizeof(header) + std::uintmax_t(4) * width * height;
+    if (_total.fetch_add(size) + size > _max_bytes) {
+        _trim();
+    }
+}
+
+void DrawingDiskCache::_trim() const
+{
+    std::unique_lock lock(_trim_mutex, std::try_to_lock);
+    if (!lock) {
+        return; // Another thread is already trimming.
+    }
+
+    boost::system::error_code ec;
+    std::vector<std::tuple<std::time_t, std::uintmax_t, fs::path>> entries;
+    std::uintmax_t total = 0;
+
+    for (fs::directory_iterator it(_dir, ec), end; !ec && it != end; it.increment(ec)) {
+        auto const &path = it->path();
+        boost::system::error_code file_ec;
+        auto const size = fs::file_size(path, file_ec);
+        auto const time = fs::last_write_time(path, file_ec);
+        if (file_ec) {
+            continue;
+        }
+        entries.emplace_back(time, size, path);
+        total += size;
+    }
+
+    if (total <= _max_bytes) {
+        _total = total;
+        return;
+    }
+
+    // Remove the least recently used entries, including any temporaries left behind by a crash.
+    // Go some way below the limit, so that the next few stores do not rescan the directory.
+    auto const target = _max_bytes - _max_bytes / 8;
+    std::sort(entries.begin(), entries.end());
+    for (auto const &[time, size, path] : entries) {
+        if (total <= target) {
+            break;
+        }
+        if (fs::remove(path, ec)) {
+            total -= size;
+        }
+    }
+    _total = total;
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
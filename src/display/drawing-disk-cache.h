@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Persistent on-disk cache of rendered drawing items.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_DISK_CACHE_H
+#define SEEN_INKSCAPE_DISPLAY_DRAWING_DISK_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+extern "C" {
+typedef struct _cairo_surface cairo_surface_t;
+}
+
+namespace Inkscape {
+
+/**
+ * Content-addressed store of finished item renderings, shared between documents and sessions.
+ *
+ * Entries are named by a hash of everything that affects the rendering of an item (see
+ * DrawingItem::setContentKey()) and hold its premultiplied ARGB32 pixels. Entries are written
+ * under a temporary name and then renamed, so several processes can safely share a directory.
+ * The least recently used entries are removed when the cache is opened, and whenever the entries
+ * stored since push it over its size.
+ *
+ * All failures are silent; a cache that cannot be read or written simply never hits.
+ */
+class DrawingDiskCache
+{
+public:
+    /// Open the cache in dir, creating the directory if needed and trimming it to max_bytes.
+    DrawingDiskCache(std::string dir, std::uintmax_t max_bytes);
+
+    /**
+     * The cache in the user cache directory, or null if disabled. Its size is set by the
+     * preference /options/renderingcache/disksize, in MiB.
+     */
+    static std::shared_ptr<DrawingDiskCache> get();
+
+    /**
+     * Fill the ARGB32 image surface with the entry stored under key. Returns false, leaving the
+     * surface contents unspecified, if there is no entry of the same pixel size.
+     */
+    bool load(std::string const &key, cairo_surface_t *surface) const;
+
+    /// Store the contents of the ARGB32 image surface under key.
+    void store(std::string const &key, cairo_surface_t *surface) const;
+
+private:
+    std::string _path(std::string const &key) const;
+    void _trim() const;
+
+    std::string _dir;
+    std::uintmax_t _max_bytes;
+    mutable std::atomic<std::uintmax_t> _total{0}; ///< Size of the directory, as far as known.
+    mutable std::mutex _trim_mutex;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_DRAWING_DISK_CACHE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
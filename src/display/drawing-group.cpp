@@ -10,6 +10,10 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
 #include "drawing-group.h"
 #include "cairo-utils.h"
 #include "drawing-context.h"
@@ -20,9 +24,263 @@
 
 namespace Inkscape {
 
+namespace {
+
+// Groups with fewer children are searched linearly.
+constexpr std::size_t INDEX_MIN_CHILDREN = 32;
+
+// Maximum number of children in a leaf of the index.
+constexpr int INDEX_LEAF_SIZE = 4;
+
+// Whether a box reaches the edge of a union it is part of, so that the union may shrink without it.
+bool touches_edge(Geom::OptIntRect const &box, Geom::OptIntRect const &bounds)
+{
+    if (!box || !bounds) {
+        return false;
+    }
+    return box->left() <= bounds->left() || box->top() <= bounds->top()
+        || box->right() >= bounds->right() || box->bottom() >= bounds->bottom();
+}
+
+// The area that a child must cover to be picked or rendered, under any flags.
+Geom::OptIntRect index_box(DrawingItem const &item)
+{
+    auto box = item.bbox();
+    box.unionWith(item.drawbox());
+    return box;
+}
+
+} // namespace
+
+/**
+ * Bounding volume hierarchy over the children of a group, so that rendering and picking only
+ * visit the children close to the area of interest, in Z order.
+ *
+ * The tree is built top-down, splitting at the median along the longer side. Children whose
+ * boxes change have the boxes along their path to the root refitted. The index is rebuilt when
+ * children are added, removed or reordered, or once many children have moved, since refitting
+ * gradually makes the tree less selective.
+ */
+class DrawingGroup::ChildIndex
+{
+public:
+    explicit ChildIndex(DrawingItem::ChildrenList &children);
+
+    /// Take the new boxes of the children into account. Returns false if a rebuild is needed.
+    bool refit();
+    /// Like refit(), when only the given children can have changed.
+    bool refit(std::vector<DrawingItem *> const &changed);
+
+    /**
+     * Call f on the children whose boxes intersect area, in Z order, until it returns true.
+     * Returns whether f returned true.
+     */
+    template <typename F>
+    bool query(Geom::IntRect const &area, F &&f) const;
+
+private:
+    struct Node
+    {
+        Geom::OptIntRect box;
+        int parent;
+        int left = -1; ///< Inner nodes only.
+        int right = -1;
+        int begin; ///< Leaves only: range in _order.
+        int end;
+    };
+
+    int _build(int begin, int end, int parent);
+    void _refitNode(Node &node);
+    bool _refitChild(int i);
+
+    std::vector<DrawingItem *> _items;  ///< Children in Z order.
+    std::unordered_map<DrawingItem const *, int> _positions; ///< Index of each child in _items.
+    std::vector<Geom::OptIntRect> _boxes; ///< Indexed boxes of the children.
+    std::vector<int> _leaf; ///< Leaf holding each child, or -1 if it had no box.
+    std::vector<int> _order; ///< Children with boxes, grouped by leaf.
+    std::vector<Node> _nodes; ///< Root first.
+    std::size_t _moved = 0;
+};
+
+DrawingGroup::ChildIndex::ChildIndex(DrawingItem::ChildrenList &children)
+{
+    _items.reserve(children.size());
+    for (auto &i : children) {
+        _positions.emplace(&i, _items.size());
+        _items.push_back(&i);
+    }
+
+    int const n = _items.size();
+    _boxes.resize(n);
+    _leaf.assign(n, -1);
+    for (int i = 0; i < n; i++) {
+        _boxes[i] = index_box(*_items[i]);
+        if (_boxes[i]) {
+            _order.push_back(i);
+        }
+    }
+
+    if (!_order.empty()) {
+        _nodes.reserve(2 * _order.size() / INDEX_LEAF_SIZE + 1);
+        _build(0, _order.size(), -1);
+    }
+}
+
+int DrawingGroup::ChildIndex::_build(int begin, int end, int parent)
+{
+    int const index = _nodes.size();
+    _nodes.push_back({{}, parent, -1, -1, begin, end});
+
+    if (end - begin <= INDEX_LEAF_SIZE) {
+        for (int k = begin; k < end; k++) {
+            _leaf[_order[k]] = index;
+        }
+        _refitNode(_nodes[index]);
+        return index;
+    }
+
+    // Split at the median of the box centres along the longer side of their bounds.
+    auto centre = [this] (int i, Geom::Dim2 d) {
+        return (double)_boxes[i]->min()[d] + _boxes[i]->max()[d];
+    };
+    double lo[2] = {centre(_order[begin], Geom::X), centre(_order[begin], Geom::Y)};
+    double hi[2] = {lo[0], lo[1]};
+    for (int k = begin + 1; k < end; k++) {
+        for (auto d : {Geom::X, Geom::Y}) {
+            lo[d] = std::min(lo[d], centre(_order[k], d));
+            hi[d] = std::max(hi[d], centre(_order[k], d));
+        }
+    }
+    auto const axis = hi[Geom::X] - lo[Geom::X] >= hi[Geom::Y] - lo[Geom::Y] ? Geom::X : Geom::Y;
+
+    int const mid = begin + (end - begin) / 2;
+    std::nth_element(_order.begin() + begin, _order.begin() + mid, _order.begin() + end, [&] (int a, int b) {
+        return centre(a, axis) < centre(b, axis);
+    });
+
+    int const left = _build(begin, mid, index);
+    int const right = _build(mid, end, index);
+    _nodes[index].left = left;
+    _nodes[index].right = right;
+    _refitNode(_nodes[index]);
+    return index;
+}
+
+void DrawingGroup::ChildIndex::_refitNode(Node &node)
+{
+    node.box = Geom::OptIntRect();
+    if (node.left < 0) {
+        for (int k = node.begin; k < node.end; k++) {
+            node.box.unionWith(_boxes[_order[k]]);
+        }
+    } else {
+        node.box.unionWith(_nodes[node.left].box);
+        node.box.unionWith(_nodes[node.right].box);
+    }
+}
+
+bool DrawingGroup::ChildIndex::_refitChild(int i)
+{
+    auto const box = index_box(*_items[i]);
+    if (box == _boxes[i]) {
+        return true;
+    }
+    if (_leaf[i] < 0 || ++_moved > _items.size() / 4) {
+        return false;
+    }
+
+    _boxes[i] = box;
+    for (int n = _leaf[i]; n >= 0; n = _nodes[n].parent) {
+        auto const old_box = _nodes[n].box;
+        _refitNode(_nodes[n]);
+        if (_nodes[n].box == old_box) {
+            break; // Ancestors are unaffected.
+        }
+    }
+    return true;
+}
+
+bool DrawingGroup::ChildIndex::refit()
+{
+    for (std::size_t i = 0; i < _items.size(); i++) {
+        if (!_refitChild(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DrawingGroup::ChildIndex::refit(std::vector<DrawingItem *> const &changed)
+{
+    for (auto item : changed) {
+        auto it = _positions.find(item);
+        if (it == _positions.end() || !_refitChild(it->second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename F>
+bool DrawingGroup::ChildIndex::query(Geom::IntRect const &area, F &&f) const
+{
+    if (_nodes.empty()) {
+        return false;
+    }
+
+    std::vector<int> found;
+    std::vector<int> stack{0};
+    while (!stack.empty()) {
+        auto const &node = _nodes[stack.back()];
+        stack.pop_back();
+        if (!node.box || !node.box->intersects(area)) {
+            continue;
+        }
+        if (node.left < 0) {
+            for (int k = node.begin; k < node.end; k++) {
+                int const i = _order[k];
+                if (_boxes[i] && _boxes[i]->intersects(area)) {
+                    found.push_back(i);
+                }
+            }
+        } else {
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    for (int i : found) {
+        if (f(*_items[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
 DrawingGroup::DrawingGroup(Drawing &drawing)
     : DrawingItem(drawing) {}
 
+DrawingGroup::~DrawingGroup() = default;
+
+/**
+ * Call f on the children that may intersect area, in Z order, until it returns true.
+ * Returns whether f returned true.
+ */
+template <typename F>
+bool DrawingGroup::_forChildrenIn(Geom::IntRect const &area, F &&f)
+{
+    if (_child_index) {
+        return _child_index->query(area, std::forward<F>(f));
+    }
+    for (auto &i : _children) {
+        if (f(i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * Set whether the group returns children from pick calls.
  * Previously this feature was called "transparent groups".
@@ -59,15 +317,61 @@ unsigned DrawingGroup::_updateItem(Geom::IntRect const &area, UpdateContext cons
     if (_child_transform) {
         child_ctx.ctm = *_child_transform * ctx.ctm;
     }
-    for (auto &i : _children) {
-        i.update(area, child_ctx, flags, reset);
+
+    auto const child_box = [outline] (DrawingItem const &i) { return outline ? i.bbox() : i.drawbox(); };
+    auto const recompute_box = [&] {
+        _children_box = Geom::OptIntRect();
+        for (auto &i : _children) {
+            if (i.visible()) {
+                _children_box.unionWith(child_box(i));
+            }
+        }
+        _children_box_outline = outline;
+        _children_box_stale = false;
+    };
+
+    auto dirty = _takeDirtyChildren();
+    bool const visit_all = reset || outline != _children_box_outline;
+
+    if (visit_all) {
+        // The reset has to reach every child.
+        for (auto &i : _children) {
+            i.update(area, child_ctx, flags, reset);
+            _listDirtyChild(i);
+        }
+        recompute_box();
+    } else {
+        // Only the children marked for update can have changed. If none of them reached the
+        // edge of the union of boxes, the union can only grow.
+        bool may_shrink = _children_box_stale;
+        for (auto i : dirty) {
+            may_shrink = may_shrink || touches_edge(child_box(*i), _children_box);
+        }
+        for (auto i : dirty) {
+            i->update(area, child_ctx, flags, reset);
+            _listDirtyChild(*i);
+        }
+        if (may_shrink) {
+            recompute_box();
+        } else {
+            for (auto i : dirty) {
+                if (i->visible()) {
+                    _children_box.unionWith(child_box(*i));
+                }
+            }
+        }
     }
-    _bbox = Geom::OptIntRect();
-    for (auto &i : _children) {
-        if (i.visible()) {
-            _bbox.unionWith(outline ? i.bbox() : i.drawbox());
+    _bbox = _children_box;
+
+    if (_index_children && _children.size() >= INDEX_MIN_CHILDREN) {
+        bool const refitted = _child_index && (visit_all ? _child_index->refit() : _child_index->refit(dirty));
+        if (!refitted) {
+            _child_index = std::make_unique<ChildIndex>(_children);
         }
+    } else {
+        _child_index.reset();
     }
+
     return STATE_ALL;
 }
 
@@ -75,9 +379,10 @@ unsigned DrawingGroup::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::
 {
     if (stop_at == nullptr) {
         // normal rendering
-        for (auto &i : _children) {
+        _forChildrenIn(area, [&] (DrawingItem &i) {
             i.render(dc, rc, area, flags, stop_at);
-        }
+            return false;
+        });
     } else {
         // background rendering
         for (auto &i : _children) {
@@ -97,18 +402,24 @@ unsigned DrawingGroup::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::
 
 void DrawingGroup::_clipItem(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area)
 {
-    for (auto &i : _children) {
+    _forChildrenIn(area, [&] (DrawingItem &i) {
         i.clip(dc, rc, area);
-    }
+        return false;
+    });
 }
 
 DrawingItem *DrawingGroup::_pickItem(Geom::Point const &p, double delta, unsigned flags)
 {
-    for (auto &i : _children) {
-        DrawingItem *picked = i.pick(p, delta, flags);
-        if (picked) {
-            return _pick_children ? picked : this;
-        }
+    Geom::Rect area(p, p);
+    area.expandBy(delta);
+
+    DrawingItem *picked = nullptr;
+    _forChildrenIn(area.roundOutwards(), [&] (DrawingItem &i) {
+        picked = i.pick(p, delta, flags);
+        return picked != nullptr;
+    });
+    if (picked) {
+        return _pick_children ? picked : this;
     }
     return nullptr;
 }
@@ -118,6 +429,12 @@ bool DrawingGroup::_canClip()
     return true;
 }
 
+void DrawingGroup::_childrenChanged()
+{
+    _child_index.reset();
+    _children_box_stale = true;
+}
+
 } // namespace Inkscape
 
 /*
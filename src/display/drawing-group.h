@@ -29,7 +29,7 @@ public:
     void setChildTransform(Geom::Affine const &);
 
 protected:
-    ~DrawingGroup() override = default;
+    ~DrawingGroup() override;
 
     unsigned _updateItem(Geom::IntRect const &area, UpdateContext const &ctx,
                                  unsigned flags, unsigned reset) override;
@@ -38,8 +38,24 @@ protected:
     void _clipItem(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area) override;
     DrawingItem *_pickItem(Geom::Point const &p, double delta, unsigned flags) override;
     bool _canClip() override;
+    void _childrenChanged() override;
 
     std::unique_ptr<Geom::Affine> _child_transform;
+
+    /// Whether large numbers of children are indexed by their bounding boxes. Must be turned
+    /// off by subclasses whose children are picked by anything else than their boxes.
+    bool _index_children = true;
+
+private:
+    class ChildIndex;
+    std::unique_ptr<ChildIndex> _child_index; ///< Null if not in use or out of date.
+
+    Geom::OptIntRect _children_box; ///< Union of the boxes of the visible children.
+    bool _children_box_outline = false; ///< Whether _children_box is made of outline boxes.
+    bool _children_box_stale = true; ///< Whether children were removed since _children_box was computed.
+
+    template <typename F>
+    bool _forChildrenIn(Geom::IntRect const &area, F &&f);
 };
 
 } // namespace Inkscape
@@ -10,6 +10,8 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <2geom/bezier-curve.h>
 
 #include "drawing.h"
@@ -20,15 +22,68 @@
 
 namespace Inkscape {
 
+namespace {
+
+/**
+ * Halve an ARGB32 surface in both dimensions by averaging blocks of 2x2 pixels, which is exact
+ * for premultiplied colors. Odd sizes are rounded up by repeating the last row or column.
+ */
+Cairo::RefPtr<Cairo::ImageSurface> halve(cairo_surface_t *src)
+{
+    int const sw = cairo_image_surface_get_width(src);
+    int const sh = cairo_image_surface_get_height(src);
+    int const sstride = cairo_image_surface_get_stride(src);
+    auto const sdata = cairo_image_surface_get_data(src);
+
+    auto dst = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, (sw + 1) / 2, (sh + 1) / 2);
+    int const w = dst->get_width();
+    int const h = dst->get_height();
+    int const stride = dst->get_stride();
+    auto const data = dst->get_data();
+
+    ink_cairo_parallel_for(0, h, w * h, [&] (int y) {
+        auto const row0 = reinterpret_cast<guint32 const *>(sdata + 2 * y * sstride);
+        auto const row1 = reinterpret_cast<guint32 const *>(sdata + std::min(2 * y + 1, sh - 1) * sstride);
+        auto const out = reinterpret_cast<guint32 *>(data + y * stride);
+        for (int x = 0; x < w; x++) {
+            int const x0 = 2 * x;
+            int const x1 = std::min(x0 + 1, sw - 1);
+            guint32 const p[4] = {row0[x0], row0[x1], row1[x0], row1[x1]};
+            // Average two channels at a time; the sums of four bytes fit into 16-bit lanes.
+            guint32 rb = 0x00020002, ag = 0x00020002;
+            for (auto px : p) {
+                rb += px & 0x00ff00ff;
+                ag += (px >> 8) & 0x00ff00ff;
+            }
+            out[x] = ((rb >> 2) & 0x00ff00ff) | (((ag >> 2) & 0x00ff00ff) << 8);
+        }
+    });
+
+    dst->mark_dirty();
+    return dst;
+}
+
+} // namespace
+
 DrawingImage::DrawingImage(Drawing &drawing)
     : DrawingItem(drawing)
     , style_image_rendering(SP_CSS_IMAGE_RENDERING_AUTO)
 {
 }
 
+DrawingImage::~DrawingImage()
+{
+    auto lock = std::lock_guard(_drawing._mipmap_mutex);
+    _dropMipmaps();
+}
+
 void DrawingImage::setPixbuf(std::shared_ptr<Inkscape::Pixbuf const> pixbuf)
 {
     defer([this, pixbuf = std::move(pixbuf)] () mutable {
+        {
+            auto lock = std::lock_guard(_drawing._mipmap_mutex);
+            _dropMipmaps();
+        }
         _pixbuf = std::move(pixbuf);
         _markForUpdate(STATE_ALL, false);
     });
@@ -116,14 +171,6 @@ unsigned DrawingImage::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::
         dc.rectangle(_clipbox);
         dc.clip();
 
-        dc.translate(_origin);
-        dc.scale(_scale);
-        // const_cast required since Cairo needs to modify the internal refcount variable, but we do not want to give up the
-        // benefits of const for the rest of our code. The underlying object is guaranteed to be non-const, so this is well-defined.
-        // It is also thread-safe to modify the refcount in this way, since Cairo uses atomics internally.
-        dc.setSource(const_cast<cairo_surface_t*>(_pixbuf->getSurfaceRaw()), 0, 0);
-        dc.patternSetExtend(CAIRO_EXTEND_PAD);
-
         // See: http://www.w3.org/TR/SVG/painting.html#ImageRenderingProperty
         //      https://drafts.csswg.org/css-images-3/#the-image-rendering
         //      style.h/style.cpp, cairo-render-context.cpp
@@ -131,21 +178,55 @@ unsigned DrawingImage::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::
         // CSS 3 defines:
         //   'optimizeSpeed' as alias for "pixelated"
         //   'optimizeQuality' as alias for "smooth"
+        bool smooth;
         switch (style_image_rendering) {
             case SP_CSS_IMAGE_RENDERING_OPTIMIZESPEED:
             case SP_CSS_IMAGE_RENDERING_PIXELATED:
             // we don't have an implementation for crisp-edges, but it should *not* smooth or blur
             case SP_CSS_IMAGE_RENDERING_CRISPEDGES:
-                dc.patternSetFilter( CAIRO_FILTER_NEAREST );
+                smooth = false;
                 break;
             case SP_CSS_IMAGE_RENDERING_AUTO:
             case SP_CSS_IMAGE_RENDERING_OPTIMIZEQUALITY:
             default:
-                // In recent Cairo, BEST used Lanczos3, which is prohibitively slow
-                dc.patternSetFilter( CAIRO_FILTER_GOOD );
+                smooth = true;
                 break;
         }
 
+        // const_cast required since Cairo needs to modify the internal refcount variable, but we do not want to give up the
+        // benefits of const for the rest of our code. The underlying object is guaranteed to be non-const, so this is well-defined.
+        // It is also thread-safe to modify the refcount in this way, since Cairo uses atomics internally.
+        auto surface = const_cast<cairo_surface_t*>(_pixbuf->getSurfaceRaw());
+        auto scale = _scale;
+
+        // When zoomed out, sample the smallest mipmap that still has a pixel for every device pixel.
+        Cairo::RefPtr<Cairo::ImageSurface> mipmap;
+        if (smooth) {
+            auto const device = Geom::Affine(_scale) * _ctm * Geom::Scale(dc.surface()->device_scale());
+            auto const expansion = std::max(device.expansionX(), device.expansionY());
+            // Going by the real sizes of the levels, which are rounded.
+            int level = 0;
+            for (int w = _pixbuf->width(), h = _pixbuf->height(); w > 1 || h > 1; level++) {
+                w = (w + 1) / 2;
+                h = (h + 1) / 2;
+                if (w < _pixbuf->width() * expansion || h < _pixbuf->height() * expansion) {
+                    break;
+                }
+            }
+            if (level > 0 && (mipmap = _mipmap(level))) {
+                surface = mipmap->cobj();
+                scale *= Geom::Scale(double(_pixbuf->width()) / mipmap->get_width(),
+                                     double(_pixbuf->height()) / mipmap->get_height());
+            }
+        }
+
+        dc.translate(_origin);
+        dc.scale(scale);
+        dc.setSource(surface, 0, 0);
+        dc.patternSetExtend(CAIRO_EXTEND_PAD);
+        // In recent Cairo, BEST used Lanczos3, which is prohibitively slow
+        dc.patternSetFilter(smooth ? CAIRO_FILTER_GOOD : CAIRO_FILTER_NEAREST);
+
         // Handle an exceptional case where the greyscale color mode needs to be applied per-image.
         bool const greyscale_exception = (flags & RENDER_OUTLINE) && _drawing.colorMode() == ColorMode::GRAYSCALE;
         if (greyscale_exception) {
@@ -193,6 +274,69 @@ unsigned DrawingImage::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::
     return RENDER_OK;
 }
 
+/**
+ * The pixbuf downscaled by 2^level, building the missing levels from the next larger one.
+ * If the levels do not all fit into the cache budget, the smallest one that does is returned,
+ * or null if none does.
+ */
+Cairo::RefPtr<Cairo::ImageSurface> DrawingImage::_mipmap(int level)
+{
+    auto lock = std::unique_lock(_drawing._mipmap_mutex);
+    auto &images = _drawing._mipmap_images;
+
+    while (int(_mipmaps.size()) < level) {
+        // Mark as the most recently used image, so that making room does not drop its levels.
+        if (!_mipmaps.empty()) {
+            images.splice(images.begin(), images, _mipmap_iterator);
+        }
+
+        auto const built = _mipmaps.size();
+        auto const larger = built ? _mipmaps.back() : Cairo::RefPtr<Cairo::ImageSurface>();
+        auto const src = larger ? larger->cobj() : const_cast<cairo_surface_t*>(_pixbuf->getSurfaceRaw());
+        int const w = (cairo_image_surface_get_width(src) + 1) / 2;
+        int const h = (cairo_image_surface_get_height(src) + 1) / 2;
+        auto const bytes = size_t(cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, w)) * h;
+        if (!_drawing._reserveMipmap(bytes, this)) {
+            break;
+        }
+
+        // Halving runs on the thread pool; don't keep other images waiting for the lock meanwhile.
+        lock.unlock();
+        auto smaller = halve(src);
+        lock.lock();
+
+        if (_mipmaps.size() != built) {
+            // Another thread got there first, or the levels were dropped to make room.
+            _drawing._mipmap_bytes -= bytes;
+            continue;
+        }
+        if (_mipmaps.empty()) {
+            images.push_front(this);
+            _mipmap_iterator = images.begin();
+        }
+        _mipmaps.emplace_back(std::move(smaller));
+        _mipmap_bytes += bytes;
+    }
+
+    if (_mipmaps.empty()) {
+        return {};
+    }
+    images.splice(images.begin(), images, _mipmap_iterator);
+    return _mipmaps[std::min<size_t>(level, _mipmaps.size()) - 1];
+}
+
+/// Free the mipmaps. Must be called with Drawing::_mipmap_mutex held.
+void DrawingImage::_dropMipmaps()
+{
+    if (_mipmaps.empty()) {
+        return;
+    }
+    _mipmaps.clear();
+    _drawing._mipmap_bytes -= _mipmap_bytes;
+    _mipmap_bytes = 0;
+    _drawing._mipmap_images.erase(_mipmap_iterator);
+}
+
 /** Calculates the closest distance from p to the segment a1-a2*/
 static double distance_to_segment(Geom::Point const &p, Geom::Point const &a1, Geom::Point const &a2)
 {
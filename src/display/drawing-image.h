@@ -13,10 +13,13 @@
 #ifndef INKSCAPE_DISPLAY_DRAWING_IMAGE_H
 #define INKSCAPE_DISPLAY_DRAWING_IMAGE_H
 
+#include <list>
 #include <memory>
+#include <vector>
 #include <2geom/transforms.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <cairo.h>
+#include <cairomm/surface.h>
 
 #include "display/drawing-item.h"
 
@@ -38,11 +41,13 @@ public:
     Geom::Rect bounds() const;
 
 protected:
-    ~DrawingImage() override = default;
+    ~DrawingImage() override;
 
     unsigned _updateItem(Geom::IntRect const &area, UpdateContext const &ctx, unsigned flags, unsigned reset) override;
     unsigned _renderItem(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags, DrawingItem *stop_at) override;
     DrawingItem *_pickItem(Geom::Point const &p, double delta, unsigned flags) override;
+    Cairo::RefPtr<Cairo::ImageSurface> _mipmap(int level);
+    void _dropMipmaps();
 
     std::shared_ptr<Inkscape::Pixbuf const> _pixbuf;
 
@@ -52,6 +57,14 @@ protected:
     Geom::Rect _clipbox; ///< for preserveAspectRatio
     Geom::Point _origin;
     Geom::Scale _scale;
+
+    // Downscaled copies of the pixbuf, each half the size of the previous one, built on demand.
+    // Guarded by Drawing::_mipmap_mutex, since they are built during rendering.
+    std::vector<Cairo::RefPtr<Cairo::ImageSurface>> _mipmaps;
+    size_t _mipmap_bytes = 0;
+    std::list<DrawingImage*>::iterator _mipmap_iterator; ///< Valid if _mipmaps is not empty.
+
+    friend class Drawing;
 };
 
 } // namespace Inkscape
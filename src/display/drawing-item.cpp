@@ -10,12 +10,18 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
 #include <climits>
+#include <iomanip>
+#include <sstream>
+#include <glibmm/checksum.h>
 
 #include "display/drawing-context.h"
+#include "display/drawing-disk-cache.h"
 #include "display/drawing-group.h"
 #include "display/drawing-item.h"
 #include "display/drawing-pattern.h"
+#include "display/drawing-profile.h"
 #include "display/drawing-surface.h"
 #include "display/drawing-text.h"
 #include "display/drawing.h"
@@ -81,6 +87,7 @@ DrawingItem::DrawingItem(Drawing &drawing)
     , _cached_persistent(0)
     , _has_cache_iterator(0)
     , _propagate(0)
+    , _dirty_listed(0)
     , _pick_children(0)
     , _antialias(2)
     , _prev_nir(false)
@@ -108,6 +115,11 @@ DrawingItem::~DrawingItem()
     // Remove from the set of cached items and delete cache.
     _setCached(false, true);
 
+    if (auto profile = _drawing.profile()) {
+        profile->forget(this);
+    }
+
+    _dirty_children.clear();
     _children.clear_and_dispose([] (auto c) { delete c; });
     delete _clip;
     delete _mask;
@@ -140,6 +152,7 @@ void DrawingItem::appendChild(DrawingItem *item)
 
     defer([=] {
         _children.push_back(*item);
+        _childrenChanged();
 
         // This ensures that _markForUpdate() called on the child will recurse to this item
         item->_state = STATE_ALL;
@@ -160,6 +173,7 @@ void DrawingItem::prependChild(DrawingItem *item)
 
     defer([=] {
         _children.push_front(*item);
+        _childrenChanged();
         item->_state = STATE_ALL;
         item->_markForUpdate(STATE_ALL, true);
     });
@@ -171,7 +185,9 @@ void DrawingItem::clearChildren()
     defer([=] {
         if (_children.empty()) return;
         _markForRendering();
+        _dirty_children.clear();
         _children.clear_and_dispose([] (auto c) { delete c; });
+        _childrenChanged();
         _markForUpdate(STATE_ALL, false);
     });
 }
@@ -231,6 +247,8 @@ void DrawingItem::setVisible(bool visible)
         if (visible == _visible) return;
         _visible = visible;
         _markForRendering();
+        // The bounding box of the parent depends on which children are visible.
+        _markForUpdate(STATE_BBOX, false);
     });
 }
 
@@ -406,6 +424,7 @@ void DrawingItem::setZOrder(unsigned zorder)
         auto it2 = _parent->_children.begin();
         std::advance(it2, std::min<unsigned>(zorder, _parent->_children.size()));
         _parent->_children.insert(it2, *this);
+        _parent->_childrenChanged();
         _markForRendering();
     });
 }
@@ -425,6 +444,18 @@ void DrawingItem::setFilterRenderer(std::unique_ptr<Filters::Filter> filter)
     });
 }
 
+/**
+ * Set the hash of everything in the object tree that determines how this item renders in its
+ * own coordinate system. Together with the transform and render settings, this names the
+ * item's rendering in the drawing's disk cache. An empty key disables the disk cache.
+ */
+void DrawingItem::setContentKey(std::string key)
+{
+    defer([=, key = std::move(key)] () mutable {
+        _content_key = std::move(key);
+    });
+}
+
 /**
  * Update derived data before operations.
  * The purpose of this call is to recompute internal data which depends
@@ -449,6 +480,8 @@ void DrawingItem::setFilterRenderer(std::unique_ptr<Filters::Filter> filter)
  */
 void DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, unsigned flags, unsigned reset)
 {
+    _drawing._update_visits++;
+
     // We don't need to update what is not visible
     if (!visible()) {
         _state = STATE_ALL; // Touch the state for future change to this item
@@ -639,7 +672,8 @@ struct MaskLuminanceToAlpha
 unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags, DrawingItem *stop_at)
 {
     bool outline = flags & RENDER_OUTLINE;
-    bool render_filters = !(flags & RENDER_NO_FILTERS);
+    bool draft = flags & RENDER_DRAFT;
+    bool render_filters = !(flags & (RENDER_NO_FILTERS | RENDER_DRAFT));
     bool forcecache = _filter && render_filters;
 
     // stop_at is handled in DrawingGroup, but this check is required to handle the case
@@ -668,6 +702,8 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
         return RENDER_OK;
     }
 
+    DrawingProfile::Scope profile(_drawing.profile(), *this);
+
     Geom::OptIntRect iarea = carea;
     // expand carea to contain the dependent area of filters.
     if (forcecache) {
@@ -689,10 +725,24 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
 
     // Device scale for HiDPI screens (typically 1 or 2)
     int device_scale = dc.surface()->device_scale();
+    profile.addPixels(*carea, device_scale);
 
     // Render from cache if possible
     // Bypass in case of pattern, see below.
-    if (_cached && !(flags & RENDER_BYPASS_CACHE)) {
+    // Drafts only use a cache that is clean over the whole area, and leave it untouched otherwise,
+    // as they would fill it with content lacking filters.
+    if (draft) {
+        if (_cached && _cache && _cache->device_scale() == device_scale && !(flags & RENDER_BYPASS_CACHE)) {
+            _cache->prepare();
+            if (_cache->isClean(*carea)) {
+                dc.setOperator(ink_css_blend_to_cairo_operator(_blend_mode));
+                _cache->paintFromCache(dc, carea, false);
+                profile.cacheHit();
+                dc.setSource(0, 0, 0, 0);
+                return RENDER_OK;
+            }
+        }
+    } else if (_cached && !(flags & RENDER_BYPASS_CACHE)) {
         if (_cache && _cache->device_scale() != device_scale) {
             _cache.reset();
         }
@@ -702,6 +752,7 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
             dc.setOperator(ink_css_blend_to_cairo_operator(_blend_mode));
             _cache->paintFromCache(dc, carea, forcecache);
             if (!carea) {
+                profile.cacheHit();
                 dc.setSource(0, 0, 0, 0);
                 return RENDER_OK;
             }
@@ -727,11 +778,17 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
         || _blend_mode != SP_CSS_BLEND_NORMAL     // 5. it has blend mode
         || _isolation == SP_CSS_ISOLATION_ISOLATE // 6. it is isolated
         || _child_type == ChildType::ROOT;        // 7. is root, need isolation from background
-    if (_prev_nir && !needs_intermediate_rendering) {
-        _setCached(false, true);
+    if (draft) {
+        if (_filter && !(flags & RENDER_NO_FILTERS)) {
+            rc.draft_incomplete = true;
+        }
+    } else {
+        if (_prev_nir && !needs_intermediate_rendering) {
+            _setCached(false, true);
+        }
+        _prev_nir = needs_intermediate_rendering;
+        needs_intermediate_rendering |= !!_cache; // 8. it is to be cached
     }
-    _prev_nir = needs_intermediate_rendering;
-    needs_intermediate_rendering |= !!_cache;     // 8. it is to be cached
 
     /* How the rendering is done.
      *
@@ -771,77 +828,87 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
 
     unsigned render_result = RENDER_OK;
 
-    // 1. Render clipping path with alpha = opacity.
-    ict.setSource(0,0,0,_opacity);
-    // Since clip can be combined with opacity, the result could be incorrect
-    // for overlapping clip children. To fix this we use the SOURCE operator
-    // instead of the default OVER.
-    ict.setOperator(CAIRO_OPERATOR_SOURCE);
-    ict.paint();
-    if (_clip) {
-        ict.pushGroup();
-        _clip->clip(ict, rc, *carea);
-        ict.popGroupToSource();
-        ict.setOperator(CAIRO_OPERATOR_IN);
+    // 0. Look for a finished rendering in the disk cache, and skip steps 1-5 if there is one.
+    auto const disk_key = _diskCacheKey(dc, *carea, flags, stop_at);
+    if (disk_key.empty() || !_drawing.diskCache()->load(disk_key, intermediate.raw())) {
+        // 1. Render clipping path with alpha = opacity.
+        ict.setSource(0,0,0,_opacity);
+        // Since clip can be combined with opacity, the result could be incorrect
+        // for overlapping clip children. To fix this we use the SOURCE operator
+        // instead of the default OVER.
+        ict.setOperator(CAIRO_OPERATOR_SOURCE);
         ict.paint();
-    }
-    ict.setOperator(CAIRO_OPERATOR_OVER); // reset back to default
+        if (_clip) {
+            ict.pushGroup();
+            _clip->clip(ict, rc, *carea);
+            ict.popGroupToSource();
+            ict.setOperator(CAIRO_OPERATOR_IN);
+            ict.paint();
+        }
+        ict.setOperator(CAIRO_OPERATOR_OVER); // reset back to default
 
-    // 2. Render the mask if present and compose it with the clipping path + opacity.
-    if (_mask) {
+        // 2. Render the mask if present and compose it with the clipping path + opacity.
+        if (_mask) {
+            ict.pushGroup();
+            _mask->render(ict, rc, *carea, flags);
+
+            cairo_surface_t *mask_s = ict.rawTarget();
+            // Convert mask's luminance to alpha
+            ink_cairo_surface_filter(mask_s, mask_s, MaskLuminanceToAlpha());
+            ict.popGroupToSource();
+            ict.setOperator(CAIRO_OPERATOR_IN);
+            ict.paint();
+            ict.setOperator(CAIRO_OPERATOR_OVER);
+        }
+
+        // 3. Render object itself
         ict.pushGroup();
-        _mask->render(ict, rc, *carea, flags);
+        render_result = _renderItem(ict, rc, *carea, flags, stop_at);
+
+        // 4. Apply filter.
+        if (_filter && render_filters) {
+            profile.startFilter();
+            bool rendered = false;
+            if (_filter->uses_background() && _background_accumulate) {
+                DrawingItem *bg_root = this;
+                for (; bg_root; bg_root = bg_root->_parent) {
+                    if (bg_root->_background_new) break;
+                }
+                if (bg_root) {
+                    DrawingSurface bg(*carea, device_scale);
+                    DrawingContext bgdc(bg);
+                    bg_root->render(bgdc, rc, *carea, flags | RENDER_FILTER_BACKGROUND, this);
+                    _filter->render(this, ict, &bgdc, rc);
+                    rendered = true;
+                }
+            }
+            if (!rendered) {
+                _filter->render(this, ict, nullptr, rc);
+            }
+            profile.finishFilter();
+            // Note that because the object was rendered to a group,
+            // the internals of the filter need to use cairo_get_group_target()
+            // instead of cairo_get_target().
+        }
+
+        // 4b. Apply greyscale rendering mode, if root node.
+        bool const greyscale = _drawing.colorMode() == ColorMode::GRAYSCALE && !(flags & RENDER_OUTLINE);
+        if (greyscale && _child_type == ChildType::ROOT) {
+            ink_cairo_surface_filter(ict.rawTarget(), ict.rawTarget(), _drawing.grayscaleMatrix());
+        }
 
-        cairo_surface_t *mask_s = ict.rawTarget();
-        // Convert mask's luminance to alpha
-        ink_cairo_surface_filter(mask_s, mask_s, MaskLuminanceToAlpha());
+        // 5. Render object inside the composited mask + clip
         ict.popGroupToSource();
         ict.setOperator(CAIRO_OPERATOR_IN);
         ict.paint();
-        ict.setOperator(CAIRO_OPERATOR_OVER);
-    }
 
-    // 3. Render object itself
-    ict.pushGroup();
-    render_result = _renderItem(ict, rc, *carea, flags, stop_at);
-
-    // 4. Apply filter.
-    if (_filter && render_filters) {
-        bool rendered = false;
-        if (_filter->uses_background() && _background_accumulate) {
-            DrawingItem *bg_root = this;
-            for (; bg_root; bg_root = bg_root->_parent) {
-                if (bg_root->_background_new) break;
-            }
-            if (bg_root) {
-                DrawingSurface bg(*carea, device_scale);
-                DrawingContext bgdc(bg);
-                bg_root->render(bgdc, rc, *carea, flags | RENDER_FILTER_BACKGROUND, this);
-                _filter->render(this, ict, &bgdc, rc);
-                rendered = true;
-            }
-        }
-        if (!rendered) {
-            _filter->render(this, ict, nullptr, rc);
+        if (!disk_key.empty() && render_result == RENDER_OK) {
+            _drawing.diskCache()->store(disk_key, intermediate.raw());
         }
-        // Note that because the object was rendered to a group,
-        // the internals of the filter need to use cairo_get_group_target()
-        // instead of cairo_get_target().
-    }
-
-    // 4b. Apply greyscale rendering mode, if root node.
-    bool const greyscale = _drawing.colorMode() == ColorMode::GRAYSCALE && !(flags & RENDER_OUTLINE);
-    if (greyscale && _child_type == ChildType::ROOT) {
-        ink_cairo_surface_filter(ict.rawTarget(), ict.rawTarget(), _drawing.grayscaleMatrix());
     }
 
-    // 5. Render object inside the composited mask + clip
-    ict.popGroupToSource();
-    ict.setOperator(CAIRO_OPERATOR_IN);
-    ict.paint();
-
     // 6. Paint the completed rendering onto the base context (or into cache)
-    if (_cached && _cache) {
+    if (_cached && _cache && !draft) {
         DrawingContext cachect(*_cache);
         cachect.rectangle(*carea);
         cachect.setOperator(CAIRO_OPERATOR_SOURCE);
@@ -1049,6 +1116,8 @@ void DrawingItem::_markForRendering()
         bkg_root->_invalidateFilterBackground(*dirty);
     }
 
+    _drawing._average_cache.invalidate(*dirty);
+
     if (drawing().getCanvasItemDrawing()) {
         Geom::Rect area = *dirty;
         drawing().getCanvasItemDrawing()->get_canvas()->redraw_area(area);
@@ -1085,6 +1154,9 @@ void DrawingItem::_invalidateFilterBackground(Geom::IntRect const &area)
  * of the tree. Without this we would need to unset state bits in all children.
  * With _propagate we do this during the update call, when we have to recurse
  * into children anyway.
+ *
+ * Marked items are also listed in the _dirty_children of their parent, so that
+ * the update call only has to visit the children that changed.
  */
 void DrawingItem::_markForUpdate(unsigned flags, bool propagate)
 {
@@ -1110,6 +1182,29 @@ void DrawingItem::_markForUpdate(unsigned flags, bool propagate)
             }
         }
     }
+
+    _listDirty();
+}
+
+/// Add this item to the _dirty_children of its parent, if it needs an update and is not yet listed.
+void DrawingItem::_listDirty()
+{
+    if (_child_type == ChildType::NORMAL && !_dirty_listed && _needsUpdate()) {
+        _parent->_dirty_children.push_back(this);
+        _dirty_listed = true;
+    }
+}
+
+/// Empty _dirty_children ahead of updating the children, returning its previous contents.
+/// Children still needing an update afterwards have to be listed again with _listDirtyChild().
+std::vector<DrawingItem *> DrawingItem::_takeDirtyChildren()
+{
+    std::vector<DrawingItem *> result;
+    result.swap(_dirty_children);
+    for (auto child : result) {
+        child->_dirty_listed = false;
+    }
+    return result;
 }
 
 /**
@@ -1175,6 +1270,43 @@ Geom::OptIntRect DrawingItem::_cacheRect()
     return r;
 }
 
+/**
+ * Name of the rendering of the given area in the drawing's disk cache, or an empty string if it
+ * should not be looked up there. Only filtered items are worth the disk round trip, and only
+ * if the filter does not read the background, which is not covered by the content key.
+ */
+std::string DrawingItem::_diskCacheKey(DrawingContext &dc, Geom::IntRect const &area, unsigned flags, DrawingItem *stop_at) const
+{
+    if (_content_key.empty() || !_drawing.diskCache() || !_filter || (flags & (RENDER_NO_FILTERS | RENDER_DRAFT)) || stop_at) {
+        return {};
+    }
+    if (_filter->uses_background() && _background_accumulate) {
+        return {};
+    }
+
+    // Shifting by whole pixels does not change the rendering, so strip them from the key to let
+    // copies at different positions share an entry.
+    auto const shift = _ctm.translation().floor();
+    auto const ctm = _ctm * Geom::Translate(-shift);
+    auto const rect = area - shift;
+
+    std::ostringstream params;
+    params << std::setprecision(17) << _content_key;
+    for (int i = 0; i < 6; i++) {
+        params << ' ' << ctm[i];
+    }
+    params << ' ' << rect.left() << ' ' << rect.top() << ' ' << rect.right() << ' ' << rect.bottom()
+           << ' ' << dc.surface()->device_scale()
+           << ' ' << (flags & ~RENDER_BYPASS_CACHE)
+           << ' ' << cairo_get_antialias(dc.raw())
+           << ' ' << _drawing.filterQuality()
+           << ' ' << _drawing.blurQuality()
+           << ' ' << _drawing.useDithering()
+           << ' ' << static_cast<int>(_drawing.colorMode());
+
+    return Glib::Checksum::compute_checksum(Glib::Checksum::CHECKSUM_SHA256, params.str());
+}
+
 void apply_antialias(DrawingContext &dc, int antialias)
 {
     switch (antialias) {
@@ -1206,8 +1338,13 @@ void DrawingItem::unlink()
 
         switch (_child_type) {
             case ChildType::NORMAL: {
+                if (_dirty_listed) {
+                    auto &dirty = _parent->_dirty_children;
+                    dirty.erase(std::find(dirty.begin(), dirty.end(), this));
+                }
                 auto it = _parent->_children.iterator_to(*this);
                 _parent->_children.erase(it);
+                _parent->_childrenChanged();
                 break;
             }
             case ChildType::CLIP:
@@ -16,6 +16,8 @@
 #include <memory>
 #include <list>
 #include <exception>
+#include <string>
+#include <vector>
 
 #include <boost/operators.hpp>
 #include <boost/utility.hpp>
@@ -42,6 +44,7 @@ namespace Filters { class Filter; }
 struct RenderContext
 {
     uint32_t outline_color;
+    bool draft_incomplete = false; ///< Set by draft renders that left out filters.
 };
 
 struct UpdateContext
@@ -76,7 +79,8 @@ public:
         RENDER_FILTER_BACKGROUND = 1 << 2,
         RENDER_OUTLINE           = 1 << 3,
         RENDER_NO_FILTERS        = 1 << 4,
-        RENDER_VISIBLE_HAIRLINES = 1 << 5
+        RENDER_VISIBLE_HAIRLINES = 1 << 5,
+        RENDER_DRAFT             = 1 << 6  // Quick preview: skip filters, and leave caches alone.
     };
     enum StateFlags
     {
@@ -134,6 +138,7 @@ public:
     void setZOrder(unsigned zorder);
     void setItemBounds(Geom::OptRect const &bounds);
     void setFilterRenderer(std::unique_ptr<Filters::Filter> renderer);
+    void setContentKey(std::string key);
 
     void setKey(unsigned key) { _key = key; }
     unsigned key() const { return _key; }
@@ -167,11 +172,16 @@ protected:
     virtual ~DrawingItem(); // Private to prevent deletion of items that are still in use by a snapshot.
     void _renderOutline(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags);
     void _markForUpdate(unsigned state, bool propagate);
+    bool _needsUpdate() const { return _state != STATE_ALL || _propagate_state; }
+    void _listDirty();
+    std::vector<DrawingItem *> _takeDirtyChildren();
+    void _listDirtyChild(DrawingItem &child) { child._listDirty(); }
     void _markForRendering();
     void _invalidateFilterBackground(Geom::IntRect const &area);
     double _cacheScore();
     Geom::OptIntRect _cacheRect();
     void _setCached(bool cached, bool persistent = false);
+    std::string _diskCacheKey(DrawingContext &dc, Geom::IntRect const &area, unsigned flags, DrawingItem *stop_at) const;
     virtual unsigned _updateItem(Geom::IntRect const &area, UpdateContext const &ctx,
                                  unsigned flags, unsigned reset) { return 0; }
     virtual unsigned _renderItem(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags,
@@ -180,6 +190,7 @@ protected:
     virtual DrawingItem *_pickItem(Geom::Point const &p, double delta, unsigned flags) { return nullptr; }
     virtual bool _canClip() { return false; }
     virtual void _dropPatternCache() {}
+    virtual void _childrenChanged() {} ///< Called when children are added, removed or reordered.
 
     Drawing &_drawing;
     DrawingItem *_parent;
@@ -192,6 +203,8 @@ protected:
         boost::intrusive::member_hook<DrawingItem, ListHook, &DrawingItem::_child_hook>
         >;
     ChildrenList _children;
+    std::vector<DrawingItem *> _dirty_children; ///< Children that may need an update. Unless a reset is
+                                                ///  propagated, only these are visited by updates.
 
     // Todo: Try to get rid of all of these variables, moving them into the object tree.
     unsigned _key; ///< Auxiliary key used by the object tree for showing clips/masks/patterns.
@@ -214,6 +227,7 @@ protected:
     DrawingPattern *_stroke_pattern;
     std::unique_ptr<Inkscape::Filters::Filter> _filter;
     std::unique_ptr<DrawingCache> _cache;
+    std::string _content_key; ///< Hash of the object subtree, for lookups in the drawing's disk cache
     bool _prev_nir = false;
 
     CacheList::iterator _cache_iterator;
@@ -234,6 +248,7 @@ protected:
     unsigned _cached_persistent : 1; ///< If set, will always be cached regardless of score
     unsigned _has_cache_iterator : 1; ///< If set, _cache_iterator is valid
     unsigned _propagate : 1; ///< Whether to call update for all children on next update
+    unsigned _dirty_listed : 1; ///< Whether this item is in the _dirty_children of its parent
     unsigned _pick_children : 1; ///< For groups: if true, children are returned from pick(),
                                  ///  otherwise the group is returned
     unsigned _antialias : 2; ///< antialiasing level (NONE/FAST/GOOD(DEFAULT)/BEST)
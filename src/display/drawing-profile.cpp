@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Per-object render statistics of drawings.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "display/drawing-profile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ostream>
+
+#include "debug/logger.h"
+#include "debug/simple-event.h"
+#include "display/drawing-item.h"
+#include "object/sp-item.h"
+#include "xml/node.h"
+
+namespace Inkscape {
+namespace {
+
+// Time spent rendering the children of the innermost item being rendered on this thread.
+thread_local double children_time = 0;
+
+std::shared_ptr<DrawingProfile> active_profile;
+
+std::string object_id(DrawingItem const &item)
+{
+    auto const object = item.getItem();
+    if (!object) {
+        return "<anonymous>";
+    }
+    if (auto const id = object->getId()) {
+        return id;
+    }
+    if (auto const repr = object->getRepr()) {
+        return std::string("<") + repr->name() + ">";
+    }
+    return "<anonymous>";
+}
+
+void accumulate(DrawingProfile::Entry &to, DrawingProfile::Entry const &from)
+{
+    to.total_time += from.total_time;
+    to.self_time += from.self_time;
+    to.filter_time += from.filter_time;
+    to.renders += from.renders;
+    to.pixels += from.pixels;
+    to.cache_hits += from.cache_hits;
+}
+
+void write_json_string(std::ostream &os, std::string const &s)
+{
+    os << '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (c < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            os << buf;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+using ProfileEvent = Debug::SimpleEvent<Debug::Event::OTHER>;
+
+class ItemEvent : public ProfileEvent
+{
+public:
+    ItemEvent(DrawingProfile::Entry const &entry)
+        : ProfileEvent("render-profile-item")
+    {
+        _addProperty("id", entry.id.c_str());
+        _addProperty("self-us", long(entry.self_time * 1e6));
+        _addProperty("total-us", long(entry.total_time * 1e6));
+        _addProperty("filter-us", long(entry.filter_time * 1e6));
+        _addProperty("renders", long(entry.renders));
+        _addProperty("pixels", long(entry.pixels));
+        _addProperty("cache-hits", long(entry.cache_hits));
+    }
+};
+
+class ReportEvent : public ProfileEvent
+{
+public:
+    ReportEvent(std::vector<DrawingProfile::Entry> entries)
+        : ProfileEvent("render-profile")
+        , _entries(std::move(entries))
+    {}
+
+    void generateChildEvents() const override
+    {
+        for (auto const &entry : _entries) {
+            Debug::Logger::write<ItemEvent>(entry);
+        }
+    }
+
+private:
+    std::vector<DrawingProfile::Entry> _entries;
+};
+
+} // namespace
+
+DrawingProfile::Scope::Scope(DrawingProfile *profile, DrawingItem const &item)
+    : _profile(profile)
+    , _item(item)
+{
+    if (!_profile) {
+        return;
+    }
+    _outer_children_time = children_time;
+    children_time = 0;
+    _start = Clock::now();
+}
+
+DrawingProfile::Scope::~Scope()
+{
+    if (!_profile) {
+        return;
+    }
+    double const elapsed = std::chrono::duration<double>(Clock::now() - _start).count();
+
+    Entry sample;
+    sample.total_time = elapsed;
+    sample.self_time = std::max(elapsed - children_time, 0.0);
+    sample.filter_time = _filter_time;
+    sample.renders = 1;
+    sample.pixels = _pixels;
+    sample.cache_hits = _cache_hit;
+    _profile->_record(_item, sample);
+
+    children_time = _outer_children_time + elapsed;
+}
+
+void DrawingProfile::Scope::addPixels(Geom::IntRect const &area, int device_scale)
+{
+    _pixels += std::uint64_t(area.width()) * area.height() * device_scale * device_scale;
+}
+
+void DrawingProfile::Scope::startFilter()
+{
+    if (_profile) {
+        _filter_start = Clock::now();
+    }
+}
+
+void DrawingProfile::Scope::finishFilter()
+{
+    if (_profile) {
+        _filter_time += std::chrono::duration<double>(Clock::now() - _filter_start).count();
+    }
+}
+
+std::shared_ptr<DrawingProfile> DrawingProfile::get()
+{
+    return active_profile;
+}
+
+void DrawingProfile::start()
+{
+    active_profile = std::make_shared<DrawingProfile>();
+}
+
+std::shared_ptr<DrawingProfile> DrawingProfile::stop()
+{
+    return std::move(active_profile);
+}
+
+void DrawingProfile::_record(DrawingItem const &item, Entry const &sample)
+{
+    auto lock = std::lock_guard(_mutex);
+    auto [it, inserted] = _live.try_emplace(&item);
+    if (inserted) {
+        // The id is taken on first use, as the object may be gone by the time of the report.
+        it->second.id = object_id(item);
+    }
+    accumulate(it->second, sample);
+}
+
+void DrawingProfile::forget(DrawingItem const *item)
+{
+    auto lock = std::lock_guard(_mutex);
+    auto it = _live.find(item);
+    if (it != _live.end()) {
+        _retired.emplace_back(std::move(it->second));
+        _live.erase(it);
+    }
+}
+
+std::vector<DrawingProfile::Entry> DrawingProfile::report(SortKey key) const
+{
+    std::unordered_map<std::string, Entry> by_id;
+    auto add = [&] (Entry const &entry) {
+        auto &result = by_id[entry.id];
+        result.id = entry.id;
+        accumulate(result, entry);
+    };
+    {
+        auto lock = std::lock_guard(_mutex);
+        for (auto const &[item, entry] : _live) {
+            add(entry);
+        }
+        for (auto const &entry : _retired) {
+            add(entry);
+        }
+    }
+
+    std::vector<Entry> result;
+    result.reserve(by_id.size());
+    for (auto &[id, entry] : by_id) {
+        result.emplace_back(std::move(entry));
+    }
+
+    auto value = [key] (Entry const &entry) -> double {
+        switch (key) {
+            case SortKey::TOTAL_TIME: return entry.total_time;
+            case SortKey::FILTER_TIME: return entry.filter_time;
+            case SortKey::PIXELS: return entry.pixels;
+            case SortKey::CACHE_HITS: return entry.cache_hits;
+            case SortKey::SELF_TIME:
+            default: return entry.self_time;
+        }
+    };
+    std::sort(result.begin(), result.end(), [&] (Entry const &a, Entry const &b) {
+        auto const va = value(a);
+        auto const vb = value(b);
+        return va != vb ? va > vb : a.id < b.id;
+    });
+    return result;
+}
+
+void DrawingProfile::writeJson(std::ostream &os) const
+{
+    auto const entries = report();
+
+    double total = 0;
+    for (auto const &entry : entries) {
+        total += entry.self_time;
+    }
+
+    os << "{\n  \"total_ms\": " << total * 1e3 << ",\n  \"items\": [";
+    for (std::size_t i = 0; i < entries.size(); i++) {
+        auto const &entry = entries[i];
+        os << (i ? ",\n    {" : "\n    {") << "\"id\": ";
+        write_json_string(os, entry.id);
+        os << ", \"self_ms\": " << entry.self_time * 1e3
+           << ", \"total_ms\": " << entry.total_time * 1e3
+           << ", \"filter_ms\": " << entry.filter_time * 1e3
+           << ", \"share\": " << (total > 0 ? entry.self_time / total : 0)
+           << ", \"renders\": " << entry.renders
+           << ", \"pixels\": " << entry.pixels
+           << ", \"cache_hits\": " << entry.cache_hits << "}";
+    }
+    os << (entries.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
+
+void DrawingProfile::log() const
+{
+    Debug::Logger::write<ReportEvent>(report());
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Per-object render statistics of drawings.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_PROFILE_H
+#define SEEN_INKSCAPE_DISPLAY_DRAWING_PROFILE_H
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <2geom/int-rect.h>
+
+namespace Inkscape {
+
+class DrawingItem;
+
+/**
+ * Render statistics of drawing items, for finding the objects that make a drawing slow.
+ *
+ * Drawings given a profile with Drawing::setProfile() record every render of their items into
+ * it, from any thread. The statistics are reported per id of the object that created the item,
+ * so that the items of several drawings of the same document add up.
+ */
+class DrawingProfile
+{
+public:
+    struct Entry
+    {
+        std::string id;              ///< Id of the object, or its element name in angle brackets.
+        double total_time = 0;       ///< Seconds spent rendering, including children.
+        double self_time = 0;        ///< Seconds spent rendering, excluding children.
+        double filter_time = 0;      ///< Seconds spent in the filter, including its background.
+        std::uint64_t renders = 0;
+        std::uint64_t pixels = 0;     ///< Device pixels rendered, summed over all renders.
+        std::uint64_t cache_hits = 0; ///< Renders served entirely from the item's cache.
+    };
+
+    enum class SortKey
+    {
+        SELF_TIME,
+        TOTAL_TIME,
+        FILTER_TIME,
+        PIXELS,
+        CACHE_HITS
+    };
+
+    /// Measures one render of an item. Does nothing if the profile is null.
+    class Scope
+    {
+    public:
+        Scope(DrawingProfile *profile, DrawingItem const &item);
+        ~Scope();
+        Scope(Scope const &) = delete;
+        Scope &operator=(Scope const &) = delete;
+
+        void addPixels(Geom::IntRect const &area, int device_scale);
+        void cacheHit() { _cache_hit = true; }
+        void startFilter();
+        void finishFilter();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        DrawingProfile *_profile;
+        DrawingItem const &_item;
+        Clock::time_point _start;
+        Clock::time_point _filter_start;
+        double _filter_time = 0;
+        double _outer_children_time = 0;
+        std::uint64_t _pixels = 0;
+        bool _cache_hit = false;
+    };
+
+    /// The profile that export drawings record into, or null if exports are not profiled.
+    static std::shared_ptr<DrawingProfile> get();
+    /// Profile the exports from now on into a new profile.
+    static void start();
+    /// Stop profiling exports, returning the profile.
+    static std::shared_ptr<DrawingProfile> stop();
+
+    /// Stop tracking an item about to be destroyed. Its statistics are kept.
+    void forget(DrawingItem const *item);
+
+    /// Statistics per object, largest first.
+    std::vector<Entry> report(SortKey key = SortKey::SELF_TIME) const;
+
+    /// Write the report as a JSON object, sorted by self time.
+    void writeJson(std::ostream &os) const;
+    /// Write the report to the debug log, if enabled.
+    void log() const;
+
+private:
+    void _record(DrawingItem const &item, Entry const &sample);
+
+    mutable std::mutex _mutex;
+    std::unordered_map<DrawingItem const *, Entry> _live; ///< Statistics of existing items.
+    std::vector<Entry> _retired;                          ///< Statistics of destroyed items.
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_DRAWING_PROFILE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -31,6 +31,52 @@
 
 namespace Inkscape {
 
+namespace {
+
+// Paths with fewer segments are cheap enough to pass to Cairo again.
+constexpr size_t DISPLAY_LIST_MIN_SEGMENTS = 16;
+
+// Wider strokes are stroked from the curves, since the joins between the segments of a flattened
+// curve become visible on the outside of thick strokes.
+constexpr double DISPLAY_LIST_MAX_STROKE_WIDTH = 4.0;
+
+} // namespace
+
+/**
+ * The path as flattened by Cairo, so that it need not be converted and flattened again for every
+ * tile. Valid for rendering under the same transformation up to a translation.
+ */
+struct DrawingShape::DisplayList
+{
+    cairo_matrix_t matrix;
+    double tolerance;
+    cairo_path_t *path;
+    mutable std::atomic<size_t> used; ///< Drawing::_display_list_epoch when last replayed.
+
+    DisplayList(cairo_t *ct, size_t epoch)
+        : used(epoch)
+    {
+        cairo_get_matrix(ct, &matrix);
+        tolerance = cairo_get_tolerance(ct);
+        path = cairo_copy_path_flat(ct);
+    }
+
+    DisplayList(DisplayList const &) = delete;
+    DisplayList &operator=(DisplayList const &) = delete;
+    ~DisplayList() { cairo_path_destroy(path); }
+
+    /// The memory charged against the cache budget of the drawing.
+    size_t bytes() const { return sizeof(*this) + sizeof(cairo_path_data_t) * path->num_data; }
+
+    bool matches(cairo_t *ct) const
+    {
+        cairo_matrix_t m;
+        cairo_get_matrix(ct, &m);
+        return m.xx == matrix.xx && m.yx == matrix.yx && m.xy == matrix.xy && m.yy == matrix.yy &&
+               cairo_get_tolerance(ct) == tolerance;
+    }
+};
+
 DrawingShape::DrawingShape(Drawing &drawing)
     : DrawingItem(drawing)
     , style_vector_effect_stroke(false)
@@ -43,6 +89,11 @@ DrawingShape::DrawingShape(Drawing &drawing)
 {
 }
 
+DrawingShape::~DrawingShape()
+{
+    _dropDisplayList();
+}
+
 void DrawingShape::setPath(std::shared_ptr<SPCurve const> curve)
 {
     defer([this, curve = std::move(curve)] () mutable {
@@ -100,6 +151,11 @@ unsigned DrawingShape::_updateItem(Geom::IntRect const &area, UpdateContext cons
         _nrstyle.update();
     }
 
+    // the path or transformation may have changed
+    if (flags & STATE_BBOX) {
+        _dropDisplayList();
+    }
+
     auto calc_curve_bbox = [&, this] () -> Geom::OptIntRect {
         if (!_curve) {
             return {};
@@ -159,6 +215,79 @@ unsigned DrawingShape::_updateItem(Geom::IntRect const &area, UpdateContext cons
     return _state | flags;
 }
 
+/**
+ * Add the path to the context, whose transformation must map the shape to the device. Replays the
+ * display list if it was recorded under the same transformation, and records it otherwise.
+ */
+void DrawingShape::_addPath(DrawingContext &dc)
+{
+    auto const ct = dc.raw();
+
+    auto const list = _display_list.load(std::memory_order_acquire);
+    if (list && list->matches(ct)) {
+        cairo_append_path(ct, list->path);
+        list->used.store(_drawing._display_list_epoch, std::memory_order_relaxed);
+        return;
+    }
+
+    dc.path(_curve->get_pathvector());
+
+    // Only the first transformation since the last update is recorded.
+    if (list || _curve->get_segment_count() < DISPLAY_LIST_MIN_SEGMENTS) {
+        return;
+    }
+    auto recorded = std::make_unique<DisplayList const>(ct, _drawing._display_list_epoch);
+    if (recorded->path->status != CAIRO_STATUS_SUCCESS) {
+        return;
+    }
+    auto const bytes = recorded->bytes();
+    if (!_drawing._reserveDisplayList(bytes)) {
+        return;
+    }
+    DisplayList const *expected = nullptr;
+    if (_display_list.compare_exchange_strong(expected, recorded.get(), std::memory_order_release, std::memory_order_relaxed)) {
+        recorded.release();
+        auto lock = std::lock_guard(_drawing._display_list_mutex);
+        _display_list_iterator = _drawing._display_list_shapes.insert(_drawing._display_list_shapes.end(), this);
+    } else {
+        // Another thread recorded it first.
+        _drawing._display_list_bytes -= bytes;
+    }
+}
+
+/// Free the display list. Rendering never runs concurrently with updates, so no one can still be reading it.
+void DrawingShape::_dropDisplayList()
+{
+    if (auto list = _display_list.exchange(nullptr, std::memory_order_relaxed)) {
+        {
+            auto lock = std::lock_guard(_drawing._display_list_mutex);
+            _drawing._display_list_shapes.erase(_display_list_iterator);
+        }
+        _drawing._display_list_bytes -= list->bytes();
+        delete list;
+    }
+}
+
+/// When the display list was last replayed, as a Drawing::_display_list_epoch, or 0 without one.
+size_t DrawingShape::_displayListUsed() const
+{
+    auto const list = _display_list.load(std::memory_order_relaxed);
+    return list ? list->used.load(std::memory_order_relaxed) : 0;
+}
+
+/// Whether the stroke may be drawn from the display list.
+bool DrawingShape::_thinStroke() const
+{
+    if (_nrstyle.hairline || style_stroke_extensions_hairline) {
+        return true;
+    }
+    auto width = _nrstyle.stroke_width;
+    if (!style_vector_effect_stroke) {
+        width *= _ctm.descrim();
+    }
+    return width <= DISPLAY_LIST_MAX_STROKE_WIDTH;
+}
+
 void DrawingShape::_renderFill(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area)
 {
     Inkscape::DrawingContext::Save save(dc);
@@ -167,7 +296,7 @@ void DrawingShape::_renderFill(DrawingContext &dc, RenderContext &rc, Geom::IntR
     bool has_fill = _nrstyle.prepareFill(dc, rc, area, _item_bbox, _fill_pattern);
 
     if (has_fill) {
-        dc.path(_curve->get_pathvector());
+        _addPath(dc);
         auto dl = DitherLock(dc, _nrstyle.fill.ditherable() && _drawing.useDithering());
         _nrstyle.applyFill(dc);
         dc.fillPreserve();
@@ -187,7 +316,11 @@ void DrawingShape::_renderStroke(DrawingContext &dc, RenderContext &rc, Geom::In
 
     if (has_stroke) {
         // TODO: remove segments outside of bbox when no dashes present
-        dc.path(_curve->get_pathvector());
+        if (_thinStroke()) {
+            _addPath(dc);
+        } else {
+            dc.path(_curve->get_pathvector());
+        }
         if (style_vector_effect_stroke) {
             dc.restore();
             dc.save();
@@ -235,7 +368,7 @@ unsigned DrawingShape::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::
         {
             Inkscape::DrawingContext::Save save(dc);
             dc.transform(_ctm);
-            dc.path(_curve->get_pathvector());
+            _addPath(dc);
         }
         {
             Inkscape::DrawingContext::Save save(dc);
@@ -264,7 +397,11 @@ unsigned DrawingShape::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::
             bool has_stroke = _nrstyle.prepareStroke(dc, rc, *visible, _item_bbox, _stroke_pattern);
             has_stroke &= (_nrstyle.stroke_width != 0 || _nrstyle.hairline == true);
             if (has_fill || has_stroke) {
-                dc.path(_curve->get_pathvector());
+                if (!has_stroke || _thinStroke()) {
+                    _addPath(dc);
+                } else {
+                    dc.path(_curve->get_pathvector());
+                }
                 // TODO: remove segments outside of bbox when no dashes present
                 if (has_fill) {
                     auto dl = DitherLock(dc, _nrstyle.fill.ditherable() && _drawing.useDithering());
@@ -332,7 +469,7 @@ void DrawingShape::_clipItem(DrawingContext &dc, RenderContext &rc, Geom::IntRec
         dc.setFillRule(CAIRO_FILL_RULE_WINDING);
     }
     dc.transform(_ctm);
-    dc.path(_curve->get_pathvector());
+    _addPath(dc);
     dc.fill();
 }
 
@@ -13,6 +13,8 @@
 #ifndef INKSCAPE_DISPLAY_DRAWING_SHAPE_H
 #define INKSCAPE_DISPLAY_DRAWING_SHAPE_H
 
+#include <atomic>
+
 #include "display/drawing-item.h"
 #include "display/nr-style.h"
 
@@ -32,7 +34,7 @@ public:
     void setChildrenStyle(SPStyle const *context_style) override;
 
 protected:
-    ~DrawingShape() override = default;
+    ~DrawingShape() override;
 
     unsigned _updateItem(Geom::IntRect const &area, UpdateContext const &ctx, unsigned flags, unsigned reset) override;
     unsigned _renderItem(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags, DrawingItem *stop_at) override;
@@ -43,6 +45,10 @@ protected:
     void _renderFill(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area);
     void _renderStroke(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags);
     void _renderMarkers(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags, DrawingItem *stop_at);
+    void _addPath(DrawingContext &dc);
+    void _dropDisplayList();
+    size_t _displayListUsed() const;
+    bool _thinStroke() const;
 
     bool style_vector_effect_stroke : 1;
     bool style_stroke_extensions_hairline : 1;
@@ -53,8 +59,15 @@ protected:
     std::shared_ptr<SPCurve const> _curve;
     NRStyle _nrstyle;
 
+    // Recorded at most once between updates, by whichever rendering thread gets there first.
+    struct DisplayList;
+    std::atomic<DisplayList const *> _display_list{nullptr};
+    std::list<DrawingShape*>::iterator _display_list_iterator; ///< Valid while _display_list is set.
+
     DrawingItem *_last_pick;
     unsigned _repick_after;
+
+    friend class Drawing;
 };
 
 } // namespace Inkscape
@@ -229,6 +229,13 @@ DrawingCache::markClean(Geom::IntRect const &area)
     cairo_rectangle_int_t clean = _convertRect(*r);
     cairo_region_union_rectangle(_clean_region, &clean);
 }
+/// Whether the whole of the given area can be painted from cache.
+bool
+DrawingCache::isClean(Geom::IntRect const &area) const
+{
+    cairo_rectangle_int_t r = _convertRect(area);
+    return cairo_region_contains_rectangle(_clean_region, &r) == CAIRO_REGION_OVERLAP_IN;
+}
 
 /// Call this during the update phase to schedule a transformation of the cache.
 void
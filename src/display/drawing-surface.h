@@ -70,6 +70,7 @@ public:
 
     void markDirty(Geom::IntRect const &area = Geom::IntRect::infinite());
     void markClean(Geom::IntRect const &area = Geom::IntRect::infinite());
+    bool isClean(Geom::IntRect const &area) const;
     void scheduleTransform(Geom::IntRect const &new_area, Geom::Affine const &trans);
     void prepare();
     void paintFromCache(DrawingContext &dc, Geom::OptIntRect &area, bool is_filter);
@@ -219,6 +219,8 @@ DrawingText::DrawingText(Drawing &drawing)
     , style_stroke_extensions_hairline(false)
     , style_clip_rule(SP_WIND_RULE_EVENODD)
 {
+    // Glyphs are picked by their pick boxes.
+    _index_children = false;
 }
 
 bool DrawingText::addComponent(std::shared_ptr<FontInstance> const &font, int glyph, Geom::Affine const &trans, float width, float ascent, float descent, float phase_length)
@@ -21,6 +21,8 @@
 // Grayscale colormode
 #include "cairo-templates.h"
 #include "drawing-context.h"
+#include "drawing-image.h"
+#include "drawing-shape.h"
 
 namespace Inkscape {
 
@@ -64,6 +66,7 @@ void Drawing::setRoot(DrawingItem *root)
 {
     delete _root;
     _root = root;
+    _average_cache.clear();
     if (_root) {
         assert(_root->_child_type == DrawingItem::ChildType::ORPHAN);
         _root->_child_type = DrawingItem::ChildType::ROOT;
@@ -100,6 +103,7 @@ void Drawing::setOutlineOverlay(bool outlineoverlay)
         if (outlineoverlay == _outlineoverlay) return;
         _outlineoverlay = outlineoverlay;
         _root->_markForUpdate(DrawingItem::STATE_ALL, true);
+        _clearCache();
     });
 }
 
@@ -192,6 +196,7 @@ void Drawing::setCacheBudget(size_t bytes)
 {
     defer([=] {
         _cache_budget = bytes;
+        _trimMipmaps();
         _pickItemsForCaching();
     });
 }
@@ -217,6 +222,8 @@ void Drawing::setClip(std::optional<Geom::PathVector> &&clip)
 
 void Drawing::update(Geom::IntRect const &area, Geom::Affine const &affine, unsigned flags, unsigned reset)
 {
+    _update_visits = 0;
+    _display_list_epoch++;
     if (_root) {
         _root->update(area, { affine }, flags, reset);
     }
@@ -226,7 +233,7 @@ void Drawing::update(Geom::IntRect const &area, Geom::Affine const &affine, unsi
     }
 }
 
-void Drawing::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flags, int antialiasing_override)
+bool Drawing::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flags, int antialiasing_override)
 {
     int antialias = _root->antialiasing();
     if (antialiasing_override >= 0) {
@@ -246,6 +253,8 @@ void Drawing::render(DrawingContext &dc, Geom::IntRect const &area, unsigned fla
     if (_clip) {
         dc.restore();
     }
+
+    return !rc.draft_incomplete;
 }
 
 DrawingItem *Drawing::pick(Geom::Point const &p, double delta, unsigned flags)
@@ -268,15 +277,19 @@ void Drawing::unsnapshot()
 
 void Drawing::_pickItemsForCaching()
 {
-    // Build sorted list of items that should be cached.
+    // Build sorted list of items that should be cached. Mipmaps keep their room, while display
+    // lists give theirs up, being cheap to record again.
     std::vector<DrawingItem*> to_cache;
-    size_t used = 0;
+    size_t const reserved = _mipmap_bytes;
+    size_t used = reserved;
     for (auto &rec : _candidate_items) {
         if (used + rec.cache_size > _cache_budget) break;
         to_cache.emplace_back(rec.item);
         used += rec.cache_size;
     }
     std::sort(to_cache.begin(), to_cache.end());
+    _cached_item_bytes = used - reserved;
+    _trimDisplayLists(_cache_budget - std::min(used, _cache_budget));
 
     // Uncache the items that are cached but should not be cached.
     // Note: setCached() modifies _cached_items, so the temporary container is necessary.
@@ -296,12 +309,85 @@ void Drawing::_pickItemsForCaching()
 
 void Drawing::_clearCache()
 {
+    // Averages are taken from tiles rendered with the old settings too.
+    _average_cache.clear();
+
     // Note: setCached() modifies _cached_items, so the temporary container is necessary.
     std::vector<DrawingItem*> to_uncache;
     std::copy(_cached_items.begin(), _cached_items.end(), std::back_inserter(to_uncache));
     for (auto item : to_uncache) {
         item->_setCached(false, true);
     }
+    _cached_item_bytes = 0;
+}
+
+/**
+ * Make room for bytes more of mipmaps for the given image, which must be the most recently used
+ * one if it has any, by dropping the mipmaps of the least recently used images. Returns false if
+ * they do not fit into the cache budget. Must be called with _mipmap_mutex held.
+ */
+bool Drawing::_reserveMipmap(size_t bytes, DrawingImage const *user)
+{
+    auto const fits = [&] { return _mipmap_bytes + _display_list_bytes + _cached_item_bytes + bytes <= _cache_budget; };
+    while (!fits() && !_mipmap_images.empty() && _mipmap_images.back() != user) {
+        _mipmap_images.back()->_dropMipmaps();
+    }
+    if (!fits()) {
+        return false;
+    }
+    _mipmap_bytes += bytes;
+    return true;
+}
+
+/**
+ * Account for bytes more of shape display lists, if they fit into the cache budget. Nothing is
+ * evicted to make room for them, as other rendering threads may be reading any display list;
+ * _trimDisplayLists() does that during updates.
+ */
+bool Drawing::_reserveDisplayList(size_t bytes)
+{
+    if (_mipmap_bytes + _cached_item_bytes + (_display_list_bytes += bytes) > _cache_budget) {
+        _display_list_bytes -= bytes;
+        return false;
+    }
+    return true;
+}
+
+void Drawing::_trimMipmaps()
+{
+    auto lock = std::lock_guard(_mipmap_mutex);
+    // Levels still being built are reserved but not listed yet.
+    while (_mipmap_bytes > _cache_budget && !_mipmap_images.empty()) {
+        _mipmap_images.back()->_dropMipmaps();
+    }
+}
+
+/**
+ * Drop the display lists least recently replayed until the rest fit into budget. Must not be
+ * called while rendering.
+ */
+void Drawing::_trimDisplayLists(size_t budget)
+{
+    if (_display_list_bytes <= budget) {
+        return;
+    }
+
+    std::vector<std::pair<size_t, DrawingShape*>> shapes;
+    {
+        auto lock = std::lock_guard(_display_list_mutex);
+        shapes.reserve(_display_list_shapes.size());
+        for (auto shape : _display_list_shapes) {
+            shapes.emplace_back(shape->_displayListUsed(), shape);
+        }
+    }
+    std::sort(shapes.begin(), shapes.end());
+
+    for (auto const &[used, shape] : shapes) {
+        if (_display_list_bytes <= budget) {
+            break;
+        }
+        shape->_dropDisplayList();
+    }
 }
 
 void Drawing::_loadPrefs()
@@ -354,15 +440,12 @@ void Drawing::_loadPrefs()
 }
 
 /*
- * Return average color over area. Used by Calligraphic, Dropper, and Spray tools.
+ * Return average color over area. Used by Calligraphic, Dropper, and Spray tools, and the
+ * Clone Tiler. Repeated queries over an unchanged drawing are answered from cached tiles.
  */
 void Drawing::averageColor(Geom::IntRect const &area, double &R, double &G, double &B, double &A)
 {
-    auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, area.width(), area.height());
-    auto dc = Inkscape::DrawingContext(surface->cobj(), area.min());
-    render(dc, area);
-
-    ink_cairo_surface_average_color_premul(surface->cobj(), R, G, B, A);
+    _average_cache.average(*this, area, R, G, B, A);
 }
 
 /*
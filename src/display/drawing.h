@@ -14,13 +14,16 @@
 #define INKSCAPE_DISPLAY_DRAWING_H
 
 #include <set>
+#include <atomic>
 #include <cstdint>
+#include <mutex>
 #include <vector>
 #include <boost/operators.hpp>
 #include <2geom/rect.h>
 #include <2geom/pathvector.h>
 #include <sigc++/sigc++.h>
 
+#include "display/drawing-average-cache.h"
 #include "display/drawing-item.h"
 #include "display/rendermode.h"
 #include "nr-filter-colormatrix.h"
@@ -32,6 +35,10 @@ namespace Inkscape {
 class DrawingItem;
 class CanvasItemDrawing;
 class DrawingContext;
+class DrawingDiskCache;
+class DrawingImage;
+class DrawingProfile;
+class DrawingShape;
 
 class Drawing
 {
@@ -60,6 +67,8 @@ public:
     void setCacheBudget(size_t bytes);
     void setCacheLimit(Geom::OptIntRect const &rect);
     void setClip(std::optional<Geom::PathVector> &&clip);
+    void setDiskCache(std::shared_ptr<DrawingDiskCache> cache) { _disk_cache = std::move(cache); }
+    void setProfile(std::shared_ptr<DrawingProfile> profile) { _profile = std::move(profile); }
 
     RenderMode renderMode() const { return _rendermode; }
     ColorMode colorMode() const { return _colormode; }
@@ -74,10 +83,18 @@ public:
     bool useDithering() const { return _use_dithering; }
     double cursorTolerance() const { return _cursor_tolerance; }
     Geom::OptIntRect const &cacheLimit() const { return _cache_limit; }
+    DrawingDiskCache *diskCache() const { return _disk_cache.get(); }
+    DrawingProfile *profile() const { return _profile.get(); }
 
     void update(Geom::IntRect const &area = Geom::IntRect::infinite(), Geom::Affine const &affine = Geom::identity(),
                 unsigned flags = DrawingItem::STATE_ALL, unsigned reset = 0);
-    void render(DrawingContext &dc, Geom::IntRect const &area, unsigned flags = 0, int antialiasing_override = -1);
+    /// Number of items visited by the last update.
+    size_t updateVisits() const { return _update_visits; }
+    /// Memory taken from the cache budget by image mipmaps and shape display lists.
+    size_t mipmapBytes() const { return _mipmap_bytes; }
+    size_t displayListBytes() const { return _display_list_bytes; }
+    /// Render the drawing. Returns false if a draft render (RENDER_DRAFT) left out any filters.
+    bool render(DrawingContext &dc, Geom::IntRect const &area, unsigned flags = 0, int antialiasing_override = -1);
     DrawingItem *pick(Geom::Point const &p, double delta, unsigned flags);
 
     void snapshot();
@@ -92,6 +109,10 @@ private:
     void _pickItemsForCaching();
     void _clearCache();
     void _loadPrefs();
+    bool _reserveMipmap(size_t bytes, DrawingImage const *user);
+    bool _reserveDisplayList(size_t bytes);
+    void _trimMipmaps();
+    void _trimDisplayLists(size_t budget);
 
     DrawingItem *_root = nullptr;
     Inkscape::CanvasItemDrawing *_canvas_item_drawing = nullptr;
@@ -110,12 +131,31 @@ private:
     bool _use_dithering;
     double _cursor_tolerance;
     size_t _cache_budget; ///< Maximum allowed size of cache.
+    size_t _update_visits = 0; ///< Incremented by DrawingItem::update().
     Geom::OptIntRect _cache_limit;
     std::optional<Geom::PathVector> _clip;
+    std::shared_ptr<DrawingDiskCache> _disk_cache; ///< Persistent cache of filtered items, used for export.
+    std::shared_ptr<DrawingProfile> _profile; ///< Render statistics of the items, if collected.
+    DrawingAverageCache _average_cache; ///< Summed-area tables for averageColor().
 
     std::set<DrawingItem*> _cached_items; // modified by DrawingItem::_setCached()
     CacheList _candidate_items;           // keep this list always sorted with std::greater
 
+    // Image mipmaps share the cache budget. They are built during rendering, hence the mutex.
+    std::mutex _mipmap_mutex;
+    std::list<DrawingImage*> _mipmap_images; ///< Images with mipmaps, most recently used first.
+    std::atomic<size_t> _mipmap_bytes{0};
+
+    // So do the display lists of shapes, which are also recorded during rendering. As rendering
+    // threads read them without locking, they are only dropped during updates.
+    std::mutex _display_list_mutex;
+    std::list<DrawingShape*> _display_list_shapes; ///< Shapes with display lists.
+    std::atomic<size_t> _display_list_bytes{0};
+    size_t _display_list_epoch = 0; ///< Incremented by update(), to find the lists not replayed lately.
+
+    // And so do the caches of the items picked by _pickItemsForCaching().
+    std::atomic<size_t> _cached_item_bytes{0};
+
     /*
      * Simple cacheline separator compatible with x86 (64 bytes) and M* (128 bytes).
      * Ideally alignas(std::hardware_destructive_interference_size) could be used instead,
@@ -130,6 +170,8 @@ private:
     void defer(F &&f) { _snapshotted ? _funclog.emplace(std::forward<F>(f)) : f(); }
 
     friend class DrawingItem;
+    friend class DrawingImage;
+    friend class DrawingShape;
 };
 
 } // namespace Inkscape
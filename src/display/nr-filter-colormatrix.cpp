@@ -13,6 +13,7 @@
 
 #include <cmath>
 #include <algorithm>
+#include "display/cairo-simd.h"
 #include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
 #include "display/nr-filter-colormatrix.h"
@@ -69,6 +70,11 @@ guint32 FilterColorMatrix::ColorMatrixMatrix::operator()(guint32 in)
     return pxout;
 }
 
+void FilterColorMatrix::ColorMatrixMatrix::span(guint32 const *in, guint32 *out, int n)
+{
+    Inkscape::Pixels::color_matrix(in, out, n, _v);
+}
+
 struct ColorMatrixSaturate
 {
     ColorMatrixSaturate(double v_in)
@@ -190,10 +196,40 @@ void FilterColorMatrix::render_cairo(FilterSlot &slot) const
         break;
     }
 
+    Geom::Rect vp = filter_primitive_area(slot.get_units());
+    slot.set_primitive_area(_output, vp); // Needed for tiling
+
     slot.set(_output, out);
     cairo_surface_destroy(out);
 }
 
+FilterPrimitive::PixelMap FilterColorMatrix::pixel_map() const
+{
+    // Per-pixel functor without a span method.
+    auto const map = [] (auto f) -> PixelMap {
+        return [f] (guint32 const *in, guint32 *out, int n) mutable {
+            for (int i = 0; i < n; ++i) {
+                out[i] = f(in[i]);
+            }
+        };
+    };
+
+    switch (type) {
+    case COLORMATRIX_MATRIX:
+        return [m = ColorMatrixMatrix(values)] (guint32 const *in, guint32 *out, int n) mutable {
+            m.span(in, out, n);
+        };
+    case COLORMATRIX_SATURATE:
+        return map(ColorMatrixSaturate(value));
+    case COLORMATRIX_HUEROTATE:
+        return map(ColorMatrixHueRotate(value));
+    case COLORMATRIX_LUMINANCETOALPHA: // produces an alpha-only surface
+    case COLORMATRIX_ENDTYPE:
+    default:
+        return {};
+    }
+}
+
 bool FilterColorMatrix::can_handle_affine(Geom::Affine const &) const
 {
     return true;
@@ -43,6 +43,7 @@ public:
     void render_cairo(FilterSlot &slot) const override;
     bool can_handle_affine(Geom::Affine const &) const override;
     double complexity(Geom::Affine const &ctm) const override;
+    PixelMap pixel_map() const override;
 
     virtual void set_type(FilterColorMatrixType type);
     virtual void set_value(double value);
@@ -55,6 +56,7 @@ public:
     {
         ColorMatrixMatrix(std::vector<double> const &values);
         guint32 operator()(guint32 in);
+        void span(guint32 const *in, guint32 *out, int n);
     private:
         gint32 _v[20];
     };
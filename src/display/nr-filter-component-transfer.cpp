@@ -12,6 +12,7 @@
  */
 
 #include <cmath>
+#include "display/cairo-simd.h"
 #include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
 #include "display/nr-filter-component-transfer.h"
@@ -24,34 +25,6 @@ FilterComponentTransfer::FilterComponentTransfer() = default;
 
 FilterComponentTransfer::~FilterComponentTransfer() = default;
 
-struct UnmultiplyAlpha
-{
-    guint32 operator()(guint32 in)
-    {
-        EXTRACT_ARGB32(in, a, r, g, b);
-        if (a == 0 )
-            return in;
-        r = unpremul_alpha(r, a);
-        g = unpremul_alpha(g, a);
-        b = unpremul_alpha(b, a);
-        ASSEMBLE_ARGB32(out, a, r, g, b);
-        return out;
-    }
-};
-
-struct MultiplyAlpha
-{
-    guint32 operator()(guint32 in)
-    {
-        EXTRACT_ARGB32(in, a, r, g, b);
-        r = premul_alpha(r, a);
-        g = premul_alpha(g, a);
-        b = premul_alpha(b, a);
-        ASSEMBLE_ARGB32(out, a, r, g, b);
-        return out;
-    }
-};
-
 struct ComponentTransfer
 {
     ComponentTransfer(guint32 color)
@@ -166,22 +139,61 @@ private:
     double _offset;
 };
 
-void FilterComponentTransfer::render_cairo(FilterSlot &slot) const
+/**
+ * Applies all four channel transfer functions in a single pass. Every transfer function only
+ * depends on the value of its own channel, so each one is tabulated for all 256 inputs.
+ * The lookup operates on un-premultiplied values.
+ */
+struct ComponentTransferLut
 {
-    cairo_surface_t *input = slot.getcairo(_input);
-    cairo_surface_t *out = ink_cairo_surface_create_same_size(input, CAIRO_CONTENT_COLOR_ALPHA);
+    ComponentTransferLut()
+    {
+        for (auto &table : _lut) {
+            for (unsigned v = 0; v < 256; ++v) {
+                table[v] = v;
+            }
+        }
+    }
 
-    // We may need to transform input surface to correct color interpolation space. The input surface
-    // might be used as input to another primitive but it is likely that all the primitives in a given
-    // filter use the same color interpolation space so we don't copy the input before converting.
-    set_cairo_surface_ci(out, color_interpolation);
-    set_cairo_surface_ci(input, color_interpolation);
+    template <typename Transfer>
+    void set(guint32 color, Transfer transfer)
+    {
+        guint32 shift = color * 8;
+        for (guint32 v = 0; v < 256; ++v) {
+            _lut[color][v] = (transfer(v << shift) >> shift) & 0xff;
+        }
+    }
 
-    ink_cairo_surface_blit(input, out);
+    guint32 operator()(guint32 in)
+    {
+        EXTRACT_ARGB32(in, a, r, g, b)
+        if (a != 0) {
+            r = unpremul_alpha(r, a);
+            g = unpremul_alpha(g, a);
+            b = unpremul_alpha(b, a);
+        }
+        a = _lut[3][a];
+        r = premul_alpha(_lut[2][r], a);
+        g = premul_alpha(_lut[1][g], a);
+        b = premul_alpha(_lut[0][b], a);
+        ASSEMBLE_ARGB32(out, a, r, g, b)
+        return out;
+    }
 
+    void span(guint32 const *in, guint32 *out, int n)
+    {
+        Inkscape::Pixels::component_lut(in, out, n, _lut);
+    }
+
+private:
+    guint8 _lut[4][256];
+};
+
+static ComponentTransferLut make_lut(FilterComponentTransfer const &ct)
+{
     // We need to operate on unmultipled by alpha color values otherwise a change in alpha screws
     // up the premultiplied by alpha r, g, b values.
-    ink_cairo_surface_filter(out, out, UnmultiplyAlpha());
+    ComponentTransferLut lut;
 
     // parameters: R = 0, G = 1, B = 2, A = 3
     // Cairo:      R = 2, G = 1, B = 0, A = 3
@@ -190,22 +202,22 @@ void FilterComponentTransfer::render_cairo(FilterSlot &slot) const
         guint32 color = 2 - i;
         if (i == 3) color = 3; // alpha
 
-        switch (type[i]) {
+        switch (ct.type[i]) {
         case COMPONENTTRANSFER_TYPE_TABLE:
-            if (!tableValues[i].empty()) {
-              ink_cairo_surface_filter(out, out, ComponentTransferTable(color, tableValues[i]));
+            if (!ct.tableValues[i].empty()) {
+                lut.set(color, ComponentTransferTable(color, ct.tableValues[i]));
             }
             break;
         case COMPONENTTRANSFER_TYPE_DISCRETE:
-            if (!tableValues[i].empty()) {
-                ink_cairo_surface_filter(out, out, ComponentTransferDiscrete(color, tableValues[i]));
+            if (!ct.tableValues[i].empty()) {
+                lut.set(color, ComponentTransferDiscrete(color, ct.tableValues[i]));
             }
             break;
         case COMPONENTTRANSFER_TYPE_LINEAR:
-            ink_cairo_surface_filter(out, out, ComponentTransferLinear(color, intercept[i], slope[i]));
+            lut.set(color, ComponentTransferLinear(color, ct.intercept[i], ct.slope[i]));
             break;
         case COMPONENTTRANSFER_TYPE_GAMMA:
-            ink_cairo_surface_filter(out, out, ComponentTransferGamma(color, amplitude[i], exponent[i], offset[i]));
+            lut.set(color, ComponentTransferGamma(color, ct.amplitude[i], ct.exponent[i], ct.offset[i]));
             break;
         case COMPONENTTRANSFER_TYPE_ERROR:
         case COMPONENTTRANSFER_TYPE_IDENTITY:
@@ -214,12 +226,36 @@ void FilterComponentTransfer::render_cairo(FilterSlot &slot) const
         }
     }
 
-    ink_cairo_surface_filter(out, out, MultiplyAlpha());
+    return lut;
+}
+
+void FilterComponentTransfer::render_cairo(FilterSlot &slot) const
+{
+    cairo_surface_t *input = slot.getcairo(_input);
+    cairo_surface_t *out = ink_cairo_surface_create_same_size(input, CAIRO_CONTENT_COLOR_ALPHA);
+
+    // We may need to transform input surface to correct color interpolation space. The input surface
+    // might be used as input to another primitive but it is likely that all the primitives in a given
+    // filter use the same color interpolation space so we don't copy the input before converting.
+    set_cairo_surface_ci(out, color_interpolation);
+    set_cairo_surface_ci(input, color_interpolation);
+
+    ink_cairo_surface_filter(input, out, make_lut(*this));
+
+    Geom::Rect vp = filter_primitive_area(slot.get_units());
+    slot.set_primitive_area(_output, vp); // Needed for tiling
 
     slot.set(_output, out);
     cairo_surface_destroy(out);
 }
 
+FilterPrimitive::PixelMap FilterComponentTransfer::pixel_map() const
+{
+    return [lut = make_lut(*this)] (guint32 const *in, guint32 *out, int n) mutable {
+        lut.span(in, out, n);
+    };
+}
+
 bool FilterComponentTransfer::can_handle_affine(Geom::Affine const &) const
 {
     return true;
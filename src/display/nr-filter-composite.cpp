@@ -12,6 +12,7 @@
 
 #include <cmath>
 
+#include "display/cairo-simd.h"
 #include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
 #include "display/nr-filter-composite.h"
@@ -59,6 +60,12 @@ struct ComposeArithmetic
         return pxout;
     }
 
+    void span(guint32 const *in1, guint32 const *in2, guint32 *out, int n)
+    {
+        gint32 const k[4] = {_k1, _k2, _k3, _k4};
+        Inkscape::Pixels::composite_arithmetic(in1, in2, out, n, k);
+    }
+
 private:
     gint32 _k1, _k2, _k3, _k4;
 };
@@ -116,6 +123,17 @@ void FilterComposite::render_cairo(FilterSlot &slot) const
     cairo_surface_destroy(out);
 }
 
+FilterPrimitive::PixelBlend FilterComposite::pixel_blend() const
+{
+    // The other operators are done by Cairo.
+    if (op != COMPOSITE_ARITHMETIC) {
+        return {};
+    }
+    return [blend = ComposeArithmetic(k1, k2, k3, k4)] (guint32 const *in1, guint32 const *in2, guint32 *out, int n) mutable {
+        blend.span(in1, in2, out, n);
+    };
+}
+
 bool FilterComposite::can_handle_affine(Geom::Affine const &) const
 {
     return true;
@@ -30,9 +30,11 @@ public:
     void render_cairo(FilterSlot &) const override;
     bool can_handle_affine(Geom::Affine const &) const override;
     double complexity(Geom::Affine const &ctm) const override;
+    PixelBlend pixel_blend() const override;
 
     void set_input(int input) override;
     void set_input(int input, int slot) override;
+    std::vector<int> get_inputs() const override { return {_input, _input2}; }
 
     void set_operator(FeCompositeOperator op);
     void set_arithmetic(double k1, double k2, double k3, double k4);
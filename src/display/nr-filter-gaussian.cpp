@@ -22,16 +22,15 @@
 #include <cstdlib>
 #include <glib.h>
 #include <limits>
-#if HAVE_OPENMP
-#include <omp.h>
-#endif //HAVE_OPENMP
 
+#include "async/scheduler.h"
 #include "display/cairo-utils.h"
 #include "display/nr-filter-primitive.h"
 #include "display/nr-filter-gaussian.h"
 #include "display/nr-filter-types.h"
 #include "display/nr-filter-units.h"
 #include "display/nr-filter-slot.h"
+#include "display/surface-pool.h"
 #include <2geom/affine.h>
 #include "util/fixed_point.h"
 
@@ -284,79 +283,128 @@ static void calcTriggsSdikaInitialization(double const M[N*N], IIRValue const uo
     }
 }
 
-// Filters over 1st dimension
-template<typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA>
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define PREMUL_ALPHA_LOOP for(unsigned int c=0; c<PC-1; ++c)
+#else
+#define PREMUL_ALPHA_LOOP for(unsigned int c=1; c<PC; ++c)
+#endif
+
+// Lines are filtered in blocks, so that the recurrences can be vectorized across the lines and
+// channels of a block. Lines that are adjacent in memory (the columns of the vertical pass) are
+// grouped into BLOCK_BYTES wide strips, so each cache line is loaded once per strip instead of
+// once per column; other lines are grouped by BLOCK_LINES. Larger blocks need more scratch space
+// per block, which stops paying off once it no longer fits in L2 for tall images.
+static int const BLOCK_LINES = 2;
+static int const BLOCK_BYTES = 32;
+
+// Filters LINES lines starting at c2 over the 1st dimension, producing exactly the same result
+// as filtering each line on its own. tmpdata must hold n1*LINES*PC values.
+template<typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA, int LINES>
 static void
-filter2D_IIR(PT *const dest, int const dstr1, int const dstr2,
-             PT const *const src, int const sstr1, int const sstr2,
-             int const n1, int const n2, IIRValue const b[N+1], double const M[N*N],
-             IIRValue *const tmpdata[], int const num_threads)
+filter_lines_IIR(PT *const dest, int const dstr1, int const dstr2,
+                 PT const *const src, int const sstr1, int const sstr2,
+                 int const n1, int const c2, IIRValue const b[N+1], double const M[N*N],
+                 IIRValue *const tmpdata)
 {
-    assert(src && dest);
-
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
     static unsigned int const alpha_PC = PC-1;
-    #define PREMUL_ALPHA_LOOP for(unsigned int c=0; c<PC-1; ++c)
 #else
     static unsigned int const alpha_PC = 0;
-    #define PREMUL_ALPHA_LOOP for(unsigned int c=1; c<PC; ++c)
 #endif
+    // Lanes of the recurrence: every channel of every line in the block.
+    static unsigned int const L = LINES*PC;
 
-INK_UNUSED(num_threads); // to suppress unused argument compiler warning
-#if HAVE_OPENMP
-#pragma omp parallel for num_threads(num_threads)
-#endif // HAVE_OPENMP
-    for ( int c2 = 0 ; c2 < n2 ; c2++ ) {
-#if HAVE_OPENMP
-        unsigned int tid = omp_get_thread_num();
-#else
-        unsigned int tid = 0;
-#endif // HAVE_OPENMP
-        // corresponding line in the source and output buffer
-        PT const * srcimg = src  + c2*sstr2;
-        PT       * dstimg = dest + c2*dstr2 + n1*dstr1;
-        // Border constants
-        IIRValue imin[PC];  copy_n(srcimg + (0)*sstr1, PC, imin);
-        IIRValue iplus[PC]; copy_n(srcimg + (n1-1)*sstr1, PC, iplus);
-        // Forward pass
-        IIRValue u[N+1][PC];
-        for(unsigned int i=0; i<N; i++) copy_n(imin, PC, u[i]);
-        for ( int c1 = 0 ; c1 < n1 ; c1++ ) {
-            for(unsigned int i=N; i>0; i--) copy_n(u[i-1], PC, u[i]);
-            copy_n(srcimg, PC, u[0]);
-            srcimg += sstr1;
-            for(unsigned int c=0; c<PC; c++) u[0][c] *= b[0];
-            for(unsigned int i=1; i<N+1; i++) {
-                for(unsigned int c=0; c<PC; c++) u[0][c] += u[i][c]*b[i];
+    auto const load = [&] (int c1, IIRValue *u) {
+        for (int l = 0; l < LINES; l++) {
+            PT const *srcimg = src + (c2+l)*sstr2 + c1*sstr1;
+            for(unsigned int c=0; c<PC; c++) u[l*PC+c] = srcimg[c];
+        }
+    };
+    auto const store = [&] (int c1, IIRValue const *v) {
+        for (int l = 0; l < LINES; l++) {
+            PT *dstimg = dest + (c2+l)*dstr2 + c1*dstr1;
+            IIRValue const *vl = v + l*PC;
+            if ( PREMULTIPLIED_ALPHA ) {
+                dstimg[alpha_PC] = clip_round_cast<PT>(vl[alpha_PC]);
+                PREMUL_ALPHA_LOOP dstimg[c] = clip_round_cast_varmax<PT>(vl[c], dstimg[alpha_PC]);
+            } else {
+                for(unsigned int c=0; c<PC; c++) dstimg[c] = clip_round_cast<PT>(vl[c]);
             }
-            copy_n(u[0], PC, tmpdata[tid]+c1*PC);
         }
-        // Backward pass
-        IIRValue v[N+1][PC];
-        calcTriggsSdikaInitialization<PC>(M, u, iplus, iplus, b[0], v);
-        dstimg -= dstr1;
-        if ( PREMULTIPLIED_ALPHA ) {
-            dstimg[alpha_PC] = clip_round_cast<PT>(v[0][alpha_PC]);
-            PREMUL_ALPHA_LOOP dstimg[c] = clip_round_cast_varmax<PT>(v[0][c], dstimg[alpha_PC]);
-        } else {
-            for(unsigned int c=0; c<PC; c++) dstimg[c] = clip_round_cast<PT>(v[0][c]);
+    };
+
+    // Border constants
+    IIRValue imin[L];  load(0, imin);
+    IIRValue iplus[L]; load(n1-1, iplus);
+    // Forward pass
+    IIRValue u[N+1][L];
+    for(unsigned int i=0; i<N; i++) copy_n(imin, L, u[i]);
+    for ( int c1 = 0 ; c1 < n1 ; c1++ ) {
+        for(unsigned int i=N; i>0; i--) copy_n(u[i-1], L, u[i]);
+        load(c1, u[0]);
+        for(unsigned int k=0; k<L; k++) u[0][k] *= b[0];
+        for(unsigned int i=1; i<N+1; i++) {
+            for(unsigned int k=0; k<L; k++) u[0][k] += u[i][k]*b[i];
         }
-        int c1=n1-1;
-        while(c1-->0) {
-            for(unsigned int i=N; i>0; i--) copy_n(v[i-1], PC, v[i]);
-            copy_n(tmpdata[tid]+c1*PC, PC, v[0]);
-            for(unsigned int c=0; c<PC; c++) v[0][c] *= b[0];
-            for(unsigned int i=1; i<N+1; i++) {
-                for(unsigned int c=0; c<PC; c++) v[0][c] += v[i][c]*b[i];
-            }
-            dstimg -= dstr1;
-            if ( PREMULTIPLIED_ALPHA ) {
-                dstimg[alpha_PC] = clip_round_cast<PT>(v[0][alpha_PC]);
-                PREMUL_ALPHA_LOOP dstimg[c] = clip_round_cast_varmax<PT>(v[0][c], dstimg[alpha_PC]);
+        copy_n(u[0], L, tmpdata+c1*L);
+    }
+    // Backward pass
+    IIRValue v[N+1][L];
+    calcTriggsSdikaInitialization<L>(M, u, iplus, iplus, b[0], v);
+    store(n1-1, v[0]);
+    int c1=n1-1;
+    while(c1-->0) {
+        for(unsigned int i=N; i>0; i--) copy_n(v[i-1], L, v[i]);
+        copy_n(tmpdata+c1*L, L, v[0]);
+        for(unsigned int k=0; k<L; k++) v[0][k] *= b[0];
+        for(unsigned int i=1; i<N+1; i++) {
+            for(unsigned int k=0; k<L; k++) v[0][k] += v[i][k]*b[i];
+        }
+        store(c1, v[0]);
+    }
+}
+
+// Filters over 1st dimension
+template<typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA, int LINES>
+static void
+filter2D_IIR_blocked(PT *const dest, int const dstr1, int const dstr2,
+                     PT const *const src, int const sstr1, int const sstr2,
+                     int const n1, int const n2, IIRValue const b[N+1], double const M[N*N],
+                     int const num_threads)
+{
+    assert(src && dest);
+
+    // Full blocks first, then the remaining lines one by one.
+    int const blocks = n2 / LINES;
+    int const rest = n2 % LINES;
+    Inkscape::Async::Scheduler::get().parallel_for_ranges(0, blocks + rest, [&] (int begin, int end, int) {
+        std::vector<IIRValue> tmpdata(n1 * LINES * PC);
+        for (int i = begin; i < end; i++) {
+            if (i < blocks) {
+                filter_lines_IIR<PT, PC, PREMULTIPLIED_ALPHA, LINES>(dest, dstr1, dstr2, src, sstr1, sstr2,
+                                                                      n1, i * LINES, b, M, tmpdata.data());
             } else {
-                for(unsigned int c=0; c<PC; c++) dstimg[c] = clip_round_cast<PT>(v[0][c]);
+                filter_lines_IIR<PT, PC, PREMULTIPLIED_ALPHA, 1>(dest, dstr1, dstr2, src, sstr1, sstr2,
+                                                                  n1, blocks * LINES + i - blocks, b, M, tmpdata.data());
             }
         }
+    }, num_threads);
+}
+
+template<typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA>
+static void
+filter2D_IIR(PT *const dest, int const dstr1, int const dstr2,
+             PT const *const src, int const sstr1, int const sstr2,
+             int const n1, int const n2, IIRValue const b[N+1], double const M[N*N],
+             bool const blocked, int const num_threads)
+{
+    static int const ADJACENT_LINES = BLOCK_BYTES / (PC * sizeof(PT));
+    if (!blocked) {
+        filter2D_IIR_blocked<PT, PC, PREMULTIPLIED_ALPHA, 1>(dest, dstr1, dstr2, src, sstr1, sstr2, n1, n2, b, M, num_threads);
+    } else if (sstr2 == PC && dstr2 == PC) {
+        filter2D_IIR_blocked<PT, PC, PREMULTIPLIED_ALPHA, ADJACENT_LINES>(dest, dstr1, dstr2, src, sstr1, sstr2, n1, n2, b, M, num_threads);
+    } else {
+        filter2D_IIR_blocked<PT, PC, PREMULTIPLIED_ALPHA, BLOCK_LINES>(dest, dstr1, dstr2, src, sstr1, sstr2, n1, n2, b, M, num_threads);
     }
 }
 
@@ -371,106 +419,309 @@ filter2D_FIR(PT *const dst, int const dstr1, int const dstr2,
 {
     assert(src && dst);
 
-    // Past pixels seen (to enable in-place operation)
-    PT history[scr_len+1][PC];
+    Inkscape::Async::Scheduler::get().parallel_for_ranges(0, n2, [&] (int begin, int end, int) {
+        // Past pixels seen (to enable in-place operation)
+        PT history[scr_len+1][PC];
 
-INK_UNUSED(num_threads); // suppresses unused argument compiler warning
-#if HAVE_OPENMP
-#pragma omp parallel for num_threads(num_threads) private(history)
-#endif // HAVE_OPENMP
-    for ( int c2 = 0 ; c2 < n2 ; c2++ ) {
+        for ( int c2 = begin ; c2 < end ; c2++ ) {
 
-        // corresponding line in the source buffer
-        int const src_line = c2 * sstr2;
+            // corresponding line in the source buffer
+            int const src_line = c2 * sstr2;
 
-        // current line in the output buffer
-        int const dst_line = c2 * dstr2;
+            // current line in the output buffer
+            int const dst_line = c2 * dstr2;
 
-        int skipbuf[4] = {INT_MIN, INT_MIN, INT_MIN, INT_MIN};
+            int skipbuf[4] = {INT_MIN, INT_MIN, INT_MIN, INT_MIN};
 
-        // history initialization
-        PT imin[PC]; copy_n(src + src_line, PC, imin);
-        for(int i=0; i<scr_len; i++) copy_n(imin, PC, history[i]);
+            // history initialization
+            PT imin[PC]; copy_n(src + src_line, PC, imin);
+            for(int i=0; i<scr_len; i++) copy_n(imin, PC, history[i]);
 
-        for ( int c1 = 0 ; c1 < n1 ; c1++ ) {
+            for ( int c1 = 0 ; c1 < n1 ; c1++ ) {
 
-            int const src_disp = src_line + c1 * sstr1;
-            int const dst_disp = dst_line + c1 * dstr1;
+                int const src_disp = src_line + c1 * sstr1;
+                int const dst_disp = dst_line + c1 * dstr1;
 
-            // update history
-            for(int i=scr_len; i>0; i--) copy_n(history[i-1], PC, history[i]);
-            copy_n(src + src_disp, PC, history[0]);
+                // update history
+                for(int i=scr_len; i>0; i--) copy_n(history[i-1], PC, history[i]);
+                copy_n(src + src_disp, PC, history[0]);
 
-            // for all bytes of the pixel
-            for ( unsigned int byte = 0 ; byte < PC ; byte++) {
+                // for all bytes of the pixel
+                for ( unsigned int byte = 0 ; byte < PC ; byte++) {
 
-                if(skipbuf[byte] > c1) continue;
+                    if(skipbuf[byte] > c1) continue;
 
-                FIRValue sum = 0;
-                int last_in = -1;
-                int different_count = 0;
+                    FIRValue sum = 0;
+                    int last_in = -1;
+                    int different_count = 0;
 
-                // go over our point's neighbours in the history
-                for ( int i = 0 ; i <= scr_len ; i++ ) {
-                    // value at the pixel
-                    PT in_byte = history[i][byte];
+                    // go over our point's neighbours in the history
+                    for ( int i = 0 ; i <= scr_len ; i++ ) {
+                        // value at the pixel
+                        PT in_byte = history[i][byte];
 
-                    // is it the same as last one we saw?
-                    if(in_byte != last_in) different_count++;
-                    last_in = in_byte;
+                        // is it the same as last one we saw?
+                        if(in_byte != last_in) different_count++;
+                        last_in = in_byte;
 
-                    // sum pixels weighted by the kernel
-                    sum += in_byte * kernel[i];
-                }
+                        // sum pixels weighted by the kernel
+                        sum += in_byte * kernel[i];
+                    }
 
-                // go over our point's neighborhood on x axis in the in buffer
-                int nb_src_disp = src_disp + byte;
-                for ( int i = 1 ; i <= scr_len ; i++ ) {
-                    // the pixel we're looking at
-                    int c1_in = c1 + i;
-                    if (c1_in >= n1) {
-                        c1_in = n1 - 1;
-                    } else {
-                        nb_src_disp += sstr1;
+                    // go over our point's neighborhood on x axis in the in buffer
+                    int nb_src_disp = src_disp + byte;
+                    for ( int i = 1 ; i <= scr_len ; i++ ) {
+                        // the pixel we're looking at
+                        int c1_in = c1 + i;
+                        if (c1_in >= n1) {
+                            c1_in = n1 - 1;
+                        } else {
+                            nb_src_disp += sstr1;
+                        }
+
+                        // value at the pixel
+                        PT in_byte = src[nb_src_disp];
+
+                        // is it the same as last one we saw?
+                        if(in_byte != last_in) different_count++;
+                        last_in = in_byte;
+
+                        // sum pixels weighted by the kernel
+                        sum += in_byte * kernel[i];
                     }
 
-                    // value at the pixel
-                    PT in_byte = src[nb_src_disp];
+                    // store the result in bufx
+                    dst[dst_disp + byte] = round_cast<PT>(sum);
+
+                    // optimization: if there was no variation within this point's neighborhood,
+                    // skip ahead while we keep seeing the same last_in byte:
+                    // blurring flat color would not change it anyway
+                    if (different_count <= 1) { // note that different_count is at least 1, because last_in is initialized to -1
+                        int pos = c1 + 1;
+                        int nb_src_disp = src_disp + (1+scr_len)*sstr1 + byte; // src_line + (pos+scr_len) * sstr1 + byte
+                        int nb_dst_disp = dst_disp + (1)        *dstr1 + byte; // dst_line + (pos) * sstr1 + byte
+                        while(pos + scr_len < n1 && src[nb_src_disp] == last_in) {
+                            dst[nb_dst_disp] = last_in;
+                            pos++;
+                            nb_src_disp += sstr1;
+                            nb_dst_disp += dstr1;
+                        }
+                        skipbuf[byte] = pos;
+                    }
+                }
+            }
+        }
+    }, num_threads);
+}
 
-                    // is it the same as last one we saw?
-                    if(in_byte != last_in) different_count++;
-                    last_in = in_byte;
+// Filters LINES lines that are adjacent in memory, starting at c2, over the 1st dimension.
+// Produces exactly the same result as filter2D_FIR, which uses the same fixed point arithmetic,
+// but has no flat-area shortcut to keep the loop over the lanes branch-free.
+// kernel holds the raw 16.16 fixed point coefficients; history must hold (scr_len+1)*LINES*PC values.
+template<typename PT, unsigned int PC, int LINES>
+static void
+filter_lines_FIR(PT *const dst, int const dstr1, PT const *const src, int const sstr1,
+                 int const n1, int const c2, unsigned int const *const kernel, int const scr_len,
+                 PT *const history)
+{
+    static unsigned int const L = LINES*PC;
+    int const R = scr_len + 1;
+    PT const *const src_block = src + c2*PC;
+    PT *const dst_block = dst + c2*PC;
+
+    // Past pixels seen (to enable in-place operation), as a ring buffer indexed by c1 mod R.
+    // Positions before the start of the line repeat the first pixel.
+    for (int i = 0; i < R; i++) copy_n(src_block, L, history + i*L);
+
+    for ( int c1 = 0 ; c1 < n1 ; c1++ ) {
+        copy_n(src_block + c1*sstr1, L, history + (c1 % R)*L);
+
+        unsigned int sum[L];
+        for(unsigned int k=0; k<L; k++) sum[k] = 1u << 15; // rounding
+        for ( int i = 0 ; i <= scr_len ; i++ ) {
+            PT const *in = history + ((c1 - i + R) % R)*L;
+            for(unsigned int k=0; k<L; k++) sum[k] += in[k] * kernel[i];
+        }
+        for ( int i = 1 ; i <= scr_len ; i++ ) {
+            PT const *in = src_block + std::min(c1 + i, n1 - 1)*sstr1;
+            for(unsigned int k=0; k<L; k++) sum[k] += in[k] * kernel[i];
+        }
 
-                    // sum pixels weighted by the kernel
-                    sum += in_byte * kernel[i];
-                }
+        PT *out = dst_block + c1*dstr1;
+        for(unsigned int k=0; k<L; k++) out[k] = sum[k] >> 16;
+    }
+}
 
-                // store the result in bufx
-                dst[dst_disp + byte] = round_cast<PT>(sum);
-
-                // optimization: if there was no variation within this point's neighborhood,
-                // skip ahead while we keep seeing the same last_in byte:
-                // blurring flat color would not change it anyway
-                if (different_count <= 1) { // note that different_count is at least 1, because last_in is initialized to -1
-                    int pos = c1 + 1;
-                    int nb_src_disp = src_disp + (1+scr_len)*sstr1 + byte; // src_line + (pos+scr_len) * sstr1 + byte
-                    int nb_dst_disp = dst_disp + (1)        *dstr1 + byte; // dst_line + (pos) * sstr1 + byte
-                    while(pos + scr_len < n1 && src[nb_src_disp] == last_in) {
-                        dst[nb_dst_disp] = last_in;
-                        pos++;
-                        nb_src_disp += sstr1;
-                        nb_dst_disp += dstr1;
-                    }
-                    skipbuf[byte] = pos;
-                }
+template<typename PT, unsigned int PC>
+static void
+filter2D_FIR_blocked(PT *const dst, int const dstr1, int const dstr2,
+                     PT const *const src, int const sstr1, int const sstr2,
+                     int const n1, int const n2, FIRValue const *const kernel, int const scr_len, int const num_threads)
+{
+    assert(src && dst);
+    static int const LINES = BLOCK_BYTES / (PC * sizeof(PT));
+
+    std::vector<unsigned int> kernel_raw(scr_len + 1);
+    for (int i = 0; i <= scr_len; i++) {
+        kernel_raw[i] = static_cast<unsigned int>(std::ldexp(static_cast<double>(kernel[i]), 16));
+    }
+
+    int const blocks = n2 / LINES;
+    Inkscape::Async::Scheduler::get().parallel_for_ranges(0, blocks, [&] (int begin, int end, int) {
+        std::vector<PT> history((scr_len + 1) * LINES * PC);
+        for (int i = begin; i < end; i++) {
+            filter_lines_FIR<PT, PC, LINES>(dst, dstr1, src, sstr1, n1, i * LINES, kernel_raw.data(), scr_len, history.data());
+        }
+    }, num_threads);
+
+    // The remaining lines one by one.
+    int const done = blocks * LINES;
+    if (done < n2) {
+        filter2D_FIR<PT, PC>(dst + done * dstr2, dstr1, dstr2, src + done * sstr2, sstr1, sstr2,
+                             n1, n2 - done, kernel, scr_len, num_threads);
+    }
+}
+
+// Approximation of the Gaussian by three extended box filters, based on:
+// P. Gwosdek, S. Grewenig, A. Bruhn, J. Weickert, Theoretical Foundations of Gaussian
+// Convolution by Extended Box Filtering, SSVM 2011, LNCS 6667, 447-458.
+//
+// An extended box of radius r has weight 1 at offsets up to r and weight alpha in [0,1) at r+1,
+// so its variance can be matched to that of the Gaussian exactly instead of in whole pixel steps.
+// Each box is a running sum, so the cost per pixel does not depend on the deviation.
+static int const BOX_PASSES = 3;
+
+// Single precision is plenty: the running sums drift by well under one level of 8 bits.
+typedef float BoxValue;
+
+struct ExtendedBox
+{
+    int r;
+    BoxValue alpha;
+    BoxValue norm; // reciprocal of the total weight
+};
+
+static ExtendedBox calcExtendedBox(double const deviation)
+{
+    double const var = sqr(deviation) / BOX_PASSES;
+    // Widest plain box whose variance r(r+1)/3 does not exceed var.
+    int const r = static_cast<int>(std::floor((std::sqrt(1 + 12*var) - 1) / 2));
+    double const alpha = (2*r+1) * (r*(r+1) - 3*var) / (6*(var - sqr(r+1.0)));
+    return {r, static_cast<BoxValue>(alpha), static_cast<BoxValue>(1 / (2*r+1 + 2*alpha))};
+}
+
+// Filters LINES lines starting at c2 over the 1st dimension with BOX_PASSES extended boxes.
+//
+// The passes are pipelined: pass k consumes the output of pass k-1 as soon as it is produced,
+// lagging r+1 pixels behind it, so each pass only keeps a ring buffer of its last 2r+3 inputs.
+// The line is extended by repeating its end pixels, like the exact filters do. Before the start
+// of the line every pass sees a constant, so the rings start out filled with the first pixel.
+// tmpdata must hold BOX_PASSES*(2*box.r+3)*LINES*PC values.
+template<typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA, int LINES>
+static void
+filter_lines_box(PT *const dest, int const dstr1, int const dstr2,
+                 PT const *const src, int const sstr1, int const sstr2,
+                 int const n1, int const c2, ExtendedBox const &box, BoxValue *const tmpdata)
+{
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    static unsigned int const alpha_PC = PC-1;
+#else
+    static unsigned int const alpha_PC = 0;
+#endif
+    static unsigned int const L = LINES*PC;
+    int const reach = box.r + 1;
+    int const R = 2*reach + 1;
+
+    BoxValue value[L];
+    auto const load = [&] (int c1) {
+        for (int l = 0; l < LINES; l++) {
+            PT const *srcimg = src + (c2+l)*sstr2 + c1*sstr1;
+            for(unsigned int c=0; c<PC; c++) value[l*PC+c] = srcimg[c];
+        }
+    };
+
+    BoxValue sum[BOX_PASSES][L];
+    load(0);
+    for (int pass = 0; pass < BOX_PASSES; pass++) {
+        for (int i = 0; i < R; i++) copy_n(value, L, tmpdata + (pass*R + i)*L);
+        for(unsigned int k=0; k<L; k++) sum[pass][k] = (2*box.r+1) * value[k];
+    }
+
+    // Input t is the pixel at t, and the output of pass k is the pixel at t - (k+1)*reach.
+    for ( int t = 0 ; t < n1 + BOX_PASSES*reach ; t++ ) {
+        load(std::min(t, n1 - 1));
+
+        int const newest = t % R;
+        int const oldest = (t + 1) % R;
+        int const leaving = (t + 2) % R;
+        for (int pass = 0; pass < BOX_PASSES; pass++) {
+            BoxValue *ring = tmpdata + pass*R*L;
+            copy_n(value, L, ring + newest*L);
+            BoxValue const *lo = ring + oldest*L;
+            BoxValue const *first = ring + leaving*L;
+            for(unsigned int k=0; k<L; k++) {
+                BoxValue const in = value[k];
+                value[k] = (sum[pass][k] + box.alpha * (lo[k] + in)) * box.norm;
+                sum[pass][k] += in - first[k];
+            }
+        }
+
+        int const c1 = t - BOX_PASSES*reach;
+        if (c1 < 0) continue;
+        for (int l = 0; l < LINES; l++) {
+            PT *dstimg = dest + (c2+l)*dstr2 + c1*dstr1;
+            BoxValue const *vl = value + l*PC;
+            if ( PREMULTIPLIED_ALPHA ) {
+                dstimg[alpha_PC] = clip_round_cast<PT>(vl[alpha_PC]);
+                PREMUL_ALPHA_LOOP dstimg[c] = clip_round_cast_varmax<PT>(vl[c], dstimg[alpha_PC]);
+            } else {
+                for(unsigned int c=0; c<PC; c++) dstimg[c] = clip_round_cast<PT>(vl[c]);
+            }
+        }
+    }
+}
+
+template<typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA, int LINES>
+static void
+filter2D_box_blocked(PT *const dest, int const dstr1, int const dstr2,
+                     PT const *const src, int const sstr1, int const sstr2,
+                     int const n1, int const n2, ExtendedBox const &box, int const num_threads)
+{
+    assert(src && dest);
+
+    int const blocks = n2 / LINES;
+    int const rest = n2 % LINES;
+    Inkscape::Async::Scheduler::get().parallel_for_ranges(0, blocks + rest, [&] (int begin, int end, int) {
+        std::vector<BoxValue> tmpdata(BOX_PASSES * (2 * box.r + 3) * LINES * PC);
+        for (int i = begin; i < end; i++) {
+            if (i < blocks) {
+                filter_lines_box<PT, PC, PREMULTIPLIED_ALPHA, LINES>(dest, dstr1, dstr2, src, sstr1, sstr2,
+                                                                      n1, i * LINES, box, tmpdata.data());
+            } else {
+                filter_lines_box<PT, PC, PREMULTIPLIED_ALPHA, 1>(dest, dstr1, dstr2, src, sstr1, sstr2,
+                                                                  n1, blocks * LINES + i - blocks, box, tmpdata.data());
             }
         }
+    }, num_threads);
+}
+
+template<typename PT, unsigned int PC, bool PREMULTIPLIED_ALPHA>
+static void
+filter2D_box(PT *const dest, int const dstr1, int const dstr2,
+             PT const *const src, int const sstr1, int const sstr2,
+             int const n1, int const n2, ExtendedBox const &box, int const num_threads)
+{
+    static int const ADJACENT_LINES = BLOCK_BYTES / (PC * sizeof(PT));
+    if (sstr2 == PC && dstr2 == PC) {
+        filter2D_box_blocked<PT, PC, PREMULTIPLIED_ALPHA, ADJACENT_LINES>(dest, dstr1, dstr2, src, sstr1, sstr2, n1, n2, box, num_threads);
+    } else {
+        filter2D_box_blocked<PT, PC, PREMULTIPLIED_ALPHA, BLOCK_LINES>(dest, dstr1, dstr2, src, sstr1, sstr2, n1, n2, box, num_threads);
     }
 }
 
 static void
 gaussian_pass_IIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_surface_t *dest,
-    IIRValue **tmpdata, int num_threads)
+    bool blocked, int num_threads)
 {
     // Filter variables
     IIRValue b[N+1];  // scaling coefficient + filter coefficients (can be 10.21 fixed point)
@@ -500,13 +751,13 @@ gaussian_pass_IIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_su
         filter2D_IIR<unsigned char,1,false>(
             cairo_image_surface_get_data(dest), d == Geom::X ? 1 : stride, d == Geom::X ? stride : 1,
             cairo_image_surface_get_data(src),  d == Geom::X ? 1 : stride, d == Geom::X ? stride : 1,
-            w, h, b, M, tmpdata, num_threads);
+            w, h, b, M, blocked, num_threads);
         break;
     case CAIRO_FORMAT_ARGB32: ///< Premultiplied 8 bit RGBA
         filter2D_IIR<unsigned char,4,true>(
             cairo_image_surface_get_data(dest), d == Geom::X ? 4 : stride, d == Geom::X ? stride : 4,
             cairo_image_surface_get_data(src),  d == Geom::X ? 4 : stride, d == Geom::X ? stride : 4,
-            w, h, b, M, tmpdata, num_threads);
+            w, h, b, M, blocked, num_threads);
         break;
     default:
         g_warning("gaussian_pass_IIR: unsupported image format");
@@ -515,7 +766,7 @@ gaussian_pass_IIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_su
 
 static void
 gaussian_pass_FIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_surface_t *dest,
-    int num_threads)
+    bool blocked, int num_threads)
 {
     int scr_len = _effect_area_scr(deviation);
     // Filter kernel for x direction
@@ -527,16 +778,20 @@ gaussian_pass_FIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_su
     int h = cairo_image_surface_get_height(src);
     if (d != Geom::X) std::swap(w, h);
 
+    // The columns of the vertical pass are adjacent in memory, so they can be filtered in blocks.
+    auto const filter_A8 = blocked && d == Geom::Y ? filter2D_FIR_blocked<unsigned char,1> : filter2D_FIR<unsigned char,1>;
+    auto const filter_ARGB32 = blocked && d == Geom::Y ? filter2D_FIR_blocked<unsigned char,4> : filter2D_FIR<unsigned char,4>;
+
     // Filter (x)
     switch (cairo_image_surface_get_format(src)) {
     case CAIRO_FORMAT_A8:        ///< Grayscale
-        filter2D_FIR<unsigned char,1>(
+        filter_A8(
             cairo_image_surface_get_data(dest), d == Geom::X ? 1 : stride, d == Geom::X ? stride : 1,
             cairo_image_surface_get_data(src),  d == Geom::X ? 1 : stride, d == Geom::X ? stride : 1,
             w, h, &kernel[0], scr_len, num_threads);
         break;
     case CAIRO_FORMAT_ARGB32: ///< Premultiplied 8 bit RGBA
-        filter2D_FIR<unsigned char,4>(
+        filter_ARGB32(
             cairo_image_surface_get_data(dest), d == Geom::X ? 4 : stride, d == Geom::X ? stride : 4,
             cairo_image_surface_get_data(src),  d == Geom::X ? 4 : stride, d == Geom::X ? stride : 4,
             w, h, &kernel[0], scr_len, num_threads);
@@ -546,6 +801,89 @@ gaussian_pass_FIR(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_su
     };
 }
 
+void gaussian_blur_surface(cairo_surface_t *surface, double deviation_x, double deviation_y, bool blocked)
+{
+    int threads = get_num_filter_threads();
+    cairo_surface_flush(surface);
+
+    // Decide which filter to use for X and Y
+    // This threshold was determined by trial-and-error for one specific machine,
+    // so there's a good chance that it's not optimal.
+    // Whatever you do, don't go below 1 (and preferably not even below 2), as
+    // the IIR filter gets unstable there.
+    if (_effect_area_scr(deviation_x) > 0) {
+        if (deviation_x > 3) {
+            gaussian_pass_IIR(Geom::X, deviation_x, surface, surface, blocked, threads);
+        } else {
+            gaussian_pass_FIR(Geom::X, deviation_x, surface, surface, blocked, threads);
+        }
+    }
+
+    if (_effect_area_scr(deviation_y) > 0) {
+        if (deviation_y > 3) {
+            gaussian_pass_IIR(Geom::Y, deviation_y, surface, surface, blocked, threads);
+        } else {
+            gaussian_pass_FIR(Geom::Y, deviation_y, surface, surface, blocked, threads);
+        }
+    }
+
+    cairo_surface_mark_dirty(surface);
+}
+
+static void
+box_pass(Geom::Dim2 d, double deviation, cairo_surface_t *src, cairo_surface_t *dest, int num_threads)
+{
+    auto const box = calcExtendedBox(deviation);
+
+    int stride = cairo_image_surface_get_stride(src);
+    int w = cairo_image_surface_get_width(src);
+    int h = cairo_image_surface_get_height(src);
+    if (d != Geom::X) std::swap(w, h);
+
+    switch (cairo_image_surface_get_format(src)) {
+    case CAIRO_FORMAT_A8:        ///< Grayscale
+        filter2D_box<unsigned char,1,false>(
+            cairo_image_surface_get_data(dest), d == Geom::X ? 1 : stride, d == Geom::X ? stride : 1,
+            cairo_image_surface_get_data(src),  d == Geom::X ? 1 : stride, d == Geom::X ? stride : 1,
+            w, h, box, num_threads);
+        break;
+    case CAIRO_FORMAT_ARGB32: ///< Premultiplied 8 bit RGBA
+        filter2D_box<unsigned char,4,true>(
+            cairo_image_surface_get_data(dest), d == Geom::X ? 4 : stride, d == Geom::X ? stride : 4,
+            cairo_image_surface_get_data(src),  d == Geom::X ? 4 : stride, d == Geom::X ? stride : 4,
+            w, h, box, num_threads);
+        break;
+    default:
+        g_warning("box_pass: unsupported image format");
+    };
+}
+
+void box_blur_surface(cairo_surface_t *surface, double deviation_x, double deviation_y)
+{
+    int threads = get_num_filter_threads();
+    cairo_surface_flush(surface);
+
+    // Below a deviation of 2 the boxes are too narrow to approximate the Gaussian well, while
+    // the exact FIR filter only needs a handful of taps, so it is used instead.
+    if (_effect_area_scr(deviation_x) > 0) {
+        if (deviation_x >= 2) {
+            box_pass(Geom::X, deviation_x, surface, surface, threads);
+        } else {
+            gaussian_pass_FIR(Geom::X, deviation_x, surface, surface, true, threads);
+        }
+    }
+
+    if (_effect_area_scr(deviation_y) > 0) {
+        if (deviation_y >= 2) {
+            box_pass(Geom::Y, deviation_y, surface, surface, threads);
+        } else {
+            gaussian_pass_FIR(Geom::Y, deviation_y, surface, surface, true, threads);
+        }
+    }
+
+    cairo_surface_mark_dirty(surface);
+}
+
 void FilterGaussian::render_cairo(FilterSlot &slot) const
 {
     cairo_surface_t *in = slot.getcairo(_input);
@@ -587,18 +925,7 @@ void FilterGaussian::render_cairo(FilterSlot &slot) const
     deviation_x_orig *= device_scale;
     deviation_y_orig *= device_scale;
 
-    cairo_format_t fmt = cairo_image_surface_get_format(in);
-    int bytes_per_pixel = 0;
-    switch (fmt) {
-        case CAIRO_FORMAT_A8:
-            bytes_per_pixel = 1; break;
-        case CAIRO_FORMAT_ARGB32:
-        default:
-            bytes_per_pixel = 4; break;
-    }
-
     int quality = slot.get_blurquality();
-    int threads = get_num_filter_threads();
     int x_step = 1 << _effect_subsample_step_log2(deviation_x_orig, quality);
     int y_step = 1 << _effect_subsample_step_log2(deviation_y_orig, quality);
     bool resampling = x_step > 1 || y_step > 1;
@@ -608,32 +935,12 @@ void FilterGaussian::render_cairo(FilterSlot &slot) const
     int h_downsampled = resampling ? static_cast<int>(ceil(static_cast<double>(h_orig)/y_step))+1 : h_orig;
     double deviation_x = deviation_x_orig / x_step;
     double deviation_y = deviation_y_orig / y_step;
-    int scr_len_x = _effect_area_scr(deviation_x);
-    int scr_len_y = _effect_area_scr(deviation_y);
-
-    // Decide which filter to use for X and Y
-    // This threshold was determined by trial-and-error for one specific machine,
-    // so there's a good chance that it's not optimal.
-    // Whatever you do, don't go below 1 (and preferably not even below 2), as
-    // the IIR filter gets unstable there.
-    bool use_IIR_x = deviation_x > 3;
-    bool use_IIR_y = deviation_y > 3;
-
-    // Temporary storage for IIR filter
-    // NOTE: This can be eliminated, but it reduces the precision a bit
-    IIRValue * tmpdata[threads];
-    std::fill_n(tmpdata, threads, (IIRValue*)0);
-    if ( use_IIR_x || use_IIR_y ) {
-        for(int i = 0; i < threads; ++i) {
-            tmpdata[i] = new IIRValue[std::max(w_downsampled,h_downsampled)*bytes_per_pixel];
-        }
-    }
 
     cairo_surface_t *downsampled = nullptr;
     if (resampling) {
         // Divide by device scale as w_downsampled is in pixels while
         // cairo_surface_create_similar() uses device units.
-        downsampled = cairo_surface_create_similar(in, cairo_surface_get_content(in),
+        downsampled = SurfacePool::create_similar(in, cairo_surface_get_content(in),
             w_downsampled/device_scale, h_downsampled/device_scale);
         cairo_t *ct = cairo_create(downsampled);
         cairo_scale(ct, static_cast<double>(w_downsampled)/w_orig, static_cast<double>(h_downsampled)/h_orig);
@@ -643,35 +950,17 @@ void FilterGaussian::render_cairo(FilterSlot &slot) const
     } else {
         downsampled = ink_cairo_surface_copy(in);
     }
-    cairo_surface_flush(downsampled);
-
-    if (scr_len_x > 0) {
-        if (use_IIR_x) {
-            gaussian_pass_IIR(Geom::X, deviation_x, downsampled, downsampled, tmpdata, threads);
-        } else {
-            gaussian_pass_FIR(Geom::X, deviation_x, downsampled, downsampled, threads);
-        }
-    }
 
-    if (scr_len_y > 0) {
-        if (use_IIR_y) {
-            gaussian_pass_IIR(Geom::Y, deviation_y, downsampled, downsampled, tmpdata, threads);
-        } else {
-            gaussian_pass_FIR(Geom::Y, deviation_y, downsampled, downsampled, threads);
-        }
-    }
-
-    // free the temporary data
-    if ( use_IIR_x || use_IIR_y ) {
-        for(int i = 0; i < threads; ++i) {
-            delete[] tmpdata[i];
-        }
+    // Below BLUR_QUALITY_BETTER the Gaussian is also approximated, in addition to subsampling.
+    if (quality <= BLUR_QUALITY_NORMAL) {
+        box_blur_surface(downsampled, deviation_x, deviation_y);
+    } else {
+        gaussian_blur_surface(downsampled, deviation_x, deviation_y);
     }
 
-    cairo_surface_mark_dirty(downsampled);
     if (resampling) {
-        cairo_surface_t *upsampled = cairo_surface_create_similar(downsampled, cairo_surface_get_content(downsampled),
-                                                                  w_orig / device_scale, h_orig / device_scale);
+        cairo_surface_t *upsampled = SurfacePool::create_similar(downsampled, cairo_surface_get_content(downsampled),
+                                                                 w_orig / device_scale, h_orig / device_scale);
         cairo_t *ct = cairo_create(upsampled);
         cairo_scale(ct, static_cast<double>(w_orig) / w_downsampled, static_cast<double>(h_orig) / h_downsampled);
         cairo_set_source_surface(ct, downsampled, 0, 0);
@@ -18,6 +18,11 @@
 #include <2geom/forward.h>
 #include "display/nr-filter-primitive.h"
 
+extern "C" {
+typedef struct _cairo_surface cairo_surface_t;
+}
+
+/// Qualities up to BLUR_QUALITY_NORMAL approximate the Gaussian with box filters; see box_blur_surface().
 enum
 {
     BLUR_QUALITY_BEST = 2,
@@ -30,6 +35,23 @@ enum
 namespace Inkscape {
 namespace Filters {
 
+/**
+ * Blur an ARGB32 or A8 image surface in place, with the standard deviations given in pixels.
+ * This is the blur engine of FilterGaussian, without the subsampling used at lower qualities.
+ * Lines are filtered in cache-friendly blocks, unless blocked is false, in which case every line
+ * is filtered on its own; the results are identical, so that is only useful for comparison.
+ */
+void gaussian_blur_surface(cairo_surface_t *surface, double deviation_x, double deviation_y, bool blocked = true);
+
+/**
+ * Blur an ARGB32 or A8 image surface in place with an approximation of the Gaussian, made of
+ * three box filters with the same total variance, so it takes constant time per pixel whatever
+ * the deviation. Deviations below 2 pixels are blurred exactly. Results differ from those of
+ * gaussian_blur_surface() by at most 5 levels of 255 per channel, both on noise and on hard edges;
+ * the differences are largest around the corners of sharp shapes.
+ */
+void box_blur_surface(cairo_surface_t *surface, double deviation_x, double deviation_y);
+
 class FilterGaussian : public FilterPrimitive
 {
 public:
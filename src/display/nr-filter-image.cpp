@@ -21,6 +21,7 @@
 #include "display/nr-filter.h"
 #include "display/nr-filter-slot.h"
 #include "display/nr-filter-units.h"
+#include "display/surface-pool.h"
 #include "enums.h"
 #include <glibmm/fileutils.h>
 
@@ -68,7 +69,7 @@ void FilterImage::render_cairo(FilterSlot &slot) const
     int device_scale = slot.get_device_scale();
 
     Geom::Rect sa = slot.get_slot_area();
-    cairo_surface_t *out = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, sa.width() * device_scale, sa.height() * device_scale);
+    cairo_surface_t *out = SurfacePool::create(CAIRO_FORMAT_ARGB32, sa.width() * device_scale, sa.height() * device_scale);
     cairo_surface_set_device_scale(out, device_scale, device_scale);
 
     Inkscape::DrawingContext dc(out, sa.min());
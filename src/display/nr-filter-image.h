@@ -31,6 +31,7 @@ class FilterImage : public FilterPrimitive
 {
 public:
     void render_cairo(FilterSlot &slot) const override;
+    std::vector<int> get_inputs() const override { return {}; }
     bool can_handle_affine(Geom::Affine const &) const override;
     double complexity(Geom::Affine const &ctm) const override;
 
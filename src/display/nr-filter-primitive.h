@@ -12,7 +12,9 @@
 #ifndef SEEN_NR_FILTER_PRIMITIVE_H
 #define SEEN_NR_FILTER_PRIMITIVE_H
 
+#include <functional>
 #include <memory>
+#include <vector>
 #include <2geom/forward.h>
 #include <2geom/rect.h>
 
@@ -71,6 +73,30 @@ public:
      */
     virtual void set_output(int slot);
 
+    /// The slots read by render_cairo(), in the order of the inputs.
+    virtual std::vector<int> get_inputs() const { return {_input}; }
+
+    /// The slot written by render_cairo().
+    int get_output() const { return _output; }
+
+    SPColorInterpolation get_color_interpolation() const { return color_interpolation; }
+
+    /// A per-pixel operation on a span of premultiplied ARGB32 pixels, which may be done in place.
+    using PixelMap = std::function<void(guint32 const *in, guint32 *out, int n)>;
+
+    /// A per-pixel operation combining spans of two inputs, which may be done in place.
+    using PixelBlend = std::function<void(guint32 const *in1, guint32 const *in2, guint32 *out, int n)>;
+
+    /**
+     * For primitives whose output pixels only depend on the input pixel at the same position,
+     * and which always produce an ARGB32 result: the operation applied to every pixel.
+     * Empty for all other primitives. Used by Filter::optimize() to fuse chains of primitives.
+     */
+    virtual PixelMap pixel_map() const { return {}; }
+
+    /// The counterpart of pixel_map() for primitives with two inputs.
+    virtual PixelBlend pixel_blend() const { return {}; }
+
     // returns cache score factor, reflecting the cost of rendering this filter
     // this should return how many times slower this primitive is that normal rendering
     virtual double complexity(Geom::Affine const &/*ctm*/) const { return 1.0; }
@@ -23,6 +23,7 @@
 #include "nr-filter-gaussian.h"
 #include "nr-filter-slot.h"
 #include "nr-filter-units.h"
+#include "surface-pool.h"
 
 namespace Inkscape {
 namespace Filters {
@@ -118,7 +119,7 @@ cairo_surface_t *FilterSlot::getcairo(int slot_nr)
 
     if (s == _slots.end()) {
         // create empty surface
-        cairo_surface_t *empty = cairo_surface_create_similar(
+        cairo_surface_t *empty = SurfacePool::create_similar(
             _source_graphic, cairo_surface_get_content(_source_graphic),
             _slot_w, _slot_h);
         _set_internal(slot_nr, empty);
@@ -137,7 +138,7 @@ cairo_surface_t *FilterSlot::_get_transformed_source_graphic() const
         return _source_graphic;
     }
 
-    cairo_surface_t *tsg = cairo_surface_create_similar(
+    cairo_surface_t *tsg = SurfacePool::create_similar(
         _source_graphic, cairo_surface_get_content(_source_graphic),
         _slot_w, _slot_h);
     cairo_t *tsg_ct = cairo_create(tsg);
@@ -161,7 +162,7 @@ cairo_surface_t *FilterSlot::_get_transformed_background() const
 
     if (_background_ct) {
         cairo_surface_t *bg = cairo_get_group_target(_background_ct);
-        tbg = cairo_surface_create_similar(
+        tbg = SurfacePool::create_similar(
             bg, cairo_surface_get_content(bg),
             _slot_w, _slot_h);
         cairo_t *tbg_ct = cairo_create(tbg);
@@ -174,7 +175,7 @@ cairo_surface_t *FilterSlot::_get_transformed_background() const
         cairo_paint(tbg_ct);
         cairo_destroy(tbg_ct);
     } else {
-        tbg = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, _slot_w * device_scale, _slot_h * device_scale);
+        tbg = SurfacePool::create(CAIRO_FORMAT_ARGB32, _slot_w * device_scale, _slot_h * device_scale);
     }
 
     return tbg;
@@ -190,7 +191,7 @@ cairo_surface_t *FilterSlot::get_result(int res)
         return result;
     }
 
-    cairo_surface_t *r = cairo_surface_create_similar(_source_graphic,
+    cairo_surface_t *r = SurfacePool::create_similar(_source_graphic,
         cairo_surface_get_content(_source_graphic),
         _source_graphic_area.width(),
         _source_graphic_area.height());
@@ -233,6 +234,15 @@ void FilterSlot::set(int slot_nr, cairo_surface_t *surface)
     _last_out = slot_nr;
 }
 
+void FilterSlot::release(int slot_nr)
+{
+    SlotMap::iterator s = _slots.find(slot_nr);
+    if (s != _slots.end()) {
+        cairo_surface_destroy(s->second);
+        _slots.erase(s);
+    }
+}
+
 void FilterSlot::set_primitive_area(int slot_nr, Geom::Rect &area)
 {
     if (slot_nr == NR_FILTER_SLOT_NOT_SET)
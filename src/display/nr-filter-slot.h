@@ -57,6 +57,11 @@ public:
 
     cairo_surface_t *get_result(int slot_nr);
 
+    /** Drops the pixblock in the given slot. Reading the slot afterwards gives an empty
+     * pixblock, or recreates it for the pre-defined slots.
+     */
+    void release(int slot);
+
     void set_primitive_area(int slot, Geom::Rect &area);
     Geom::Rect get_primitive_area(int slot) const;
     
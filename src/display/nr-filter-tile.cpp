@@ -16,6 +16,7 @@
 #include "display/nr-filter-tile.h"
 #include "display/nr-filter-slot.h"
 #include "display/nr-filter-units.h"
+#include "display/surface-pool.h"
 
 namespace Inkscape {
 namespace Filters {
@@ -65,8 +66,8 @@ void FilterTile::render_cairo(FilterSlot &slot) const
         Geom::Point shift = sa.min() - tt.min(); 
 
         // Create feTile tile surface
-        cairo_surface_t *tile = cairo_surface_create_similar(in, cairo_surface_get_content(in),
-                                                             tt.width(), tt.height());
+        cairo_surface_t *tile = SurfacePool::create_similar(in, cairo_surface_get_content(in),
+                                                            tt.width(), tt.height());
         cairo_t *ct_tile = cairo_create(tile);
         cairo_set_source_surface(ct_tile, in, shift[Geom::X], shift[Geom::Y]);
         cairo_paint(ct_tile);
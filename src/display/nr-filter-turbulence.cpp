@@ -24,6 +24,7 @@
 #include "display/nr-filter-turbulence.h"
 #include "display/nr-filter-units.h"
 #include "display/nr-filter-utils.h"
+#include "display/surface-pool.h"
 #include <cmath>
 
 namespace Inkscape {
@@ -395,7 +396,7 @@ void FilterTurbulence::render_cairo(FilterSlot &slot) const
     cairo_surface_get_device_scale(input, &x_scale, &y_scale);
     int width  = ceil(cairo_image_surface_get_width( input)/x_scale/x_scale);
     int height = ceil(cairo_image_surface_get_height(input)/y_scale/y_scale);
-    cairo_surface_t *temp = cairo_surface_create_similar (input, CAIRO_CONTENT_COLOR_ALPHA, width, height);
+    cairo_surface_t *temp = SurfacePool::create_similar(input, CAIRO_CONTENT_COLOR_ALPHA, width, height);
     cairo_surface_set_device_scale( temp, 1, 1 );
 
     // color_interpolation_filter is determined by CSS value (see spec. Turbulence).
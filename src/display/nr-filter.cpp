@@ -11,8 +11,10 @@
  */
 
 #include <glib.h>
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <map>
 #include <string>
 #include <cairo.h>
 
@@ -39,6 +41,7 @@
 #include "display/nr-filter-tile.h"
 #include "display/nr-filter-turbulence.h"
 
+#include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
 #include "display/drawing.h"
 #include "display/drawing-item.h"
@@ -55,6 +58,148 @@ namespace Filters {
 using Geom::X;
 using Geom::Y;
 
+namespace {
+
+/// Applies a chain of per-pixel operations in a single pass.
+struct PixelMapChain
+{
+    std::vector<FilterPrimitive::PixelMap> maps;
+
+    guint32 operator()(guint32 in)
+    {
+        span(&in, &in, 1);
+        return in;
+    }
+
+    void span(guint32 const *in, guint32 *out, int n)
+    {
+        maps.front()(in, out, n);
+        for (auto i = maps.begin() + 1; i != maps.end(); ++i) {
+            (*i)(out, out, n);
+        }
+    }
+};
+
+/// Adapts a PixelBlend to ink_cairo_surface_blend().
+struct PixelBlendFunctor
+{
+    FilterPrimitive::PixelBlend blend;
+
+    guint32 operator()(guint32 in1, guint32 in2)
+    {
+        guint32 out;
+        blend(&in1, &in2, &out, 1);
+        return out;
+    }
+
+    void span(guint32 const *in1, guint32 const *in2, guint32 *out, int n)
+    {
+        blend(in1, in2, out, n);
+    }
+};
+
+/// Blends two inputs, one of which is first passed through a chain of per-pixel operations.
+struct PixelMapBlend
+{
+    PixelMapChain chain;
+    FilterPrimitive::PixelBlend blend;
+    bool chain_first; ///< Whether the chain applies to the first input rather than the second.
+
+    guint32 operator()(guint32 in1, guint32 in2)
+    {
+        guint32 out;
+        span(&in1, &in2, &out, 1);
+        return out;
+    }
+
+    void span(guint32 const *in1, guint32 const *in2, guint32 *out, int n)
+    {
+        if (chain_first) {
+            chain.span(in1, out, n);
+            blend(out, in2, out, n);
+        } else {
+            chain.span(in2, out, n);
+            blend(in1, out, out, n);
+        }
+    }
+};
+
+/**
+ * Stands in for a chain of per-pixel primitives, each only read by the next one, optionally
+ * ending in a two-input primitive. Renders the whole chain without intermediate images.
+ */
+class FilterFused final : public FilterPrimitive
+{
+public:
+    /**
+     * @param input The slot read by the start of the chain.
+     * @param other The other input of the blend, if any.
+     */
+    FilterFused(std::vector<FilterPrimitive const *> maps, FilterPrimitive const *blend, bool chain_first,
+                int input, int other, int output)
+        : _blend(blend)
+        , _last(blend ? blend : maps.back())
+        , _other(other)
+        , _chain_first(chain_first)
+    {
+        for (auto map : maps) {
+            _chain.maps.emplace_back(map->pixel_map());
+        }
+        _input = input;
+        _output = output;
+        color_interpolation = maps.front()->get_color_interpolation();
+    }
+
+    void render_cairo(FilterSlot &slot) const override
+    {
+        cairo_surface_t *input = slot.getcairo(_input);
+        set_cairo_surface_ci(input, color_interpolation);
+
+        // The chain always produces a colour image, so the output does too.
+        cairo_surface_t *out = ink_cairo_surface_create_same_size(input, CAIRO_CONTENT_COLOR_ALPHA);
+        set_cairo_surface_ci(out, color_interpolation);
+
+        // The output is that of the last primitive of the chain, and so is its subregion.
+        Geom::Rect vp = _last->filter_primitive_area(slot.get_units());
+        slot.set_primitive_area(_output, vp); // Needed for tiling
+
+        if (!_blend) {
+            ink_cairo_surface_filter(input, out, _chain);
+        } else {
+            cairo_surface_t *other = slot.getcairo(_other);
+            set_cairo_surface_ci(other, color_interpolation);
+
+            if (cairo_image_surface_get_format(input) == CAIRO_FORMAT_ARGB32) {
+                auto in1 = _chain_first ? input : other;
+                auto in2 = _chain_first ? other : input;
+                ink_cairo_surface_blend(in1, in2, out, PixelMapBlend{_chain, _blend->pixel_blend(), _chain_first});
+            } else {
+                // Alpha-only input; map it to colour first, then blend in place.
+                ink_cairo_surface_filter(input, out, _chain);
+                auto in1 = _chain_first ? out : other;
+                auto in2 = _chain_first ? other : out;
+                ink_cairo_surface_blend(in1, in2, out, PixelBlendFunctor{_blend->pixel_blend()});
+            }
+        }
+
+        slot.set(_output, out);
+        cairo_surface_destroy(out);
+    }
+
+    bool can_handle_affine(Geom::Affine const &) const override { return true; }
+
+    Glib::ustring name() const override { return Glib::ustring("Fused"); }
+
+private:
+    PixelMapChain _chain;
+    FilterPrimitive const *_blend;
+    FilterPrimitive const *_last;
+    int _other;
+    bool _chain_first;
+};
+
+} // namespace
+
 Filter::Filter()
 {
     _common_init();
@@ -144,8 +289,17 @@ int Filter::render(Inkscape::DrawingItem const *item, DrawingContext &graphic, D
 
     auto slot = FilterSlot(bgdc, graphic, units, rc, blurquality);
 
-    for (auto &i : primitives) {
-        i->render_cairo(slot);
+    if (_plan.empty()) {
+        for (auto &i : primitives) {
+            i->render_cairo(slot);
+        }
+    } else {
+        for (auto &step : _plan) {
+            step.primitive->render_cairo(slot);
+            for (int s : step.release) {
+                slot.release(s);
+            }
+        }
     }
 
     Geom::Point origin = graphic.targetLogicalBounds().min();
@@ -166,6 +320,167 @@ int Filter::render(Inkscape::DrawingItem const *item, DrawingContext &graphic, D
 void Filter::add_primitive(std::unique_ptr<FilterPrimitive> primitive)
 {
     primitives.emplace_back(std::move(primitive));
+    _plan.clear();
+    _fused.clear();
+}
+
+void Filter::optimize()
+{
+    _plan.clear();
+    _fused.clear();
+
+    int const n = primitives.size();
+
+    // Resolve the slots read and written by each primitive the way FilterSlot does, and
+    // remember which primitive wrote each slot read, or -1 for the pre-defined images.
+    struct Node
+    {
+        std::vector<int> inputs;
+        std::vector<int> producers;
+        int output;
+        int readers = 0;
+        bool live = false;
+        int step = -1;
+    };
+    std::vector<Node> nodes(n);
+    std::map<int, int> written_by;
+    int last_out = NR_FILTER_SOURCEGRAPHIC;
+
+    for (int i = 0; i < n; i++) {
+        auto &node = nodes[i];
+        for (int s : primitives[i]->get_inputs()) {
+            if (s == NR_FILTER_SLOT_NOT_SET) {
+                s = last_out;
+            }
+            auto w = written_by.find(s);
+            node.inputs.push_back(s);
+            node.producers.push_back(w != written_by.end() ? w->second : -1);
+        }
+        node.output = primitives[i]->get_output();
+        if (node.output == NR_FILTER_SLOT_NOT_SET) {
+            node.output = NR_FILTER_UNNAMED_SLOT;
+        }
+        written_by[node.output] = i;
+        last_out = node.output;
+    }
+
+    int const result_slot = _output_slot == NR_FILTER_SLOT_NOT_SET ? last_out : _output_slot;
+    auto const w = written_by.find(result_slot);
+    if (w == written_by.end()) {
+        return; // Filter output is not produced by any primitive; nothing to gain.
+    }
+    int const result = w->second;
+
+    // Mark the primitives contributing to the output, and count the readers of each result.
+    nodes[result].live = true;
+    for (int i = result; i >= 0; i--) {
+        if (nodes[i].live) {
+            for (int p : nodes[i].producers) {
+                if (p >= 0) {
+                    nodes[p].live = true;
+                    nodes[p].readers++;
+                }
+            }
+        }
+    }
+
+    std::vector<FilterPrimitive::PixelMap> maps(n);
+    std::vector<int> live;
+    for (int i = 0; i < n; i++) {
+        if (nodes[i].live) {
+            maps[i] = primitives[i]->pixel_map();
+            live.push_back(i);
+        }
+    }
+
+    // Whether the result of a is read by b and nothing else.
+    auto only_read_by = [&] (int a, int b) {
+        return a != result && nodes[a].readers == 1 &&
+               std::count(nodes[b].producers.begin(), nodes[b].producers.end(), a) == 1 &&
+               primitives[a]->get_color_interpolation() == primitives[b]->get_color_interpolation();
+    };
+
+    for (std::size_t k = 0; k < live.size(); ) {
+        std::vector<int> chain{live[k++]};
+        int blend = -1;
+        if (maps[chain.front()]) {
+            while (k < live.size() && only_read_by(chain.back(), live[k])) {
+                int const next = live[k];
+                if (maps[next]) {
+                    chain.push_back(next);
+                    k++;
+                } else {
+                    if (nodes[next].inputs.size() == 2 && primitives[next]->pixel_blend()) {
+                        blend = next;
+                        k++;
+                    }
+                    break;
+                }
+            }
+        }
+
+        int const step = _plan.size();
+        for (int i : chain) {
+            nodes[i].step = step;
+        }
+
+        if (chain.size() == 1 && blend < 0) {
+            _plan.push_back({primitives[chain.front()].get(), {}});
+            continue;
+        }
+
+        std::vector<FilterPrimitive const *> chain_primitives;
+        for (int i : chain) {
+            chain_primitives.push_back(primitives[i].get());
+        }
+        int other = NR_FILTER_SLOT_NOT_SET;
+        bool chain_first = true;
+        int output = nodes[chain.back()].output;
+        if (blend >= 0) {
+            nodes[blend].step = step;
+            chain_first = nodes[blend].producers[0] == chain.back();
+            other = nodes[blend].inputs[chain_first ? 1 : 0];
+            output = nodes[blend].output;
+        }
+        _fused.push_back(std::make_unique<FilterFused>(std::move(chain_primitives),
+                                                       blend >= 0 ? primitives[blend].get() : nullptr,
+                                                       chain_first, nodes[chain.front()].inputs[0], other, output));
+        _plan.push_back({_fused.back().get(), {}});
+    }
+
+    // Release each image after the last step reading it. Images passed along inside a fused
+    // step are never stored. Reading the alpha of the source or background also reads the
+    // image itself.
+    std::map<std::pair<int, int>, int> last_read;
+    for (int i : live) {
+        auto read = [&] (int slot, int producer) {
+            auto &last = last_read[{slot, producer}];
+            last = std::max(last, nodes[i].step);
+        };
+        for (std::size_t j = 0; j < nodes[i].inputs.size(); j++) {
+            int const s = nodes[i].inputs[j];
+            int const p = nodes[i].producers[j];
+            if (p >= 0 && nodes[p].step == nodes[i].step) {
+                continue;
+            }
+            read(s, p);
+            if (s == NR_FILTER_SOURCEALPHA) {
+                read(NR_FILTER_SOURCEGRAPHIC, -1);
+            } else if (s == NR_FILTER_BACKGROUNDALPHA) {
+                read(NR_FILTER_BACKGROUNDIMAGE, -1);
+            }
+        }
+    }
+
+    for (auto const &[image, step] : last_read) {
+        auto const [slot, producer] = image;
+        auto const output = _plan[step].primitive->get_output();
+        bool const overwritten = slot == (output == NR_FILTER_SLOT_NOT_SET ? NR_FILTER_UNNAMED_SLOT : output);
+        if ((slot == result_slot && producer == result) || overwritten) {
+            continue;
+        }
+        _plan[step].release.push_back(slot);
+    }
 }
 
 void Filter::set_filter_units(SPFilterUnits unit)
@@ -298,6 +613,8 @@ bool Filter::uses_background() const
 void Filter::clear_primitives()
 {
     primitives.clear();
+    _plan.clear();
+    _fused.clear();
 }
 
 void Filter::set_x(SVGLength const &length)
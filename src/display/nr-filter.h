@@ -14,6 +14,7 @@
  */
 
 #include <memory>
+#include <vector>
 #include <cairo.h>
 #include "display/nr-filter-primitive.h"
 #include "display/nr-filter-types.h"
@@ -66,6 +67,15 @@ public:
      */
     void set_output(int slot);
 
+    /**
+     * Plans the rendering of the primitives added so far. Primitives whose results do not
+     * reach the filter output are skipped, chains of per-pixel primitives are fused into
+     * single passes, and intermediate images are released as soon as their last reader has
+     * run. Adding or removing primitives discards the plan, in which case all primitives are
+     * rendered in order until this is called again.
+     */
+    void optimize();
+
     void set_x(SVGLength const &length);
     void set_y(SVGLength const &length);
     void set_width(SVGLength const &length);
@@ -161,6 +171,18 @@ public:
 private:
     std::vector<std::unique_ptr<FilterPrimitive>> primitives;
 
+    struct Step
+    {
+        FilterPrimitive const *primitive;
+        std::vector<int> release; ///< Slots no longer read after this step.
+    };
+
+    /** Rendering order computed by optimize(); empty if not optimized. */
+    std::vector<Step> _plan;
+
+    /** Primitives standing in for fused chains of primitives in _plan */
+    std::vector<std::unique_ptr<FilterPrimitive>> _fused;
+
     /** Amount of image slots used when this filter was rendered last time */
     int _slot_count;
 
@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Recycling of the pixel buffers of temporary image surfaces.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "display/surface-pool.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace Inkscape {
+namespace {
+
+// Smaller requests share the smallest bucket.
+constexpr std::size_t MIN_BUCKET_BYTES = 4096;
+
+// Enough for a handful of full-screen intermediate images per thread.
+constexpr std::size_t MAX_IDLE_BYTES = std::size_t{64} << 20;
+
+// But not for every one of many render threads.
+constexpr std::size_t MAX_TOTAL_IDLE_BYTES = std::size_t{256} << 20;
+
+std::atomic<std::size_t> total_idle_bytes{0};
+std::atomic<std::uint64_t> hits{0};
+std::atomic<std::uint64_t> misses{0};
+
+cairo_user_data_key_t const buffer_key{};
+
+struct Buffer
+{
+    unsigned char *data;
+    std::size_t size;
+};
+
+void free_buffer(Buffer *buffer)
+{
+    std::free(buffer->data);
+    delete buffer;
+}
+
+/// Round up to a multiple of an eighth of the largest power of two not above size.
+std::size_t bucket_size(std::size_t size)
+{
+    if (size <= MIN_BUCKET_BYTES) {
+        return MIN_BUCKET_BYTES;
+    }
+    std::size_t step = 1;
+    while (step * 8 <= size) {
+        step *= 2;
+    }
+    return (size + step - 1) / step * step;
+}
+
+class Pool
+{
+public:
+    ~Pool()
+    {
+        for (auto &[size, buffers] : _idle) {
+            for (auto buffer : buffers) {
+                free_buffer(buffer);
+            }
+        }
+        total_idle_bytes -= _idle_bytes;
+        destroyed = true;
+    }
+
+    Buffer *take(std::size_t size)
+    {
+        auto it = _idle.find(size);
+        if (it == _idle.end() || it->second.empty()) {
+            return nullptr;
+        }
+        auto buffer = it->second.back();
+        it->second.pop_back();
+        _idle_bytes -= size;
+        total_idle_bytes -= size;
+        return buffer;
+    }
+
+    void give(Buffer *buffer)
+    {
+        if (_idle_bytes + buffer->size > MAX_IDLE_BYTES) {
+            free_buffer(buffer);
+            return;
+        }
+        if (total_idle_bytes.fetch_add(buffer->size) + buffer->size > MAX_TOTAL_IDLE_BYTES) {
+            total_idle_bytes -= buffer->size;
+            free_buffer(buffer);
+            return;
+        }
+        _idle[buffer->size].push_back(buffer);
+        _idle_bytes += buffer->size;
+    }
+
+    /// The pool of the calling thread, or null once it has been destroyed at thread exit.
+    static Pool *local()
+    {
+        if (destroyed) {
+            return nullptr;
+        }
+        thread_local Pool pool;
+        return &pool;
+    }
+
+private:
+    std::unordered_map<std::size_t, std::vector<Buffer *>> _idle;
+    std::size_t _idle_bytes = 0;
+
+    static thread_local bool destroyed;
+};
+
+thread_local bool Pool::destroyed = false;
+
+void release_buffer(void *data)
+{
+    auto buffer = static_cast<Buffer *>(data);
+    if (auto pool = Pool::local()) {
+        pool->give(buffer);
+    } else {
+        free_buffer(buffer);
+    }
+}
+
+} // namespace
+
+cairo_surface_t *SurfacePool::create(cairo_format_t format, int width, int height)
+{
+    int const stride = cairo_format_stride_for_width(format, width);
+    if (width <= 0 || height <= 0 || stride <= 0) {
+        return cairo_image_surface_create(format, width, height);
+    }
+
+    std::size_t const size = std::size_t(stride) * height;
+    std::size_t const capacity = bucket_size(size);
+
+    Buffer *buffer = nullptr;
+    if (auto pool = Pool::local()) {
+        buffer = pool->take(capacity);
+    }
+    if (buffer) {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        std::memset(buffer->data, 0, size);
+    } else {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        auto data = static_cast<unsigned char *>(std::calloc(capacity, 1));
+        if (!data) {
+            return cairo_image_surface_create(format, width, height);
+        }
+        buffer = new Buffer{data, capacity};
+    }
+
+    auto surface = cairo_image_surface_create_for_data(buffer->data, format, width, height, stride);
+    // Also fails if the surface could not be created.
+    if (cairo_surface_set_user_data(surface, &buffer_key, buffer, release_buffer) != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(surface);
+        release_buffer(buffer);
+        return cairo_image_surface_create(format, width, height);
+    }
+    return surface;
+}
+
+cairo_surface_t *SurfacePool::create_similar(cairo_surface_t *other, cairo_content_t content, int width, int height)
+{
+    if (cairo_surface_get_type(other) != CAIRO_SURFACE_TYPE_IMAGE) {
+        return cairo_surface_create_similar(other, content, width, height);
+    }
+
+    double x_scale = 1;
+    double y_scale = 1;
+    cairo_surface_get_device_scale(other, &x_scale, &y_scale);
+
+    cairo_format_t format;
+    switch (content) {
+        case CAIRO_CONTENT_ALPHA:
+            format = CAIRO_FORMAT_A8;
+            break;
+        case CAIRO_CONTENT_COLOR:
+            format = CAIRO_FORMAT_RGB24;
+            break;
+        case CAIRO_CONTENT_COLOR_ALPHA:
+        default:
+            format = CAIRO_FORMAT_ARGB32;
+            break;
+    }
+
+    auto surface = create(format, std::ceil(width * x_scale), std::ceil(height * y_scale));
+    cairo_surface_set_device_scale(surface, x_scale, y_scale);
+    return surface;
+}
+
+SurfacePool::Stats SurfacePool::stats()
+{
+    Stats result;
+    result.hits = hits.load(std::memory_order_relaxed);
+    result.misses = misses.load(std::memory_order_relaxed);
+    return result;
+}
+
+void SurfacePool::reset_stats()
+{
+    hits.store(0, std::memory_order_relaxed);
+    misses.store(0, std::memory_order_relaxed);
+}
+
+std::size_t SurfacePool::max_idle_bytes()
+{
+    return MAX_IDLE_BYTES;
+}
+
+std::size_t SurfacePool::max_total_idle_bytes()
+{
+    return MAX_TOTAL_IDLE_BYTES;
+}
+
+std::size_t SurfacePool::idle_bytes()
+{
+    return total_idle_bytes;
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Recycling of the pixel buffers of temporary image surfaces.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_SURFACE_POOL_H
+#define SEEN_INKSCAPE_DISPLAY_SURFACE_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cairo.h>
+
+namespace Inkscape {
+
+/**
+ * Per-thread pools of idle pixel buffers, used for the intermediate images of filter renders.
+ *
+ * Surfaces from create() are ordinary image surfaces, except that destroying them hands their
+ * buffer to the pool of the destroying thread rather than freeing it. Buffers are grouped into
+ * size buckets, eight per power of two, and a request is served from its own bucket only. Each
+ * thread keeps at most max_idle_bytes() of idle buffers, and all threads together at most
+ * max_total_idle_bytes(), since render threads live as long as the program; anything returned
+ * beyond that is freed, as are all idle buffers of a thread when it exits.
+ */
+class SurfacePool final
+{
+public:
+    struct Stats
+    {
+        std::uint64_t hits = 0;   ///< Surfaces created from an idle buffer.
+        std::uint64_t misses = 0; ///< Surfaces that needed a new buffer.
+    };
+
+    SurfacePool() = delete;
+
+    /// Create an image surface cleared to transparent, reusing an idle buffer if possible.
+    static cairo_surface_t *create(cairo_format_t format, int width, int height);
+
+    /**
+     * Drop-in replacement for cairo_surface_create_similar(): for image surfaces, width and
+     * height are in device units and the device scale of other is kept. Other surface types
+     * are passed on to Cairo.
+     */
+    static cairo_surface_t *create_similar(cairo_surface_t *other, cairo_content_t content, int width, int height);
+
+    /// Hit and miss counts of all threads since the last reset_stats().
+    static Stats stats();
+    static void reset_stats();
+
+    /// The limit on idle memory held by each thread.
+    static std::size_t max_idle_bytes();
+    /// The limit on idle memory held by all threads together.
+    static std::size_t max_total_idle_bytes();
+    /// The idle memory currently held by all threads.
+    static std::size_t idle_bytes();
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_SURFACE_POOL_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -50,6 +50,7 @@
 #include <cstddef>
 #include <string>
 
+#include "attribute-rel-util.h"
 #include "event.h"
 #include "inkscape.h"
 
@@ -179,6 +180,9 @@ void Inkscape::DocumentUndo::maybeDone(SPDocument *doc,
     // This is only used for output to debug log file (and not for undo).
     Inkscape::Debug::EventTracker<CommitEvent> tracker(doc, key, doc->getEventDescriptionStacked().c_str(), icon_name.c_str());
 
+    // Check the attributes edited in this transaction, so that any removals are part of it.
+    doc->_attribute_cleaner->flush();
+
 	doc->collectOrphans();
 
 	doc->ensureUpToDate();
@@ -225,6 +229,7 @@ void Inkscape::DocumentUndo::cancel(SPDocument *doc)
     }
     g_assert (doc->sensitive);
 	sp_repr_rollback (doc->rdoc);
+    doc->_attribute_cleaner->clear();
 
 	if (doc->partial) {
 		sp_repr_undo_log (doc->partial);
@@ -310,6 +315,9 @@ gboolean Inkscape::DocumentUndo::undo(SPDocument *doc)
 	    ret = FALSE;
     }
 
+    // Replaying the log restores attributes as they were, which need no checking on the next commit.
+    doc->_attribute_cleaner->clear();
+
     sp_repr_begin_transaction (doc->rdoc);
     doc->sensitive = TRUE;
     doc->seeking = false;
@@ -356,6 +364,8 @@ gboolean Inkscape::DocumentUndo::redo(SPDocument *doc)
 		ret = FALSE;
 	}
     
+    doc->_attribute_cleaner->clear();
+
 	sp_repr_begin_transaction (doc->rdoc);
 
 	doc->sensitive = TRUE;
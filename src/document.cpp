@@ -37,6 +37,7 @@
 #define noSP_DOCUMENT_DEBUG_IDLE
 #define noSP_DOCUMENT_DEBUG_UNDO
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -45,6 +46,7 @@
 
 #include <2geom/transforms.h>
 
+#include "attribute-rel-util.h"
 #include "desktop.h"
 #include "document-undo.h"
 #include "event-log.h"
@@ -54,6 +56,7 @@
 #include "inkscape-window.h"
 #include "profile-manager.h"
 #include "rdf.h"
+#include "style-rule-index.h"
 
 #include "live_effects/effect.h"
 
@@ -105,6 +108,46 @@ static gint doc_mem_count = 0;
 
 static unsigned long next_serial = 0;
 
+/**
+ * Keeps the class and element indexes of a document up to date as the XML tree changes.
+ */
+class SPDocument::IndexObserver : public Inkscape::XML::NodeObserver
+{
+public:
+    IndexObserver(SPDocument &document)
+        : _document(document)
+    {
+        _document.rroot->addSubtreeObserver(*this);
+    }
+
+    ~IndexObserver() override { _document.rroot->removeSubtreeObserver(*this); }
+
+    void notifyAttributeChanged(Inkscape::XML::Node &node, GQuark name, Inkscape::Util::ptr_shared,
+                                Inkscape::Util::ptr_shared new_value) override
+    {
+        static GQuark const class_key = g_quark_from_static_string("class");
+        if (name != class_key) {
+            return;
+        }
+        // Nodes not bound yet are indexed when they are.
+        if (auto object = _document.getObjectByRepr(&node)) {
+            _document._unindexClasses(object);
+            _document._indexClasses(object, new_value);
+        }
+    }
+
+    void notifyElementNameChanged(Inkscape::XML::Node &node, GQuark old_name, GQuark new_name) override
+    {
+        if (auto object = _document.getObjectByRepr(&node)) {
+            _document._unindexElement(object, old_name);
+            _document._indexElement(object, new_name);
+        }
+    }
+
+private:
+    SPDocument &_document;
+};
+
 SPDocument::SPDocument() :
     keepalive(false),
     virgin(true),
@@ -128,6 +171,7 @@ SPDocument::SPDocument() :
 
     _event_log = std::make_unique<Inkscape::EventLog>(this);
     _selection = std::make_unique<Inkscape::Selection>(this);
+    _style_rule_index = std::make_unique<Inkscape::StyleRuleIndex>(style_cascade);
 
     _desktop_activated_connection = INKSCAPE.signal_activate_desktop.connect(
                 sigc::hide(sigc::bind(
@@ -181,6 +225,8 @@ SPDocument::~SPDocument() {
         partial = nullptr;
     }
 
+    _attribute_cleaner.reset();
+
     DocumentUndo::clearRedo(this);
     DocumentUndo::clearUndo(this);
 
@@ -190,12 +236,15 @@ SPDocument::~SPDocument() {
         root = nullptr;
     }
 
+    _index_observer.reset();
+
     if (rdoc) Inkscape::GC::release(rdoc);
 
     /* Free resources */
     resources.clear();
 
     // This also destroys all attached stylesheets
+    _style_rule_index.reset();
     cr_cascade_unref(style_cascade);
     style_cascade = nullptr;
 
@@ -359,6 +408,8 @@ SPDocument *SPDocument::createDoc(Inkscape::XML::Document *rdoc,
 
     document->rdoc = rdoc;
     document->rroot = rroot;
+    document->_attribute_cleaner = std::make_unique<Inkscape::AttributeCleaner>(*rroot, [document] { return document->isSensitive(); });
+    document->_index_observer = std::make_unique<IndexObserver>(*document);
     if (parent) {
         document->_parent_document = parent;
         parent->_child_documents.push_back(document);
@@ -1121,64 +1172,25 @@ SPObject *SPDocument::getObjectByHref(char const *href) const
     return getObjectById(id);
 }
 
-static void _getObjectsByClassRecursive(Glib::ustring const &klass, SPObject *parent, std::vector<SPObject*> &objects)
-{
-    if (!parent) return;
-
-    if (auto const temp = parent->getAttribute("class")) {
-        std::istringstream classes(temp);
-        Glib::ustring token;
-        while (classes >> token) {
-            // we can have multiple class
-            if (classes.str() == " ") {
-                token = "";
-                continue;
-            }
-            if (token == klass) {
-                objects.emplace_back(parent);
-                break;
-            }
-        }
-    }
-
-    // Check children
-    for (auto &child : parent->children) {
-        _getObjectsByClassRecursive(klass, &child, objects);
-    }
-}
-
 std::vector<SPObject*> SPDocument::getObjectsByClass(Glib::ustring const &klass) const
 {
     if (klass.empty()) return {};
-    std::vector<SPObject*> objects;
-    _getObjectsByClassRecursive(klass, root, objects);
+    auto it = _class_index.find(g_quark_try_string(klass.c_str()));
+    if (it == _class_index.end()) return {};
+    std::vector<SPObject*> objects(it->second.begin(), it->second.end());
+    _sortInDocumentOrder(objects);
     return objects;
 }
 
-static void _getObjectsByElementRecursive(Glib::ustring const &element,
-                                          SPObject *parent,
-                                          std::vector<SPObject*> &objects,
-                                          bool custom)
-{
-    if (!parent) return;
-
-    Glib::ustring prefixed = custom ? "inkscape:" : "svg:";
-    prefixed += element;
-    if (parent->getRepr()->name() == prefixed) {
-        objects.emplace_back(parent);
-    }
-
-    // Check children
-    for (auto &child : parent->children) {
-        _getObjectsByElementRecursive(element, &child, objects, custom);
-    }
-}
-
 std::vector<SPObject*> SPDocument::getObjectsByElement(Glib::ustring const &element, bool custom) const
 {
     if (element.empty()) return {};
-    std::vector<SPObject*> objects;
-    _getObjectsByElementRecursive(element, root, objects, custom);
+    Glib::ustring prefixed = custom ? "inkscape:" : "svg:";
+    prefixed += element;
+    auto it = _element_index.find(g_quark_try_string(prefixed.c_str()));
+    if (it == _element_index.end()) return {};
+    std::vector<SPObject*> objects(it->second.begin(), it->second.end());
+    _sortInDocumentOrder(objects);
     return objects;
 }
 
@@ -1186,7 +1198,9 @@ static void _getObjectsBySelectorRecursive(SPObject *parent,
                                            CRSelEng *sel_eng, CRSimpleSel *simple_sel,
                                            std::vector<SPObject*> &objects)
 {
-    if (parent) {
+    // Like the indexes, leave out the children <use> elements build: they share the repr of
+    // the original, which is found already.
+    if (parent && !parent->cloned) {
         gboolean result = false;
         cr_sel_eng_matches_node(sel_eng, simple_sel, parent->getRepr(), &result);
         if (result) {
@@ -1213,14 +1227,166 @@ std::vector<SPObject*> SPDocument::getObjectsBySelector(Glib::ustring const &sel
 
     std::vector<SPObject*> objects;
     for (auto cur = cr_selector; cur; cur = cur->next) {
-        if (cur->simple_sel) {
+        if (!cur->simple_sel) {
+            continue;
+        }
+
+        // Only objects matching the rightmost simple selector can match the whole selector, so
+        // take the candidates from the smallest index bucket it names, if any.
+        auto rightmost = cur->simple_sel;
+        while (rightmost->next) {
+            rightmost = rightmost->next;
+        }
+
+        std::unordered_set<SPObject*> const *bucket = nullptr;
+        bool filtered = false;
+        for (auto add_sel = rightmost->add_sel; add_sel; add_sel = add_sel->next) {
+            if (add_sel->type == CLASS_ADD_SELECTOR && add_sel->content.class_name) {
+                auto it = _class_index.find(g_quark_try_string(add_sel->content.class_name->stryng->str));
+                if (it == _class_index.end()) {
+                    bucket = nullptr;
+                    filtered = true;
+                    break;
+                }
+                if (!bucket || it->second.size() < bucket->size()) {
+                    bucket = &it->second;
+                }
+                filtered = true;
+            }
+        }
+
+        std::vector<SPObject*> candidates;
+        if (bucket) {
+            candidates.assign(bucket->begin(), bucket->end());
+        } else if (!filtered && (rightmost->type_mask & TYPE_SELECTOR) && rightmost->name) {
+            // Type selectors match the local name, whatever the prefix.
+            auto const name = rightmost->name->stryng->str;
+            for (auto const &[qname, members] : _element_index) {
+                auto const qname_str = g_quark_to_string(qname);
+                auto const colon = std::strrchr(qname_str, ':');
+                if (!std::strcmp(colon ? colon + 1 : qname_str, name)) {
+                    candidates.insert(candidates.end(), members.begin(), members.end());
+                }
+            }
+            filtered = true;
+        }
+
+        if (!filtered) {
             _getObjectsBySelectorRecursive(root, sel_eng, cur->simple_sel, objects);
+            continue;
+        }
+
+        _sortInDocumentOrder(candidates);
+        for (auto object : candidates) {
+            gboolean result = false;
+            cr_sel_eng_matches_node(sel_eng, cur->simple_sel, object->getRepr(), &result);
+            if (result) {
+                objects.push_back(object);
+            }
         }
     }
     cr_selector_destroy(cr_selector);
     return objects;
 }
 
+void SPDocument::_indexClasses(SPObject *object, char const *classes)
+{
+    if (!classes) {
+        return;
+    }
+
+    // Classes are separated by whitespace.
+    std::vector<GQuark> keys;
+    auto p = classes;
+    while (*p) {
+        while (*p && g_ascii_isspace(*p)) {
+            p++;
+        }
+        auto const start = p;
+        while (*p && !g_ascii_isspace(*p)) {
+            p++;
+        }
+        if (p > start) {
+            auto const key = g_quark_from_string(std::string(start, p).c_str());
+            if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+                keys.push_back(key);
+                _class_index[key].insert(object);
+            }
+        }
+    }
+
+    if (!keys.empty()) {
+        _object_classes[object] = std::move(keys);
+    }
+}
+
+void SPDocument::_unindexClasses(SPObject *object)
+{
+    auto it = _object_classes.find(object);
+    if (it == _object_classes.end()) {
+        return;
+    }
+
+    for (auto key : it->second) {
+        auto bucket = _class_index.find(key);
+        bucket->second.erase(object);
+        if (bucket->second.empty()) {
+            _class_index.erase(bucket);
+        }
+    }
+    _object_classes.erase(it);
+}
+
+void SPDocument::_indexElement(SPObject *object, GQuark name)
+{
+    _element_index[name].insert(object);
+}
+
+void SPDocument::_unindexElement(SPObject *object, GQuark name)
+{
+    auto bucket = _element_index.find(name);
+    if (bucket == _element_index.end() || !bucket->second.erase(object)) {
+        // Renamed while not observed.
+        bucket = std::find_if(_element_index.begin(), _element_index.end(),
+                              [=] (auto const &b) { return b.second.count(object); });
+        if (bucket == _element_index.end()) {
+            return;
+        }
+        bucket->second.erase(object);
+    }
+    if (bucket->second.empty()) {
+        _element_index.erase(bucket);
+    }
+}
+
+/**
+ * Sort objects from the indexes in document order, which is the order a walk of the tree would
+ * have found them in.
+ */
+void SPDocument::_sortInDocumentOrder(std::vector<SPObject *> &objects) const
+{
+    // Comparing positions climbs the tree, so for many objects a single walk is faster.
+    if (objects.size() <= 64) {
+        std::sort(objects.begin(), objects.end(), sp_object_compare_position_bool);
+        return;
+    }
+
+    std::unordered_set<SPObject *> const wanted(objects.begin(), objects.end());
+    objects.clear();
+    if (!root) {
+        return;
+    }
+    auto const walk = [&] (SPObject *object, auto const &walk) -> void {
+        if (wanted.count(object)) {
+            objects.push_back(object);
+        }
+        for (auto &child : object->children) {
+            walk(&child, walk);
+        }
+    };
+    walk(root, walk);
+}
+
 // Note: Despite appearances, this implementation is allocation-free thanks to SSO.
 std::string SPDocument::generate_unique_id(char const *prefix)
 {
@@ -1245,9 +1411,13 @@ void SPDocument::bindObjectToRepr(Inkscape::XML::Node *repr, SPObject *object)
     if (object) {
         auto ret = reprdef.emplace(repr, object);
         g_assert(ret.second);
+        _indexElement(object, repr->code());
+        _indexClasses(object, repr->attribute("class"));
     } else {
         auto it = reprdef.find(repr);
         g_assert(it != reprdef.end());
+        _unindexElement(it->second, repr->code());
+        _unindexClasses(it->second);
         reprdef.erase(it);
     }
 }
@@ -25,6 +25,8 @@
 #include <memory>
 #include <vector>
 #include <queue>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <boost/ptr_container/ptr_list.hpp>
 
@@ -77,7 +79,9 @@ class SPRoot;
 class SPNamedView;
 
 namespace Inkscape {
+    class AttributeCleaner;
     class Selection; 
+    class StyleRuleIndex;
     class UndoStackObserver;
     class EventLog;
     class ProfileManager;
@@ -218,6 +222,8 @@ public:
 
     // Styling
     CRCascade    *getStyleCascade() { return style_cascade; }
+    /// The rules of the style cascade, indexed for matching. Invalidate it when the cascade changes.
+    Inkscape::StyleRuleIndex &getStyleRuleIndex() { return *_style_rule_index; }
 
     // File information --------------------
 
@@ -403,6 +409,7 @@ private:
 
     // Styling
     CRCascade *style_cascade;
+    std::unique_ptr<Inkscape::StyleRuleIndex> _style_rule_index;
 
     // Desktop geometry
     mutable Geom::Affine _doc2dt;
@@ -416,6 +423,20 @@ private:
     std::map<std::string, SPObject *> iddef;
     std::map<Inkscape::XML::Node *, SPObject *> reprdef;
 
+    // Find items by class or element --------
+    // Kept for the objects bound to a repr, and updated by an observer of the XML tree.
+    class IndexObserver;
+    std::unique_ptr<IndexObserver> _index_observer;
+    std::unordered_map<GQuark, std::unordered_set<SPObject *>> _class_index;
+    std::unordered_map<GQuark, std::unordered_set<SPObject *>> _element_index; ///< By qualified name.
+    std::unordered_map<SPObject *, std::vector<GQuark>> _object_classes;
+
+    void _indexClasses(SPObject *object, char const *classes);
+    void _unindexClasses(SPObject *object);
+    void _indexElement(SPObject *object, GQuark name);
+    void _unindexElement(SPObject *object, GQuark name);
+    void _sortInDocumentOrder(std::vector<SPObject *> &objects) const;
+
     // Find items by geometry --------------------
     mutable std::deque<SPItem*> _node_cache; // Used to speed up search.
     mutable bool _node_cache_valid;
@@ -427,6 +448,7 @@ private:
     // Document undo/redo ----------------------
     friend Inkscape::DocumentUndo;
     std::unique_ptr<Inkscape::EventLog> _event_log;
+    std::unique_ptr<Inkscape::AttributeCleaner> _attribute_cleaner; // Checks edited attributes on commit.
 
     /* Undo/Redo state */
     bool sensitive; /* If we save actions to undo stack */
@@ -15,10 +15,31 @@
  */
 
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glib/gstdio.h>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
 #include <2geom/rect.h>
 #include <2geom/transforms.h>
 
 #include <png.h>
+#include <zlib.h>
 
 #include "document.h"
 #include "inkscape.h"
@@ -28,6 +49,8 @@
 
 #include "display/cairo-utils.h"
 #include "display/drawing-context.h"
+#include "display/drawing-disk-cache.h"
+#include "display/drawing-profile.h"
 #include "display/drawing.h"
 
 #include "io/sys.h"
@@ -51,15 +74,390 @@
  * working PNG reader/writer, see pngtest.c, included in this distribution.
  */
 
+class TiledRenderer;
+
 struct SPEBP {
     unsigned long int width, height, sheight;
     guint32 background;
     Inkscape::Drawing *drawing; // it is assumed that all unneeded items are hidden
+    bool prepared; // drawing was already updated for the whole image, so rows only need rendering
+    TiledRenderer *tiler; // only used by the multi-threaded exporter
     guchar *px;
     unsigned (*status)(float, void *);
     void *data;
 };
 
+/**
+ * Renders and encodes an export area on a pool of worker threads.
+ *
+ * The area is cut into strips of sheight rows, and every strip into tiles. Each strip then goes
+ * through a pipeline of stages, each of which runs as a task on the pool:
+ *
+ *   1. Render: tiles are rendered concurrently straight into the pixel buffer of their strip.
+ *   2. Convert: once all tiles are in, the strip is unpremultiplied, converted to the requested
+ *      PNG colour type and bit depth, and run through the PNG row filters.
+ *   3. Deflate: the filtered rows are compressed as an independent piece of the zlib stream.
+ *
+ * Finished strips are handed out strictly from top to bottom by next_strip(), so the writer only
+ * has to wrap them in IDAT chunks. Only a bounded number of strips is in flight at any time, so
+ * memory use does not grow with the height of the export.
+ *
+ * For the compressed pieces to be independent, the first row of each strip is only allowed the
+ * filters that do not look at the previous row, and each piece is a raw deflate stream ended by a
+ * sync flush (the last one by a final block). Concatenated, they form one valid deflate stream;
+ * the writer adds the zlib header and combines the per-strip Adler-32 checksums for the trailer.
+ *
+ * DrawingItems keep mutable state during rendering (filter caches, cache scores), so the
+ * drawing tree cannot be shared between threads. Instead every worker renders from its own
+ * copy, shown under its own display key.
+ */
+class TiledRenderer
+{
+public:
+    struct Strip
+    {
+        int row = 0;
+        int num_rows = 0;
+        int stride = 0;
+        int tiles_left = 0;
+        std::unique_ptr<guchar[]> px; ///< Rendered pixels, freed after conversion.
+        std::vector<guchar> filtered; ///< Filtered rows, freed after compression.
+        std::vector<guchar> deflated; ///< Compressed rows, ready to be written.
+        size_t raw_size = 0;          ///< Size of the filtered rows.
+        uLong adler = 0;              ///< Adler-32 checksum of the filtered rows.
+        bool done = false;
+    };
+
+    TiledRenderer(SPDocument *doc, Geom::Affine const &affine, std::vector<SPItem*> const &items_only,
+                  unsigned long width, unsigned long height, unsigned long sheight,
+                  guint32 background, int antialiasing, int color_type, int bit_depth, int zlib,
+                  int numthreads);
+    ~TiledRenderer();
+
+    /// Wait for the next strip from the top and take ownership of it.
+    /// Returns a strip with no rows once the whole area has been handed out.
+    Strip next_strip();
+
+private:
+    static int constexpr TILE_WIDTH = 512;
+
+    SPDocument *_doc;
+    int _width;
+    int _height;
+    int _sheight;
+    guint32 _background;
+    int _antialiasing;
+    int _color_type;
+    int _bit_depth;
+    int _zlib;
+    int _lookahead;
+
+    std::vector<std::unique_ptr<Inkscape::Drawing>> _drawings;
+    std::vector<unsigned> _dkeys;
+    std::vector<Inkscape::Drawing*> _idle; // Drawings not currently used by any worker.
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::deque<Strip> _strips; // In-flight strips, topmost first.
+    int _next_row = 0; // First row not yet queued for rendering.
+    bool _cancelled = false;
+
+    std::optional<boost::asio::thread_pool> _pool;
+
+    void _queueStrip();
+    void _renderTile(Strip &strip, Geom::IntRect const &tile);
+    void _convertStrip(Strip &strip);
+    void _deflateStrip(Strip &strip);
+};
+
+TiledRenderer::TiledRenderer(SPDocument *doc, Geom::Affine const &affine, std::vector<SPItem*> const &items_only,
+                             unsigned long width, unsigned long height, unsigned long sheight,
+                             guint32 background, int antialiasing, int color_type, int bit_depth, int zlib,
+                             int numthreads)
+    : _doc(doc)
+    , _width(width)
+    , _height(height)
+    , _sheight(sheight)
+    , _background(background)
+    , _antialiasing(antialiasing)
+    , _color_type(color_type)
+    , _bit_depth(bit_depth)
+    , _zlib(zlib)
+    , _lookahead(2 * numthreads)
+{
+    // Showing and updating the drawings touches the object tree, so do it here on the calling thread.
+    for (int i = 0; i < numthreads; i++) {
+        auto drawing = std::make_unique<Inkscape::Drawing>();
+        if (items_only.empty()) {
+            drawing->setDiskCache(Inkscape::DrawingDiskCache::get());
+        }
+        drawing->setProfile(Inkscape::DrawingProfile::get());
+        unsigned const dkey = SPItem::display_key_new(1);
+        drawing->setRoot(doc->getRoot()->invoke_show(*drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+        drawing->root()->setTransform(affine);
+        drawing->setExact(); // export with maximum blur rendering quality
+        if (!items_only.empty()) {
+            doc->getRoot()->invoke_hide_except(dkey, items_only);
+        }
+        drawing->update(Geom::IntRect::from_xywh(0, 0, width, height));
+
+        _idle.emplace_back(drawing.get());
+        _drawings.emplace_back(std::move(drawing));
+        _dkeys.emplace_back(dkey);
+    }
+
+    _pool.emplace(numthreads);
+
+    auto lock = std::lock_guard(_mutex);
+    for (int i = 0; i < _lookahead && _next_row < _height; i++) {
+        _queueStrip();
+    }
+}
+
+TiledRenderer::~TiledRenderer()
+{
+    {
+        auto lock = std::lock_guard(_mutex);
+        _cancelled = true;
+    }
+    _pool->join();
+
+    // Hide items, this releases arenaitems.
+    for (auto dkey : _dkeys) {
+        _doc->getRoot()->invoke_hide(dkey);
+    }
+}
+
+/// Queue the tiles of the next strip for rendering. Must be called with the mutex held.
+void TiledRenderer::_queueStrip()
+{
+    auto &strip = _strips.emplace_back();
+    strip.row = _next_row;
+    strip.num_rows = std::min(_sheight, _height - _next_row);
+    strip.stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, _width);
+    strip.px.reset(new guchar[strip.num_rows * strip.stride]);
+    _next_row += strip.num_rows;
+
+    for (int x = 0; x < _width; x += TILE_WIDTH) {
+        auto tile = Geom::IntRect::from_xywh(x, strip.row, std::min(TILE_WIDTH, _width - x), strip.num_rows);
+        strip.tiles_left++;
+        // Deque references remain valid under emplace_back() and pop_front().
+        boost::asio::post(*_pool, [this, &strip, tile] { _renderTile(strip, tile); });
+    }
+}
+
+void TiledRenderer::_renderTile(Strip &strip, Geom::IntRect const &tile)
+{
+    Inkscape::Drawing *drawing;
+    {
+        auto lock = std::lock_guard(_mutex);
+        if (_cancelled) {
+            return;
+        }
+        drawing = _idle.back();
+        _idle.pop_back();
+    }
+
+    // Render straight into the strip buffer; the tile is a window onto it with the strip's stride.
+    auto px = strip.px.get() + 4 * tile.left();
+    cairo_surface_t *s = cairo_image_surface_create_for_data(
+        px, CAIRO_FORMAT_ARGB32, tile.width(), tile.height(), strip.stride);
+    Inkscape::DrawingContext dc(s, tile.min());
+    dc.setSource(_background);
+    dc.setOperator(CAIRO_OPERATOR_SOURCE);
+    dc.paint();
+    dc.setOperator(CAIRO_OPERATOR_OVER);
+
+    drawing->render(dc, tile, 0, _antialiasing);
+    cairo_surface_destroy(s);
+
+    auto lock = std::lock_guard(_mutex);
+    _idle.emplace_back(drawing);
+    if (--strip.tiles_left == 0) {
+        boost::asio::post(*_pool, [this, &strip] { _convertStrip(strip); });
+    }
+}
+
+static inline int paeth_predictor(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+/**
+ * Apply PNG filter \a type to a row, writing the result to \a out.
+ * A null \a prev means the previous row is not available.
+ */
+static void png_filter_row(int type, guchar const *row, guchar const *prev, size_t rowbytes, size_t bpp, guchar *out)
+{
+    for (size_t i = 0; i < rowbytes; i++) {
+        int a = i >= bpp ? row[i - bpp] : 0;
+        int b = prev ? prev[i] : 0;
+        int c = prev && i >= bpp ? prev[i - bpp] : 0;
+        switch (type) {
+            case PNG_FILTER_VALUE_SUB:   out[i] = row[i] - a; break;
+            case PNG_FILTER_VALUE_UP:    out[i] = row[i] - b; break;
+            case PNG_FILTER_VALUE_AVG:   out[i] = row[i] - (a + b) / 2; break;
+            case PNG_FILTER_VALUE_PAETH: out[i] = row[i] - paeth_predictor(a, b, c); break;
+            default:                     out[i] = row[i]; break;
+        }
+    }
+}
+
+/**
+ * Filter rows for PNG output. If \a adaptive is set, the filter of each row is chosen by the same
+ * minimum sum of absolute differences heuristic as libpng, otherwise no filtering is done.
+ * The row before the first is treated as unavailable, so the first row never refers to it.
+ */
+static void png_filter_rows(guchar const *const *rows, int num_rows, size_t rowbytes, size_t bpp, bool adaptive, guchar *out)
+{
+    std::vector<guchar> trial(rowbytes);
+    for (int r = 0; r < num_rows; r++) {
+        guchar const *prev = r > 0 ? rows[r - 1] : nullptr;
+        guchar *dst = out + r * (rowbytes + 1);
+
+        int best = PNG_FILTER_VALUE_NONE;
+        if (adaptive) {
+            size_t best_sum = SIZE_MAX;
+            int const last = prev ? PNG_FILTER_VALUE_PAETH : PNG_FILTER_VALUE_SUB;
+            for (int type = PNG_FILTER_VALUE_NONE; type <= last; type++) {
+                png_filter_row(type, rows[r], prev, rowbytes, bpp, trial.data());
+                size_t sum = 0;
+                for (auto v : trial) {
+                    sum += std::abs(static_cast<signed char>(v));
+                }
+                if (sum < best_sum) {
+                    best_sum = sum;
+                    best = type;
+                }
+            }
+        }
+
+        dst[0] = best;
+        png_filter_row(best, rows[r], prev, rowbytes, bpp, dst + 1);
+    }
+}
+
+void TiledRenderer::_convertStrip(Strip &strip)
+{
+    // PNG stores data as unpremultiplied big-endian RGBA, which means
+    // it's identical to the GdkPixbuf format.
+    convert_pixels_argb32_to_pixbuf(strip.px.get(), _width, strip.num_rows, strip.stride,
+                                    /* RGBA to ARGB with A=0 */ _background >> 8);
+
+    // If a custom bit depth or color type is asked, then convert rgb to grayscale, etc.
+    std::vector<guchar const *> rows(strip.num_rows);
+    auto packed = pixbuf_to_png(rows.data(), strip.px.get(), strip.num_rows, _width, strip.stride, _color_type, _bit_depth);
+    strip.px.reset();
+
+    int const n_fields = 1 + (_color_type & 2) + (_color_type & 4) / 4;
+    size_t const rowbytes = (n_fields * _bit_depth * _width + 7) / 8;
+    size_t const bpp = std::max(1, n_fields * _bit_depth / 8);
+
+    // Like libpng, only filter images of at least 8 bits per sample.
+    strip.raw_size = strip.num_rows * (rowbytes + 1);
+    strip.filtered.resize(strip.raw_size);
+    png_filter_rows(rows.data(), strip.num_rows, rowbytes, bpp, _bit_depth >= 8, strip.filtered.data());
+    free((void *)packed);
+
+    boost::asio::post(*_pool, [this, &strip] { _deflateStrip(strip); });
+}
+
+void TiledRenderer::_deflateStrip(Strip &strip)
+{
+    bool const last = strip.row + strip.num_rows == _height;
+
+    strip.adler = adler32(adler32(0, nullptr, 0), strip.filtered.data(), strip.raw_size);
+
+    z_stream zs = {};
+    // Raw deflate, so the pieces can be concatenated; libpng also uses Z_FILTERED for filtered rows.
+    deflateInit2(&zs, _zlib, Z_DEFLATED, -15, 8, _bit_depth >= 8 ? Z_FILTERED : Z_DEFAULT_STRATEGY);
+
+    zs.next_in = strip.filtered.data();
+    zs.avail_in = strip.raw_size;
+    size_t const chunk = deflateBound(&zs, strip.raw_size) + 64; // Leave room for the sync flush marker.
+    size_t have = 0;
+    do {
+        strip.deflated.resize(have + chunk);
+        zs.next_out = strip.deflated.data() + have;
+        zs.avail_out = chunk;
+        deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+        have = strip.deflated.size() - zs.avail_out;
+    } while (zs.avail_out == 0);
+    strip.deflated.resize(have);
+    deflateEnd(&zs);
+
+    strip.filtered = {};
+
+    auto lock = std::lock_guard(_mutex);
+    strip.done = true;
+    _cond.notify_all();
+}
+
+TiledRenderer::Strip TiledRenderer::next_strip()
+{
+    auto lock = std::unique_lock(_mutex);
+
+    if (_strips.empty()) {
+        return {};
+    }
+
+    _cond.wait(lock, [this] { return _strips.front().done; });
+    auto strip = std::move(_strips.front());
+    _strips.pop_front();
+
+    // Keep the pipeline full.
+    if (_next_row < _height) {
+        _queueStrip();
+    }
+
+    return strip;
+}
+
+/**
+ * Number of threads to use for export, with 0 meaning one per processor.
+ */
+static int export_numthreads(int numthreads)
+{
+    if (numthreads > 0) {
+        return numthreads;
+    }
+    auto ret = std::thread::hardware_concurrency();
+    return ret == 0 ? 4 : ret; // Sensible fallback if not reported.
+}
+
+/**
+ * The transform from document coordinates to the pixels of an export of the given area and size.
+ */
+static Geom::Affine sp_export_affine(Geom::Rect const &area, unsigned long width, unsigned long height)
+{
+    /* Calculate translation by transforming to document coordinates (flipping Y)*/
+    Geom::Point translation = -area.min();
+
+    /*  This calculation is only valid when assumed that (x0,y0)= area.corner(0) and (x1,y1) = area.corner(2)
+     * 1) a[0] * x0 + a[2] * y1 + a[4] = 0.0
+     * 2) a[1] * x0 + a[3] * y1 + a[5] = 0.0
+     * 3) a[0] * x1 + a[2] * y1 + a[4] = width
+     * 4) a[1] * x0 + a[3] * y0 + a[5] = height
+     * 5) a[1] = 0.0;
+     * 6) a[2] = 0.0;
+     *
+     * (1,3) a[0] * x1 - a[0] * x0 = width
+     * a[0] = width / (x1 - x0)
+     * (2,4) a[3] * y0 - a[3] * y1 = height
+     * a[3] = height / (y0 - y1)
+     * (1) a[4] = -a[0] * x0
+     * (2) a[5] = -a[3] * y1
+     */
+
+    return Geom::Translate(translation) * Geom::Scale(width / area.width(), height / area.height());
+}
+
 /* write a png file */
 
 struct SPPNGBD {
@@ -123,8 +521,102 @@ void PngTextList::add(gchar const* key, gchar const* text)
     }
 }
 
+/**
+ * Write the image data produced by the TiledRenderer as IDAT chunks.
+ *
+ * The renderer delivers each strip as a piece of a raw deflate stream; this adds the zlib header
+ * in front and the Adler-32 checksum of all pieces at the end.
+ *
+ * @return Whether all rows were written, i.e. the export was not cancelled.
+ */
 static bool
-sp_png_write_rgba_striped(SPDocument *doc,
+sp_png_write_idat_pipelined(png_structp png_ptr, SPEBP *ebp, int zlib)
+{
+    // zlib header: deflate with a 32K window, compression level hint, and check bits.
+    int const flevel = zlib < 2 ? 0 : zlib < 6 ? 1 : zlib == 6 ? 2 : 3;
+    int const cmf = 0x78;
+    int flg = flevel << 6;
+    flg += 31 - (cmf * 256 + flg) % 31;
+    png_byte const header[2] = { cmf, static_cast<png_byte>(flg) };
+    png_write_chunk(png_ptr, (png_const_bytep)"IDAT", header, sizeof(header));
+
+    uLong adler = adler32(0, nullptr, 0);
+    while (true) {
+        auto strip = ebp->tiler->next_strip();
+        if (strip.num_rows == 0) {
+            break;
+        }
+
+        if (ebp->status) {
+            if (!ebp->status((float) strip.row / ebp->height, ebp->data)) return false;
+        }
+
+        png_write_chunk(png_ptr, (png_const_bytep)"IDAT", strip.deflated.data(), strip.deflated.size());
+        adler = adler32_combine(adler, strip.adler, strip.raw_size);
+    }
+
+    png_byte const trailer[4] = {
+        static_cast<png_byte>(adler >> 24),
+        static_cast<png_byte>(adler >> 16),
+        static_cast<png_byte>(adler >> 8),
+        static_cast<png_byte>(adler)
+    };
+    png_write_chunk(png_ptr, (png_const_bytep)"IDAT", trailer, sizeof(trailer));
+
+    return true;
+}
+
+/**
+ * The text chunks to write to an exported PNG: the document metadata that has an equivalent
+ * PNG keyword.
+ */
+static std::vector<std::pair<std::string, std::string>>
+sp_png_text_metadata(SPDocument *doc)
+{
+    std::vector<std::pair<std::string, std::string>> metadata;
+
+    metadata.emplace_back("Software", "www.inkscape.org"); // Made by Inkscape comment
+    {
+        const gchar* pngToDc[] = {"Title", "title",
+                               "Author", "creator",
+                               "Description", "description",
+                               //"Copyright", "",
+                               "Creation Time", "date",
+                               //"Disclaimer", "",
+                               //"Warning", "",
+                               "Source", "source"
+                               //"Comment", ""
+        };
+        for (size_t i = 0; i < G_N_ELEMENTS(pngToDc); i += 2) {
+            struct rdf_work_entity_t * entity = rdf_find_entity ( pngToDc[i + 1] );
+            if (entity) {
+                gchar const* data = rdf_get_work_entity(doc, entity);
+                if (data && *data) {
+                    metadata.emplace_back(pngToDc[i], data);
+                }
+            } else {
+                g_warning("Unable to find entity [%s]", pngToDc[i + 1]);
+            }
+        }
+
+
+        struct rdf_license_t *license =  rdf_get_license(doc);
+        if (license) {
+            if (license->name && license->uri) {
+                metadata.emplace_back("Copyright", std::string(license->name) + " " + license->uri);
+            } else if (license->name) {
+                metadata.emplace_back("Copyright", license->name);
+            } else if (license->uri) {
+                metadata.emplace_back("Copyright", license->uri);
+            }
+        }
+    }
+
+    return metadata;
+}
+
+static bool
+sp_png_write_rgba_striped(std::vector<std::pair<std::string, std::string>> const &metadata,
                           gchar const *filename, unsigned long int width, unsigned long int height, double xdpi, double ydpi,
                           int (* get_rows)(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth, int antialias),
                           void *data, bool interlace, int color_type, int bit_depth, int zlib, int antialiasing)
@@ -211,44 +703,8 @@ sp_png_write_rgba_striped(SPDocument *doc,
     }
 
     PngTextList textList;
-
-    textList.add("Software", "www.inkscape.org"); // Made by Inkscape comment
-    {
-        const gchar* pngToDc[] = {"Title", "title",
-                               "Author", "creator",
-                               "Description", "description",
-                               //"Copyright", "",
-                               "Creation Time", "date",
-                               //"Disclaimer", "",
-                               //"Warning", "",
-                               "Source", "source"
-                               //"Comment", ""
-        };
-        for (size_t i = 0; i < G_N_ELEMENTS(pngToDc); i += 2) {
-            struct rdf_work_entity_t * entity = rdf_find_entity ( pngToDc[i + 1] );
-            if (entity) {
-                gchar const* data = rdf_get_work_entity(doc, entity);
-                if (data && *data) {
-                    textList.add(pngToDc[i], data);
-                }
-            } else {
-                g_warning("Unable to find entity [%s]", pngToDc[i + 1]);
-            }
-        }
-
-
-        struct rdf_license_t *license =  rdf_get_license(doc);
-        if (license) {
-            if (license->name && license->uri) {
-                gchar* tmp = g_strdup_printf("%s %s", license->name, license->uri);
-                textList.add("Copyright", tmp);
-                g_free(tmp);
-            } else if (license->name) {
-                textList.add("Copyright", license->name);
-            } else if (license->uri) {
-                textList.add("Copyright", license->uri);
-            }
-        }
+    for (auto const &[key, text] : metadata) {
+        textList.add(key.c_str(), text.c_str());
     }
     if (textList.getCount() > 0) {
         png_set_text(png_ptr, info_ptr, textList.getPtext(), textList.getCount());
@@ -282,6 +738,21 @@ sp_png_write_rgba_striped(SPDocument *doc,
      * use the first method if you aren't handling interlacing yourself.
      */
 
+    if (ebp->tiler) {
+        // Image data arrives already filtered and compressed, so write the IDAT chunks directly.
+        bool const complete = sp_png_write_idat_pipelined(png_ptr, ebp, zlib);
+        if (complete) {
+            png_write_chunk(png_ptr, (png_const_bytep)"IEND", nullptr, 0);
+        }
+        png_destroy_write_struct(&png_ptr, &info_ptr);
+        fclose(fp);
+        if (!complete) {
+            // Cancelled or failed: don't leave a truncated image behind.
+            g_unlink(filename);
+        }
+        return complete;
+    }
+
     png_bytep* row_pointers = new png_bytep[ebp->sheight];
     int number_of_passes = interlace ? png_set_interlace_handling(png_ptr) : 1;
 
@@ -341,7 +812,9 @@ sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, v
     Geom::IntRect bbox = Geom::IntRect::from_xywh(0, row, ebp->width, num_rows);
 
     /* Update to renderable state */
-    ebp->drawing->update(bbox);
+    if (!ebp->prepared) {
+        ebp->drawing->update(bbox);
+    }
 
     int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, ebp->width);
     unsigned char *px = g_new(guchar, num_rows * stride);
@@ -377,16 +850,20 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
                                 unsigned long bgcolor,
                                 unsigned int (*status) (float, void *),
                                 void *data, bool force_overwrite,
-                                const std::vector<SPItem*> &items_only, bool interlace, int color_type, int bit_depth, int zlib, int antialiasing)
+                                const std::vector<SPItem*> &items_only, bool interlace, int color_type, int bit_depth, int zlib, int antialiasing,
+                                int numthreads)
 {
     return sp_export_png_file(doc, filename, Geom::Rect(Geom::Point(x0,y0),Geom::Point(x1,y1)),
-                              width, height, xdpi, ydpi, bgcolor, status, data, force_overwrite, items_only, interlace, color_type, bit_depth, zlib, antialiasing);
+                              width, height, xdpi, ydpi, bgcolor, status, data, force_overwrite, items_only, interlace, color_type, bit_depth, zlib, antialiasing,
+                              numthreads);
 }
 
 /**
  * Export an area to a PNG file
  *
  * @param area Area in document coordinates
+ * @param numthreads Number of threads to render with, or 0 for one per processor.
+ *                   With more than one thread, the area is rendered as tiles in parallel.
  */
 ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
                                 Geom::Rect const &area,
@@ -394,7 +871,8 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
                                 unsigned long bgcolor,
                                 unsigned (*status)(float, void *),
                                 void *data, bool force_overwrite,
-                                const std::vector<SPItem*> &items_only, bool interlace, int color_type, int bit_depth, int zlib, int antialiasing)
+                                const std::vector<SPItem*> &items_only, bool interlace, int color_type, int bit_depth, int zlib, int antialiasing,
+                                int numthreads)
 {
     g_return_val_if_fail(doc != nullptr, EXPORT_ERROR);
     g_return_val_if_fail(filename != nullptr, EXPORT_ERROR);
@@ -409,36 +887,44 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 
     doc->ensureUpToDate();
 
-    /* Calculate translation by transforming to document coordinates (flipping Y)*/
-    Geom::Point translation = -area.min();
-
-    /*  This calculation is only valid when assumed that (x0,y0)= area.corner(0) and (x1,y1) = area.corner(2)
-     * 1) a[0] * x0 + a[2] * y1 + a[4] = 0.0
-     * 2) a[1] * x0 + a[3] * y1 + a[5] = 0.0
-     * 3) a[0] * x1 + a[2] * y1 + a[4] = width
-     * 4) a[1] * x0 + a[3] * y0 + a[5] = height
-     * 5) a[1] = 0.0;
-     * 6) a[2] = 0.0;
-     *
-     * (1,3) a[0] * x1 - a[0] * x0 = width
-     * a[0] = width / (x1 - x0)
-     * (2,4) a[3] * y0 - a[3] * y1 = height
-     * a[3] = height / (y0 - y1)
-     * (1) a[4] = -a[0] * x0
-     * (2) a[5] = -a[3] * y1
-     */
-
-    Geom::Affine const affine(Geom::Translate(translation)
-                            * Geom::Scale(width / area.width(),
-                                        height / area.height()));
+    Geom::Affine const affine = sp_export_affine(area, width, height);
 
     struct SPEBP ebp;
     ebp.width  = width;
     ebp.height = height;
     ebp.background = bgcolor;
+    ebp.drawing = nullptr;
+    ebp.prepared = false;
+    ebp.tiler = nullptr;
+    ebp.status = status;
+    ebp.data   = data;
+    ebp.sheight = 64;
+
+    bool write_status = false;
+
+    numthreads = export_numthreads(numthreads);
+
+    if (numthreads > 1) {
+        // Interlaced images are written in several passes over the rows, so are not streamable.
+        if (interlace) {
+            g_warning("Interlaced PNG export is not supported with multiple threads; using one thread.");
+        } else {
+            TiledRenderer tiler(doc, affine, items_only, width, height, ebp.sheight, bgcolor, antialiasing,
+                                color_type, bit_depth, zlib, numthreads);
+            ebp.tiler = &tiler;
+            ebp.px = nullptr;
+            return sp_png_write_rgba_striped(sp_png_text_metadata(doc), filename, width, height, xdpi, ydpi, nullptr, &ebp, interlace, color_type, bit_depth, zlib, antialiasing)
+                ? EXPORT_OK : EXPORT_ERROR;
+        }
+    }
 
     /* Create new drawing */
     Inkscape::Drawing drawing;
+    if (items_only.empty()) {
+        // Content keys do not cover the items hidden for export, so only use it for full exports.
+        drawing.setDiskCache(Inkscape::DrawingDiskCache::get());
+    }
+    drawing.setProfile(Inkscape::DrawingProfile::get());
     unsigned const dkey = SPItem::display_key_new(1);
     drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
     drawing.root()->setTransform(affine);
@@ -452,16 +938,10 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
         doc->getRoot()->invoke_hide_except(dkey, items_only);
     }
 
-    ebp.status = status;
-    ebp.data   = data;
-
-    bool write_status = false;;
-
-    ebp.sheight = 64;
     ebp.px = g_try_new(guchar, 4 * ebp.sheight * width);
 
     if (ebp.px) {
-        write_status = sp_png_write_rgba_striped(doc, filename, width, height, xdpi, ydpi, sp_export_get_rows, &ebp, interlace, color_type, bit_depth, zlib, antialiasing);
+        write_status = sp_png_write_rgba_striped(sp_png_text_metadata(doc), filename, width, height, xdpi, ydpi, sp_export_get_rows, &ebp, interlace, color_type, bit_depth, zlib, antialiasing);
         g_free(ebp.px);
     }
 
@@ -472,6 +952,223 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 }
 
 
+
+/**
+ * A queued export, with its own drawing tree so that it can be rendered concurrently with others.
+ */
+struct PngExportJob
+{
+    SPDocument *doc;
+    unsigned dkey;
+    std::unique_ptr<Inkscape::Drawing> drawing;
+    std::vector<std::pair<std::string, std::string>> metadata;
+    std::string filename;
+    unsigned long width, height;
+    double xdpi, ydpi;
+    guint32 background;
+    int color_type, bit_depth, zlib, antialiasing;
+    std::size_t bytes;
+
+    std::chrono::steady_clock::time_point deadline;
+    bool timed_out = false;
+    bool ok = false;
+    bool done = false;
+};
+
+class PngExportQueuePrivate
+{
+public:
+    PngExportQueuePrivate(int numthreads, std::size_t max_bytes, double timeout);
+
+    void run(PngExportJob &job);
+    void reap(bool wait);
+
+    std::size_t max_bytes;
+    double timeout;
+    int lookahead;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::list<PngExportJob> jobs; // Queued, running and finished jobs not yet reaped.
+    std::size_t bytes = 0; // Estimated memory of the unfinished jobs.
+    int pending = 0; // Number of unfinished jobs.
+    int failures = 0;
+
+    boost::asio::thread_pool pool;
+};
+
+PngExportQueuePrivate::PngExportQueuePrivate(int numthreads, std::size_t max_bytes, double timeout)
+    : max_bytes(max_bytes)
+    , timeout(timeout)
+    , lookahead(2 * numthreads)
+    , pool(numthreads)
+{}
+
+static unsigned sp_export_job_status(float, void *data)
+{
+    auto job = static_cast<PngExportJob *>(data);
+    if (std::chrono::steady_clock::now() > job->deadline) {
+        job->timed_out = true;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Render and write an export. Runs on a worker thread, so touches nothing but the job. Its
+ * drawing was updated by add(), so it is only rendered here.
+ */
+void PngExportQueuePrivate::run(PngExportJob &job)
+{
+    bool const limited = timeout > 0;
+    if (limited) {
+        job.deadline = std::chrono::steady_clock::now()
+                     + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout));
+    }
+
+    SPEBP ebp;
+    ebp.width = job.width;
+    ebp.height = job.height;
+    ebp.sheight = 64;
+    ebp.background = job.background;
+    ebp.drawing = job.drawing.get();
+    ebp.prepared = true; // Updating touches fonts and styles shared with the calling thread.
+    ebp.tiler = nullptr;
+    ebp.status = limited ? sp_export_job_status : nullptr;
+    ebp.data = &job;
+    ebp.px = g_try_new(guchar, 4 * ebp.sheight * job.width);
+
+    bool ok = false;
+    if (ebp.px) {
+        ok = sp_png_write_rgba_striped(job.metadata, job.filename.c_str(), job.width, job.height, job.xdpi, job.ydpi,
+                                       sp_export_get_rows, &ebp, false, job.color_type, job.bit_depth, job.zlib,
+                                       job.antialiasing);
+        g_free(ebp.px);
+    }
+
+    if (job.timed_out) {
+        // Don't leave a truncated image behind.
+        g_unlink(job.filename.c_str());
+        ok = false;
+    }
+
+    auto lock = std::lock_guard(mutex);
+    job.ok = ok;
+    job.done = true;
+    bytes -= job.bytes;
+    pending--;
+    cond.notify_all();
+}
+
+/// Release the drawings of finished jobs. Runs on the thread owning the documents.
+void PngExportQueuePrivate::reap(bool wait)
+{
+    std::list<PngExportJob> finished;
+    {
+        auto lock = std::unique_lock(mutex);
+        if (wait) {
+            cond.wait(lock, [this] { return pending == 0; });
+        }
+        for (auto it = jobs.begin(); it != jobs.end(); ) {
+            auto next = std::next(it);
+            if (it->done) {
+                finished.splice(finished.end(), jobs, it);
+            }
+            it = next;
+        }
+    }
+
+    for (auto &job : finished) {
+        if (job.timed_out) {
+            std::cerr << "PngExportQueue: Export to " << job.filename << " timed out after " << timeout << " s." << std::endl;
+        } else if (!job.ok) {
+            std::cerr << "PngExportQueue: Failed to export to " << job.filename << std::endl;
+        }
+        if (!job.ok) {
+            failures++;
+        }
+        // Hide items, this releases arenaitems.
+        job.doc->getRoot()->invoke_hide(job.dkey);
+        job.drawing.reset();
+    }
+}
+
+PngExportQueue::PngExportQueue(int numthreads, std::size_t max_bytes, double timeout)
+    : d(std::make_unique<PngExportQueuePrivate>(export_numthreads(numthreads), max_bytes, timeout))
+{}
+
+PngExportQueue::~PngExportQueue()
+{
+    finish();
+}
+
+void PngExportQueue::add(SPDocument *doc, std::string filename, Geom::Rect const &area,
+                         unsigned long width, unsigned long height, double xdpi, double ydpi, unsigned long bgcolor,
+                         std::vector<SPItem*> const &items_only, int color_type, int bit_depth, int zlib, int antialiasing)
+{
+    g_return_if_fail(doc != nullptr);
+    g_return_if_fail(width >= 1);
+    g_return_if_fail(height >= 1);
+    g_return_if_fail(!area.hasZeroArea());
+
+    // Estimate the memory used by rendering as that of the whole image.
+    std::size_t const bytes = std::size_t{4} * width * height;
+
+    // Wait for room, releasing what finished in the meantime.
+    {
+        auto lock = std::unique_lock(d->mutex);
+        d->cond.wait(lock, [&] {
+            return d->pending < d->lookahead && (d->pending == 0 || d->bytes + bytes <= d->max_bytes);
+        });
+    }
+    d->reap(false);
+
+    doc->ensureUpToDate();
+
+    PngExportJob job;
+    job.doc = doc;
+    job.metadata = sp_png_text_metadata(doc);
+    job.filename = std::move(filename);
+    job.width = width;
+    job.height = height;
+    job.xdpi = xdpi;
+    job.ydpi = ydpi;
+    job.background = bgcolor;
+    job.color_type = color_type;
+    job.bit_depth = bit_depth;
+    job.zlib = zlib;
+    job.antialiasing = antialiasing;
+    job.bytes = bytes;
+
+    // Showing and updating the drawing touches the object tree, so do it here on the calling thread.
+    job.drawing = std::make_unique<Inkscape::Drawing>();
+    if (items_only.empty()) {
+        job.drawing->setDiskCache(Inkscape::DrawingDiskCache::get());
+    }
+    job.drawing->setProfile(Inkscape::DrawingProfile::get());
+    job.dkey = SPItem::display_key_new(1);
+    job.drawing->setRoot(doc->getRoot()->invoke_show(*job.drawing, job.dkey, SP_ITEM_SHOW_DISPLAY));
+    job.drawing->root()->setTransform(sp_export_affine(area, width, height));
+    job.drawing->setExact(); // export with maximum blur rendering quality
+    if (!items_only.empty()) {
+        doc->getRoot()->invoke_hide_except(job.dkey, items_only);
+    }
+    job.drawing->update(Geom::IntRect::from_xywh(0, 0, width, height));
+
+    auto lock = std::lock_guard(d->mutex);
+    auto &queued = d->jobs.emplace_back(std::move(job));
+    d->bytes += bytes;
+    d->pending++;
+    // List references remain valid until the job is reaped, which waits for it to be done.
+    boost::asio::post(d->pool, [this, &queued] { d->run(queued); });
+}
+
+int PngExportQueue::finish()
+{
+    d->reap(true);
+    return std::exchange(d->failures, 0);
+}
+
 /*
   Local Variables:
   mode:c++
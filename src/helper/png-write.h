@@ -16,6 +16,9 @@
  */
 
 #include <glib.h> // Only for gchar.
+#include <cstddef>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <2geom/forward.h>
@@ -39,13 +42,50 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 				unsigned long int width, unsigned long int height, double xdpi, double ydpi,
 				unsigned long bgcolor,
 				unsigned int (*status) (float, void *), void *data, bool force_overwrite = false, const std::vector<SPItem*> &items_only = std::vector<SPItem*>(), 
-                                bool interlace = false, int color_type = 6, int bit_depth = 8, int zlib = 6, int antialiasing = 2);
+                                bool interlace = false, int color_type = 6, int bit_depth = 8, int zlib = 6, int antialiasing = 2,
+                                int numthreads = 1);
 
 ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 				Geom::Rect const &area,
 				unsigned long int width, unsigned long int height, double xdpi, double ydpi,
 				unsigned long bgcolor,
 				unsigned int (*status) (float, void *), void *data, bool force_overwrite = false, const std::vector<SPItem*> &items_only = std::vector<SPItem*>(), 
-                                bool interlace = false, int color_type = 6, int bit_depth = 8, int zlib = 6, int antialiasing = 2);
+                                bool interlace = false, int color_type = 6, int bit_depth = 8, int zlib = 6, int antialiasing = 2,
+                                int numthreads = 1);
+
+class PngExportQueuePrivate;
+
+/**
+ * Renders and writes many PNG exports at once, possibly of different documents, on a bounded
+ * pool of worker threads.
+ *
+ * Each export is prepared on the calling thread, which must own the document, and gets its own
+ * drawing tree; that tree is then rendered and written on a worker while the caller goes on to
+ * prepare further exports. The documents must stay alive until finish() returns.
+ */
+class PngExportQueue
+{
+public:
+    /**
+     * @param numthreads Number of exports to render at once, or 0 for one per processor.
+     * @param max_bytes Approximate memory limit for the exports in progress, estimated from
+     *                  their pixel sizes. A single larger export still runs, on its own.
+     * @param timeout Seconds after which a running export is abandoned, or 0 for no limit.
+     */
+    PngExportQueue(int numthreads, std::size_t max_bytes, double timeout);
+    ~PngExportQueue();
+
+    /// Queue an export, with the parameters of sp_export_png_file(). Blocks while the queue is full.
+    void add(SPDocument *doc, std::string filename, Geom::Rect const &area,
+             unsigned long width, unsigned long height, double xdpi, double ydpi, unsigned long bgcolor,
+             std::vector<SPItem*> const &items_only = {}, int color_type = 6, int bit_depth = 8,
+             int zlib = 6, int antialiasing = 2);
+
+    /// Wait for all queued exports. Returns the number that failed or timed out.
+    int finish();
+
+private:
+    std::unique_ptr<PngExportQueuePrivate> d;
+};
 
 #endif // SEEN_SP_PNG_WRITE_H
@@ -35,6 +35,7 @@
  *       InkscapeApplication::destroy_window
  */
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <cerrno>  // History file
@@ -75,6 +76,7 @@
 #include "io/file.h"                // File open (command line).
 #include "io/resource.h"            // TEMPLATE
 #include "io/fix-broken-links.h"    // Fix up references.
+#include "io/render-server.h"       // Export server.
 
 #include "object/sp-root.h"         // Inkscape version.
 
@@ -732,6 +734,11 @@ InkscapeApplication::InkscapeApplication()
     gapp->add_main_option_entry(T::OPTION_TYPE_STRING,   "export-background-opacity", 'y', N_("Background opacity for exported bitmaps (0.0 to 1.0, or 1 to 255)"), N_("VALUE")); // Bxx
     gapp->add_main_option_entry(T::OPTION_TYPE_STRING,   "export-png-color-mode", '\0', N_("Color mode (bit depth and color type) for exported bitmaps (Gray_1/Gray_2/Gray_4/Gray_8/Gray_16/RGB_8/RGB_16/GrayAlpha_8/GrayAlpha_16/RGBA_8/RGBA_16)"), N_("COLOR-MODE")); // Bxx
     gapp->add_main_option_entry(T::OPTION_TYPE_STRING,      "export-png-use-dithering", '\0', N_("Force dithering or disables it"), "false|true"); // Bxx
+    gapp->add_main_option_entry(T::OPTION_TYPE_INT,      "export-png-threads",    '\0', N_("Number of threads to render bitmaps with (0 for one per processor); default is 1"), N_("THREADS")); // Bxx
+    gapp->add_main_option_entry(T::OPTION_TYPE_INT,      "export-jobs",           '\0', N_("Number of bitmap exports to render at once, across input files and object IDs (0 for one per processor); default is 1"), N_("JOBS")); // Bxx
+    gapp->add_main_option_entry(T::OPTION_TYPE_INT,      "export-timeout",        '\0', N_("Abandon bitmap exports taking longer than this (with --export-jobs)"), N_("SECONDS")); // Bxx
+    gapp->add_main_option_entry(T::OPTION_TYPE_INT,      "export-memory-limit",   '\0', N_("Memory to use for bitmap exports rendered at once (with --export-jobs); default is 1024"), N_("MIB")); // Bxx
+    gapp->add_main_option_entry(T::OPTION_TYPE_FILENAME, "export-render-profile", '\0', N_("Write render time per object of exported bitmaps to a JSON file"), N_("FILENAME")); // Bxx
 
     // Query - Geometry
     _start_main_option_section(_("Query object/document geometry"));
@@ -758,6 +765,7 @@ InkscapeApplication::InkscapeApplication()
     gapp->add_main_option_entry(T::OPTION_TYPE_BOOL,     "batch-process",         '\0', N_("Close GUI after executing all actions"),                                    "");
     _start_main_option_section();
     gapp->add_main_option_entry(T::OPTION_TYPE_BOOL,     "shell",                 '\0', N_("Start Inkscape in interactive shell mode"),                                 "");
+    gapp->add_main_option_entry(T::OPTION_TYPE_FILENAME, "server",                '\0', N_("Listen for export jobs on a Unix socket"),                                 N_("FILENAME"));
 
     // clang-format on
 
@@ -1063,7 +1071,13 @@ InkscapeApplication::on_activate()
     }
 
     // Process document (command line actions, shell, create window)
+    _file_export.begin_exports();
     process_document (document, output);
+    _file_export.finish_exports();
+
+    if (!_server_socket.empty()) {
+        Inkscape::RenderServer(*this, _server_socket).run();
+    }
 
     if (_batch_process) {
         // If with_gui, we've reused a window for each file. We must quit to destroy it.
@@ -1104,6 +1118,7 @@ InkscapeApplication::on_open(const Gio::Application::type_vec_files& files, cons
     }
 
     startup_close();
+    _file_export.begin_exports();
     for (auto file : files) {
 
         // Open file
@@ -1117,6 +1132,13 @@ InkscapeApplication::on_open(const Gio::Application::type_vec_files& files, cons
         process_document (document, file->get_path());
     }
 
+    // Bitmap exports may still be rendering concurrently.
+    _file_export.finish_exports();
+
+    if (!_server_socket.empty()) {
+        Inkscape::RenderServer(*this, _server_socket).run();
+    }
+
     if (_batch_process) {
         // If with_gui, we've reused a window for each file. We must quit to destroy it.
         gio_app()->quit();
@@ -1459,7 +1481,8 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
         options->contains("select")                ||
         options->contains("action-list")           ||
         options->contains("actions")               ||
-        options->contains("shell")
+        options->contains("shell")                 ||
+        options->contains("server")
         ) {
         _with_gui = false;
     }
@@ -1475,6 +1498,9 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
     if (options->contains("batch-process"))  _batch_process = true;
     if (options->contains("shell"))          _use_shell = true;
     if (options->contains("pipe"))           _use_pipe  = true;
+    if (options->contains("server")) {
+        options->lookup_value("server", _server_socket);
+    }
 
     // Enable auto-export
     if (options->contains("export-filename")  ||
@@ -1655,6 +1681,29 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
         else std::cerr << "invalid value for export-png-use-dithering. Ignoring." << std::endl;
     } else _file_export.export_png_use_dithering = prefs->getBool("/options/dithering/value", true);
 
+    if (options->contains("export-png-threads")) {
+        options->lookup_value("export-png-threads", _file_export.export_png_threads);
+    }
+
+    if (options->contains("export-jobs")) {
+        options->lookup_value("export-jobs", _file_export.export_jobs);
+    }
+
+    if (options->contains("export-timeout")) {
+        int timeout = 0;
+        options->lookup_value("export-timeout", timeout);
+        _file_export.export_timeout = std::max(timeout, 0);
+    }
+
+    if (options->contains("export-memory-limit")) {
+        options->lookup_value("export-memory-limit", _file_export.export_memory_limit);
+        _file_export.export_memory_limit = std::max(_file_export.export_memory_limit, 1);
+    }
+
+    if (options->contains("export-render-profile")) {
+        options->lookup_value("export-render-profile", _file_export.export_render_profile);
+    }
+
 
     GVariantDict *options_copy = options->gobj_copy();
     GVariant *options_var = g_variant_dict_end(options_copy);
@@ -137,6 +137,7 @@ protected:
     bool _batch_process = false; // Temp
     bool _use_shell   = false;
     bool _use_pipe    = false;
+    std::string _server_socket; // Listen for export jobs on this socket if set.
     bool _auto_export = false;
     int _pdf_poppler  = false;
     bool _use_command_line_argument = false;
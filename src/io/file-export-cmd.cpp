@@ -15,6 +15,7 @@
 
 #include "file-export-cmd.h"
 
+#include <fstream>
 #include <boost/algorithm/string.hpp>
 #include <png.h> // PNG export
 
@@ -32,6 +33,7 @@
 #include "text-editing.h" // te_update_layout_now_recursive
 #include "selection-chemistry.h" // fit_canvas_to_drawing
 #include "svg/svg-color.h" // Background color
+#include "display/drawing-profile.h"
 #include "helper/png-write.h" // PNG Export
 #include "util/parse-int-range.h"
 
@@ -72,10 +74,46 @@ InkFileExportCmd::InkFileExportCmd()
     , export_id_only(false)
     , export_background_opacity(-1) // default is unset != actively set to 0
     , export_plain_svg(false)
+    , export_png_use_dithering(Inkscape::Preferences::get()->getBool("/options/dithering/value", true))
+    , export_png_threads(1)
+    , export_jobs(1)
+    , export_timeout(0)
+    , export_memory_limit(1024)
 {
 }
 
+InkFileExportCmd::~InkFileExportCmd() = default;
+
 void
+InkFileExportCmd::begin_exports()
+{
+    if (!export_render_profile.empty()) {
+        // Collect the render statistics of the bitmap exports of all documents.
+        Inkscape::DrawingProfile::start();
+    }
+}
+
+int
+InkFileExportCmd::finish_exports()
+{
+    int const failures = _png_queue ? _png_queue->finish() : 0;
+
+    auto profile = Inkscape::DrawingProfile::stop();
+    if (profile && !export_render_profile.empty()) {
+        profile->log();
+        std::ofstream file(export_render_profile);
+        profile->writeJson(file);
+        file.close();
+        if (file.fail()) {
+            std::cerr << "InkFileExportCmd::finish_exports: Could not write render profile to "
+                      << export_render_profile << std::endl;
+        }
+    }
+
+    return failures;
+}
+
+int
 InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
 {
     std::string export_type_filename;
@@ -98,7 +136,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 std::cerr << "InkFileExportCmd::do_export: No export type specified. "
                           << "Append a supported file extension to filename provided with --export-filename or "
                           << "provide one or more extensions separately using --export-type" << std::endl;
-                return;
+                return 1;
             } else {
                 // no extension is fine if --export-type is given
                 // explicitly stated extensions are handled later
@@ -122,7 +160,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         if (export_id.empty() && !export_area_drawing) {
             std::cerr << "InkFileExportCmd::do_export: "
                       << "--export-use-hints can only be used with --export-id or --export-area-drawing." << std::endl;
-            return;
+            return 1;
         }
         if (export_type_list.size() > 1 || (export_type_list.size() == 1 && export_type_list[0] != "png")) {
             std::cerr << "InkFileExportCmd::do_export: --export-use-hints can only be used with PNG export! "
@@ -146,7 +184,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 std::cerr << "InkFileExportCmd::do_export: "
                           << "The supplied --export-extension was not found. Specify a file extension "
                           << "to get a list of available extensions for this file type.";
-                return;
+                return 1;
             }
         } else {
             export_type_list.emplace_back("svg"); // fall-back to SVG by default
@@ -165,6 +203,8 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
     Inkscape::Extension::DB::OutputList extension_list;
     Inkscape::Extension::db.get_output_list(extension_list);
 
+    int status = 0;
+
     for (auto const &Type : export_type_list) {
         // use lowercase type for following comparisons
         auto type = Type.lowercase();
@@ -182,10 +222,11 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         // For PNG export, there is no extension, so the method below can not be used.
         if (type == "png") {
             if (!export_extension_forced) {
-                do_export_png(doc, export_filename);
+                status |= do_export_png(doc, export_filename);
             } else {
                 std::cerr << "InkFileExportCmd::do_export: "
                           << "The parameter --export-extension is invalid for PNG export" << std::endl;
+                status = 1;
             }
             continue;
         }
@@ -193,7 +234,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         // an extension ID was explicitly given. This makes handling of --export-plain-svg easier (which
         // should also work when multiple file types are given, unlike --export-extension)
         if (type == "svg" && !export_extension_forced) {
-            do_export_svg(doc, export_filename);
+            status |= do_export_svg(doc, export_filename);
             continue;
         }
 
@@ -215,15 +256,15 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 if (!export_extension_forced ||
                     (export_extension == Glib::ustring(oext->get_id()).lowercase())) {
                     if (type == "svg") {
-                        do_export_svg(doc, export_filename, *oext);
+                        status |= do_export_svg(doc, export_filename, *oext);
                     } else if (type == "ps") {
-                        do_export_ps_pdf(doc, export_filename, "image/x-postscript", *oext);
+                        status |= do_export_ps_pdf(doc, export_filename, "image/x-postscript", *oext);
                     } else if (type == "eps") {
-                        do_export_ps_pdf(doc, export_filename, "image/x-e-postscript", *oext);
+                        status |= do_export_ps_pdf(doc, export_filename, "image/x-e-postscript", *oext);
                     } else if (type == "pdf") {
-                        do_export_ps_pdf(doc, export_filename, "application/pdf", *oext);
+                        status |= do_export_ps_pdf(doc, export_filename, "application/pdf", *oext);
                     } else {
-                        do_export_extension(doc, export_filename, oext);
+                        status |= do_export_extension(doc, export_filename, oext);
                     }
                     exported = true;
                     break;
@@ -231,6 +272,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
             }
         }
         if (!exported) {
+            status = 1;
             if (export_extension_forced && extension_for_fn_exists) {
                 // the located extension for this file type did not match the provided --export-extension parameter
                 std::cerr << "InkFileExportCmd::do_export: "
@@ -249,6 +291,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
             }
         }
     }
+    return status;
 }
 
 // File names use std::string. HTML5 and presumably SVG 2 allows UTF-8 characters. Do we need to convert "object_id" here?
@@ -493,6 +536,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
 {
     bool filename_from_hint = false;
     gdouble dpi = 0.0;
+    int status = 0;
 
     auto prefs = Inkscape::Preferences::get();
     bool old_dither = prefs->getBool("/options/dithering/value", true);
@@ -510,6 +554,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
             std::cerr << "InkFileExport::do_export_png: "
                       << "Object with id=\"" << object_id.raw()
                       << "\" was not found in the document. Skipping." << std::endl;
+            status = 1;
             continue;
         }
 
@@ -517,6 +562,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
             std::cerr << "InkFileExportCmd::do_export_png: "
                       << "Object with id=\"" << object_id.raw()
                       << "\" is not a visible item. Skipping." << std::endl;
+            status = 1;
             continue;
         }
 
@@ -538,10 +584,12 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
             // And if only one page is selected then we assume the user knows the filename they intended.
             std::string filename_out = base + (pages.size() > 1 ? "_p" + std::to_string(page_num) : "") + ".png";
             if (auto page = pm.getPage(page_num - 1)) {
-                do_export_png_now(doc, filename_out, page->getDesktopRect(), dpi, items);
+                status |= do_export_png_now(doc, filename_out, page->getDesktopRect(), dpi, items);
+            } else {
+                status = 1;
             }
         }
-        return 0;
+        return status;
     }
 
     if (objects.empty()) {
@@ -572,6 +620,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
             } else {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Export filename hint not found for object " << object_id.raw() << ". Skipping." << std::endl;
+                status = 1;
                 continue;
             }
 
@@ -598,6 +647,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
         if (filename_out.empty()) {
             std::cerr << "InkFileExport::do_export_png: "
                       << "No valid export filename given and no filename hint. Skipping." << std::endl;
+            status = 1;
             continue;
         }
 
@@ -615,6 +665,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
         std::string directory = Glib::path_get_dirname(filename_out);
         if (!Glib::file_test(directory, Glib::FILE_TEST_IS_DIR)) {
             std::cerr << "File path " << filename_out << " includes directory that doesn't exist. Skipping." << std::endl;
+            status = 1;
             continue;
         }
 
@@ -651,6 +702,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
             } else {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Unable to determine a valid bounding box. Skipping." << std::endl;
+                status = 1;
                 continue;
             }
         }
@@ -659,14 +711,14 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
             area = area.roundOutwards();
         }
         // End finding area.
-        do_export_png_now(doc, filename_out, area, dpi, items);
+        status |= do_export_png_now(doc, filename_out, area, dpi, items);
 
     } // End loop over objects.
     prefs->setBool("/options/dithering/value", old_dither);
-    return 0;
+    return status;
 }
 
-void
+int
 InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename_out, Geom::Rect area, double dpi_in, const std::vector<SPItem *> &items)
 {
     // -------------------------- DPI -------------------------------
@@ -679,7 +731,7 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
             std::cerr << "InkFileExport::do_export_png: "
                       << "DPI value " << export_dpi
                       << " out of range [0.1 - 10000.0]. Skipping.";
-            return;
+            return 1;
         }
     }
 
@@ -700,7 +752,7 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
             if ((height < 1) || (height > PNG_UINT_31_MAX)) {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Export height " << height << " out of range (1 to " << PNG_UINT_31_MAX << ")" << std::endl;
-                return;
+                return 1;
             }
             ydpi = Inkscape::Util::Quantity::convert(height, "in", "px") / area.height();
             xdpi = ydpi;
@@ -712,7 +764,7 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
             if ((width < 1) || (width > PNG_UINT_31_MAX)) {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Export width " << width << " out of range (1 to " << PNG_UINT_31_MAX << ")." << std::endl;
-                return;
+                return 1;
             }
             xdpi = Inkscape::Util::Quantity::convert(width, "in", "px") / area.width();
             ydpi = export_height ? ydpi : xdpi;
@@ -729,7 +781,7 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
 
         if ((width < 1) || (height < 1) || (width > PNG_UINT_31_MAX) || (height > PNG_UINT_31_MAX)) {
             std::cerr << "InkFileExport::do_export_png: Dimensions " << width << "x" << height << " are out of range (1 to " << PNG_UINT_31_MAX << ")." << std::endl;
-            return;
+            return 1;
         }
 
         // -------------------------- Bit Depth and Color Type --------------------
@@ -756,7 +808,7 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
             if (it == color_modes.end()) {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Color mode " << export_png_color_mode.raw() << " is invalid. It must be one of Gray_1/Gray_2/Gray_4/Gray_8/Gray_16/RGB_8/RGB_16/GrayAlpha_8/GrayAlpha_16/RGBA_8/RGBA_16." << std::endl;
-                return;
+                return 1;
             } else {
                 std::tie(color_type, bit_depth) = it->second;
             }
@@ -772,12 +824,23 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
                   << width << " x " << height << " pixels (" << dpi << " dpi)" << std::endl;
 #endif
 
+        if (export_jobs != 1) {
+            if (!_png_queue) {
+                _png_queue = std::make_unique<PngExportQueue>(export_jobs, (size_t{1} << 20) * export_memory_limit, export_timeout);
+            }
+            _png_queue->add(doc, filename_out, area, width, height, xdpi, ydpi, bgcolor,
+                            export_id_only ? items : std::vector<SPItem*>(), color_type, bit_depth, 6, 2);
+            return 0; // Failures are counted by finish_exports().
+        }
+
         if( sp_export_png_file(doc, filename_out.c_str(), area, width, height, xdpi, ydpi,
                                bgcolor, nullptr, nullptr, true, export_id_only ? items : std::vector<SPItem*>(),
-                               false, color_type, bit_depth) == 1 ) {
+                               false, color_type, bit_depth, 6, 2, export_png_threads) == 1 ) {
         } else {
             std::cerr << "InkFileExport::do_export_png: Failed to export to " << filename_out << std::endl;
+            return 1;
         }
+        return 0;
 }
 
 
@@ -964,9 +1027,15 @@ int InkFileExportCmd::do_export_extension(SPDocument *doc, std::string const &fi
                                           Inkscape::Extension::Output *extension)
 {
     std::string filename_out = get_filename_out(filename_in);
-    if (extension) {
-        extension->set_state(Inkscape::Extension::Extension::STATE_LOADED);
+    if (!extension) {
+        return 1;
+    }
+    extension->set_state(Inkscape::Extension::Extension::STATE_LOADED);
+    try {
         extension->save(doc, filename_out.c_str());
+    } catch (...) {
+        std::cerr << "InkFileExportCmd::do_export_extension: Failed to save to: " << filename_out << std::endl;
+        return 1;
     }
     return 0;
 }
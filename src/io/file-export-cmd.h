@@ -13,9 +13,11 @@
 #define INK_FILE_EXPORT_CMD_H
 
 #include <iostream>
+#include <memory>
 #include <glibmm.h>
 #include "2geom/rect.h"
 
+class PngExportQueue;
 class SPDocument;
 class SPItem;
 namespace Inkscape {
@@ -28,8 +30,11 @@ class InkFileExportCmd {
 
 public:
     InkFileExportCmd();
+    ~InkFileExportCmd();
 
-    void do_export(SPDocument* doc, std::string filename_in="");
+    void begin_exports(); // Before the first document, to profile the exports of all of them.
+    int do_export(SPDocument* doc, std::string filename_in=""); // Returns non-zero if any export failed.
+    int finish_exports(); // Wait for bitmap exports queued with export_jobs, write the profile. Returns the number that failed.
 
 private:
     guint32 get_bgcolor(SPDocument *doc);
@@ -43,7 +48,8 @@ private:
     int do_export_extension(SPDocument *doc, std::string const &filename_in, Inkscape::Extension::Output *extension);
     Glib::ustring export_type_current;
 
-    void do_export_png_now(SPDocument *doc, std::string const &filename_out, Geom::Rect area, double dpi_in, const std::vector<SPItem *> &items);
+    int do_export_png_now(SPDocument *doc, std::string const &filename_out, Geom::Rect area, double dpi_in, const std::vector<SPItem *> &items);
+    std::unique_ptr<PngExportQueue> _png_queue;
 public:
     // Should be private, but this is just temporary code (I hope!).
 
@@ -78,6 +84,11 @@ public:
     Glib::ustring export_png_color_mode;
     bool          export_plain_svg;
     bool          export_png_use_dithering;
+    int           export_png_threads;
+    int           export_jobs;           // Bitmap exports rendered at once, across documents and ids.
+    double        export_timeout;        // Seconds, for exports rendered with export_jobs.
+    int           export_memory_limit;   // MiB, for exports rendered with export_jobs.
+    std::string   export_render_profile; // JSON file for render statistics of bitmap exports.
 };
 
 #endif // INK_FILE_EXPORT_CMD_H
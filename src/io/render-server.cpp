@@ -0,0 +1,387 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Headless export server, answering export jobs sent over a local socket.
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * The contents of this file may be used under the GNU General Public License Version 2 or later.
+ *
+ */
+
+#include "render-server.h"
+
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include <glib/gstdio.h>
+#ifdef G_OS_UNIX
+#include <giomm/unixsocketaddress.h>
+#endif
+
+#include "document.h"
+#include "file-export-cmd.h"
+#include "inkscape.h"
+#include "inkscape-application.h"
+
+namespace Inkscape {
+
+namespace {
+
+// The number of parsed documents kept for later jobs.
+constexpr std::size_t MAX_DOCUMENTS = 16;
+
+struct FileStamp
+{
+    std::int64_t mtime = -1; // Microseconds, as a file rewritten within a second must not match.
+    std::int64_t size = -1;
+};
+
+FileStamp file_stamp(std::string const &path)
+{
+    FileStamp result;
+    try {
+        auto const info = Gio::File::create_for_path(path)->query_info(
+            G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC "," G_FILE_ATTRIBUTE_STANDARD_SIZE);
+        result.mtime = static_cast<std::int64_t>(info->get_attribute_uint64(G_FILE_ATTRIBUTE_TIME_MODIFIED)) * 1000000
+                     + info->get_attribute_uint32(G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+        result.size = info->get_size();
+    } catch (Glib::Error const &) {
+    }
+    return result;
+}
+
+bool parse_bool(Glib::ustring const &value)
+{
+    return value.empty() || value == "true" || value == "yes" || value == "1";
+}
+
+/// The export types of a job, lowercase, as do_export() determines them.
+std::vector<Glib::ustring> export_types(InkFileExportCmd const &job)
+{
+    if (!job.export_type.empty()) {
+        std::vector<Glib::ustring> types;
+        for (auto const &type : Glib::Regex::split_simple("[,;]", job.export_type)) {
+            types.emplace_back(type.lowercase());
+        }
+        return types;
+    }
+    auto const basename = Glib::path_get_basename(job.export_filename);
+    auto const dot = basename.rfind('.');
+    if (dot == std::string::npos) {
+        return {"svg"};
+    }
+    return {Glib::ustring(basename.substr(dot + 1)).lowercase()};
+}
+
+/// The file a job exports to, which is the first of several if more than one type is given.
+std::string output_filename(InkFileExportCmd const &job)
+{
+    auto const basename = Glib::path_get_basename(job.export_filename);
+    if (basename.find('.') != std::string::npos || job.export_type.empty()) {
+        return job.export_filename;
+    }
+    return job.export_filename + "." + export_types(job).front().raw();
+}
+
+} // namespace
+
+struct RenderServer::Client
+{
+    Glib::RefPtr<Gio::SocketConnection> connection;
+    Glib::RefPtr<Gio::DataInputStream> input;
+};
+
+RenderDocumentCache::RenderDocumentCache(OpenFunc open, CloseFunc close, std::size_t max_documents)
+    : _open(std::move(open))
+    , _close(std::move(close))
+    , _max_documents(max_documents)
+{}
+
+RenderDocumentCache::~RenderDocumentCache()
+{
+    while (!_documents.empty()) {
+        evict(_documents.begin()->first);
+    }
+}
+
+SPDocument *RenderDocumentCache::get(std::string const &path, std::string &error)
+{
+    auto const stamp = file_stamp(path);
+    if (stamp.mtime < 0) {
+        error = "cannot read " + path;
+        return nullptr;
+    }
+
+    auto it = _documents.find(path);
+    if (it != _documents.end() && (it->second.mtime != stamp.mtime || it->second.size != stamp.size)) {
+        // Changed on disk since it was parsed.
+        evict(path);
+        it = _documents.end();
+    }
+
+    if (it == _documents.end()) {
+        if (!_documents.empty() && _documents.size() >= _max_documents) {
+            auto lru = std::min_element(_documents.begin(), _documents.end(), [] (auto const &a, auto const &b) {
+                return a.second.last_used < b.second.last_used;
+            });
+            evict(lru->first);
+        }
+
+        auto document = _open(path);
+        if (!document) {
+            error = "cannot open " + path;
+            return nullptr;
+        }
+        it = _documents.emplace(path, Entry{ document, stamp.mtime, stamp.size, 0 }).first;
+    }
+
+    it->second.last_used = ++_uses;
+    return it->second.document;
+}
+
+void RenderDocumentCache::evict(std::string const &path)
+{
+    auto it = _documents.find(path);
+    if (it == _documents.end()) {
+        return;
+    }
+    auto const document = it->second.document;
+    _documents.erase(it);
+    _close(document);
+}
+
+RenderServer::RenderServer(InkscapeApplication &app, std::string socket_path)
+    : _app(app)
+    , _socket_path(std::move(socket_path))
+    , _documents(
+          [this] (std::string const &path) {
+              auto document = _app.document_open(Gio::File::create_for_path(path));
+              if (document) {
+                  INKSCAPE.add_document(document);
+              }
+              return document;
+          },
+          [this] (SPDocument *document) {
+              INKSCAPE.remove_document(document);
+              _app.document_close(document);
+          },
+          MAX_DOCUMENTS)
+{}
+
+RenderServer::~RenderServer() = default;
+
+bool RenderServer::run()
+{
+#ifdef G_OS_UNIX
+    // Replace the socket of a previous server that did not shut down.
+    GStatBuf st;
+    if (g_lstat(_socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        g_unlink(_socket_path.c_str());
+    }
+
+    _service = Gio::SocketService::create();
+    try {
+        Glib::RefPtr<Gio::SocketAddress> effective_address;
+        _service->add_address(Gio::UnixSocketAddress::create(_socket_path), Gio::SOCKET_TYPE_STREAM,
+                              Gio::SOCKET_PROTOCOL_DEFAULT, effective_address);
+    } catch (Glib::Error const &e) {
+        std::cerr << "RenderServer::run: Cannot listen on " << _socket_path << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    _service->signal_incoming().connect(
+        [this] (Glib::RefPtr<Gio::SocketConnection> const &connection, Glib::RefPtr<Glib::Object> const &) {
+            return on_incoming(connection);
+        }, false);
+    _service->start();
+    std::cerr << "Inkscape export server listening on " << _socket_path << std::endl;
+
+    _loop = Glib::MainLoop::create();
+    _loop->run();
+
+    _service->stop();
+    _service->close();
+    _clients.clear();
+    g_unlink(_socket_path.c_str());
+    return true;
+#else
+    std::cerr << "RenderServer::run: Export server is not supported on this platform." << std::endl;
+    return false;
+#endif
+}
+
+bool RenderServer::on_incoming(Glib::RefPtr<Gio::SocketConnection> const &connection)
+{
+    auto client = std::make_unique<Client>();
+    client->connection = connection;
+    client->input = Gio::DataInputStream::create(connection->get_input_stream());
+    auto &ref = *client;
+    _clients.emplace_back(std::move(client));
+    read_next(ref);
+    return true;
+}
+
+void RenderServer::read_next(Client &client)
+{
+    client.input->read_line_async([this, &client] (Glib::RefPtr<Gio::AsyncResult> &result) {
+        std::string line;
+        bool got_line = false;
+        try {
+            got_line = client.input->read_line_finish(result, line);
+        } catch (Glib::Error const &) {
+        }
+        if (!got_line) {
+            // Connection closed.
+            remove_client(client);
+            return;
+        }
+
+        line = Glib::Regex::create("\\s+$")->replace(line, 0, "", static_cast<Glib::RegexMatchFlags>(0));
+        if (line == "quit") {
+            _loop->quit();
+            return;
+        }
+        if (line.empty()) {
+            read_next(client);
+            return;
+        }
+
+        auto const response = run_job(line) + "\n";
+        try {
+            client.connection->get_output_stream()->write(response);
+        } catch (Glib::Error const &) {
+            remove_client(client);
+            return;
+        }
+        read_next(client);
+    });
+}
+
+void RenderServer::remove_client(Client &client)
+{
+    _clients.remove_if([&] (auto const &c) { return c.get() == &client; });
+}
+
+std::string RenderServer::parse_job(Glib::ustring const &line, InkFileExportCmd &job, std::string &file)
+{
+    auto const re_colon = Glib::Regex::create("\\s*:\\s*");
+    for (auto const &token : Glib::Regex::split_simple("\\s*;\\s*", line)) {
+        if (token.empty()) {
+            continue;
+        }
+        // Split into 2 tokens max, as values may contain colons (areas, paths on Windows).
+        auto const parts = re_colon->split(token, 0, static_cast<Glib::RegexMatchFlags>(0), 2);
+        auto const key = parts[0];
+        auto const value = parts.size() > 1 ? parts[1] : Glib::ustring();
+        try {
+            if      (key == "file")                      file = value;
+            else if (key == "export-filename")           job.export_filename = value;
+            else if (key == "export-type")               job.export_type = value;
+            else if (key == "export-id")                 job.export_id = value;
+            else if (key == "export-id-only")            job.export_id_only = parse_bool(value);
+            else if (key == "export-area")               job.export_area = value;
+            else if (key == "export-area-page")          job.export_area_page = parse_bool(value);
+            else if (key == "export-area-drawing")       job.export_area_drawing = parse_bool(value);
+            else if (key == "export-area-snap")          job.export_area_snap = parse_bool(value);
+            else if (key == "export-page")               job.export_page = value;
+            else if (key == "export-margin")             job.export_margin = std::stoi(value.raw());
+            else if (key == "export-dpi")                job.export_dpi = std::stod(value.raw());
+            else if (key == "export-width")              job.export_width = std::stoi(value.raw());
+            else if (key == "export-height")             job.export_height = std::stoi(value.raw());
+            else if (key == "export-background")         job.export_background = value;
+            else if (key == "export-background-opacity") job.export_background_opacity = std::stod(value.raw());
+            else if (key == "export-ignore-filters")     job.export_ignore_filters = parse_bool(value);
+            else if (key == "export-text-to-path")       job.export_text_to_path = parse_bool(value);
+            else if (key == "export-plain-svg")          job.export_plain_svg = parse_bool(value);
+            else if (key == "export-png-color-mode")     job.export_png_color_mode = value;
+            else if (key == "export-png-use-dithering")  job.export_png_use_dithering = parse_bool(value);
+            else if (key == "export-png-threads")        job.export_png_threads = std::stoi(value.raw());
+            else return "unknown option " + key.raw();
+        } catch (std::exception const &) {
+            return "invalid value for " + key.raw();
+        }
+    }
+
+    if (file.empty()) {
+        return "no file given";
+    }
+    if (job.export_filename.empty()) {
+        return "no export-filename given";
+    }
+    return {};
+}
+
+void RenderServer::seed_job(InkFileExportCmd &job, InkFileExportCmd const &defaults)
+{
+    // What to export and where is given by each job; how to export it defaults to the options
+    // the server was started with.
+    job.export_overwrite = defaults.export_overwrite;
+    job.export_margin = defaults.export_margin;
+    job.export_area_snap = defaults.export_area_snap;
+    job.export_dpi = defaults.export_dpi;
+    job.export_ignore_filters = defaults.export_ignore_filters;
+    job.export_text_to_path = defaults.export_text_to_path;
+    job.export_ps_level = defaults.export_ps_level;
+    job.export_pdf_level = defaults.export_pdf_level;
+    job.export_latex = defaults.export_latex;
+    job.export_use_hints = defaults.export_use_hints;
+    job.export_background = defaults.export_background;
+    job.export_background_opacity = defaults.export_background_opacity;
+    job.export_png_color_mode = defaults.export_png_color_mode;
+    job.export_plain_svg = defaults.export_plain_svg;
+    job.export_png_use_dithering = defaults.export_png_use_dithering;
+    job.export_png_threads = defaults.export_png_threads;
+}
+
+bool RenderServer::keeps_document(InkFileExportCmd const &job)
+{
+    // Other exports may convert text to paths, crop the document or fit its page to the export
+    // area, and extensions may do anything. Bitmap exports only read it.
+    auto const types = export_types(job);
+    return std::all_of(types.begin(), types.end(), [] (auto const &type) { return type == "png"; });
+}
+
+std::string RenderServer::run_job(Glib::ustring const &line)
+{
+    InkFileExportCmd job;
+    seed_job(job, *_app.file_export());
+    std::string file;
+    auto error = parse_job(line, job, file);
+    if (!error.empty()) {
+        return "error " + error;
+    }
+
+    auto document = _documents.get(file, error);
+    if (!document) {
+        return "error " + error;
+    }
+    document->ensureUpToDate();
+
+    // Before exporting, which rewrites the export options.
+    auto const output = output_filename(job);
+    bool const keep = keeps_document(job);
+
+    int const status = job.do_export(document, file);
+
+    if (!keep || document->isModifiedSinceSave()) {
+        _documents.evict(file);
+    }
+
+    if (status != 0) {
+        return "error export to " + output + " failed";
+    }
+    return "ok " + output;
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
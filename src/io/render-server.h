@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Headless export server, answering export jobs sent over a local socket.
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * The contents of this file may be used under the GNU General Public License Version 2 or later.
+ *
+ */
+
+#ifndef INK_RENDER_SERVER_H
+#define INK_RENDER_SERVER_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <glibmm.h>
+#include <giomm.h>
+
+class InkFileExportCmd;
+class InkscapeApplication;
+class SPDocument;
+
+namespace Inkscape {
+
+/**
+ * Parsed documents kept between export jobs, as long as their file is unchanged on disk. When
+ * full, the least recently used document is closed.
+ */
+class RenderDocumentCache
+{
+public:
+    using OpenFunc = std::function<SPDocument *(std::string const &path)>;
+    using CloseFunc = std::function<void (SPDocument *document)>;
+
+    RenderDocumentCache(OpenFunc open, CloseFunc close, std::size_t max_documents);
+    ~RenderDocumentCache();
+    RenderDocumentCache(RenderDocumentCache const &) = delete;
+    RenderDocumentCache &operator=(RenderDocumentCache const &) = delete;
+
+    /**
+     * The document of the file at path, parsing it if it is not kept or changed since. Returns
+     * null and sets error if it cannot be opened.
+     */
+    SPDocument *get(std::string const &path, std::string &error);
+
+    /// Close the document of path if it is kept, e.g. because a job changed it.
+    void evict(std::string const &path);
+
+    std::size_t size() const { return _documents.size(); }
+
+private:
+    struct Entry
+    {
+        SPDocument *document;
+        std::int64_t mtime;
+        std::int64_t size;
+        std::uint64_t last_used;
+    };
+
+    OpenFunc _open;
+    CloseFunc _close;
+    std::size_t _max_documents;
+    std::map<std::string, Entry> _documents;
+    std::uint64_t _uses = 0;
+};
+
+/**
+ * Listens on a Unix socket for export jobs, so that a pipeline pays the start-up cost of
+ * Inkscape (fonts, extensions, preferences) once rather than once per file.
+ *
+ * Each line sent by a client is one job, written like the export options of the command line,
+ * e.g. "file:drawing.svg; export-id:icon1; export-dpi:192; export-filename:icon1.png".
+ * Options not given by a job, like export-dpi or export-png-threads, default to those the server
+ * was started with. Each job is answered by a line "ok FILENAME" or "error MESSAGE", in order.
+ * Any number of clients may be connected at once, but their jobs are run one after the other on
+ * the main loop, as the object tree is not thread-safe; only the rendering of a bitmap uses
+ * several threads, as many as export-png-threads asks for. The line "quit" stops the server.
+ *
+ * Parsed documents are kept for later jobs that export bitmaps, which leave them unchanged.
+ */
+class RenderServer
+{
+public:
+    RenderServer(InkscapeApplication &app, std::string socket_path);
+    ~RenderServer();
+    RenderServer(RenderServer const &) = delete;
+    RenderServer &operator=(RenderServer const &) = delete;
+
+    /// Serve jobs until a client asks to quit. Returns false if the socket could not be opened.
+    bool run();
+
+    /**
+     * Set up job and the input file from a job line. Returns an error message, or an empty
+     * string on success.
+     */
+    static std::string parse_job(Glib::ustring const &line, InkFileExportCmd &job, std::string &file);
+
+    /// Set the options of job that are not given by its line to those of defaults.
+    static void seed_job(InkFileExportCmd &job, InkFileExportCmd const &defaults);
+
+    /// Whether running the parsed job leaves its document unchanged, so that it can be kept.
+    static bool keeps_document(InkFileExportCmd const &job);
+
+private:
+    struct Client;
+
+    InkscapeApplication &_app;
+    std::string _socket_path;
+    Glib::RefPtr<Glib::MainLoop> _loop;
+    Glib::RefPtr<Gio::SocketService> _service;
+    std::list<std::unique_ptr<Client>> _clients;
+    RenderDocumentCache _documents;
+
+    bool on_incoming(Glib::RefPtr<Gio::SocketConnection> const &connection);
+    void read_next(Client &client);
+    void remove_client(Client &client);
+
+    std::string run_job(Glib::ustring const &line);
+};
+
+} // namespace Inkscape
+
+#endif // INK_RENDER_SERVER_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
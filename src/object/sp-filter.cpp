@@ -508,6 +508,7 @@ std::unique_ptr<Inkscape::Filters::Filter> SPFilter::build_renderer(Inkscape::Dr
             nr_filter->add_primitive(primitive->build_renderer(item));
         }
     }
+    nr_filter->optimize();
 
     return nr_filter;
 }
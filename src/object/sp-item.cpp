@@ -15,6 +15,9 @@
 
 #include "sp-item.h"
 
+#include <cstring>
+#include <unordered_set>
+#include <glibmm/checksum.h>
 #include <glibmm/i18n.h>
 
 #include "bad-uri-exception.h"
@@ -22,7 +25,9 @@
 #include "svg/svg.h"
 #include "svg/svg-color.h"
 #include "print.h"
+#include "display/cairo-utils.h"
 #include "display/curve.h"
+#include "display/drawing.h"
 #include "display/drawing-item.h"
 #include "display/drawing-pattern.h"
 #include "attributes.h"
@@ -40,6 +45,7 @@
 #include "sp-desc.h"
 #include "sp-guide.h"
 #include "sp-hatch.h"
+#include "sp-image.h"
 #include "sp-mask.h"
 #include "sp-pattern.h"
 #include "sp-rect.h"
@@ -753,6 +759,16 @@ void SPItem::update(SPCtx *ctx, unsigned flags)
                 v.drawingitem->setVisible(!isHidden());
             }
         }
+
+        // Only export drawings have a disk cache, so only pay for hashing there.
+        auto content_key = lazy([this] {
+            return contentKey();
+        });
+        for (auto &v : views) {
+            if (v.drawingitem->drawing().diskCache() && isFiltered()) {
+                v.drawingitem->setContentKey(content_key());
+            }
+        }
     }
 
     // Update bounding box in user space, used for filter and objectBoundingBox units.
@@ -1157,6 +1173,91 @@ bool SPItem::isFiltered() const {
     return style && style->filter.href && style->filter.href->getObject();
 }
 
+namespace {
+
+void hash_content(Glib::Checksum &sum, SPObject const *object, std::unordered_set<SPObject const *> &seen, bool top);
+
+void add_field(Glib::Checksum &sum, char const *str)
+{
+    sum.update(str);
+    sum.update("\x1f"); // Unit separator, so that fields can not run into each other.
+}
+
+/// Hash the targets of any url(#id) references in a value.
+void hash_urls(Glib::Checksum &sum, SPObject const *object, char const *value, std::unordered_set<SPObject const *> &seen)
+{
+    for (auto p = value; (p = std::strstr(p, "url(#")); ) {
+        p += 5;
+        auto const end = p + std::strcspn(p, ")");
+        if (auto ref = object->document->getObjectById(std::string(p, end))) {
+            hash_content(sum, ref, seen, false);
+        }
+        p = end;
+    }
+}
+
+void hash_content(Glib::Checksum &sum, SPObject const *object, std::unordered_set<SPObject const *> &seen, bool top)
+{
+    if (!seen.insert(object).second) {
+        add_field(sum, "<seen>");
+        return;
+    }
+
+    if (auto repr = object->getRepr()) {
+        add_field(sum, repr->name() ? repr->name() : "");
+        add_field(sum, repr->content() ? repr->content() : "");
+        for (auto const &attr : repr->attributeList()) {
+            auto const name = g_quark_to_string(attr.key);
+            if (std::strcmp(name, "id") == 0 || (top && std::strcmp(name, "transform") == 0)) {
+                continue;
+            }
+            add_field(sum, name);
+            add_field(sum, attr.value);
+            hash_urls(sum, object, attr.value, seen);
+            if (std::strcmp(name, "xlink:href") == 0 || std::strcmp(name, "href") == 0) {
+                if (attr.value[0] == '#') {
+                    if (auto ref = object->document->getObjectById(attr.value + 1)) {
+                        hash_content(sum, ref, seen, false);
+                    }
+                }
+            }
+        }
+    }
+
+    // The computed style also covers inheritance and style sheets.
+    if (object->style) {
+        auto const css = object->style->write(SP_STYLE_FLAG_ALWAYS);
+        add_field(sum, css.c_str());
+        hash_urls(sum, object, css.c_str(), seen);
+    }
+
+    // Linked images are only referenced by file name, so also hash when the file was changed.
+    if (auto image = cast<SPImage>(object); image && image->pixbuf) {
+        add_field(sum, image->pixbuf->originalPath().c_str());
+        add_field(sum, std::to_string(image->pixbuf->modificationTime()).c_str());
+    }
+
+    for (auto const &child : object->children) {
+        hash_content(sum, &child, seen, false);
+    }
+}
+
+} // namespace
+
+std::string SPItem::contentKey() const
+{
+    Glib::Checksum sum(Glib::Checksum::CHECKSUM_SHA256);
+
+    // Percentage lengths are relative to the viewport.
+    for (auto const c : {viewport.left(), viewport.top(), viewport.width(), viewport.height()}) {
+        add_field(sum, std::to_string(c).c_str());
+    }
+
+    std::unordered_set<SPObject const *> seen;
+    hash_content(sum, this, seen, true);
+    return sum.get_string();
+}
+
 SPObject* SPItem::isInMask() const {
     SPObject* parent = this->parent;
     while (parent && !is<SPMask>(parent)) {
@@ -1238,6 +1339,9 @@ Inkscape::DrawingItem *SPItem::invoke_show(Inkscape::Drawing &drawing, unsigned
     if (auto filter = style->getFilter()) {
         filter->show(ai);
     }
+    if (drawing.diskCache() && isFiltered()) {
+        ai->setContentKey(contentKey());
+    }
 
     return ai;
 }
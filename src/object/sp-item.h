@@ -333,6 +333,13 @@ public:
      */
     bool isFiltered() const;
 
+    /**
+     * Hash of everything in the document that determines how this item renders in its own
+     * coordinate system: its subtree, the computed styles in it, and everything referenced from
+     * it. Used to key the on-disk render cache, so it ignores ids and this item's transform.
+     */
+    std::string contentKey() const;
+
     SPObject* isInMask() const;
 
     SPObject* isInClipPath() const;
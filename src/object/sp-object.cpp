@@ -26,7 +26,6 @@
 
 #include "helper/sp-marshal.h"
 #include "attributes.h"
-#include "attribute-rel-util.h"
 #include "color-profile.h"
 #include "document.h"
 #include "io/fix-broken-links.h"
@@ -1073,12 +1072,10 @@ void SPObject::readAttr(SPAttr keyid)
         return;
     }
 
-    char const *key = sp_attribute_name(keyid);
-
-    assert(key != nullptr);
+    assert(keyid != SPAttr::INVALID);
     assert(getRepr() != nullptr);
 
-    char const *value = getRepr()->attribute(key);
+    char const *value = getRepr()->attribute(keyid);
 
     setKeyValue(keyid, value);
 }
@@ -1101,8 +1098,10 @@ void SPObject::readAttr(gchar const *key)
 
 void SPObject::notifyAttributeChanged(Inkscape::XML::Node &, GQuark key_, Util::ptr_shared, Util::ptr_shared)
 {
-    auto const key = g_quark_to_string(key_);
-    readAttr(key);
+    auto const keyid = sp_attribute_lookup(key_);
+    if (keyid != SPAttr::INVALID) {
+        readAttr(keyid);
+    }
 
     auto lpeitem = cast<SPLPEItem>(this);
     if (lpeitem && lpeitem->document->isSeeking()) {
@@ -1178,15 +1177,7 @@ Inkscape::XML::Node* SPObject::write(Inkscape::XML::Document *doc, Inkscape::XML
                 requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_STYLE_MODIFIED_FLAG);
             }
 
-            // Check for valid attributes. This may be time consuming.
-            // It is useful, though, for debugging Inkscape code.
-            Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-            if( prefs->getBool("/options/svgoutput/check_on_editing") ) {
-
-                unsigned int flags = sp_attribute_clean_get_prefs();
-                style_prop = sp_attribute_clean_style(repr, style_prop.c_str(), flags);
-            }
-
+            // The style is checked with the other edited attributes when the document commits.
             repr->setAttributeOrRemoveIfEmpty("style", style_prop);
         } else {
             /** \todo I'm not sure what to do in this case.  Bug #1165868
@@ -15,6 +15,7 @@
 #include "document.h"
 #include "sp-root.h"
 #include "style.h"
+#include "style-rule-index.h"
 #include "xml/repr.h"
 
 // For external style sheets
@@ -448,6 +449,7 @@ static void clear_style_sheet(SPStyleElem &self)
     auto *topsheet = cr_cascade_get_sheet(cascade, ORIGIN_AUTHOR);
 
     cr_stylesheet_unlink(self.style_sheet);
+    self.document->getStyleRuleIndex().invalidate();
 
     if (topsheet == self.style_sheet) {
         // will unref style_sheet
@@ -492,6 +494,7 @@ void SPStyleElem::read_content() {
             // If not the first, then chain up this style_sheet
             cr_stylesheet_append_stylesheet(topsheet, style_sheet);
         }
+        document->getStyleRuleIndex().invalidate();
     } else {
         cr_stylesheet_destroy (style_sheet);
         style_sheet = nullptr;
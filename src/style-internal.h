@@ -153,7 +153,7 @@ protected:
 public:
     void readAttribute(Inkscape::XML::Node *repr)
     {
-        readIfUnset(repr->attribute(name().c_str()), SPStyleSrc::ATTRIBUTE);
+        readIfUnset(repr->attribute(id()), SPStyleSrc::ATTRIBUTE);
     }
 
     virtual const Glib::ustring get_value() const = 0;
@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Index of the style sheet rules of a document, for matching them against elements.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "style-rule-index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "xml/node.h"
+
+namespace Inkscape {
+
+namespace {
+
+// Beyond this many signatures, the matches remembered are dropped.
+constexpr std::size_t MAX_SIGNATURES = 4096;
+
+char const *cr_str(CRString const *string)
+{
+    return string && string->stryng ? string->stryng->str : nullptr;
+}
+
+bool is_css_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f';
+}
+
+} // namespace
+
+StyleRuleIndex::StyleRuleIndex(CRCascade *cascade)
+    : _cascade(cascade)
+{}
+
+void StyleRuleIndex::invalidate()
+{
+    _valid = false;
+    _rules.clear();
+    _by_id.clear();
+    _by_class.clear();
+    _by_tag.clear();
+    _universal.clear();
+    _matched.clear();
+}
+
+void StyleRuleIndex::_build()
+{
+    invalidate();
+    for (int origin = ORIGIN_UA; origin < NB_ORIGINS; origin++) {
+        for (auto sheet = cr_cascade_get_sheet(_cascade, static_cast<CRStyleOrigin>(origin)); sheet; sheet = sheet->next) {
+            _addSheet(sheet);
+        }
+    }
+    _valid = true;
+}
+
+void StyleRuleIndex::_addSheet(CRStyleSheet *sheet)
+{
+    // In the order the selection engine visits them. It also matches the first ruleset of @media
+    // rules, but these never contribute properties, so they are left out.
+    for (auto statement = sheet->statements; statement; statement = statement->next) {
+        if (statement->type == RULESET_STMT && statement->kind.ruleset) {
+            for (auto sel = statement->kind.ruleset->sel_list; sel; sel = sel->next) {
+                if (sel->simple_sel) {
+                    _addRule(statement, sel->simple_sel);
+                }
+            }
+        } else if (statement->type == AT_IMPORT_RULE_STMT && statement->kind.import_rule &&
+                   statement->kind.import_rule->sheet) {
+            _addSheet(statement->kind.import_rule->sheet);
+        }
+    }
+}
+
+void StyleRuleIndex::_addRule(CRStatement *statement, CRSimpleSel *selector)
+{
+    cr_simple_sel_compute_specificity(selector);
+
+    auto rightmost = selector;
+    while (rightmost->next) {
+        rightmost = rightmost->next;
+    }
+
+    bool context_free = rightmost == selector;
+    char const *id = nullptr;
+    char const *klass = nullptr;
+    for (auto add_sel = rightmost->add_sel; add_sel; add_sel = add_sel->next) {
+        if (add_sel->type == ID_ADD_SELECTOR) {
+            id = id ? id : cr_str(add_sel->content.id_name);
+        } else if (add_sel->type == CLASS_ADD_SELECTOR) {
+            klass = klass ? klass : cr_str(add_sel->content.class_name);
+        } else {
+            context_free = false;
+        }
+    }
+    char const *tag = rightmost->type_mask & TYPE_SELECTOR ? cr_str(rightmost->name) : nullptr;
+
+    auto const index = static_cast<unsigned>(_rules.size());
+    _rules.push_back({statement, selector, selector->specificity, context_free});
+
+    if (id) {
+        _by_id[id].push_back(index);
+    } else if (klass) {
+        _by_class[klass].push_back(index);
+    } else if (tag) {
+        _by_tag[tag].push_back(index);
+    } else {
+        _universal.push_back(index);
+    }
+}
+
+CRStatus StyleRuleIndex::getMatchedProperties(CRSelEng *sel_eng, XML::Node const *node, CRPropList **props)
+{
+    g_return_val_if_fail(sel_eng && node && props, CR_BAD_PARAM_ERROR);
+
+    if (node->type() != XML::NodeType::ELEMENT_NODE) {
+        return CR_OK;
+    }
+    if (!_valid) {
+        _build();
+    }
+    if (_rules.empty()) {
+        return CR_OK;
+    }
+
+    auto const name = node->name();
+    auto const colon = std::strrchr(name, ':');
+    auto const tag = colon ? colon + 1 : name;
+    auto const id = node->attribute("id");
+    auto const classes = node->attribute("class");
+
+    // The buckets this element can match rules from.
+    std::vector<Bucket const *> buckets;
+    auto const add = [&] (std::unordered_map<std::string, Bucket> const &map, std::string const &key) {
+        auto it = map.find(key);
+        if (it != map.end() && std::find(buckets.begin(), buckets.end(), &it->second) == buckets.end()) {
+            buckets.push_back(&it->second);
+        }
+    };
+    // Ids no rule names do not matter, and would keep elements from sharing a signature.
+    bool const named = id && _by_id.count(id);
+    if (named) {
+        add(_by_id, id);
+    }
+    add(_by_tag, tag);
+    for (auto p = classes; p && *p; ) {
+        while (*p && is_css_space(*p)) {
+            p++;
+        }
+        auto const start = p;
+        while (*p && !is_css_space(*p)) {
+            p++;
+        }
+        if (p > start) {
+            add(_by_class, std::string(start, p));
+        }
+    }
+    buckets.push_back(&_universal);
+
+    std::string signature = tag;
+    signature += '\0';
+    signature += named ? id : "";
+    signature += '\0';
+    signature += classes ? classes : "";
+    auto const known = _matched.find(signature);
+
+    std::vector<unsigned> matched;
+    std::vector<unsigned> context_free_matched;
+    for (auto bucket : buckets) {
+        for (auto index : *bucket) {
+            auto const &rule = _rules[index];
+            if (rule.context_free && known != _matched.end()) {
+                continue;
+            }
+            gboolean result = FALSE;
+            cr_sel_eng_matches_node(sel_eng, rule.selector, node, &result);
+            if (result) {
+                matched.push_back(index);
+                if (rule.context_free) {
+                    context_free_matched.push_back(index);
+                }
+            }
+        }
+    }
+
+    if (known != _matched.end()) {
+        matched.insert(matched.end(), known->second.begin(), known->second.end());
+    } else {
+        if (_matched.size() >= MAX_SIGNATURES) {
+            _matched.clear();
+        }
+        _matched.emplace(std::move(signature), std::move(context_free_matched));
+    }
+
+    if (matched.empty()) {
+        return CR_OK;
+    }
+
+    // Back in cascade order. Like the selection engine, give each statement the specificity of
+    // the last of its selectors that matched.
+    std::sort(matched.begin(), matched.end());
+    std::vector<CRStatement *> statements;
+    statements.reserve(matched.size());
+    for (auto index : matched) {
+        auto const &rule = _rules[index];
+        rule.statement->specificity = rule.specificity;
+        statements.push_back(rule.statement);
+    }
+
+    return cr_sel_eng_get_properties_from_rulesets(statements.data(), statements.size(), props);
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Index of the style sheet rules of a document, for matching them against elements.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_STYLE_RULE_INDEX_H
+#define SEEN_INKSCAPE_STYLE_RULE_INDEX_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "3rdparty/libcroco/cr-sel-eng.h"
+
+namespace Inkscape {
+
+namespace XML {
+class Node;
+}
+
+/**
+ * Finds the style sheet rules that apply to an element without testing every rule.
+ *
+ * Each selector of the cascade is filed in one bucket, by the id, the first class or the tag
+ * name of its rightmost simple selector, as browser engines do, or with the universal selectors
+ * if it has none of those. Only the selectors in the buckets of an element are tested against it.
+ *
+ * Whether a selector made of a single simple selector without pseudo-classes or attribute
+ * selectors matches depends only on the tag name, id and classes of the element. Those results
+ * are kept for each such signature, so that elements sharing it (typically siblings) reuse them.
+ *
+ * The index is built on first use, and must be invalidated whenever the cascade changes.
+ */
+class StyleRuleIndex
+{
+public:
+    explicit StyleRuleIndex(CRCascade *cascade);
+    StyleRuleIndex(StyleRuleIndex const &) = delete;
+    StyleRuleIndex &operator=(StyleRuleIndex const &) = delete;
+
+    /// Forget the rules, as the style sheets of the cascade changed.
+    void invalidate();
+
+    /**
+     * Compute the properties that the rules of the cascade give to node, with the same result
+     * as cr_sel_eng_get_matched_properties_from_cascade().
+     */
+    CRStatus getMatchedProperties(CRSelEng *sel_eng, XML::Node const *node, CRPropList **props);
+
+private:
+    struct Rule
+    {
+        CRStatement *statement;
+        CRSimpleSel *selector;
+        gulong specificity;
+        bool context_free; ///< Whether matching depends only on the signature of the element.
+    };
+
+    using Bucket = std::vector<unsigned>; // Indices into _rules, in increasing order.
+
+    CRCascade *_cascade;
+    bool _valid = false;
+
+    std::vector<Rule> _rules; // In cascade order.
+    std::unordered_map<std::string, Bucket> _by_id;
+    std::unordered_map<std::string, Bucket> _by_class;
+    std::unordered_map<std::string, Bucket> _by_tag;
+    Bucket _universal;
+
+    /// The context-free rules matched by each signature.
+    std::unordered_map<std::string, std::vector<unsigned>> _matched;
+
+    void _build();
+    void _addSheet(CRStyleSheet *sheet);
+    void _addRule(CRStatement *statement, CRSimpleSel *selector);
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_STYLE_RULE_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
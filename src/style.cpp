@@ -34,6 +34,7 @@
 #include "bad-uri-exception.h"
 #include "document.h"
 #include "preferences.h"
+#include "style-rule-index.h"
 
 #include "3rdparty/libcroco/cr-sel-eng.h"
 
@@ -995,11 +996,7 @@ SPStyle::_mergeObjectStylesheet( SPObject const *const object, SPDocument *const
     CRPropList *props = nullptr;
 
     //XML Tree being directly used here while it shouldn't be.
-    CRStatus status =
-        cr_sel_eng_get_matched_properties_from_cascade(sel_eng,
-                                                       document->getStyleCascade(),
-                                                       object->getRepr(),
-                                                       &props);
+    CRStatus status = document->getStyleRuleIndex().getMatchedProperties(sel_eng, object->getRepr(), &props);
     g_return_if_fail(status == CR_OK);
     /// \todo Check what errors can occur, and handle them properly.
     if (props) {
@@ -17,6 +17,8 @@
 
 #include "clonetiler.h"
 
+#include <algorithm>
+
 #include <glibmm/i18n.h>
 
 #include <gtkmm/adjustment.h>
@@ -37,8 +39,6 @@
 #include "inkscape.h"
 #include "message-stack.h"
 
-#include "display/cairo-utils.h"
-#include "display/drawing-context.h"
 #include "display/drawing.h"
 
 #include "ui/icon-loader.h"
@@ -1938,14 +1938,16 @@ guint32 CloneTiler::trace_pick(Geom::Rect box)
     /* Item integer bbox in points */
     Geom::IntRect ibox = (box * Geom::Scale(trace_zoom)).roundOutwards();
 
-    /* Find visible area */
-    cairo_surface_t *s = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, ibox.width(), ibox.height());
-    Inkscape::DrawingContext dc(s, ibox.min());
-    /* Render */
-    trace_drawing->render(dc, ibox);
+    /* Average over the area; the drawing keeps the rendered tiles between picks */
     double R = 0, G = 0, B = 0, A = 0;
-    ink_cairo_surface_average_color(s, R, G, B, A);
-    cairo_surface_destroy(s);
+    trace_drawing->averageColor(ibox, R, G, B, A);
+
+    /* Unpremultiply */
+    if (A > 0) {
+        R = std::min(R / A, 1.0);
+        G = std::min(G / A, 1.0);
+        B = std::min(B / A, 1.0);
+    }
 
     return SP_RGBA32_F_COMPOSE (R, G, B, A);
 }
@@ -2721,6 +2721,12 @@ void InkscapePreferences::initPageRendering()
     _rendering_cache_size.init("/options/renderingcache/size", 0.0, 4096.0, 1.0, 32.0, 64.0, true, false);
     _page_rendering.add_line( false, _("Rendering _cache size:"), _rendering_cache_size, C_("mebibyte (2^20 bytes) abbreviation","MiB"), _("Set the amount of memory per document which can be used to store rendered parts of the drawing for later reuse; set to zero to disable caching"), false);
 
+    _rendering_disk_cache_size.init("/options/renderingcache/disksize", 0.0, 1048576.0, 64.0, 256.0, 0.0, true, false);
+    _page_rendering.add_line( false, _("Export _disk cache size:"), _rendering_disk_cache_size, C_("mebibyte (2^20 bytes) abbreviation","MiB"), _("Set the amount of disk space which can be used to keep rendered filtered objects between exports, so that unchanged objects are not rendered again; set to zero to disable"), false);
+
+    _rendering_tile_cache_size.init("/options/rendering/tile_cache_size", 0.0, 4096.0, 1.0, 32.0, 64.0, true, false);
+    _page_rendering.add_line( false, _("_Zoom level cache size:"), _rendering_tile_cache_size, C_("mebibyte (2^20 bytes) abbreviation","MiB"), _("Set the amount of memory per window which can be used to keep the canvas as drawn at recently viewed zoom levels and locations, so that returning to them is instant; set to zero to disable"), false);
+
     // rendering x-ray radius
     _rendering_xray_radius.init("/options/rendering/xray-radius", 1.0, 1500.0, 1.0, 100.0, 100.0, true, false);
     _page_rendering.add_line( false, _("X-ray radius:"), _rendering_xray_radius, "", _("Radius of the circular area around the mouse cursor in X-ray mode"), false);
@@ -2737,6 +2743,10 @@ void InkscapePreferences::initPageRendering()
         _page_rendering.add_line(false, _("Update strategy:"), _canvas_update_strategy, "", _("How to update continually changing content when it can't be redrawn fast enough"), false);
     }
 
+    // progressive rendering
+    _canvas_progressive.init("", "/options/rendering/progressive", true);
+    _page_rendering.add_line( false, _("Draft filters first:"), _canvas_progressive, "", _("Quickly draw the canvas without filters before drawing it in full, so that slow filters do not hold up the rest of the drawing"), false);
+
     // opengl
     _canvas_request_opengl.init("", "/options/rendering/request_opengl", false);
     _page_rendering.add_line( false, _("Enable OpenGL:"), _canvas_request_opengl, "", _("Request that the canvas should be painted with OpenGL rather than Cairo. If OpenGL is unsupported, it will fall back to Cairo."), false);
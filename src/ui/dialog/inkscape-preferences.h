@@ -337,9 +337,12 @@ protected:
 
     UI::Widget::PrefSpinButton  _filter_multi_threaded;
     UI::Widget::PrefSpinButton  _rendering_cache_size;
+    UI::Widget::PrefSpinButton  _rendering_disk_cache_size;
+    UI::Widget::PrefSpinButton  _rendering_tile_cache_size;
     UI::Widget::PrefSpinButton  _rendering_xray_radius;
     UI::Widget::PrefSpinButton  _rendering_outline_overlay_opacity;
     UI::Widget::PrefCombo       _canvas_update_strategy;
+    UI::Widget::PrefCheckButton _canvas_progressive;
     UI::Widget::PrefCheckButton _canvas_request_opengl;
     UI::Widget::PrefRadioButton _blur_quality_best;
     UI::Widget::PrefRadioButton _blur_quality_better;
@@ -16,8 +16,6 @@
 #include <mutex>
 #include <array>
 #include <cassert>
-#include <boost/asio/thread_pool.hpp>
-#include <boost/asio/post.hpp>
 #include <2geom/convex-hull.h>
 
 #include "canvas.h"
@@ -28,6 +26,7 @@
 #include "desktop.h"
 #include "document.h"
 #include "preferences.h"
+#include "async/scheduler.h"
 #include "ui/util.h"
 #include "helper/geom.h"
 
@@ -45,6 +44,7 @@
 #include "ui/tools/tool-base.h"      // Default cursor
 
 #include "canvas/updaters.h"         // Update strategies
+#include "canvas/tilecache.h"        // Cache of tiles at recently viewed zoom levels
 #include "canvas/framecheck.h"       // For frame profiling
 #define framecheck_whole_function(D) \
     auto framecheckobj = D->prefs.debug_framecheck ? FrameCheck::Event(__func__) : FrameCheck::Event();
@@ -118,6 +118,7 @@ struct Tile
     Fragment fragment;
     Cairo::RefPtr<Cairo::ImageSurface> surface;
     Cairo::RefPtr<Cairo::ImageSurface> outline_surface;
+    bool draft = false; // Whether the content is an incomplete draft, to be redrawn.
 };
 
 // The urgency with which the async redraw process should exit.
@@ -138,6 +139,7 @@ struct RedrawData
     bool decoupled_mode;
     Cairo::RefPtr<Cairo::Region> snapshot_drawn;
     Geom::OptIntRect grabbed;
+    Geom::OptIntRect prefetch;
 
     // Saved prefs
     int coarsener_min_size;
@@ -149,6 +151,8 @@ struct RedrawData
     std::optional<int> redraw_delay;
     int render_time_limit;
     int numthreads;
+    bool progressive;
+    unsigned tile_cache_generation;
     bool background_in_stores_required;
     uint64_t page, desk;
     bool debug_framecheck;
@@ -159,6 +163,7 @@ struct RedrawData
     gint64 start_time;
     int phase;
     Geom::OptIntRect vis_store;
+    bool draft; // Whether the current phase renders drafts.
 
     Geom::IntRect bounds;
     Cairo::RefPtr<Cairo::Region> clean;
@@ -210,6 +215,10 @@ public:
     Stores stores;
     void handle_stores_action(Stores::Action action);
 
+    // Tiles kept from earlier zoom levels and locations.
+    TileCache tile_cache;
+    void restore_cached_tiles();
+
     // Invalidation
     std::unique_ptr<Updater> updater; // Tracks the unclean region and decides how to redraw it.
     Cairo::RefPtr<Cairo::Region> invalidated; // Buffers invalidations while the updater is in use by the background process.
@@ -251,8 +260,7 @@ public:
     bool background_in_stores_enabled = false; // Whether the page and desk should be drawn into the stores/tiles; if not then transparency is used instead.
     bool background_in_stores_required() const { return !q->get_opengl_enabled() && SP_RGBA32_A_U(page) == 255 && SP_RGBA32_A_U(desk) == 255; } // Enable solid colour optimisation if both page and desk are solid (as opposed to checkerboard).
 
-    // Async redraw process.
-    std::optional<boost::asio::thread_pool> pool;
+    // Async redraw process, run on the shared render scheduler.
     int get_numthreads() const;
 
     Synchronizer sync;
@@ -265,8 +273,8 @@ public:
     bool end_redraw(); // returns true to indicate further redraw cycles required
     void process_redraw(Geom::IntRect const &bounds, Cairo::RefPtr<Cairo::Region> clean, bool interruptible = true, bool preemptible = true);
     void render_tile(int debug_id);
-    void paint_rect(Geom::IntRect const &rect);
-    void paint_single_buffer(const Cairo::RefPtr<Cairo::ImageSurface> &surface, const Geom::IntRect &rect, bool need_background, bool outline_pass);
+    bool paint_rect(Geom::IntRect const &rect);
+    bool paint_single_buffer(const Cairo::RefPtr<Cairo::ImageSurface> &surface, const Geom::IntRect &rect, bool need_background, bool outline_pass);
 
     // Trivial overload of GtkWidget function.
     void queue_draw_area(Geom::IntRect const &rect);
@@ -309,6 +317,8 @@ Canvas::Canvas()
     d->prefs.debug_sticky_decoupled.action = [=] { d->schedule_redraw(); };
     d->prefs.debug_animate.action = [=] { queue_draw(); };
     d->prefs.outline_overlay_opacity.action = [=] { queue_draw(); };
+    d->prefs.tile_cache_size.action = [=] { d->tile_cache.set_max_bytes((std::size_t)d->prefs.tile_cache_size << 20); };
+    d->prefs.tile_cache_size.action();
     d->prefs.softproof.action = [=] { redraw_all(); };
     d->prefs.displayprofile.action = [=] { redraw_all(); };
     d->prefs.request_opengl.action = [=] {
@@ -343,9 +353,6 @@ Canvas::Canvas()
     // OpenGL switch.
     set_opengl_enabled(d->prefs.request_opengl);
 
-    // Async redraw process.
-    d->pool.emplace(1);
-
     d->sync.connectExit([this] { d->after_redraw(); });
 
     d->commit_tiles_dispatcher.connect([this] {
@@ -362,12 +369,9 @@ int CanvasPrivate::get_numthreads() const
     if (int n = prefs.numthreads; n > 0) {
         // First choice is the value set in preferences.
         return n;
-    } else if (int n = std::thread::hardware_concurrency(); n > 0) {
-        // If not set, use the number of processors.
-        return n;
     } else {
-        // If not reported, use a sensible fallback.
-        return 4;
+        // If not set, use all the threads of the render scheduler.
+        return Async::Scheduler::get().concurrency();
     }
 }
 
@@ -424,6 +428,9 @@ void CanvasPrivate::deactivate()
 {
     active = false;
 
+    // Invalidations are ignored while inactive, so the cached tiles may go stale.
+    tile_cache.clear();
+
     if (redraw_active) {
         if (schedule_redraw_conn.connected()) {
             // In first link in chain, from schedule_redraw() to launch_redraw(). Break the link and exit.
@@ -463,6 +470,7 @@ void Canvas::set_drawing(Drawing *drawing)
 {
     if (d->active && !drawing) d->deactivate();
     _drawing = drawing;
+    d->tile_cache.clear();
     if (_drawing) {
         _drawing->setRenderMode(_render_mode == RenderMode::OUTLINE_OVERLAY ? RenderMode::NORMAL : _render_mode);
         _drawing->setColorMode(_color_mode);
@@ -531,6 +539,7 @@ void CanvasPrivate::launch_redraw()
     // Determine whether the rendering parameters have changed, and trigger full store recreation if so.
     if ((outlines_required() && !outlines_enabled) || scale_factor != q->get_scale_factor()) {
         stores.reset();
+        tile_cache.clear();
     }
 
     outlines_enabled = outlines_required();
@@ -565,6 +574,7 @@ void CanvasPrivate::launch_redraw()
         q->_need_update = false;
         canvasitem_ctx->setAffine(stores.store().affine);
         canvasitem_ctx->root()->update(affine_changed);
+        fc.subtype = q->_drawing ? q->_drawing->updateVisits() : 0;
     }
 
     // Update strategy.
@@ -572,6 +582,7 @@ void CanvasPrivate::launch_redraw()
     if (updater->get_strategy() != strategy) {
         auto new_updater = Updater::create(strategy);
         new_updater->clean_region = std::move(updater->clean_region);
+        new_updater->draft_region = std::move(updater->draft_region);
         updater = std::move(new_updater);
     }
 
@@ -611,6 +622,7 @@ void CanvasPrivate::launch_redraw()
 
     // Get other misc data.
     rd.store = Fragment{ stores.store().affine, stores.store().rect };
+    rd.prefetch = stores.prefetch_rect(Fragment{ q->_affine, q->get_area_world() });
     rd.decoupled_mode = stores.mode() == Stores::Mode::Decoupled;
     rd.coarsener_min_size = prefs.coarsener_min_size;
     rd.coarsener_glue_size = prefs.coarsener_glue_size;
@@ -621,6 +633,8 @@ void CanvasPrivate::launch_redraw()
     rd.redraw_delay = prefs.debug_delay_redraw ? std::make_optional<int>(prefs.debug_delay_redraw_time) : std::nullopt;
     rd.render_time_limit = prefs.render_time_limit;
     rd.numthreads = get_numthreads();
+    rd.progressive = prefs.progressive;
+    rd.tile_cache_generation = tile_cache.generation();
     rd.background_in_stores_required = background_in_stores_required();
     rd.page = page;
     rd.desk = desk;
@@ -632,7 +646,7 @@ void CanvasPrivate::launch_redraw()
 
     abort_flags.store((int)AbortFlags::None, std::memory_order_relaxed);
 
-    boost::asio::post(*pool, [this] { init_tiler(); });
+    Async::Scheduler::get().post([this] { init_tiler(); });
 }
 
 void CanvasPrivate::after_redraw()
@@ -680,12 +694,15 @@ void CanvasPrivate::handle_stores_action(Stores::Action action)
             invalidated->do_union(geom_to_cairo(stores.store().rect));
             updater->reset();
 
+            restore_cached_tiles();
+
             if (prefs.debug_show_unclean) q->queue_draw();
             break;
 
         case Stores::Action::Shifted:
             invalidated->intersect(geom_to_cairo(stores.store().rect));
             updater->intersect(stores.store().rect);
+            restore_cached_tiles();
 
             if (prefs.debug_show_unclean) q->queue_draw();
             break;
@@ -730,6 +747,14 @@ void CanvasPrivate::commit_tiles()
             }
         }
 
+        // Keep a copy for when the view returns here, unless it has been invalidated since it was drawn.
+        if (!tile.draft && rd.tile_cache_generation == tile_cache.generation()) {
+            auto pl = Geom::Parallelogram(tile.fragment.rect) * stores.store().affine.inverse() * q->_affine;
+            if (invalidated->contains_rectangle(geom_to_cairo(pl.bounds().roundOutwards())) == Cairo::REGION_OVERLAP_OUT) {
+                tile_cache.insert(tile.fragment, tile.surface, tile.outline_surface);
+            }
+        }
+
         // Paste tile content onto stores.
         graphics->draw_tile(tile.fragment, std::move(tile.surface), std::move(tile.outline_surface));
 
@@ -759,6 +784,42 @@ void CanvasPrivate::commit_tiles()
     }
 }
 
+// Paste any cached tiles into the parts of the store still to be drawn. Requires a current OpenGL context.
+void CanvasPrivate::restore_cached_tiles()
+{
+    auto const &store = stores.store();
+    bool restored = false;
+
+    for (auto const &tile : tile_cache.find(store)) {
+        auto const &rect = tile.fragment.rect;
+        if (updater->clean_region->contains_rectangle(geom_to_cairo(rect)) != Cairo::REGION_OVERLAP_OUT) {
+            // Overlaps content already drawn, perhaps from a more recent tile.
+            continue;
+        }
+        if (dimensions(tile.surface) != rect.dimensions() * scale_factor || (outlines_enabled && !tile.outline_surface)) {
+            continue;
+        }
+
+        auto surface = graphics->request_tile_surface(rect, false);
+        TileCache::copy_pixels(tile.surface, surface);
+        Cairo::RefPtr<Cairo::ImageSurface> outline_surface;
+        if (outlines_enabled) {
+            outline_surface = graphics->request_tile_surface(rect, false);
+            TileCache::copy_pixels(tile.outline_surface, outline_surface);
+        }
+        graphics->draw_tile(Fragment{ store.affine, rect }, std::move(surface), std::move(outline_surface));
+
+        stores.mark_drawn(rect);
+        updater->mark_clean(rect);
+        invalidated->subtract(geom_to_cairo(rect));
+        restored = true;
+    }
+
+    if (restored) {
+        q->queue_draw();
+    }
+}
+
 /*
  * Event handling
  */
@@ -1407,6 +1468,7 @@ void Canvas::redraw_all()
         return;
     }
     d->invalidated->do_union(geom_to_cairo(d->stores.store().rect));
+    d->tile_cache.clear();
     d->schedule_redraw();
     if (d->prefs.debug_show_unclean) queue_draw();
 }
@@ -1443,6 +1505,7 @@ void Canvas::redraw_area(int x0, int y0, int x1, int y1)
 
     auto const rect = Geom::IntRect(x0, y0, x1, y1);
     d->invalidated->do_union(geom_to_cairo(rect));
+    d->tile_cache.invalidate(rect, _affine);
     d->schedule_redraw();
     if (d->prefs.debug_show_unclean) queue_draw();
 }
@@ -1953,10 +2016,9 @@ void CanvasPrivate::init_tiler()
     // Launch render threads to process tiles.
     rd.timeoutflag = false;
 
-    #pragma omp parallel for num_threads(rd.numthreads)
-    for (int i = 0; i < rd.numthreads; i++) {
+    Async::Scheduler::get().parallel_for(0, rd.numthreads, [this] (int i) {
         render_tile(i);
-    }
+    }, rd.numthreads);
 
     rd.rects.clear();
     sync.signalExit();
@@ -1966,6 +2028,8 @@ bool CanvasPrivate::init_redraw()
 {
     assert(rd.rects.empty());
 
+    rd.draft = false;
+
     switch (rd.phase) {
         case 0:
             if (rd.vis_store && rd.decoupled_mode) {
@@ -1989,6 +2053,18 @@ bool CanvasPrivate::init_redraw()
             }
 
         case 2:
+            if (rd.vis_store && rd.progressive) {
+                // Before the main redraw, quickly fill the visible content lacking even a draft, leaving out filters.
+                // Tiles that turn out to contain no filters are finished outright; the rest are refined next.
+                rd.draft = true;
+                process_redraw(*rd.vis_store, updater->get_next_draft_clean_region());
+                return true;
+            } else {
+                rd.phase++;
+                // fallthrough
+            }
+
+        case 3:
             if (rd.vis_store) {
                 // The main priority to redraw, and the bread and butter of Inkscape's painting, is the visible content that is not clean.
                 // This may be done over several cycles, at the direction of the Updater, each outwards from the mouse.
@@ -1999,8 +2075,8 @@ bool CanvasPrivate::init_redraw()
                 // fallthrough
             }
 
-        case 3: {
-            // The lowest priority to redraw is the prerender margin around the visible rectangle.
+        case 4: {
+            // A low priority to redraw is the prerender margin around the visible rectangle.
             // (This is in addition to any opportunistic prerendering that may have already occurred in the above steps.)
             auto prerender = expandedBy(rd.visible, rd.margin);
             auto prerender_store = regularised(prerender & rd.store.rect);
@@ -2010,10 +2086,20 @@ bool CanvasPrivate::init_redraw()
                 commit_tiles_dispatcher.emit();
                 process_redraw(*prerender_store, updater->clean_region);
                 return true;
+            }
+            rd.phase++;
+            [[fallthrough]];
+        }
+
+        case 5:
+            // The lowest priority, only while panning, is the area the view is predicted to move into.
+            if (rd.prefetch) {
+                commit_tiles_dispatcher.emit();
+                process_redraw(*rd.prefetch, updater->clean_region);
+                return true;
             } else {
                 return false;
             }
-        }
 
         default:
             assert(false);
@@ -2075,7 +2161,7 @@ void CanvasPrivate::render_tile(int debug_id)
         auto const flags = abort_flags.load(std::memory_order_relaxed);
         bool const soft = flags & (int)AbortFlags::Soft;
         bool const hard = flags & (int)AbortFlags::Hard;
-        if (hard || (rd.phase == 3 && soft)) {
+        if (hard || (rd.phase >= 4 && soft)) {
             break;
         }
 
@@ -2123,15 +2209,30 @@ void CanvasPrivate::render_tile(int debug_id)
             }
         }
 
-        // Mark the rectangle as clean.
-        updater->mark_clean(rect);
+        if (rd.draft) {
+            // Whether a draft is complete is only known once painted. Meanwhile, keep other threads off the rectangle.
+            rd.clean->do_union(geom_to_cairo(rect));
 
-        rd.mutex.unlock();
+            rd.mutex.unlock();
+            bool const complete = paint_rect(rect);
+            rd.mutex.lock();
 
-        // Paint the rectangle.
-        paint_rect(rect);
+            if (complete) {
+                updater->mark_clean(rect);
+            } else {
+                updater->mark_draft(rect);
+            }
+        } else {
+            // Mark the rectangle as clean.
+            updater->mark_clean(rect);
 
-        rd.mutex.lock();
+            rd.mutex.unlock();
+
+            // Paint the rectangle.
+            paint_rect(rect);
+
+            rd.mutex.lock();
+        }
 
         // Check for timeout.
         if (rd.interruptible) {
@@ -2166,12 +2267,22 @@ bool CanvasPrivate::end_redraw()
             return init_redraw();
 
         case 2:
+            rd.phase++;
+            // Show the drafts straight away, rather than once refined.
+            commit_tiles_dispatcher.emit();
+            return init_redraw();
+
+        case 3:
             if (!updater->report_finished()) {
                 rd.phase++;
             }
             return init_redraw();
 
-        case 3:
+        case 4:
+            rd.phase++;
+            return init_redraw();
+
+        case 5:
             return false;
 
         default:
@@ -2180,11 +2291,14 @@ bool CanvasPrivate::end_redraw()
     }
 }
 
-void CanvasPrivate::paint_rect(Geom::IntRect const &rect)
+// Returns false if the rectangle was painted as an incomplete draft.
+bool CanvasPrivate::paint_rect(Geom::IntRect const &rect)
 {
     // Make sure the paint rectangle lies within the store.
     assert(rd.store.rect.contains(rect));
 
+    bool complete = true;
+
     auto paint = [&, this] (bool need_background, bool outline_pass) {
 
         auto surface = graphics->request_tile_surface(rect, true);
@@ -2196,7 +2310,7 @@ void CanvasPrivate::paint_rect(Geom::IntRect const &rect)
             });
         }
 
-        paint_single_buffer(surface, rect, need_background, outline_pass);
+        complete &= paint_single_buffer(surface, rect, need_background, outline_pass);
 
         return surface;
     };
@@ -2209,6 +2323,7 @@ void CanvasPrivate::paint_rect(Geom::IntRect const &rect)
     if (outlines_enabled) {
         tile.outline_surface = paint(false, true);
     }
+    tile.draft = !complete;
 
     // Introduce an artificial delay for each rectangle.
     if (rd.redraw_delay) g_usleep(*rd.redraw_delay);
@@ -2218,9 +2333,11 @@ void CanvasPrivate::paint_rect(Geom::IntRect const &rect)
         auto g = std::lock_guard(rd.tiles_mutex);
         rd.tiles.emplace_back(std::move(tile));
     }
+
+    return complete;
 }
 
-void CanvasPrivate::paint_single_buffer(Cairo::RefPtr<Cairo::ImageSurface> const &surface, Geom::IntRect const &rect, bool need_background, bool outline_pass)
+bool CanvasPrivate::paint_single_buffer(Cairo::RefPtr<Cairo::ImageSurface> const &surface, Geom::IntRect const &rect, bool need_background, bool outline_pass)
 {
     // Create Cairo context.
     auto cr = Cairo::Context::create(surface);
@@ -2237,6 +2354,7 @@ void CanvasPrivate::paint_single_buffer(Cairo::RefPtr<Cairo::ImageSurface> const
 
     // Render drawing on top of background.
     auto buf = Inkscape::CanvasItemBuffer{ rect, scale_factor, cr, outline_pass };
+    buf.draft = rd.draft && !outline_pass;
     canvasitem_ctx->root()->render(buf);
 
     // Paint over newly drawn content with a translucent random colour.
@@ -2245,6 +2363,8 @@ void CanvasPrivate::paint_single_buffer(Cairo::RefPtr<Cairo::ImageSurface> const
         cr->set_operator(Cairo::OPERATOR_OVER);
         cr->paint();
     }
+
+    return !buf.draft_incomplete;
 }
 
 } // namespace Inkscape::UI::Widget
@@ -19,6 +19,8 @@ public:
     Pref<int>    xray_radius              = { "/options/rendering/xray-radius", 100, 1, 1500 };
     Pref<int>    outline_overlay_opacity  = { "/options/rendering/outline-overlay-opacity", 50, 1, 100 };
     Pref<int>    update_strategy          = { "/options/rendering/update_strategy", 3, 1, 3 };
+    Pref<bool>   progressive              = { "/options/rendering/progressive", true };
+    Pref<int>    tile_cache_size          = { "/options/rendering/tile_cache_size", 64, 0, 4096 };
     Pref<bool>   request_opengl           = { "/options/rendering/request_opengl" };
     Pref<int>    grabsize                 = { "/options/grabsize/value", 3, 1, 15 };
     Pref<int>    numthreads               = { "/options/threading/numthreads", 0, 1, 256 };
@@ -1,4 +1,5 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <2geom/transforms.h>
@@ -9,6 +10,7 @@
 #include "stores.h"
 #include "prefs.h"
 #include "fragment.h"
+#include "framecheck.h"
 #include "graphics.h"
 
 namespace Inkscape {
@@ -81,12 +83,101 @@ auto region_affine_approxinwards(Cairo::RefPtr<Cairo::Region> const &reg, Geom::
     return regdst;
 }
 
+// Return the total area of a region.
+double region_area(Cairo::RefPtr<Cairo::Region> const &reg)
+{
+    double result = 0;
+    for (int i = 0; i < reg->get_num_rectangles(); i++) {
+        auto rect = reg->get_rectangle(i);
+        result += (double)rect.width * rect.height;
+    }
+    return result;
+}
+
+// How far ahead in time to place the store while panning, in seconds.
+constexpr double LOOKAHEAD_TIME = 0.3;
+
+// Pauses between view updates longer than this, in seconds, end the current panning motion.
+constexpr double MOTION_TIMEOUT = 0.2;
+
+// Area of newly exposed content after which to report the prefetch hit rate.
+constexpr double HIT_RATE_REPORT_AREA = 1e6;
+
 } // namespace
 
+void Stores::track_motion(Fragment const &view)
+{
+    auto const now = g_get_monotonic_time();
+
+    if (_last_view) {
+        // Measure how much of the content newly scrolled into view was already drawn.
+        auto exposed = Cairo::Region::create(geom_to_cairo(view.rect));
+        exposed->subtract(geom_to_cairo(*_last_view));
+        if (!exposed->empty()) {
+            auto prefetched = exposed->copy();
+            prefetched->intersect(_store.drawn);
+            _exposed_area += region_area(exposed);
+            _prefetched_area += region_area(prefetched);
+        }
+
+        // Update the velocity, smoothing out jitter between frames.
+        double const dt = (now - _last_time) / 1e6;
+        auto const moved = Geom::Point(view.rect.midpoint() - _last_view->midpoint());
+        if (dt > MOTION_TIMEOUT) {
+            _velocity = {};
+        } else if (dt > 0) {
+            _velocity = 0.5 * _velocity + 0.5 * moved / dt;
+        }
+    }
+
+    _last_view = view.rect;
+    _last_time = now;
+
+    if (_exposed_area >= HIT_RATE_REPORT_AREA) {
+        // Reported as an instantaneous event whose subtype is the percentage of exposed content that was prefetched.
+        if (_prefs.debug_framecheck) {
+            FrameCheck::Event("prefetch", std::round(100.0 * _prefetched_area / _exposed_area));
+        }
+        _exposed_area = _prefetched_area = 0;
+    }
+}
+
+void Stores::reset_motion()
+{
+    _last_view = {};
+    _velocity = {};
+}
+
+Geom::IntPoint Stores::lookahead() const
+{
+    // Once the view has been still for a while, the last panning motion is over.
+    if ((g_get_monotonic_time() - _last_time) / 1e6 > MOTION_TIMEOUT) {
+        return {};
+    }
+
+    // Predict the motion of the view, limited so that the store always keeps the prerender margin around the view.
+    auto const ahead = _velocity * LOOKAHEAD_TIME;
+    int const limit = _prefs.padding;
+    return Geom::IntPoint(std::clamp<int>(std::round(ahead.x()), -limit, limit),
+                          std::clamp<int>(std::round(ahead.y()), -limit, limit));
+}
+
 Geom::IntRect Stores::centered(Fragment const &view) const
 {
-    // Return the visible region of the view, plus the prerender and padding margins.
-    return expandedBy(view.rect, _prefs.prerender + _prefs.padding);
+    // Return the visible region of the view, plus the prerender and padding margins, shifted ahead of any panning.
+    return expandedBy(view.rect, _prefs.prerender + _prefs.padding) + lookahead();
+}
+
+Geom::OptIntRect Stores::prefetch_rect(Fragment const &view) const
+{
+    if (_mode != Mode::Normal) {
+        return {};
+    }
+    auto const ahead = lookahead();
+    if (ahead == Geom::IntPoint()) {
+        return {};
+    }
+    return regularised((expandedBy(view.rect, _prefs.prerender) + ahead) & _store.rect);
 }
 
 void Stores::recreate_store(Fragment const &view)
@@ -239,6 +330,7 @@ void Stores::reset()
     _mode = Mode::None;
     _store.drawn.clear();
     _snapshot.drawn.clear();
+    reset_motion();
 }
 
 // Handle transitions and actions in response to viewport changes.
@@ -259,15 +351,19 @@ auto Stores::update(Fragment const &view) -> Action
             // Enter decoupled mode if the affine has changed from what the store was drawn at.
             if (view.affine != _store.affine) {
                 // Snapshot and reset the store.
+                reset_motion();
                 take_snapshot(view);
                 // Enter decoupled mode.
                 _mode = Mode::Decoupled;
                 if (_prefs.debug_logging) std::cout << "Enter decoupled mode" << std::endl;
                 result = Action::Recreated;
             } else {
+                track_motion(view);
                 // Determine whether the view has moved sufficiently far that we need to shift the store.
-                if (!_store.rect.contains(expandedBy(view.rect, _prefs.prerender))) {
-                    // The visible region + prerender margin has reached the edge of the store.
+                // While panning, this is done early, as soon as the prerender margin ahead of the view would reach the edge.
+                auto const needed = expandedBy(view.rect, _prefs.prerender);
+                if (!_store.rect.contains(needed) || !_store.rect.contains(needed + lookahead())) {
+                    // The visible region + prerender margin has reached or is about to reach the edge of the store.
                     if (!regularised(cairo_to_geom(_store.drawn->get_extents()) & expandedBy(view.rect, _prefs.prerender + _prefs.padding))) {
                         // If the store contains no reusable content at all, recreate it.
                         recreate_store(view);
@@ -7,6 +7,7 @@
 #ifndef INKSCAPE_UI_WIDGET_CANVAS_STORES_H
 #define INKSCAPE_UI_WIDGET_CANVAS_STORES_H
 
+#include <glib.h>
 #include "fragment.h"
 #include "util.h"
 
@@ -64,6 +65,9 @@ public:
     /// Record a rectangle as being drawn to the store.
     void mark_drawn(Geom::IntRect const &rect) { _store.drawn->do_union(geom_to_cairo(rect)); }
 
+    /// The area the view is predicted to pan into, clipped to the store, for drawing after everything else.
+    Geom::OptIntRect prefetch_rect(Fragment const &view) const;
+
     // Getters.
     Store const &store() const { return _store; }
     Store const &snapshot() const { return _snapshot; }
@@ -80,7 +84,19 @@ private:
     // The preferences object we read preferences from.
     Prefs const &_prefs;
 
+    // Panning motion, tracked in normal mode to place the store ahead of the view.
+    Geom::OptIntRect _last_view;
+    gint64 _last_time = 0;
+    Geom::Point _velocity; // In pixels per second.
+
+    // Area newly scrolled into view, and how much of it was already drawn, since the last report.
+    double _exposed_area = 0;
+    double _prefetched_area = 0;
+
     // Internal actions.
+    void track_motion(Fragment const &view);
+    void reset_motion();
+    Geom::IntPoint lookahead() const;
     Geom::IntRect centered(Fragment const &view) const;
     void recreate_store(Fragment const &view);
     void shift_store(Fragment const &view);
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <2geom/parallelogram.h>
+#include "tilecache.h"
+
+namespace Inkscape {
+namespace UI {
+namespace Widget {
+
+namespace {
+
+// Tiles drawn at affines this close are interchangeable.
+constexpr double affine_epsilon = 1e-6;
+
+// Invalidations are grown by this much when mapped to other affines, to cover canvas items such as handles
+// whose size on screen does not depend on the zoom level.
+constexpr int foreign_invalidation_margin = 64;
+
+std::size_t surface_bytes(Cairo::RefPtr<Cairo::ImageSurface> const &surface)
+{
+    return surface ? (std::size_t)surface->get_stride() * surface->get_height() : 0;
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> copy_surface(Cairo::RefPtr<Cairo::ImageSurface> const &surface)
+{
+    if (!surface) {
+        return {};
+    }
+    auto copy = Cairo::ImageSurface::create(surface->get_format(), surface->get_width(), surface->get_height());
+    TileCache::copy_pixels(surface, copy);
+    double x_scale, y_scale;
+    cairo_surface_get_device_scale(surface->cobj(), &x_scale, &y_scale);
+    cairo_surface_set_device_scale(copy->cobj(), x_scale, y_scale);
+    return copy;
+}
+
+} // namespace
+
+void TileCache::copy_pixels(Cairo::RefPtr<Cairo::ImageSurface> const &from, Cairo::RefPtr<Cairo::ImageSurface> const &to)
+{
+    assert(from->get_width() == to->get_width() && from->get_height() == to->get_height());
+    from->flush();
+    to->flush();
+    auto const row_bytes = std::min(from->get_stride(), to->get_stride());
+    for (int y = 0; y < from->get_height(); y++) {
+        std::memcpy(to->get_data() + y * to->get_stride(), from->get_data() + y * from->get_stride(), row_bytes);
+    }
+    to->mark_dirty();
+}
+
+void TileCache::set_max_bytes(std::size_t max_bytes)
+{
+    _max_bytes = max_bytes;
+    shrink();
+}
+
+void TileCache::insert(Fragment const &fragment, Cairo::RefPtr<Cairo::ImageSurface> const &surface, Cairo::RefPtr<Cairo::ImageSurface> const &outline_surface)
+{
+    auto const bytes = surface_bytes(surface) + surface_bytes(outline_surface);
+    if (bytes == 0 || bytes > _max_bytes) {
+        return;
+    }
+
+    // Drop the tiles the new one supersedes.
+    for (auto it = _tiles.begin(); it != _tiles.end(); ) {
+        auto next = std::next(it);
+        if (Geom::are_near(it->fragment.affine, fragment.affine, affine_epsilon) && fragment.rect.contains(it->fragment.rect)) {
+            erase(it);
+        }
+        it = next;
+    }
+
+    _tiles.push_front(Tile{ fragment, copy_surface(surface), copy_surface(outline_surface) });
+    _bytes += bytes;
+    shrink();
+}
+
+std::vector<TileCache::Tile> TileCache::find(Fragment const &store)
+{
+    std::vector<std::list<Tile>::iterator> found;
+    for (auto it = _tiles.begin(); it != _tiles.end(); ++it) {
+        if (Geom::are_near(it->fragment.affine, store.affine, affine_epsilon) && store.rect.contains(it->fragment.rect)) {
+            found.emplace_back(it);
+        }
+    }
+
+    std::vector<Tile> result;
+    result.reserve(found.size());
+    for (auto it : found) {
+        result.emplace_back(*it);
+    }
+
+    // Mark them as most recently used, keeping their order.
+    for (auto it = found.rbegin(); it != found.rend(); ++it) {
+        _tiles.splice(_tiles.begin(), _tiles, *it);
+    }
+
+    return result;
+}
+
+void TileCache::invalidate(Geom::IntRect const &rect, Geom::Affine const &affine)
+{
+    for (auto it = _tiles.begin(); it != _tiles.end(); ) {
+        auto next = std::next(it);
+        auto damaged = rect;
+        if (!Geom::are_near(it->fragment.affine, affine, affine_epsilon)) {
+            damaged = (Geom::Parallelogram(rect) * affine.inverse() * it->fragment.affine).bounds().roundOutwards();
+            damaged.expandBy(foreign_invalidation_margin);
+        }
+        if (damaged.intersects(it->fragment.rect)) {
+            erase(it);
+        }
+        it = next;
+    }
+}
+
+void TileCache::clear()
+{
+    _tiles.clear();
+    _bytes = 0;
+    _generation++;
+}
+
+void TileCache::erase(std::list<Tile>::iterator it)
+{
+    _bytes -= surface_bytes(it->surface) + surface_bytes(it->outline_surface);
+    _tiles.erase(it);
+}
+
+void TileCache::shrink()
+{
+    while (_bytes > _max_bytes) {
+        erase(std::prev(_tiles.end()));
+    }
+}
+
+} // namespace Widget
+} // namespace UI
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4 :
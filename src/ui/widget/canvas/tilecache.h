@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Cache of rendered tiles at recently viewed zoom levels.
+ * Copyright (C) 2024 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef INKSCAPE_UI_WIDGET_CANVAS_TILECACHE_H
+#define INKSCAPE_UI_WIDGET_CANVAS_TILECACHE_H
+
+#include <cstddef>
+#include <list>
+#include <vector>
+#include <cairomm/surface.h>
+#include "fragment.h"
+
+namespace Inkscape {
+namespace UI {
+namespace Widget {
+
+/**
+ * A bounded cache of copies of rendered tiles, so that returning to a recently viewed zoom level
+ * or location can show its content without rendering it again.
+ *
+ * Tiles are keyed by the affine they were drawn at and their rectangle. Rather than tracking a
+ * document revision, invalidations are applied to the tiles of every affine, so that only the
+ * tiles actually touched by a change are lost. The least recently used tiles are evicted first.
+ */
+class TileCache
+{
+public:
+    struct Tile
+    {
+        Fragment fragment;
+        Cairo::RefPtr<Cairo::ImageSurface> surface;
+        Cairo::RefPtr<Cairo::ImageSurface> outline_surface;
+    };
+
+    /// Set the memory limit, evicting tiles as necessary. Zero disables the cache.
+    void set_max_bytes(std::size_t max_bytes);
+
+    /// Store a copy of a newly rendered tile. The outline surface may be null.
+    void insert(Fragment const &fragment, Cairo::RefPtr<Cairo::ImageSurface> const &surface, Cairo::RefPtr<Cairo::ImageSurface> const &outline_surface);
+
+    /// Return the tiles drawn at the affine of \a store and lying within its rectangle, most recently used first.
+    std::vector<Tile> find(Fragment const &store);
+
+    /// Discard the tiles overlapping a rectangle invalidated at the given affine.
+    void invalidate(Geom::IntRect const &rect, Geom::Affine const &affine);
+
+    /// Discard all tiles.
+    void clear();
+
+    /// Incremented on every clear(), to recognise tiles rendered before it.
+    unsigned generation() const { return _generation; }
+
+    /// Copy the pixels of a tile into another surface of the same pixel dimensions.
+    static void copy_pixels(Cairo::RefPtr<Cairo::ImageSurface> const &from, Cairo::RefPtr<Cairo::ImageSurface> const &to);
+
+private:
+    std::list<Tile> _tiles; // Most recently used first.
+    std::size_t _bytes = 0;
+    std::size_t _max_bytes = 0;
+    unsigned _generation = 0;
+
+    void erase(std::list<Tile>::iterator it);
+    void shrink();
+};
+
+} // namespace Widget
+} // namespace UI
+} // namespace Inkscape
+
+#endif // INKSCAPE_UI_WIDGET_CANVAS_TILECACHE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4 :
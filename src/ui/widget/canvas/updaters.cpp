@@ -11,15 +11,23 @@ class ResponsiveUpdater : public Updater
 public:
     Strategy get_strategy() const override { return Strategy::Responsive; }
 
-    void reset()                                             override { clean_region = Cairo::Region::create(); }
-    void intersect (Geom::IntRect const &rect)               override { clean_region->intersect(geom_to_cairo(rect)); }
-    void mark_dirty(Geom::IntRect const &rect)               override { clean_region->subtract(geom_to_cairo(rect)); }
-    void mark_dirty(Cairo::RefPtr<Cairo::Region> const &reg) override { clean_region->subtract(reg); }
-    void mark_clean(Geom::IntRect const &rect)               override { clean_region->do_union(geom_to_cairo(rect)); }
+    void reset()                                             override { clean_region = Cairo::Region::create(); draft_region = Cairo::Region::create(); }
+    void intersect (Geom::IntRect const &rect)               override { clean_region->intersect(geom_to_cairo(rect)); draft_region->intersect(geom_to_cairo(rect)); }
+    void mark_dirty(Geom::IntRect const &rect)               override { clean_region->subtract(geom_to_cairo(rect)); draft_region->subtract(geom_to_cairo(rect)); }
+    void mark_dirty(Cairo::RefPtr<Cairo::Region> const &reg) override { clean_region->subtract(reg); draft_region->subtract(reg); }
+    void mark_clean(Geom::IntRect const &rect)               override { clean_region->do_union(geom_to_cairo(rect)); draft_region->subtract(geom_to_cairo(rect)); }
+    void mark_draft(Geom::IntRect const &rect)               override { clean_region->subtract(geom_to_cairo(rect)); draft_region->do_union(geom_to_cairo(rect)); }
 
     Cairo::RefPtr<Cairo::Region> get_next_clean_region() override { return clean_region; }
     bool                         report_finished      () override { return false; }
     void                         next_frame           () override {}
+
+    Cairo::RefPtr<Cairo::Region> get_next_draft_clean_region() override
+    {
+        auto result = get_next_clean_region()->copy();
+        result->do_union(draft_region);
+        return result;
+    }
 };
 
 class FullRedrawUpdater : public ResponsiveUpdater
@@ -148,6 +156,14 @@ public:
         if (activated) blocked[scale]->do_union(geom_to_cairo(rect));
     }
 
+    // Drafts count as progress at the current scale, so that under continuous damage only drafts are drawn,
+    // and they are refined once the damage stops.
+    void mark_draft(const Geom::IntRect &rect) override
+    {
+        ResponsiveUpdater::mark_draft(rect);
+        if (activated) blocked[scale]->do_union(geom_to_cairo(rect));
+    }
+
     Cairo::RefPtr<Cairo::Region> get_next_clean_region() override
     {
         inprogress = true;
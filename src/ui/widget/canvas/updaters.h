@@ -27,6 +27,9 @@ public:
     // The subregion of the store with up-to-date content.
     Cairo::RefPtr<Cairo::Region> clean_region;
 
+    // The subregion of the store with draft content, still to be redrawn in full. Disjoint from clean_region.
+    Cairo::RefPtr<Cairo::Region> draft_region;
+
     enum class Strategy
     {
         Responsive, // As soon as a region is invalidated, redraw it.
@@ -49,10 +52,14 @@ public:
     virtual void mark_dirty(Geom::IntRect const &) = 0;                // Called on every invalidate event.
     virtual void mark_dirty(Cairo::RefPtr<Cairo::Region> const &) = 0; // Called on every invalidate event.
     virtual void mark_clean(Geom::IntRect const &) = 0;                // Called on every rectangle redrawn.
+    virtual void mark_draft(Geom::IntRect const &) = 0;                // Called on every rectangle redrawn as an incomplete draft.
 
     // Called at the start of a redraw to determine what region to consider clean (i.e. will not be drawn).
     virtual Cairo::RefPtr<Cairo::Region> get_next_clean_region() = 0;
 
+    // Called at the start of a draft pass to determine what region needs no draft (i.e. clean or draft content).
+    virtual Cairo::RefPtr<Cairo::Region> get_next_draft_clean_region() = 0;
+
     // Called after a redraw has finished. Returns true to indicate that further redraws are required with different clean regions.
     virtual bool report_finished() = 0;
 
@@ -14,6 +14,7 @@
 #include <2geom/point.h>
 
 #include "node.h"
+#include "attributes.h"
 #include "svg/stringstream.h"
 #include "svg/css-ostringstream.h"
 #include "svg/svg-length.h"
@@ -21,11 +22,26 @@
 namespace Inkscape{
 namespace XML {
 
+char const *Node::attribute(SPAttr key) const
+{
+    return this->attribute(sp_attribute_quark(key));
+}
+
 void Node::setAttribute(Util::const_char_ptr key, Util::const_char_ptr value)
 {
     this->setAttributeImpl(key.data(), value.data());
 }
 
+void Node::setAttribute(GQuark key, Util::const_char_ptr value)
+{
+    this->setAttributeImpl(key, value.data());
+}
+
+void Node::setAttribute(SPAttr key, Util::const_char_ptr value)
+{
+    this->setAttributeImpl(sp_attribute_quark(key), value.data());
+}
+
 bool Node::copyAttribute(Util::const_char_ptr key, Node const *source_node, bool remove_if_empty)
 {
     if (source_node) {
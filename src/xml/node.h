@@ -16,6 +16,7 @@
 #include <cassert>
 #include <vector>
 #include <list>
+#include <glib.h>
 #include <2geom/point.h>
 
 #include "gc-anchored.h"
@@ -24,6 +25,8 @@
 #include "util/const_char_ptr.h"
 #include "svg/svg-length.h"
 
+enum class SPAttr;
+
 namespace Inkscape {
 namespace XML {
 
@@ -148,6 +151,21 @@ public:
      */
     virtual char const *attribute(char const *key) const = 0;
 
+    /**
+     * @brief Get the string representation of a node's attribute, by interned name
+     *
+     * Same as attribute(char const *key), without looking up the GQuark of the name on
+     * every call.
+     *
+     * @param key The GQuark of the name of the node's attribute
+     */
+    virtual char const *attribute(GQuark key) const = 0;
+
+    /**
+     * @brief Get the string representation of one of the attributes in SPAttr
+     */
+    char const *attribute(SPAttr key) const;
+
     /**
      * @brief Get a list of the node's attributes
      *
@@ -208,6 +226,8 @@ public:
      */
 
     void setAttribute(Util::const_char_ptr key, Util::const_char_ptr value);
+    void setAttribute(GQuark key, Util::const_char_ptr value);
+    void setAttribute(SPAttr key, Util::const_char_ptr value);
 
     /**
      * @brief Copy attribute value from another node to this node
@@ -604,6 +624,7 @@ protected:
     {}
 
     virtual void setAttributeImpl(char const *key, char const *value) = 0;
+    virtual void setAttributeImpl(GQuark key, char const *value) = 0;
 };
 
 } // namespace XML
@@ -11,11 +11,15 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 #include <libxml/parser.h>
+#include <libxml/parserInternals.h>
 #include <libxml/xinclude.h>
 
 #include "xml/repr.h"
@@ -48,6 +52,8 @@ using Inkscape::XML::AttributeVector;
 using Inkscape::XML::rebase_href_attrs;
 
 Document *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns);
+static Document *sp_repr_sax_read (xmlParserCtxtPtr ctxt, const gchar *default_ns, bool *uses_xinclude);
+static void sp_repr_finish_read (Node *root, const gchar *default_ns);
 static Node *sp_repr_svg_read_node (Document *xml_doc, xmlNodePtr node, const gchar *default_ns, std::map<std::string, std::string> &prefix_map);
 static gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar *default_ns, std::map<std::string, std::string> &prefix_map);
 static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
@@ -93,6 +99,7 @@ public:
     int setFile( char const * filename );
 
     xmlDocPtr readXml();
+    xmlParserCtxtPtr createParser();
 
     static int readCb( void * context, char * buffer, int len );
     static int closeCb( void * context );
@@ -170,7 +177,7 @@ int XmlSource::setFile(char const *filename)
     return retVal;
 }
 
-xmlDocPtr XmlSource::readXml()
+static int sp_repr_parse_options()
 {
     int parse_options = XML_PARSE_HUGE | XML_PARSE_RECOVER;
 
@@ -178,7 +185,12 @@ xmlDocPtr XmlSource::readXml()
     bool allowNetAccess = prefs->getBool("/options/externalresources/xml/allow_net_access", false);
     if (!allowNetAccess) parse_options |= XML_PARSE_NONET;
 
-    auto doc = xmlReadIO(readCb, closeCb, this, filename, getEncoding(), parse_options);
+    return parse_options;
+}
+
+xmlDocPtr XmlSource::readXml()
+{
+    auto doc = xmlReadIO(readCb, closeCb, this, filename, getEncoding(), sp_repr_parse_options());
     if (doc && doc->properties && xmlXIncludeProcessFlags(doc, XML_PARSE_NOXINCNODE) < 0) {
         g_warning("XInclude processing failed for %s", filename);
     }
@@ -186,6 +198,32 @@ xmlDocPtr XmlSource::readXml()
     return doc;
 }
 
+/**
+ * Creates a parser context reading from this source with the same options as readXml(), for
+ * parsing with SAX callbacks. Returns nullptr on failure.
+ */
+xmlParserCtxtPtr XmlSource::createParser()
+{
+    auto ctxt = xmlCreateIOParserCtxt(nullptr, nullptr, readCb, closeCb, this, XML_CHAR_ENCODING_NONE);
+    if (!ctxt) {
+        return nullptr;
+    }
+    // As xmlReadIO() does with its URL: the base of the document, and the file named in messages.
+    if (filename && ctxt->input && !ctxt->input->filename) {
+        ctxt->input->filename = reinterpret_cast<char *>(xmlStrdup(reinterpret_cast<xmlChar const *>(filename)));
+    }
+    if (filename && !ctxt->directory) {
+        ctxt->directory = xmlParserGetDirectory(filename);
+    }
+    xmlCtxtUseOptions(ctxt, sp_repr_parse_options());
+    if (encoding) {
+        if (auto handler = xmlFindCharEncodingHandler(encoding)) {
+            xmlSwitchToEncoding(ctxt, handler);
+        }
+    }
+    return ctxt;
+}
+
 int XmlSource::readCb( void * context, char * buffer, int len )
 {
     int retVal = -1;
@@ -268,8 +306,11 @@ int XmlSource::close()
 /**
  * Reads XML from a file, and returns the Document.
  * The default namespace can also be specified, if desired.
+ *
+ * Unless streaming is false, the Document is built while the file is parsed, rather than from a
+ * complete libxml2 tree of it. Files using XInclude are always read through a libxml2 tree.
  */
-Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns)
+Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns, bool streaming)
 {
     xmlDocPtr doc = nullptr;
     Document * rdoc = nullptr;
@@ -295,9 +336,21 @@ Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns)
 
     Inkscape::IO::dump_fopen_call(filename, "N");
 
+    if (streaming) {
+        XmlSource src;
+        bool uses_xinclude = false;
+        if (src.setFile(filename) == 0) {
+            if (auto ctxt = src.createParser()) {
+                rdoc = sp_repr_sax_read(ctxt, default_ns, &uses_xinclude);
+                xmlFreeParserCtxt(ctxt);
+            }
+        }
+        streaming = !uses_xinclude;
+    }
+
     XmlSource src;
 
-    if (src.setFile(filename) == 0) {
+    if (!streaming && src.setFile(filename) == 0) {
         doc = src.readXml();
         rdoc = sp_repr_do_read(doc, default_ns);
     }
@@ -316,7 +369,7 @@ Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns)
 /**
  * Reads and parses XML from a buffer, returning it as an Document
  */
-Document *sp_repr_read_mem (const gchar * buffer, gint length, const gchar *default_ns)
+Document *sp_repr_read_mem (const gchar * buffer, gint length, const gchar *default_ns, bool streaming)
 {
     xmlDocPtr doc;
     Document * rdoc;
@@ -330,6 +383,18 @@ Document *sp_repr_read_mem (const gchar * buffer, gint length, const gchar *defa
                                        // proper solution would be to check the preference "/options/externalresources/xml/allow_net_access"
                                        // as done in XmlSource::readXml which gets called by the analogous sp_repr_read_file()
                                        // but sp_repr_read_mem() seems to be called in locations where Inkscape::Preferences::get() fails badly
+
+    if (streaming) {
+        auto ctxt = xmlCreateMemoryParserCtxt(buffer, length);
+        if (!ctxt) {
+            return nullptr;
+        }
+        xmlCtxtUseOptions(ctxt, parser_options);
+        rdoc = sp_repr_sax_read(ctxt, default_ns, nullptr);
+        xmlFreeParserCtxt(ctxt);
+        return rdoc;
+    }
+
     doc = xmlReadMemory (const_cast<gchar *>(buffer), length, nullptr, nullptr, parser_options);
 
     rdoc = sp_repr_do_read (doc, default_ns);
@@ -342,9 +407,9 @@ Document *sp_repr_read_mem (const gchar * buffer, gint length, const gchar *defa
 /**
  * Reads and parses XML from a buffer, returning it as an Document
  */
-Document *sp_repr_read_buf (const Glib::ustring &buf, const gchar *default_ns)
+Document *sp_repr_read_buf (const Glib::ustring &buf, const gchar *default_ns, bool streaming)
 {
-    return sp_repr_read_mem(buf.c_str(), buf.size(), default_ns);
+    return sp_repr_read_mem(buf.c_str(), buf.size(), default_ns, streaming);
 }
 
 
@@ -463,34 +528,42 @@ Document *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns)
     }
 
     if (root != nullptr) {
-        /* promote elements of some XML documents that don't use namespaces
-         * into their default namespace */
-        if (!strcmp(root->name(), "ns:svg") || !strcmp(root->name(), "svg0:svg")) {
-            g_warning("Detected broken namespace \"%s\" in the SVG file, attempting to work around it", root->name());
-            repair_namespace(root, "svg");
-        } else if ( default_ns && !strchr(root->name(), ':') ) {
-            if ( !strcmp(default_ns, SP_SVG_NS_URI) ) {
-                promote_to_namespace(root, "svg");
-            }
-            if ( !strcmp(default_ns, INKSCAPE_EXTENSION_URI) ) {
-                promote_to_namespace(root, INKSCAPE_EXTENSION_NS_NC);
-            }
-        }
+        sp_repr_finish_read(root, default_ns);
+    }
 
+    return rdoc;
+}
 
-        // Clean unnecessary attributes and style properties from SVG documents. (Controlled by
-        // preferences.)  Note: internal Inkscape svg files will also be cleaned (filters.svg,
-        // icons.svg). How can one tell if a file is internal?
-        if ( !strcmp(root->name(), "svg:svg" ) ) {
-            Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-            bool clean = prefs->getBool("/options/svgoutput/check_on_reading");
-            if( clean ) {
-                sp_attribute_clean_tree( root );
-            }
+/**
+ * Fixes up the namespaces of the root element of a freshly read document, and cleans it if
+ * asked to in the preferences.
+ */
+static void sp_repr_finish_read(Node *root, const gchar *default_ns)
+{
+    /* promote elements of some XML documents that don't use namespaces
+     * into their default namespace */
+    if (!strcmp(root->name(), "ns:svg") || !strcmp(root->name(), "svg0:svg")) {
+        g_warning("Detected broken namespace \"%s\" in the SVG file, attempting to work around it", root->name());
+        repair_namespace(root, "svg");
+    } else if ( default_ns && !strchr(root->name(), ':') ) {
+        if ( !strcmp(default_ns, SP_SVG_NS_URI) ) {
+            promote_to_namespace(root, "svg");
+        }
+        if ( !strcmp(default_ns, INKSCAPE_EXTENSION_URI) ) {
+            promote_to_namespace(root, INKSCAPE_EXTENSION_NS_NC);
         }
     }
 
-    return rdoc;
+    // Clean unnecessary attributes and style properties from SVG documents. (Controlled by
+    // preferences.)  Note: internal Inkscape svg files will also be cleaned (filters.svg,
+    // icons.svg). How can one tell if a file is internal?
+    if ( !strcmp(root->name(), "svg:svg" ) ) {
+        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+        bool clean = prefs->getBool("/options/svgoutput/check_on_reading");
+        if( clean ) {
+            sp_attribute_clean_tree( root );
+        }
+    }
 }
 
 gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar */*default_ns*/, std::map<std::string, std::string> &prefix_map)
@@ -588,6 +661,397 @@ static Node *sp_repr_svg_read_node (Document *xml_doc, xmlNodePtr node, const gc
 }
 
 
+namespace {
+
+// Limits on expanding entities within entities, against documents that nest them to expand
+// exponentially.
+constexpr int MAX_ENTITY_DEPTH = 40;
+constexpr std::size_t MAX_ENTITY_BYTES = std::size_t{10} << 20;
+
+/**
+ * Builds a Document from the SAX2 callbacks of a libxml2 parser, so that no libxml2 tree of the
+ * whole file is held alongside it, as sp_repr_do_read() needs.
+ *
+ * The result is the same as that of sp_repr_do_read(), except that references to internal
+ * entities are replaced by the text of the entity, in attribute values as well as in text. Any
+ * references within that text are expanded too, up to MAX_ENTITY_DEPTH levels and
+ * MAX_ENTITY_BYTES of text per reference; beyond that the text is cut short with a warning.
+ */
+class SaxReader
+{
+public:
+    SaxReader(xmlParserCtxtPtr ctxt, bool detect_xinclude);
+    ~SaxReader();
+
+    /// Parses the input. Returns nullptr if it has no root element or uses XInclude.
+    Document *read(gchar const *default_ns);
+
+    bool usesXInclude() const { return _uses_xinclude; }
+
+private:
+    struct Open
+    {
+        Node *node;
+        bool preserve; ///< Whether white space is preserved, see xml:space.
+    };
+
+    xmlParserCtxtPtr _ctxt;
+    bool _detect_xinclude;
+    bool _uses_xinclude = false;
+    Document *_doc;
+    Node *_root = nullptr;
+    std::vector<Open> _open;
+    std::string _text; ///< Character data not turned into a node yet.
+    bool _text_cdata = false;
+    std::string _name;
+    std::string _value;
+
+    static SaxReader *get(void *ctx);
+    char const *qualifiedName(xmlChar const *localname, xmlChar const *prefix, xmlChar const *uri);
+    char const *attributeValue(xmlChar const *begin, xmlChar const *end);
+    xmlEntityPtr internalEntity(xmlChar const *name) const;
+    bool expandEntity(std::string &out, xmlEntityPtr entity, int depth) const;
+    void appendEntity(std::string &out, xmlEntityPtr entity) const;
+    void append(Node *repr);
+    void addText(xmlChar const *ch, int len, bool cdata);
+    void flushText();
+
+    static void startElement(void *ctx, xmlChar const *localname, xmlChar const *prefix, xmlChar const *uri,
+                             int nb_namespaces, xmlChar const **namespaces,
+                             int nb_attributes, int nb_defaulted, xmlChar const **attributes);
+    static void endElement(void *ctx, xmlChar const *localname, xmlChar const *prefix, xmlChar const *uri);
+    static void characters(void *ctx, xmlChar const *ch, int len);
+    static void cdataBlock(void *ctx, xmlChar const *ch, int len);
+    static void comment(void *ctx, xmlChar const *value);
+    static void processingInstruction(void *ctx, xmlChar const *target, xmlChar const *data);
+    static void reference(void *ctx, xmlChar const *name);
+};
+
+SaxReader::SaxReader(xmlParserCtxtPtr ctxt, bool detect_xinclude)
+    : _ctxt(ctxt)
+    , _detect_xinclude(detect_xinclude)
+    , _doc(new Inkscape::XML::SimpleDocument())
+{
+    // The remaining default handlers only keep the DTD, for looking up entities.
+    auto sax = _ctxt->sax;
+    sax->startElementNs = startElement;
+    sax->endElementNs = endElement;
+    sax->startElement = nullptr;
+    sax->endElement = nullptr;
+    sax->characters = characters;
+    sax->ignorableWhitespace = characters;
+    sax->cdataBlock = cdataBlock;
+    sax->comment = comment;
+    sax->processingInstruction = processingInstruction;
+    sax->reference = reference;
+    _ctxt->_private = this;
+}
+
+SaxReader::~SaxReader()
+{
+    if (_doc) {
+        Inkscape::GC::release(_doc);
+    }
+    if (_ctxt->myDoc) {
+        xmlFreeDoc(_ctxt->myDoc);
+        _ctxt->myDoc = nullptr;
+    }
+    _ctxt->_private = nullptr;
+}
+
+Document *SaxReader::read(gchar const *default_ns)
+{
+    xmlParseDocument(_ctxt);
+    flushText();
+
+    if (_uses_xinclude || !_root) {
+        return nullptr;
+    }
+    sp_repr_finish_read(_root, default_ns);
+    return std::exchange(_doc, nullptr);
+}
+
+SaxReader *SaxReader::get(void *ctx)
+{
+    // libxml2 also reports the content of an entity while checking it on first use, through a
+    // context of its own; the content is added by reference() instead.
+    auto ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+    auto reader = static_cast<SaxReader *>(ctxt->_private);
+    return reader && reader->_ctxt == ctxt ? reader : nullptr;
+}
+
+/**
+ * Returns the name of an element or attribute as it is stored in a Node, valid until the next
+ * call. The prefix is the one Inkscape uses for the namespace, as in sp_repr_qualified_name().
+ */
+char const *SaxReader::qualifiedName(xmlChar const *localname, xmlChar const *prefix, xmlChar const *uri)
+{
+    auto name = reinterpret_cast<char const *>(localname);
+    if (uri) {
+        prefix = reinterpret_cast<xmlChar const *>(sp_xml_ns_uri_prefix(reinterpret_cast<char const *>(uri),
+                                                                        reinterpret_cast<char const *>(prefix)));
+    }
+    if (!prefix) {
+        return name;
+    }
+    // Also for a prefix without a namespace declaration, as libxml2 does.
+    _name = reinterpret_cast<char const *>(prefix);
+    _name += ':';
+    _name += name;
+    return _name.c_str();
+}
+
+xmlEntityPtr SaxReader::internalEntity(xmlChar const *name) const
+{
+    auto entity = xmlGetDocEntity(_ctxt->myDoc, name);
+    return entity && entity->etype == XML_INTERNAL_GENERAL_ENTITY && entity->content ? entity : nullptr;
+}
+
+/**
+ * Appends the text of an internal entity to out, with the character references and references
+ * to other entities in it expanded. Returns false if the expansion nests or grows too far, in
+ * which case out holds the text expanded so far.
+ */
+bool SaxReader::expandEntity(std::string &out, xmlEntityPtr entity, int depth) const
+{
+    if (depth > MAX_ENTITY_DEPTH) {
+        return false;
+    }
+    auto const content = reinterpret_cast<char const *>(entity->content);
+    for (auto p = content; *p; ) {
+        // Only stopping between characters, so that the text stays valid UTF-8.
+        if (out.size() > MAX_ENTITY_BYTES && (*p & 0xc0) != 0x80) {
+            return false;
+        }
+        auto const semicolon = *p == '&' ? std::strchr(p, ';') : nullptr;
+        if (!semicolon) {
+            out += *p++;
+            continue;
+        }
+        std::string const name(p + 1, semicolon);
+        if (name.size() > 1 && name[0] == '#') {
+            bool const hex = name[1] == 'x';
+            auto const code = g_ascii_strtoull(name.c_str() + (hex ? 2 : 1), nullptr, hex ? 16 : 10);
+            char utf8[6];
+            out.append(utf8, g_unichar_to_utf8(static_cast<gunichar>(code), utf8));
+        } else if (auto nested = internalEntity(reinterpret_cast<xmlChar const *>(name.c_str()))) {
+            if (!expandEntity(out, nested, depth + 1)) {
+                return false;
+            }
+        } else if (auto predefined = xmlGetPredefinedEntity(reinterpret_cast<xmlChar const *>(name.c_str()))) {
+            out += reinterpret_cast<char const *>(predefined->content);
+        } else {
+            // Unknown, so kept as written.
+            out.append(p, semicolon + 1);
+        }
+        p = semicolon + 1;
+    }
+    return true;
+}
+
+void SaxReader::appendEntity(std::string &out, xmlEntityPtr entity) const
+{
+    std::string text;
+    if (!expandEntity(text, entity, 0)) {
+        g_warning("Expansion of entity '%s' nests too deeply or is too large, cut short.",
+                  reinterpret_cast<char const *>(entity->name));
+    }
+    out += text;
+}
+
+/**
+ * Returns an attribute value as passed to startElement(), valid until the next call. As
+ * entities are not substituted by the parser, the value still contains references to them,
+ * and "&#38;" for each ampersand.
+ */
+char const *SaxReader::attributeValue(xmlChar const *begin, xmlChar const *end)
+{
+    _value.clear();
+    for (auto p = begin; p < end; ) {
+        if (*p == '&') {
+            auto semicolon = static_cast<xmlChar const *>(std::memchr(p, ';', end - p));
+            if (semicolon) {
+                std::string name(p + 1, semicolon);
+                if (name == "#38") {
+                    _value += '&';
+                    p = semicolon + 1;
+                    continue;
+                }
+                if (auto entity = internalEntity(reinterpret_cast<xmlChar const *>(name.c_str()))) {
+                    appendEntity(_value, entity);
+                    p = semicolon + 1;
+                    continue;
+                }
+            }
+        }
+        _value += *p++;
+    }
+    return _value.c_str();
+}
+
+void SaxReader::append(Node *repr)
+{
+    if (_open.empty()) {
+        _doc->appendChild(repr);
+    } else {
+        _open.back().node->appendChild(repr);
+    }
+    Inkscape::GC::release(repr);
+}
+
+void SaxReader::addText(xmlChar const *ch, int len, bool cdata)
+{
+    if (cdata != _text_cdata) {
+        flushText();
+        _text_cdata = cdata;
+    }
+    _text.append(reinterpret_cast<char const *>(ch), len);
+}
+
+void SaxReader::flushText()
+{
+    if (_text.empty()) {
+        return;
+    }
+    // As in sp_repr_svg_read_node(), only XML's rules for white space are handled here.
+    if (!_open.empty()) {
+        bool preserve = _open.back().preserve;
+        if (preserve || !std::all_of(_text.begin(), _text.end(), [] (char c) { return g_ascii_isspace(c); })) {
+            append(_doc->createTextNode(_text.c_str(), _text_cdata));
+        }
+    }
+    _text.clear();
+}
+
+void SaxReader::startElement(void *ctx, xmlChar const *localname, xmlChar const *prefix, xmlChar const *uri,
+                             int /*nb_namespaces*/, xmlChar const ** /*namespaces*/,
+                             int nb_attributes, int nb_defaulted, xmlChar const **attributes)
+{
+    auto self = get(ctx);
+    if (!self) {
+        return;
+    }
+    self->flushText();
+
+    if (self->_open.empty() && self->_root) {
+        // A second root element, which sp_repr_do_read() does not accept either.
+        self->_root = nullptr;
+        xmlStopParser(self->_ctxt);
+        return;
+    }
+
+    if (self->_detect_xinclude && uri && (xmlStrEqual(uri, XINCLUDE_NS) || xmlStrEqual(uri, XINCLUDE_OLD_NS))) {
+        self->_uses_xinclude = true;
+        xmlStopParser(self->_ctxt);
+        return;
+    }
+
+    auto repr = self->_doc->createElement(self->qualifiedName(localname, prefix, uri));
+    bool preserve = !self->_open.empty() && self->_open.back().preserve;
+
+    // Attributes defaulted by the DTD come last; the tree leaves them out too.
+    if (!(self->_ctxt->loadsubset & XML_COMPLETE_ATTRS)) {
+        nb_attributes -= nb_defaulted;
+    }
+    for (int i = 0; i < nb_attributes; i++) {
+        // Local name, prefix, namespace, value and end of value.
+        auto attribute = attributes + 5 * i;
+        auto value = self->attributeValue(attribute[3], attribute[4]);
+        if (attribute[2] && xmlStrEqual(attribute[2], XML_XML_NAMESPACE) && xmlStrEqual(attribute[0], BAD_CAST "space")) {
+            if (!strcmp(value, "preserve")) {
+                preserve = true;
+            } else if (!strcmp(value, "default")) {
+                preserve = false;
+            }
+        }
+        repr->setAttribute(self->qualifiedName(attribute[0], attribute[1], attribute[2]), value);
+    }
+
+    if (self->_open.empty()) {
+        self->_root = repr;
+    }
+    self->append(repr);
+    self->_open.push_back({ repr, preserve });
+}
+
+void SaxReader::endElement(void *ctx, xmlChar const * /*localname*/, xmlChar const * /*prefix*/, xmlChar const * /*uri*/)
+{
+    auto self = get(ctx);
+    if (!self || self->_open.empty()) {
+        return;
+    }
+    self->flushText();
+    self->_open.pop_back();
+}
+
+void SaxReader::characters(void *ctx, xmlChar const *ch, int len)
+{
+    if (auto self = get(ctx)) {
+        self->addText(ch, len, false);
+    }
+}
+
+void SaxReader::cdataBlock(void *ctx, xmlChar const *ch, int len)
+{
+    if (auto self = get(ctx)) {
+        self->addText(ch, len, true);
+    }
+}
+
+void SaxReader::comment(void *ctx, xmlChar const *value)
+{
+    auto self = get(ctx);
+    // Comments in the DTD belong to the DTD.
+    if (!self || self->_ctxt->inSubset) {
+        return;
+    }
+    self->flushText();
+    self->append(self->_doc->createComment(reinterpret_cast<char const *>(value)));
+}
+
+void SaxReader::processingInstruction(void *ctx, xmlChar const *target, xmlChar const *data)
+{
+    auto self = get(ctx);
+    if (!self || self->_ctxt->inSubset) {
+        return;
+    }
+    self->flushText();
+    self->append(self->_doc->createPI(reinterpret_cast<char const *>(target), reinterpret_cast<char const *>(data)));
+}
+
+void SaxReader::reference(void *ctx, xmlChar const *name)
+{
+    auto self = get(ctx);
+    if (!self) {
+        return;
+    }
+    // Only text; any markup in the entity is taken literally.
+    if (auto entity = self->internalEntity(name)) {
+        std::string text;
+        self->appendEntity(text, entity);
+        self->addText(reinterpret_cast<xmlChar const *>(text.data()), text.size(), false);
+    }
+}
+
+} // namespace
+
+/**
+ * Reads a Document with the given parser context, which must not have been used yet, and
+ * leaves the context to be freed by the caller.
+ *
+ * If uses_xinclude is given, stops and returns nullptr at the first XInclude element, setting
+ * uses_xinclude to true, since XIncludes can only be processed in a libxml2 tree.
+ */
+static Document *sp_repr_sax_read(xmlParserCtxtPtr ctxt, const gchar *default_ns, bool *uses_xinclude)
+{
+    SaxReader reader(ctxt, uses_xinclude != nullptr);
+    auto rdoc = reader.read(default_ns);
+    if (uses_xinclude) {
+        *uses_xinclude = reader.usesXInclude();
+    }
+    return rdoc;
+}
+
 static void sp_repr_save_writer(Document *doc, Inkscape::IO::Writer *out,
                     gchar const *default_ns,
                     gchar const *old_href_abs_base,
@@ -52,14 +52,14 @@ Inkscape::XML::Document *sp_repr_document_new(char const *rootname);
 
 /* IO */
 
-Inkscape::XML::Document *sp_repr_read_file(char const *filename, char const *default_ns);
-Inkscape::XML::Document *sp_repr_read_mem(char const *buffer, int length, char const *default_ns);
+Inkscape::XML::Document *sp_repr_read_file(char const *filename, char const *default_ns, bool streaming = true);
+Inkscape::XML::Document *sp_repr_read_mem(char const *buffer, int length, char const *default_ns, bool streaming = true);
 void sp_repr_write_stream(Inkscape::XML::Node *repr, Inkscape::IO::Writer &out,
                           int indent_level,  bool add_whitespace, Glib::QueryQuark elide_prefix,
                           int inlineattrs, int indent,
                           char const *old_href_base = nullptr,
                           char const *new_href_base = nullptr);
-Inkscape::XML::Document *sp_repr_read_buf (const Glib::ustring &buf, const char *default_ns);
+Inkscape::XML::Document *sp_repr_read_buf (const Glib::ustring &buf, const char *default_ns, bool streaming = true);
 Glib::ustring sp_repr_save_buf(Inkscape::XML::Document *doc);
 
 // TODO convert to std::string
@@ -24,15 +24,11 @@
 
 #include <glib.h>
 
-#include "preferences.h"
-
 #include "xml/node-fns.h"
 #include "debug/event-tracker.h"
 #include "debug/simple-event.h"
 #include "util/format.h"
 
-#include "attribute-rel-util.h"
-
 namespace Inkscape {
 
 namespace XML {
@@ -213,6 +209,7 @@ SimpleNode::SimpleNode(SimpleNode const &node, Document *document)
     }
 
     _attributes = node._attributes;
+    _attribute_index = node._attribute_index;
 
     _observers.add(_subtree_observers);
 }
@@ -228,18 +225,90 @@ gchar const *SimpleNode::content() const {
 gchar const *SimpleNode::attribute(gchar const *name) const {
     g_return_val_if_fail(name != nullptr, NULL);
 
-    GQuark const key = g_quark_from_string(name);
+    // A name that was never interned cannot be the name of an attribute.
+    GQuark const key = g_quark_try_string(name);
 
-    for (const auto & iter : _attributes)
-    {
-        if ( iter.key == key ) {
-            return iter.value;
+    return key ? attribute(key) : nullptr;
+}
+
+gchar const *SimpleNode::attribute(GQuark key) const {
+    auto const attr = _findAttribute(key);
+    return attr ? static_cast<gchar const *>(attr->value) : nullptr;
+}
+
+namespace {
+
+// Below this number of attributes, a linear search of the keys is as fast as the index.
+constexpr std::size_t ATTRIBUTE_INDEX_MIN = 16;
+
+struct IndexKeyLess
+{
+    template <typename Entry>
+    bool operator()(Entry const &entry, GQuark key) const { return entry.first < key; }
+};
+
+} // namespace
+
+AttributeRecord const *SimpleNode::_findAttribute(GQuark key) const {
+    if (_attribute_index.empty()) {
+        for (auto const &iter : _attributes) {
+            if (iter.key == key) {
+                return &iter;
+            }
         }
+        return nullptr;
     }
 
+    auto it = std::lower_bound(_attribute_index.begin(), _attribute_index.end(), key, IndexKeyLess());
+    if (it != _attribute_index.end() && it->first == key) {
+        return &_attributes[it->second];
+    }
     return nullptr;
 }
 
+/**
+ * Updates the attribute index after an attribute has been appended to _attributes, starting
+ * the index once there are enough attributes.
+ */
+void SimpleNode::_indexAddedAttribute() {
+    unsigned const position = _attributes.size() - 1;
+    GQuark const key = _attributes.back().key;
+
+    if (!_attribute_index.empty()) {
+        auto it = std::lower_bound(_attribute_index.begin(), _attribute_index.end(), key, IndexKeyLess());
+        _attribute_index.emplace(it, key, position);
+    } else if (_attributes.size() >= ATTRIBUTE_INDEX_MIN) {
+        _attribute_index.reserve(_attributes.size());
+        for (unsigned i = 0; i < _attributes.size(); i++) {
+            _attribute_index.emplace_back(_attributes[i].key, i);
+        }
+        std::sort(_attribute_index.begin(), _attribute_index.end());
+    }
+}
+
+/**
+ * Updates the attribute index after the attribute at position in _attributes has been erased.
+ */
+void SimpleNode::_indexRemovedAttribute(GQuark key, unsigned position) {
+    if (_attribute_index.empty()) {
+        return;
+    }
+    if (_attributes.size() < ATTRIBUTE_INDEX_MIN / 2) {
+        _attribute_index.clear();
+        return;
+    }
+
+    auto it = std::lower_bound(_attribute_index.begin(), _attribute_index.end(), key, IndexKeyLess());
+    if (it != _attribute_index.end() && it->first == key) {
+        _attribute_index.erase(it);
+    }
+    for (auto &entry : _attribute_index) {
+        if (entry.second > position) {
+            entry.second--;
+        }
+    }
+}
+
 unsigned SimpleNode::position() const {
     g_return_val_if_fail(_parent != nullptr, 0);
     return _parent->_childPosition(*this);
@@ -318,81 +387,42 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
     // sanity check: `name` must not contain whitespace
     g_assert(std::none_of(name, name + strlen(name), [](char c) { return g_ascii_isspace(c); }));
 
-    // Check usefulness of attributes on elements in the svg namespace, optionally don't add them to tree.
-    Glib::ustring element = g_quark_to_string(_name);
-    //g_message("setAttribute:  %s: %s: %s", element.c_str(), name, value);
-    gchar* cleaned_value = g_strdup( value );
-
-    // Only check elements in SVG name space and don't block setting attribute to NULL.
-    if( element.substr(0,4) == "svg:" && value != nullptr) {
-
-        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-        if( prefs->getBool("/options/svgoutput/check_on_editing") ) {
-
-            gchar const *id_char = attribute("id");
-            Glib::ustring id = (id_char == nullptr ? "" : id_char );
-            unsigned int flags = sp_attribute_clean_get_prefs();
-            bool attr_warn   = flags & SP_ATTRCLEAN_ATTR_WARN;
-            bool attr_remove = flags & SP_ATTRCLEAN_ATTR_REMOVE;
-
-            // Check attributes
-            if( (attr_warn || attr_remove) && value != nullptr ) {
-                bool is_useful = sp_attribute_check_attribute( element, id, name, attr_warn );
-                if( !is_useful && attr_remove ) {
-                    g_free( cleaned_value );
-                    return; // Don't add to tree.
-                }
-            }
-
-            // Check style properties -- Note: if element is not yet inserted into
-            // tree (and thus has no parent), default values will not be tested.
-            if( !strcmp( name, "style" ) && (flags >= SP_ATTRCLEAN_STYLE_WARN) ) {
-                g_free( cleaned_value );
-                cleaned_value = g_strdup( sp_attribute_clean_style( this, value, flags ).c_str() );
-                // if( g_strcmp0( value, cleaned_value ) ) {
-                //     g_warning( "SimpleNode::setAttribute: %s", id.c_str() );
-                //     g_warning( "     original: %s", value);
-                //     g_warning( "      cleaned: %s", cleaned_value);
-                // }
-            }
-        }
-    }
+    setAttributeImpl(g_quark_from_string(name), value);
+}
 
-    GQuark const key = g_quark_from_string(name);
+void
+SimpleNode::setAttributeImpl(GQuark key, gchar const *value)
+{
+    g_return_if_fail(key != 0);
 
-    AttributeRecord *ref = nullptr;
-    for ( auto & existing : _attributes ) {
-        if ( existing.key == key ) {
-            ref = &existing;
-            break;
-        }
-    }
+    auto ref = const_cast<AttributeRecord *>(_findAttribute(key));
     Debug::EventTracker<> tracker;
 
     ptr_shared old_value=( ref ? ref->value : ptr_shared() );
 
     ptr_shared new_value=ptr_shared();
-    if (cleaned_value) { // set value of attribute
-        new_value = share_string(cleaned_value);
+    if (value) { // set value of attribute
+        new_value = share_string(value);
         tracker.set<DebugSetAttribute>(*this, key, new_value);
         if (!ref) {
 	    _attributes.emplace_back(key, new_value);
+            _indexAddedAttribute();
         } else {
             ref->value = new_value;
         }
     } else { //clearing attribute
         tracker.set<DebugClearAttribute>(*this, key);
         if (ref) {
-	    _attributes.erase(std::find(_attributes.begin(),_attributes.end(),(*ref)));
+            unsigned const position = ref - _attributes.data();
+            _attributes.erase(_attributes.begin() + position);
+            _indexRemovedAttribute(key, position);
         }
     }
 
     if ( new_value != old_value && (!old_value || !new_value || strcmp(old_value, new_value))) {
         _document->logger()->notifyAttributeChanged(*this, key, old_value, new_value);
         _observers.notifyAttributeChanged(*this, key, old_value, new_value);
-        //g_warning( "setAttribute notified: %s: %s: %s: %s", name, element.c_str(), old_value, new_value ); 
     }
-    g_free( cleaned_value );
 }
 
 void SimpleNode::setCodeUnsafe(int code) {
@@ -734,7 +764,7 @@ void SimpleNode::mergeFrom(Node const *src, gchar const *key, bool extension, bo
 
     for ( const auto & iter : src->attributeList() )
     {
-        setAttribute(g_quark_to_string(iter.key), iter.value);
+        setAttribute(iter.key, iter.value);
     }
 }
 
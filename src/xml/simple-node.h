@@ -17,6 +17,7 @@
 
 #include <cassert>
 #include <iostream>
+#include <utility>
 #include <vector>
 
 #include "xml/node.h"
@@ -81,7 +82,9 @@ public:
     unsigned position() const override;
     void setPosition(int pos) override;
 
+    using Node::attribute;
     char const *attribute(char const *key) const override;
+    char const *attribute(GQuark key) const override;
     bool matchAttributeName(char const *partial_name) const override;
 
     char const *content() const override;
@@ -119,6 +122,7 @@ protected:
 
     virtual SimpleNode *_duplicate(Document *doc) const=0;
     void setAttributeImpl(char const *key, char const *value) override;
+    void setAttributeImpl(GQuark key, char const *value) override;
 
 private:
     void operator=(Node const &); // no assign
@@ -126,6 +130,10 @@ private:
     void _setParent(SimpleNode *parent);
     unsigned _childPosition(SimpleNode const &child) const;
 
+    AttributeRecord const *_findAttribute(GQuark key) const;
+    void _indexAddedAttribute();
+    void _indexRemovedAttribute(GQuark key, unsigned position);
+
     SimpleNode *_parent;
     SimpleNode *_next;
     SimpleNode *_prev;
@@ -136,6 +144,10 @@ private:
 
     AttributeVector _attributes;
 
+    /// Nodes with many attributes also keep their positions in _attributes, sorted by key.
+    using AttributeIndexEntry = std::pair<GQuark, unsigned>;
+    std::vector<AttributeIndexEntry, Inkscape::GC::Alloc<AttributeIndexEntry, Inkscape::GC::ATOMIC>> _attribute_index;
+
     Inkscape::Util::ptr_shared _content;
 
     unsigned _child_count{0};
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <gtest/gtest.h>
+#include "async/scheduler.h"
+using namespace Inkscape::Async;
+
+TEST(Scheduler, parallel_for)
+{
+    auto &scheduler = Scheduler::get();
+
+    std::vector<int> visits(10000);
+    scheduler.parallel_for(0, visits.size(), [&] (int i) { visits[i]++; });
+    for (auto v : visits) {
+        EXPECT_EQ(v, 1);
+    }
+
+    // empty range
+    scheduler.parallel_for(5, 5, [&] (int) { ADD_FAILURE(); });
+}
+
+TEST(Scheduler, nested)
+{
+    auto &scheduler = Scheduler::get();
+
+    std::atomic<long> sum = 0;
+    scheduler.parallel_for(0, 64, [&] (int) {
+        scheduler.parallel_for(0, 1000, [&] (int j) { sum += j; });
+    });
+    EXPECT_EQ(sum, 64 * 999 * 1000 / 2);
+}
+
+TEST(Scheduler, slots)
+{
+    auto &scheduler = Scheduler::get();
+
+    std::vector<std::atomic<int>> in_use(2);
+    scheduler.parallel_for_ranges(0, 100000, [&] (int, int, int slot) {
+        ASSERT_GE(slot, 0);
+        ASSERT_LT(slot, 2);
+        // no two threads share a slot
+        EXPECT_EQ(in_use[slot]++, 0);
+        in_use[slot]--;
+    }, 2, 100);
+}
+
+TEST(Scheduler, exception)
+{
+    auto &scheduler = Scheduler::get();
+
+    EXPECT_THROW(scheduler.parallel_for(0, 1000, [&] (int i) {
+        if (i == 500) {
+            throw std::runtime_error("test");
+        }
+    }), std::runtime_error);
+}
+
+TEST(Scheduler, post)
+{
+    auto &scheduler = Scheduler::get();
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    int done = 0;
+
+    // Post tasks both from outside and from inside the workers.
+    for (int i = 0; i < 100; i++) {
+        scheduler.post([&] {
+            EXPECT_TRUE(scheduler.on_worker_thread());
+            scheduler.post([&] {
+                auto lock = std::lock_guard(mutex);
+                done++;
+                cond.notify_all();
+            });
+        });
+    }
+
+    EXPECT_FALSE(scheduler.on_worker_thread());
+    auto lock = std::unique_lock(mutex);
+    cond.wait(lock, [&] { return done == 100; });
+}
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests and benchmark for the vectorized pixel kernels in display/cairo-simd.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <src/display/cairo-simd.h>
+
+using namespace Inkscape::Pixels;
+
+namespace {
+
+struct Kernel
+{
+    char const *name;
+    std::function<void(std::vector<guint32> &)> run;
+};
+
+class CairoSimdTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        std::mt19937 rng(42);
+
+        // Every (alpha, color) combination, followed by random premultiplied pixels,
+        // some of them with invalid color values above alpha.
+        // The odd length exercises the scalar tails of the vector kernels.
+        for (guint32 a = 0; a < 256; ++a) {
+            for (guint32 c = 0; c < 256; ++c) {
+                in1.push_back((a << 24) | (c << 16) | ((255 - c) << 8) | (c / 2));
+            }
+        }
+        while (in1.size() < N) {
+            guint32 a = rng() & 0xff;
+            guint32 r = rng() % (a + 1), g = rng() % (a + 1), b = rng() % (a + 1);
+            if (in1.size() % 7 == 0) {
+                r = rng() & 0xff;
+            }
+            in1.push_back((a << 24) | (r << 16) | (g << 8) | b);
+        }
+        for (unsigned i = 0; i < N; ++i) {
+            in2.push_back(rng());
+        }
+
+        for (int i = 0; i < 20; ++i) {
+            matrix[i] = (i % 5 == 4) ? int(rng() % 130000) - 65000 : int(rng() % 1200) - 600;
+        }
+        for (auto &table : lut) {
+            for (auto &v : table) {
+                v = rng();
+            }
+        }
+
+        kernels = {
+            {"unpremultiply", [this](auto &out) { unpremultiply(in1.data(), out.data(), N); }},
+            {"premultiply", [this](auto &out) { premultiply(in2.data(), out.data(), N); }},
+            {"color matrix", [this](auto &out) { color_matrix(in1.data(), out.data(), N, matrix); }},
+            {"component transfer", [this](auto &out) { component_lut(in1.data(), out.data(), N, lut); }},
+            {"arithmetic", [this](auto &out) { composite_arithmetic(in1.data(), in2.data(), out.data(), N, k); }},
+        };
+    }
+
+    void TearDown() override
+    {
+        set_simd_level(simd_level_supported());
+    }
+
+    std::vector<SimdLevel> levels() const
+    {
+        std::vector<SimdLevel> result;
+        for (auto level : {SimdLevel::SCALAR, SimdLevel::SSE41, SimdLevel::AVX2}) {
+            if (level <= simd_level_supported()) {
+                result.push_back(level);
+            }
+        }
+        return result;
+    }
+
+    static constexpr unsigned N = 256 * 1024 + 5;
+    std::vector<guint32> in1, in2;
+    gint32 matrix[20];
+    gint32 const k[4] = {128, 20000, 45000, -300000};
+    guint8 lut[4][256];
+    std::vector<Kernel> kernels;
+};
+
+} // namespace
+
+TEST_F(CairoSimdTest, MatchesScalar)
+{
+    for (auto const &kernel : kernels) {
+        set_simd_level(SimdLevel::SCALAR);
+        std::vector<guint32> expected(N);
+        kernel.run(expected);
+
+        for (auto level : levels()) {
+            set_simd_level(level);
+            std::vector<guint32> out(N);
+            kernel.run(out);
+            for (unsigned i = 0; i < N; ++i) {
+                ASSERT_EQ(out[i], expected[i]) << kernel.name << " with " << simd_level_name(level) << " at pixel " << i;
+            }
+        }
+    }
+}
+
+TEST_F(CairoSimdTest, InPlace)
+{
+    for (auto level : levels()) {
+        set_simd_level(level);
+        std::vector<guint32> expected(N);
+        unpremultiply(in1.data(), expected.data(), N);
+        std::vector<guint32> out = in1;
+        unpremultiply(out.data(), out.data(), N);
+        EXPECT_EQ(out, expected) << simd_level_name(level);
+    }
+}
+
+TEST_F(CairoSimdTest, DISABLED_Benchmark)
+{
+    // Prints how much faster each kernel is than the scalar path; timings don't fail.
+    constexpr int repeats = 10;
+    std::vector<guint32> out(N);
+
+    for (auto const &kernel : kernels) {
+        double scalar_time = 0;
+        for (auto level : levels()) {
+            set_simd_level(level);
+            kernel.run(out);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repeats; ++i) {
+                kernel.run(out);
+            }
+            std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+            double ms = time.count() / repeats;
+            if (level == SimdLevel::SCALAR) {
+                scalar_time = ms;
+            }
+            std::cout << kernel.name << " [" << simd_level_name(level) << "]: " << ms << " ms per "
+                      << N << " pixels, " << scalar_time / ms << "x scalar" << std::endl;
+        }
+    }
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the checking of edited attributes when DocumentUndo commits, undoes and redoes
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <cstring>
+#include <memory>
+
+#include <gtest/gtest.h>
+#include <glib.h>
+
+#include <src/document.h>
+#include <src/document-undo.h>
+#include <src/inkscape.h>
+#include <src/preferences.h>
+#include <src/xml/node.h>
+
+using Inkscape::DocumentUndo;
+
+namespace {
+
+// cx means nothing on a rect.
+char const *const svg = R"A(
+<svg xmlns="http://www.w3.org/2000/svg" width="100" height="100">
+  <rect id="r" width="10" height="10" cx="3"/>
+</svg>)A";
+
+class DocumentUndoTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if (!Inkscape::Application::exists()) {
+            Inkscape::Application::create(false);
+        }
+        set_cleaning(true);
+        doc.reset(SPDocument::createNewDocFromMem(svg, std::strlen(svg), false));
+        ASSERT_TRUE(doc);
+        rect = doc->getObjectById("r")->getRepr();
+    }
+
+    void TearDown() override
+    {
+        doc.reset();
+        set_cleaning(false);
+    }
+
+    static void set_cleaning(bool enabled)
+    {
+        auto prefs = Inkscape::Preferences::get();
+        prefs->setBool("/options/svgoutput/incorrect_attributes_remove", enabled);
+        prefs->setBool("/options/svgoutput/disable_optimizations", false);
+        prefs->setBool("/options/svgoutput/check_on_editing", enabled);
+    }
+
+    /// Commit, and let the deferred commit run.
+    void done()
+    {
+        DocumentUndo::done(doc.get(), "edit", "");
+        while (g_main_context_iteration(nullptr, false)) {
+        }
+    }
+
+    std::unique_ptr<SPDocument> doc;
+    Inkscape::XML::Node *rect = nullptr;
+};
+
+} // namespace
+
+// A useless attribute set in a transaction is removed by the commit of that transaction, so one
+// undo reverts both.
+TEST_F(DocumentUndoTest, RemovesUselessAttributeInSameCommit)
+{
+    rect->setAttribute("width", "20");
+    rect->setAttribute("cx", "5");
+    done();
+    EXPECT_STREQ(rect->attribute("width"), "20");
+    EXPECT_FALSE(rect->attribute("cx"));
+
+    ASSERT_TRUE(DocumentUndo::undo(doc.get()));
+    EXPECT_STREQ(rect->attribute("width"), "10");
+    EXPECT_STREQ(rect->attribute("cx"), "3");
+
+    ASSERT_TRUE(DocumentUndo::redo(doc.get()));
+    EXPECT_STREQ(rect->attribute("width"), "20");
+    EXPECT_FALSE(rect->attribute("cx"));
+}
+
+// Attributes brought back by undo are not taken for edits, so the next commit leaves them be.
+TEST_F(DocumentUndoTest, UndoneAttributesAreNotChecked)
+{
+    rect->removeAttribute("cx");
+    done();
+    ASSERT_TRUE(DocumentUndo::undo(doc.get()));
+    EXPECT_STREQ(rect->attribute("cx"), "3");
+
+    rect->setAttribute("height", "30");
+    done();
+    EXPECT_STREQ(rect->attribute("height"), "30");
+    EXPECT_STREQ(rect->attribute("cx"), "3");
+}
+
+// Changes made while the document is insensitive are not the user's, so the next commit of an
+// unrelated edit leaves them be.
+TEST_F(DocumentUndoTest, InsensitiveChangesAreNotChecked)
+{
+    {
+        DocumentUndo::ScopedInsensitive _no_undo(doc.get());
+        rect->setAttribute("cx", "5");
+    }
+    rect->setAttribute("height", "30");
+    done();
+    EXPECT_STREQ(rect->attribute("height"), "30");
+    EXPECT_STREQ(rect->attribute("cx"), "5");
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the average colour queries of display/drawing-average-cache.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <array>
+#include <cstring>
+#include <memory>
+
+#include <gtest/gtest.h>
+#include <cairomm/surface.h>
+
+#include <src/display/cairo-utils.h>
+#include <src/display/drawing.h>
+#include <src/display/drawing-context.h>
+#include <src/display/drawing-surface.h>
+#include <src/document.h>
+#include <src/inkscape.h>
+#include <src/object/sp-root.h>
+
+using namespace Inkscape;
+
+namespace {
+
+char const *const svg = R"A(
+<svg xmlns="http://www.w3.org/2000/svg" width="600" height="500">
+  <rect id="a" x="0" y="0" width="300" height="260" fill="#c02040"/>
+  <rect id="b" x="240" y="180" width="350" height="300" fill="#20a0f0" opacity="0.5"/>
+  <circle id="c" cx="260" cy="250" r="40" fill="#f0e010"/>
+</svg>)A";
+
+class DrawingAverageCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if (!Application::exists()) {
+            Application::create(false);
+        }
+        doc.reset(SPDocument::createNewDocFromMem(svg, std::strlen(svg), false));
+        ASSERT_TRUE(doc);
+        doc->ensureUpToDate();
+
+        dkey = SPItem::display_key_new(1);
+        drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+        // Put the content on both sides of the origin, so that tile indices go negative.
+        drawing.root()->setTransform(Geom::Translate(-256, -200));
+        drawing.update();
+    }
+
+    void TearDown() override
+    {
+        doc->getRoot()->invoke_hide(dkey);
+    }
+
+    /// The average colour of area, computed from a rendering of just that area.
+    std::array<double, 4> expected(Geom::IntRect const &area)
+    {
+        auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, area.width(), area.height());
+        auto ds = DrawingSurface(surface->cobj(), area.min());
+        auto dc = DrawingContext(ds);
+        drawing.render(dc, area);
+        surface->flush();
+
+        std::array<double, 4> sums{};
+        for (int y = 0; y < area.height(); y++) {
+            auto const row = reinterpret_cast<guint32 const *>(surface->get_data() + y * surface->get_stride());
+            for (int x = 0; x < area.width(); x++) {
+                EXTRACT_ARGB32(row[x], a, r, g, b)
+                sums[0] += r;
+                sums[1] += g;
+                sums[2] += b;
+                sums[3] += a;
+            }
+        }
+        for (auto &s : sums) {
+            s /= 255.0 * area.width() * area.height();
+        }
+        return sums;
+    }
+
+    void check(Geom::IntRect const &area)
+    {
+        std::array<double, 4> actual;
+        drawing.averageColor(area, actual[0], actual[1], actual[2], actual[3]);
+        auto const want = expected(area);
+        for (int c = 0; c < 4; c++) {
+            EXPECT_NEAR(actual[c], want[c], 1e-9) << "channel " << c << " of " << area;
+        }
+    }
+
+    std::unique_ptr<SPDocument> doc;
+    Drawing drawing;
+    unsigned dkey = 0;
+};
+
+} // namespace
+
+TEST_F(DrawingAverageCacheTest, MatchesRendering)
+{
+    check(Geom::IntRect::from_xywh(10, 10, 50, 40));       // Within one tile.
+    check(Geom::IntRect::from_xywh(200, 30, 100, 20));     // Across a vertical tile edge.
+    check(Geom::IntRect::from_xywh(-300, -250, 600, 520)); // Across several tiles, negative coordinates.
+    check(Geom::IntRect::from_xywh(-5, -5, 10, 10));       // Around the origin.
+    check(Geom::IntRect::from_xywh(-256, -256, 256, 256)); // Exactly one tile at negative indices.
+    check(Geom::IntRect::from_xywh(-257, -1, 2, 2));       // Tiny, across four tiles.
+    check(Geom::IntRect::from_xywh(7, 3, 1, 1));           // A single pixel, again from the cached tile.
+}
+
+TEST_F(DrawingAverageCacheTest, FollowsChanges)
+{
+    auto const area = Geom::IntRect::from_xywh(-100, -100, 200, 200);
+    check(area);
+
+    // Changed content.
+    doc->getObjectById("c")->setAttribute("fill", "#000000");
+    doc->ensureUpToDate();
+    drawing.update();
+    check(area);
+
+    // Another zoom level.
+    drawing.root()->setTransform(Geom::Scale(0.5) * Geom::Translate(-30, -40));
+    drawing.update();
+    check(area);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
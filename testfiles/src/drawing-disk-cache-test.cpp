@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the persistent cache of rendered items in display/drawing-disk-cache.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <boost/filesystem.hpp>
+#include <cairo.h>
+#include <glib.h>
+
+#include <src/display/drawing-disk-cache.h>
+
+namespace fs = boost::filesystem;
+using Inkscape::DrawingDiskCache;
+
+namespace {
+
+class DrawingDiskCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        auto const tmp = g_dir_make_tmp("inkscape-disk-cache-XXXXXX", nullptr);
+        ASSERT_TRUE(tmp);
+        dir = tmp;
+        g_free(tmp);
+    }
+
+    void TearDown() override
+    {
+        boost::system::error_code ec;
+        fs::remove_all(dir, ec);
+    }
+
+    /// A surface filled with a pattern that depends on seed.
+    static cairo_surface_t *make_surface(int width, int height, int seed)
+    {
+        auto const surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+        auto const data = cairo_image_surface_get_data(surface);
+        int const stride = cairo_image_surface_get_stride(surface);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < 4 * width; x++) {
+                data[y * stride + x] = (x * 7 + y * 13 + seed) & 0xff;
+            }
+        }
+        cairo_surface_mark_dirty(surface);
+        return surface;
+    }
+
+    static bool same_pixels(cairo_surface_t *a, cairo_surface_t *b)
+    {
+        int const width = cairo_image_surface_get_width(a);
+        int const height = cairo_image_surface_get_height(a);
+        for (int y = 0; y < height; y++) {
+            auto const p = cairo_image_surface_get_data(a) + y * cairo_image_surface_get_stride(a);
+            auto const q = cairo_image_surface_get_data(b) + y * cairo_image_surface_get_stride(b);
+            if (std::memcmp(p, q, 4 * width) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::uintmax_t dir_size() const
+    {
+        std::uintmax_t total = 0;
+        for (fs::directory_iterator it(dir), end; it != end; ++it) {
+            total += fs::file_size(it->path());
+        }
+        return total;
+    }
+
+    std::string dir;
+};
+
+// The size of an entry of a 16x16 surface, with its header.
+constexpr std::uintmax_t ENTRY_BYTES = 16 + 4 * 16 * 16;
+
+} // namespace
+
+TEST_F(DrawingDiskCacheTest, RoundTrip)
+{
+    DrawingDiskCache cache(dir, 1 << 20);
+    auto const stored = make_surface(16, 16, 1);
+    cache.store("key", stored);
+
+    auto const loaded = make_surface(16, 16, 2);
+    ASSERT_TRUE(cache.load("key", loaded));
+    EXPECT_TRUE(same_pixels(stored, loaded));
+
+    // Also from another instance, as in a later session.
+    DrawingDiskCache reopened(dir, 1 << 20);
+    auto const reloaded = make_surface(16, 16, 3);
+    ASSERT_TRUE(reopened.load("key", reloaded));
+    EXPECT_TRUE(same_pixels(stored, reloaded));
+
+    // No temporaries are left behind.
+    EXPECT_EQ(dir_size(), ENTRY_BYTES);
+
+    cairo_surface_destroy(stored);
+    cairo_surface_destroy(loaded);
+    cairo_surface_destroy(reloaded);
+}
+
+TEST_F(DrawingDiskCacheTest, Misses)
+{
+    DrawingDiskCache cache(dir, 1 << 20);
+    auto const stored = make_surface(16, 16, 1);
+    cache.store("key", stored);
+
+    auto const surface = make_surface(16, 16, 2);
+    // Another key, as when anything affecting the rendering changed.
+    EXPECT_FALSE(cache.load("changed-key", surface));
+    // Another size.
+    auto const larger = make_surface(32, 16, 2);
+    EXPECT_FALSE(cache.load("key", larger));
+
+    // A truncated entry, as if written by a process that crashed without the atomic rename.
+    {
+        std::ofstream file((fs::path(dir) / "truncated").string(), std::ios_base::binary);
+        file.write("INKRC001", 8);
+    }
+    EXPECT_FALSE(cache.load("truncated", surface));
+
+    cairo_surface_destroy(stored);
+    cairo_surface_destroy(surface);
+    cairo_surface_destroy(larger);
+}
+
+// Storing keeps the directory within its size, and reopening with a smaller size removes the
+// least recently used entries.
+TEST_F(DrawingDiskCacheTest, Trims)
+{
+    auto const max_bytes = 4 * ENTRY_BYTES;
+    {
+        DrawingDiskCache cache(dir, max_bytes);
+        auto const surface = make_surface(16, 16, 1);
+        for (int i = 0; i < 20; i++) {
+            cache.store("key" + std::to_string(i), surface);
+            EXPECT_LE(dir_size(), max_bytes);
+        }
+        cairo_surface_destroy(surface);
+    }
+    EXPECT_GT(dir_size(), 0u);
+
+    // Age the entries, the last stored one least.
+    fs::remove_all(dir);
+    DrawingDiskCache cache(dir, 1 << 20);
+    auto const surface = make_surface(16, 16, 1);
+    auto const now = std::time(nullptr);
+    for (int i = 0; i < 4; i++) {
+        auto const key = "key" + std::to_string(i);
+        cache.store(key, surface);
+        fs::last_write_time(fs::path(dir) / key, now - 100 + i);
+    }
+
+    DrawingDiskCache smaller(dir, 2 * ENTRY_BYTES);
+    EXPECT_LE(dir_size(), 2 * ENTRY_BYTES);
+    EXPECT_FALSE(fs::exists(fs::path(dir) / "key0"));
+    EXPECT_TRUE(fs::exists(fs::path(dir) / "key3"));
+    cairo_surface_destroy(surface);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,251 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the child index and incremental updates of display/drawing-group.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <cairomm/surface.h>
+#include <2geom/transforms.h>
+
+#include <src/display/drawing.h>
+#include <src/display/drawing-context.h>
+#include <src/display/drawing-group.h>
+#include <src/display/drawing-surface.h>
+#include <src/document.h>
+#include <src/inkscape.h>
+#include <src/object/sp-root.h>
+
+using namespace Inkscape;
+
+namespace {
+
+// Enough overlapping squares in one group for it to be indexed.
+constexpr int N = 100;
+constexpr int SIZE = 12;
+constexpr int WIDTH = 160;
+constexpr int HEIGHT = 160;
+
+class DrawingGroupTest : public ::testing::Test
+{
+protected:
+    struct Square
+    {
+        int x, y;
+        bool visible = true;
+        bool present = true;
+    };
+
+    void SetUp() override
+    {
+        if (!Application::exists()) {
+            Application::create(false);
+        }
+
+        std::string svg = "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"160\" height=\"160\"><g id=\"g\">";
+        for (int i = 0; i < N; i++) {
+            squares.push_back({(i % 10) * 9, (i / 10) * 9});
+            svg += "<rect id=\"r" + std::to_string(i) + "\" x=\"" + std::to_string(squares[i].x) + "\" y=\"" +
+                   std::to_string(squares[i].y) + "\" width=\"12\" height=\"12\" shape-rendering=\"crispEdges\" fill=\"" +
+                   colour(i) + "\"/>";
+        }
+        svg += "</g></svg>";
+
+        doc.reset(SPDocument::createNewDocFromMem(svg.c_str(), svg.size(), false));
+        ASSERT_TRUE(doc);
+        doc->ensureUpToDate();
+
+        dkey = SPItem::display_key_new(1);
+        drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+        group = cast<SPItem>(doc->getObjectById("g"));
+        static_cast<DrawingGroup *>(group->get_arenaitem(dkey))->setPickChildren(true);
+        drawing.update();
+    }
+
+    void TearDown() override
+    {
+        doc->getRoot()->invoke_hide(dkey);
+    }
+
+    static std::string colour(int i)
+    {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "#%02x%02x%02x", 40 + i * 2, 255 - i * 2, (i * 37) % 256);
+        return buf;
+    }
+
+    SPItem *rect(int i) { return cast<SPItem>(doc->getObjectById("r" + std::to_string(i))); }
+
+    void move(int i, int x, int y)
+    {
+        squares[i].x = x;
+        squares[i].y = y;
+        rect(i)->setAttribute("x", std::to_string(x));
+        rect(i)->setAttribute("y", std::to_string(y));
+    }
+
+    void hide(int i)
+    {
+        squares[i].visible = false;
+        rect(i)->setAttribute("style", "display:none");
+    }
+
+    void remove(int i)
+    {
+        squares[i].present = false;
+        rect(i)->deleteObject();
+    }
+
+    void update()
+    {
+        doc->ensureUpToDate();
+        drawing.update();
+    }
+
+    /// The item picked at p by walking the children of the group one after another.
+    DrawingItem *linear_pick(Geom::Point const &p)
+    {
+        for (auto &child : group->children) {
+            if (auto item = cast<SPItem>(&child)) {
+                if (auto picked = item->get_arenaitem(dkey)->pick(p, 0)) {
+                    return picked;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    /// Compare the picks and the rendering of the group with a walk over all the children.
+    void check()
+    {
+        auto const group_item = group->get_arenaitem(dkey);
+        int mismatches = 0;
+        for (int y = 0; y < HEIGHT; y += 3) {
+            for (int x = 0; x < WIDTH; x += 3) {
+                auto const p = Geom::Point(x + 0.5, y + 0.5);
+                mismatches += group_item->pick(p, 0) != linear_pick(p);
+            }
+        }
+        EXPECT_EQ(mismatches, 0) << "picks";
+
+        // Render in tiles, so that only some children are found by each query.
+        auto const area = Geom::IntRect(0, 0, WIDTH, HEIGHT);
+        auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, WIDTH, HEIGHT);
+        for (int ty = 0; ty < HEIGHT; ty += 32) {
+            for (int tx = 0; tx < WIDTH; tx += 32) {
+                auto const tile = Geom::IntRect::from_xywh(tx, ty, 32, 32) & area;
+                auto ds = DrawingSurface(surface->cobj(), area.min());
+                auto dc = DrawingContext(ds);
+                dc.rectangle(*tile);
+                dc.clip();
+                drawing.render(dc, *tile);
+            }
+        }
+        surface->flush();
+
+        // Squares are opaque, so each pixel has the colour of the last square covering it.
+        mismatches = 0;
+        for (int y = 0; y < HEIGHT; y++) {
+            auto const row = reinterpret_cast<guint32 const *>(surface->get_data() + y * surface->get_stride());
+            for (int x = 0; x < WIDTH; x++) {
+                guint32 expected = 0;
+                for (int i = 0; i < N; i++) {
+                    auto const &s = squares[i];
+                    if (s.present && s.visible && x >= s.x && x < s.x + SIZE && y >= s.y && y < s.y + SIZE) {
+                        expected = 0xff000000 | std::stoul(colour(i).substr(1), nullptr, 16);
+                    }
+                }
+                mismatches += row[x] != expected;
+            }
+        }
+        EXPECT_EQ(mismatches, 0) << "pixels";
+    }
+
+    std::unique_ptr<SPDocument> doc;
+    Drawing drawing;
+    unsigned dkey = 0;
+    SPItem *group = nullptr;
+    std::vector<Square> squares;
+};
+
+} // namespace
+
+// The index stays in step with the children as they move, hide and go, whether it is refitted or
+// rebuilt.
+TEST_F(DrawingGroupTest, IndexFollowsChildren)
+{
+    check();
+
+    // A few moves: refitted.
+    move(3, 140, 140);
+    move(57, 0, 120);
+    move(90, 75, 5);
+    update();
+    check();
+
+    // Many moves: rebuilt.
+    for (int i = 10; i < 50; i++) {
+        move(i, (i * 53) % 148, (i * 29) % 148);
+    }
+    update();
+    check();
+
+    for (int i = 60; i < 70; i++) {
+        hide(i);
+    }
+    update();
+    check();
+
+    for (int i = 0; i < N; i += 7) {
+        remove(i);
+    }
+    update();
+    check();
+
+    // A moved child that was hidden.
+    move(61, 100, 100);
+    update();
+    check();
+}
+
+// Changing one child of a large group updates only that child and its ancestors, unless the
+// change has to reach every child.
+TEST_F(DrawingGroupTest, UpdatesOnlyChangedChildren)
+{
+    move(42, 130, 10);
+    update();
+    EXPECT_LE(drawing.updateVisits(), 4u);
+    check();
+
+    hide(43);
+    update();
+    EXPECT_LE(drawing.updateVisits(), 4u);
+    check();
+
+    drawing.root()->setTransform(Geom::Translate(1, 0));
+    drawing.root()->setTransform(Geom::identity());
+    drawing.update();
+    EXPECT_GE(drawing.updateVisits(), std::size_t{N});
+    check();
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the mipmaps of images in display/drawing-image.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <cairo.h>
+#include <cairomm/surface.h>
+#include <glib.h>
+#include <2geom/transforms.h>
+
+#include <src/display/drawing.h>
+#include <src/display/drawing-context.h>
+#include <src/display/drawing-surface.h>
+#include <src/document.h>
+#include <src/inkscape.h>
+#include <src/object/sp-root.h>
+
+using namespace Inkscape;
+
+namespace {
+
+/// A data URI of a PNG image of the given size.
+std::string png_uri(int width, int height)
+{
+    auto const surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    auto const cr = cairo_create(surface);
+    cairo_set_source_rgb(cr, 0.2, 0.4, 0.8);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+
+    std::string png;
+    cairo_surface_write_to_png_stream(surface, [] (void *closure, unsigned char const *data, unsigned length) {
+        static_cast<std::string *>(closure)->append(reinterpret_cast<char const *>(data), length);
+        return CAIRO_STATUS_SUCCESS;
+    }, &png);
+    cairo_surface_destroy(surface);
+
+    auto const base64 = g_base64_encode(reinterpret_cast<guchar const *>(png.data()), png.size());
+    std::string result = std::string("data:image/png;base64,") + base64;
+    g_free(base64);
+    return result;
+}
+
+// Rendered at this scale, the second halving of image a is nominally too small (25.25 x 15.25
+// pixels for 25.76 x 15.56 device pixels), but its real, rounded up size of 26 x 16 is enough.
+constexpr double SCALE = 0.255;
+
+// The bytes of the levels of image a at SCALE: 51 x 31 and 26 x 16 pixels.
+constexpr size_t A_BYTES = 204 * 31 + 104 * 16;
+// The bytes of the levels of image b at SCALE: 41 x 21 and 21 x 11 pixels.
+constexpr size_t B_BYTES = 164 * 21 + 84 * 11;
+
+class DrawingImageTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if (!Application::exists()) {
+            Application::create(false);
+        }
+        auto const svg = "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"400\" height=\"200\">"
+                         "<image x=\"0\" y=\"0\" width=\"101\" height=\"61\" xlink:href=\"" + png_uri(101, 61) + "\"/>"
+                         "<image x=\"200\" y=\"0\" width=\"81\" height=\"41\" xlink:href=\"" + png_uri(81, 41) + "\"/>"
+                         "</svg>";
+        doc.reset(SPDocument::createNewDocFromMem(svg.c_str(), svg.size(), false));
+        ASSERT_TRUE(doc);
+        doc->ensureUpToDate();
+
+        dkey = SPItem::display_key_new(1);
+        drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+    }
+
+    void TearDown() override
+    {
+        doc->getRoot()->invoke_hide(dkey);
+    }
+
+    void show(size_t cache_budget, double scale)
+    {
+        drawing.setCacheBudget(cache_budget);
+        drawing.root()->setTransform(Geom::Scale(scale));
+        drawing.update();
+    }
+
+    void render(Geom::IntRect const &area)
+    {
+        auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, area.width(), area.height());
+        auto ds = DrawingSurface(surface->cobj(), area.min());
+        auto dc = DrawingContext(ds);
+        drawing.render(dc, area);
+    }
+
+    // The device areas of the images at SCALE.
+    static Geom::IntRect area_a() { return Geom::IntRect::from_xywh(0, 0, 30, 20); }
+    static Geom::IntRect area_b() { return Geom::IntRect::from_xywh(50, 0, 30, 20); }
+
+    std::unique_ptr<SPDocument> doc;
+    Drawing drawing;
+    unsigned dkey = 0;
+};
+
+} // namespace
+
+// Levels are picked by their real size, so an odd-sized image is sampled from the smallest level
+// that still has a pixel for every device pixel.
+TEST_F(DrawingImageTest, PicksLevelByRealSize)
+{
+    show(size_t{64} << 20, SCALE);
+    render(area_a());
+    EXPECT_EQ(drawing.mipmapBytes(), A_BYTES);
+
+    // Zoomed in a little, the second level is too small.
+    show(size_t{64} << 20, 0.3);
+    render(area_a());
+    EXPECT_EQ(drawing.mipmapBytes(), A_BYTES); // Levels built before are kept.
+    drawing.setCacheBudget(0);
+    EXPECT_EQ(drawing.mipmapBytes(), 0u);
+    drawing.setCacheBudget(size_t{64} << 20);
+    render(area_a());
+    EXPECT_EQ(drawing.mipmapBytes(), size_t{204} * 31);
+
+    // Not zoomed out, no mipmaps are needed.
+    drawing.setCacheBudget(0);
+    show(size_t{64} << 20, 1.0);
+    render(Geom::IntRect::from_xywh(0, 0, 110, 70));
+    EXPECT_EQ(drawing.mipmapBytes(), 0u);
+}
+
+// When the budget is exceeded, the mipmaps of the least recently used image are dropped.
+TEST_F(DrawingImageTest, EvictsOtherImages)
+{
+    size_t const budget = A_BYTES + 10;
+    show(budget, SCALE);
+
+    render(area_a());
+    EXPECT_EQ(drawing.mipmapBytes(), A_BYTES);
+
+    // Both do not fit, so those of a make room.
+    render(area_b());
+    EXPECT_EQ(drawing.mipmapBytes(), B_BYTES);
+
+    render(area_a());
+    EXPECT_EQ(drawing.mipmapBytes(), A_BYTES);
+
+    // An image never drops its own levels; with too small a budget it gets what fits.
+    drawing.setCacheBudget(size_t{204} * 31 + 10);
+    EXPECT_EQ(drawing.mipmapBytes(), 0u);
+    render(area_a());
+    EXPECT_EQ(drawing.mipmapBytes(), size_t{204} * 31);
+    EXPECT_LE(drawing.mipmapBytes(), size_t{204} * 31 + 10);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
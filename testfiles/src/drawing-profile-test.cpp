@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the render statistics of display/drawing-profile.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <src/display/drawing.h>
+#include <src/display/drawing-profile.h>
+#include <src/document.h>
+#include <src/inkscape.h>
+#include <src/object/sp-root.h>
+
+using namespace Inkscape;
+using namespace std::chrono_literals;
+
+namespace {
+
+char const *const svg = R"A(
+<svg xmlns="http://www.w3.org/2000/svg" width="100" height="100">
+  <g id="g">
+    <rect id="a" width="10" height="10"/>
+    <rect id="b" width="20" height="20"/>
+    <rect id="c&quot;" width="30" height="30"/>
+    <rect width="40" height="40"/>
+  </g>
+</svg>)A";
+
+class DrawingProfileTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if (!Application::exists()) {
+            Application::create(false);
+        }
+        doc.reset(SPDocument::createNewDocFromMem(svg, std::strlen(svg), false));
+        ASSERT_TRUE(doc);
+        doc->ensureUpToDate();
+
+        for (auto &view : views) {
+            view.dkey = SPItem::display_key_new(1);
+            view.drawing.setRoot(doc->getRoot()->invoke_show(view.drawing, view.dkey, SP_ITEM_SHOW_DISPLAY));
+        }
+    }
+
+    void TearDown() override
+    {
+        for (auto &view : views) {
+            doc->getRoot()->invoke_hide(view.dkey);
+        }
+    }
+
+    /// The drawing item of an object in the first or second drawing.
+    DrawingItem &item(char const *id, int view = 0)
+    {
+        auto object = cast<SPItem>(doc->getObjectById(id));
+        return *object->get_arenaitem(views[view].dkey);
+    }
+
+    DrawingItem &unnamed(int view = 0)
+    {
+        return *cast<SPItem>(doc->getObjectById("g")->lastChild())->get_arenaitem(views[view].dkey);
+    }
+
+    static DrawingProfile::Entry find(std::vector<DrawingProfile::Entry> const &entries, std::string const &id)
+    {
+        for (auto const &entry : entries) {
+            if (entry.id == id) {
+                return entry;
+            }
+        }
+        ADD_FAILURE() << "no entry for " << id;
+        return {};
+    }
+
+    static std::vector<std::string> ids(std::vector<DrawingProfile::Entry> const &entries)
+    {
+        std::vector<std::string> result;
+        for (auto const &entry : entries) {
+            result.push_back(entry.id);
+        }
+        return result;
+    }
+
+    struct View
+    {
+        Drawing drawing;
+        unsigned dkey = 0;
+    };
+
+    std::unique_ptr<SPDocument> doc;
+    View views[2];
+};
+
+} // namespace
+
+// A parent is charged the time of its children in its total, but not in its self time.
+TEST_F(DrawingProfileTest, NestedScopes)
+{
+    DrawingProfile profile;
+    {
+        DrawingProfile::Scope g(&profile, item("g"));
+        std::this_thread::sleep_for(5ms);
+        {
+            DrawingProfile::Scope a(&profile, item("a"));
+            std::this_thread::sleep_for(10ms);
+        }
+        {
+            DrawingProfile::Scope b(&profile, item("b"));
+            std::this_thread::sleep_for(10ms);
+        }
+    }
+
+    auto const entries = profile.report();
+    auto const g = find(entries, "g");
+    auto const a = find(entries, "a");
+    auto const b = find(entries, "b");
+    EXPECT_DOUBLE_EQ(a.self_time, a.total_time);
+    EXPECT_GE(a.total_time, 0.010);
+    EXPECT_NEAR(g.self_time, g.total_time - a.total_time - b.total_time, 1e-9);
+    EXPECT_GE(g.self_time, 0.005);
+    EXPECT_EQ(g.renders, 1u);
+
+    // A scope without a profile records nothing.
+    {
+        DrawingProfile::Scope none(nullptr, item("a"));
+    }
+    EXPECT_EQ(find(profile.report(), "a").renders, 1u);
+}
+
+// The items of an object in several drawings, and those already destroyed, add up under its id.
+TEST_F(DrawingProfileTest, AggregatesById)
+{
+    DrawingProfile profile;
+    for (int view = 0; view < 2; view++) {
+        DrawingProfile::Scope a(&profile, item("a", view));
+        a.addPixels(Geom::IntRect::from_xywh(0, 0, 10, 10), 1);
+    }
+    {
+        DrawingProfile::Scope a(&profile, item("a", 1));
+        a.addPixels(Geom::IntRect::from_xywh(0, 0, 10, 10), 2);
+        a.cacheHit();
+    }
+    profile.forget(&item("a", 1));
+    {
+        DrawingProfile::Scope unnamed_item(&profile, unnamed());
+    }
+
+    auto const entries = profile.report();
+    ASSERT_EQ(entries.size(), 2u);
+    auto const a = find(entries, "a");
+    EXPECT_EQ(a.renders, 3u);
+    EXPECT_EQ(a.pixels, 100u + 100u + 400u);
+    EXPECT_EQ(a.cache_hits, 1u);
+    EXPECT_EQ(find(entries, "<svg:rect>").renders, 1u);
+}
+
+TEST_F(DrawingProfileTest, SortsByEachKey)
+{
+    DrawingProfile profile;
+    {
+        DrawingProfile::Scope g(&profile, item("g"));
+        {
+            // Most self time.
+            DrawingProfile::Scope a(&profile, item("a"));
+            std::this_thread::sleep_for(30ms);
+        }
+        {
+            // Most filter time, and most pixels.
+            DrawingProfile::Scope b(&profile, item("b"));
+            b.addPixels(Geom::IntRect::from_xywh(0, 0, 100, 100), 1);
+            b.startFilter();
+            std::this_thread::sleep_for(15ms);
+            b.finishFilter();
+        }
+        for (int i = 0; i < 3; i++) {
+            // Most cache hits.
+            DrawingProfile::Scope c(&profile, item("c\""));
+            c.addPixels(Geom::IntRect::from_xywh(0, 0, 10, 10), 1);
+            c.cacheHit();
+        }
+    }
+
+    auto const first = [&] (DrawingProfile::SortKey key) { return profile.report(key).front().id; };
+    EXPECT_EQ(first(DrawingProfile::SortKey::SELF_TIME), "a");
+    EXPECT_EQ(first(DrawingProfile::SortKey::TOTAL_TIME), "g");
+    EXPECT_EQ(first(DrawingProfile::SortKey::FILTER_TIME), "b");
+    EXPECT_EQ(first(DrawingProfile::SortKey::PIXELS), "b");
+    EXPECT_EQ(first(DrawingProfile::SortKey::CACHE_HITS), "c\"");
+
+    // Ties are broken by id, so that reports are stable.
+    EXPECT_EQ(ids(profile.report(DrawingProfile::SortKey::CACHE_HITS)), (std::vector<std::string>{"c\"", "a", "b", "g"}));
+}
+
+TEST_F(DrawingProfileTest, WritesJson)
+{
+    DrawingProfile empty;
+    std::ostringstream os_empty;
+    empty.writeJson(os_empty);
+    EXPECT_EQ(os_empty.str(), "{\n  \"total_ms\": 0,\n  \"items\": []\n}\n");
+
+    DrawingProfile profile;
+    {
+        DrawingProfile::Scope a(&profile, item("a"));
+        std::this_thread::sleep_for(10ms);
+    }
+    {
+        DrawingProfile::Scope c(&profile, item("c\""));
+        c.addPixels(Geom::IntRect::from_xywh(0, 0, 10, 20), 1);
+        c.cacheHit();
+    }
+
+    std::ostringstream os;
+    profile.writeJson(os);
+    auto const json = os.str();
+    EXPECT_EQ(json.rfind("{\n  \"total_ms\": ", 0), 0u);
+    EXPECT_EQ(json.substr(json.size() - 7), "\n  ]\n}\n");
+
+    // Sorted by self time, with the id escaped.
+    auto const pos_a = json.find("{\"id\": \"a\", \"self_ms\": ");
+    auto const pos_c = json.find("{\"id\": \"c\\\"\", \"self_ms\": ");
+    ASSERT_NE(pos_a, std::string::npos);
+    ASSERT_NE(pos_c, std::string::npos);
+    EXPECT_LT(pos_a, pos_c);
+    EXPECT_NE(json.find("\"renders\": 1, \"pixels\": 200, \"cache_hits\": 1}", pos_c), std::string::npos);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
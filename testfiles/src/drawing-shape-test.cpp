@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the rendering of shapes in display/drawing-shape.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include <gtest/gtest.h>
+#include <cairomm/surface.h>
+#include <2geom/transforms.h>
+
+#include <src/display/drawing.h>
+#include <src/display/drawing-context.h>
+#include <src/display/drawing-surface.h>
+#include <src/document.h>
+#include <src/inkscape.h>
+#include <src/object/sp-root.h>
+
+using namespace Inkscape;
+
+namespace {
+
+// Curved shapes with enough segments to be replayed from display lists: filled, thinly stroked,
+// and used as a clip.
+char const *const svg = R"A(
+<svg xmlns="http://www.w3.org/2000/svg" width="300" height="200">
+  <defs>
+    <clipPath id="clip">
+      <path id="clip-path" d="M 150,20 C 250,0 300,120 200,180 C 120,230 20,160 40,90 C 50,50 100,30 150,20 Z
+                              M 60,100 C 80,60 140,60 160,100 C 140,140 80,140 60,100 Z
+                              M 200,60 C 220,50 240,70 230,90 C 220,110 190,100 200,60 Z
+                              M 100,150 C 110,140 130,145 125,160 C 120,175 95,170 100,150 Z"/>
+    </clipPath>
+  </defs>
+  <path id="star" fill="#3060c0" stroke="#000" stroke-width="1.5"
+        d="M 150,10 C 160,60 170,70 220,80 C 170,90 160,100 150,150 C 140,100 130,90 80,80 C 130,70 140,60 150,10 Z
+           M 40,120 C 45,140 50,145 70,150 C 50,155 45,160 40,180 C 35,160 30,155 10,150 C 30,145 35,140 40,120 Z
+           M 250,120 C 255,140 260,145 280,150 C 260,155 255,160 250,180 C 245,160 240,155 220,150 C 240,145 245,140 250,120 Z
+           M 150,160 C 152,170 154,172 164,174 C 154,176 152,178 150,188 C 148,178 146,176 136,174 C 146,172 148,170 150,160 Z"/>
+  <rect x="0" y="0" width="300" height="200" fill="#e04020" opacity="0.6" clip-path="url(#clip)"/>
+</svg>)A";
+
+class DrawingShapeTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if (!Application::exists()) {
+            Application::create(false);
+        }
+        doc.reset(SPDocument::createNewDocFromMem(svg, std::strlen(svg), false));
+        ASSERT_TRUE(doc);
+        doc->ensureUpToDate();
+    }
+
+    struct View
+    {
+        Drawing drawing;
+        unsigned dkey;
+    };
+
+    std::unique_ptr<View> show(size_t cache_budget, Geom::Affine const &affine)
+    {
+        auto view = std::make_unique<View>();
+        view->dkey = SPItem::display_key_new(1);
+        view->drawing.setRoot(doc->getRoot()->invoke_show(view->drawing, view->dkey, SP_ITEM_SHOW_DISPLAY));
+        view->drawing.setCacheBudget(cache_budget);
+        view->drawing.root()->setTransform(affine);
+        view->drawing.update();
+        return view;
+    }
+
+    void hide(View const &view)
+    {
+        doc->getRoot()->invoke_hide(view.dkey);
+    }
+
+    /// Render the area in tiles of the given size, as the canvas does.
+    static Cairo::RefPtr<Cairo::ImageSurface> render(Drawing &drawing, Geom::IntRect const &area, int tile)
+    {
+        auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, area.width(), area.height());
+        for (int y = area.top(); y < area.bottom(); y += tile) {
+            for (int x = area.left(); x < area.right(); x += tile) {
+                auto const rect = Geom::IntRect::from_xywh(x, y, tile, tile) & area;
+                auto ds = DrawingSurface(surface->cobj(), area.min());
+                auto dc = DrawingContext(ds);
+                dc.rectangle(*rect);
+                dc.clip();
+                drawing.render(dc, *rect);
+            }
+        }
+        surface->flush();
+        return surface;
+    }
+
+    /// The largest difference of a channel between two renderings, and the number of painted pixels.
+    static std::pair<int, int> compare(Cairo::RefPtr<Cairo::ImageSurface> const &a, Cairo::RefPtr<Cairo::ImageSurface> const &b)
+    {
+        int max_difference = 0;
+        int painted = 0;
+        for (int y = 0; y < a->get_height(); y++) {
+            auto p = a->get_data() + y * a->get_stride();
+            auto q = b->get_data() + y * b->get_stride();
+            for (int x = 0; x < 4 * a->get_width(); x++) {
+                max_difference = std::max(max_difference, std::abs(p[x] - q[x]));
+                painted += x % 4 == 3 && p[x];
+            }
+        }
+        return {max_difference, painted};
+    }
+
+    std::unique_ptr<SPDocument> doc;
+};
+
+} // namespace
+
+// Shapes replayed from their display lists look the same as shapes drawn from their curves.
+TEST_F(DrawingShapeTest, DisplayListsKeepOutput)
+{
+    auto const area = Geom::IntRect::from_xywh(0, 0, 300, 200);
+    auto const affines = {
+        Geom::Affine(),
+        Geom::Affine(Geom::Scale(1.5) * Geom::Translate(-60, -40)),
+        Geom::Affine(Geom::Rotate::from_degrees(20) * Geom::Translate(40, -30)),
+    };
+
+    auto cached = show(std::size_t{64} << 20, Geom::identity());
+    for (auto const &affine : affines) {
+        // Transformations change with updates, which must not leave stale lists behind.
+        cached->drawing.root()->setTransform(affine);
+        cached->drawing.update();
+
+        auto uncached = show(0, affine);
+        auto const expected = render(uncached->drawing, area, 300);
+        hide(*uncached);
+
+        // The first tile records the lists; the others replay them under a translation.
+        auto const tiled = render(cached->drawing, area, 64);
+        auto const again = render(cached->drawing, area, 48);
+
+        auto const [difference, painted] = compare(expected, tiled);
+        EXPECT_GT(painted, 1000);
+        EXPECT_LE(difference, 2);
+        EXPECT_LE(compare(expected, again).first, 2);
+    }
+    hide(*cached);
+}
+
+// Display lists give up their room in the cache budget when it shrinks.
+TEST_F(DrawingShapeTest, DisplayListsFollowBudget)
+{
+    auto const area = Geom::IntRect::from_xywh(0, 0, 300, 200);
+    auto view = show(std::size_t{64} << 20, Geom::identity());
+    auto const expected = render(view->drawing, area, 300);
+    auto const recorded = view->drawing.displayListBytes();
+    EXPECT_GT(recorded, 0u);
+
+    // Lists are dropped until the rest fit.
+    view->drawing.setCacheBudget(recorded - 1);
+    EXPECT_LT(view->drawing.displayListBytes(), recorded);
+
+    view->drawing.setCacheBudget(0);
+    EXPECT_EQ(view->drawing.displayListBytes(), 0u);
+    render(view->drawing, area, 64); // Nothing fits to be recorded again.
+    EXPECT_EQ(view->drawing.displayListBytes(), 0u);
+    EXPECT_LE(compare(expected, render(view->drawing, area, 64)).first, 2);
+    hide(*view);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
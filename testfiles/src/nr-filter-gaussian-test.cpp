@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests and benchmark for the blocked and box-filtered Gaussian blurs in display/nr-filter-gaussian.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+
+#include <cairo.h>
+#include <gtest/gtest.h>
+#include <src/display/nr-filter-gaussian.h>
+
+using Inkscape::Filters::box_blur_surface;
+using Inkscape::Filters::gaussian_blur_surface;
+
+namespace {
+
+// Random premultiplied contents, with some opaque areas so that flat regions are covered too.
+cairo_surface_t *create_random_surface(cairo_format_t format, int width, int height, std::mt19937 &rng)
+{
+    auto surface = cairo_image_surface_create(format, width, height);
+    auto data = cairo_image_surface_get_data(surface);
+    int const stride = cairo_image_surface_get_stride(surface);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            guint32 a = (x / 10 + y / 7) % 3 ? rng() & 0xff : 0xff;
+            if (format == CAIRO_FORMAT_A8) {
+                data[y * stride + x] = a;
+            } else {
+                guint32 r = rng() % (a + 1), g = rng() % (a + 1), b = rng() % (a + 1);
+                reinterpret_cast<guint32 *>(data + y * stride)[x] = (a << 24) | (r << 16) | (g << 8) | b;
+            }
+        }
+    }
+    cairo_surface_mark_dirty(surface);
+    return surface;
+}
+
+cairo_surface_t *copy_surface(cairo_surface_t *surface)
+{
+    auto copy = cairo_image_surface_create(cairo_image_surface_get_format(surface),
+                                           cairo_image_surface_get_width(surface),
+                                           cairo_image_surface_get_height(surface));
+    std::memcpy(cairo_image_surface_get_data(copy), cairo_image_surface_get_data(surface),
+                cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface));
+    cairo_surface_mark_dirty(copy);
+    return copy;
+}
+
+} // namespace
+
+TEST(NrFilterGaussianTest, BlockedMatchesPerLine)
+{
+    std::mt19937 rng(42);
+
+    // Deviations on both sides of the switch between FIR and IIR, and sizes that leave partial blocks.
+    for (auto format : {CAIRO_FORMAT_ARGB32, CAIRO_FORMAT_A8}) {
+        for (double deviation : {0.7, 1.5, 2.5, 7.0, 30.0}) {
+            for (auto [width, height] : {std::pair{1, 1}, {37, 53}, {300, 211}}) {
+                auto expected = create_random_surface(format, width, height, rng);
+                auto out = copy_surface(expected);
+                gaussian_blur_surface(expected, deviation, deviation * 0.7, false);
+                gaussian_blur_surface(out, deviation, deviation * 0.7, true);
+
+                int const stride = cairo_image_surface_get_stride(out);
+                int const row_bytes = format == CAIRO_FORMAT_A8 ? width : 4 * width;
+                auto const a = cairo_image_surface_get_data(expected);
+                auto const b = cairo_image_surface_get_data(out);
+                for (int y = 0; y < height; ++y) {
+                    ASSERT_EQ(std::memcmp(a + y * stride, b + y * stride, row_bytes), 0)
+                        << "format " << format << ", deviation " << deviation << ", size " << width << "x"
+                        << height << ", row " << y;
+                }
+
+                cairo_surface_destroy(expected);
+                cairo_surface_destroy(out);
+            }
+        }
+    }
+}
+
+TEST(NrFilterGaussianTest, BoxBlurCloseToExact)
+{
+    std::mt19937 rng(42);
+    constexpr int width = 301, height = 203;
+
+    // Random contents, and an opaque rectangle with hard edges and corners.
+    auto noise = create_random_surface(CAIRO_FORMAT_ARGB32, width, height, rng);
+    auto shape = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    auto ct = cairo_create(shape);
+    cairo_rectangle(ct, width / 2, height / 3, width, height);
+    cairo_fill(ct);
+    cairo_destroy(ct);
+
+    for (auto input : {noise, shape}) {
+        for (double deviation : {0.5, 1.5, 2.0, 5.0, 10.0, 30.0}) {
+            auto expected = copy_surface(input);
+            auto out = copy_surface(input);
+            gaussian_blur_surface(expected, deviation, deviation);
+            box_blur_surface(out, deviation, deviation);
+
+            int const stride = cairo_image_surface_get_stride(out);
+            auto const a = cairo_image_surface_get_data(expected);
+            auto const b = cairo_image_surface_get_data(out);
+            int max_error = 0;
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < 4 * width; ++x) {
+                    int const error = std::abs(a[y * stride + x] - b[y * stride + x]);
+                    max_error = std::max(max_error, error);
+                }
+            }
+            EXPECT_LE(max_error, 5) << "deviation " << deviation;
+
+            cairo_surface_destroy(expected);
+            cairo_surface_destroy(out);
+        }
+    }
+
+    cairo_surface_destroy(noise);
+    cairo_surface_destroy(shape);
+}
+
+TEST(NrFilterGaussianTest, DISABLED_Benchmark)
+{
+    // Compares the speed of the blocked and box blurs with the per-line blur, for profiling only.
+    constexpr int width = 2000, height = 1500, repeats = 3;
+    std::mt19937 rng(42);
+    auto surface = create_random_surface(CAIRO_FORMAT_ARGB32, width, height, rng);
+
+    struct Method
+    {
+        char const *name;
+        std::function<void(double)> run;
+    };
+    Method const methods[] = {
+        {"per line", [=](double deviation) { gaussian_blur_surface(surface, deviation, deviation, false); }},
+        {"blocked", [=](double deviation) { gaussian_blur_surface(surface, deviation, deviation, true); }},
+        {"box", [=](double deviation) { box_blur_surface(surface, deviation, deviation); }},
+    };
+
+    for (double deviation : {2.0, 20.0}) {
+        double per_line_time = 0;
+        for (auto const &method : methods) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repeats; ++i) {
+                method.run(deviation);
+            }
+            std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+            double ms = time.count() / repeats;
+            if (per_line_time == 0) {
+                per_line_time = ms;
+            }
+            std::cout << "deviation " << deviation << " [" << method.name << "]: " << ms << " ms, "
+                      << width * height / ms / 1000 << " Mpx/s, " << per_line_time / ms << "x per line"
+                      << std::endl;
+        }
+    }
+
+    cairo_surface_destroy(surface);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the filter renderer in display/nr-filter.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <cstring>
+#include <memory>
+
+#include <gtest/gtest.h>
+#include <cairomm/surface.h>
+
+#include <src/document.h>
+#include <src/inkscape.h>
+#include <src/display/drawing.h>
+#include <src/display/drawing-context.h>
+#include <src/display/drawing-surface.h>
+#include <src/display/nr-filter.h>
+#include <src/display/nr-filter-primitive.h>
+#include <src/object/filters/sp-filter-primitive.h>
+#include <src/object/sp-filter.h>
+#include <src/object/sp-root.h>
+
+using namespace Inkscape;
+
+namespace {
+
+// Two chains of per-pixel primitives: one ending in an arithmetic composite, and one read by
+// feTile, which tiles the subregion of the chain's last primitive. A dead primitive is skipped.
+char const *const svg = R"A(
+<svg xmlns="http://www.w3.org/2000/svg" width="120" height="100">
+  <defs>
+    <linearGradient id="grad" x1="0" y1="0" x2="1" y2="1">
+      <stop offset="0" stop-color="#ff8000"/>
+      <stop offset="1" stop-color="#2040c0" stop-opacity="0.6"/>
+    </linearGradient>
+    <filter id="f" x="0" y="0" width="1" height="1" color-interpolation-filters="sRGB">
+      <feColorMatrix type="saturate" values="0.3" result="a"/>
+      <feComponentTransfer in="a" result="b">
+        <feFuncR type="gamma" amplitude="1.2" exponent="0.8"/>
+        <feFuncA type="linear" slope="0.9"/>
+      </feComponentTransfer>
+      <feComposite in="b" in2="SourceGraphic" operator="arithmetic" k1="0.2" k2="0.6" k3="0.3" k4="0.05" result="c"/>
+      <feColorMatrix in="SourceGraphic" type="hueRotate" values="90" result="d"/>
+      <feComponentTransfer in="d" x="20" y="15" width="30" height="25" result="e">
+        <feFuncG type="table" tableValues="0 0.5 1"/>
+      </feComponentTransfer>
+      <feTile in="e" result="g"/>
+      <feOffset in="SourceGraphic" dx="5" result="unused"/>
+      <feMerge>
+        <feMergeNode in="c"/>
+        <feMergeNode in="g"/>
+      </feMerge>
+    </filter>
+  </defs>
+  <rect id="r" x="10" y="10" width="100" height="80" fill="url(#grad)" filter="url(#f)"/>
+</svg>)A";
+
+} // namespace
+
+TEST(NrFilterTest, OptimizeKeepsOutput)
+{
+    if (!Application::exists()) {
+        Application::create(false);
+    }
+
+    auto doc = std::unique_ptr<SPDocument>(SPDocument::createNewDocFromMem(svg, std::strlen(svg), false));
+    ASSERT_TRUE(doc);
+    doc->ensureUpToDate();
+    auto item = cast<SPItem>(doc->getObjectById("r"));
+    auto filter = cast<SPFilter>(doc->getObjectById("f"));
+    ASSERT_TRUE(item && filter);
+
+    Drawing drawing;
+    auto const dkey = SPItem::display_key_new(1);
+    drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+    drawing.setExact();
+    auto drawing_item = item->get_arenaitem(dkey);
+    ASSERT_TRUE(drawing_item);
+
+    // The renderer of the filter, as SPFilter::build_renderer() makes it, but optionally without planning.
+    auto const build = [&] (bool optimize) {
+        auto renderer = std::make_unique<Filters::Filter>();
+        renderer->set_filter_units(filter->filterUnits);
+        renderer->set_primitive_units(filter->primitiveUnits);
+        renderer->set_region(filter->x, filter->y, filter->width, filter->height);
+        filter->ensure_slots();
+        for (auto &child : filter->children) {
+            if (auto primitive = cast<SPFilterPrimitive>(&child)) {
+                renderer->add_primitive(primitive->build_renderer(drawing_item));
+            }
+        }
+        if (optimize) {
+            renderer->optimize();
+        }
+        return renderer;
+    };
+
+    auto const area = Geom::IntRect::from_xywh(0, 0, 120, 100);
+    auto const render = [&] {
+        drawing.update();
+        auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, area.width(), area.height());
+        auto ds = DrawingSurface(surface->cobj(), area.min());
+        auto dc = DrawingContext(ds);
+        drawing.render(dc, area);
+        surface->flush();
+        return surface;
+    };
+
+    drawing_item->setFilterRenderer(build(false));
+    auto const plain = render();
+    drawing_item->setFilterRenderer(build(true));
+    auto const optimized = render();
+
+    int differing = 0;
+    for (int y = 0; y < area.height(); y++) {
+        auto p = plain->get_data() + y * plain->get_stride();
+        auto q = optimized->get_data() + y * optimized->get_stride();
+        differing += std::memcmp(p, q, 4 * area.width()) != 0;
+    }
+    EXPECT_EQ(differing, 0) << "rows differ";
+
+    doc->getRoot()->invoke_hide(dkey);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
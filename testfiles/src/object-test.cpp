@@ -202,3 +202,49 @@ TEST_F(ObjectTest, Objects) {
     // Test hrefcount
     EXPECT_TRUE(path->isReferenced());
 }
+
+TEST_F(ObjectTest, FindByClassAndElement) {
+    ASSERT_TRUE(doc != nullptr);
+
+    auto circle = doc->getObjectById("C");
+    auto ellipse = doc->getObjectById("E");
+    auto line = doc->getObjectById("L");
+    circle->setAttribute("class", "a b");
+    ellipse->setAttribute("class", " b  c ");
+
+    using Objects = std::vector<SPObject *>;
+    EXPECT_EQ(doc->getObjectsByClass("a"), (Objects{circle}));
+    EXPECT_EQ(doc->getObjectsByClass("b"), (Objects{circle, ellipse}));
+    EXPECT_EQ(doc->getObjectsByClass("c"), (Objects{ellipse}));
+    EXPECT_TRUE(doc->getObjectsByClass("d").empty());
+
+    circle->setAttribute("class", "c");
+    line->setAttribute("class", "c");
+    EXPECT_TRUE(doc->getObjectsByClass("a").empty());
+    EXPECT_EQ(doc->getObjectsByClass("b"), (Objects{ellipse}));
+    EXPECT_EQ(doc->getObjectsByClass("c"), (Objects{circle, ellipse, line}));
+
+    EXPECT_EQ(doc->getObjectsByElement("circle"), (Objects{circle}));
+    EXPECT_EQ(doc->getObjectsByElement("stop").size(), 2u);
+    EXPECT_TRUE(doc->getObjectsByElement("circle", true).empty());
+
+    EXPECT_EQ(doc->getObjectsBySelector("g > .c"), (Objects{circle, ellipse, line}));
+    EXPECT_EQ(doc->getObjectsBySelector("ellipse.c"), (Objects{ellipse}));
+    EXPECT_EQ(doc->getObjectsBySelector("g circle"), (Objects{circle}));
+    EXPECT_EQ(doc->getObjectsBySelector("#E"), (Objects{ellipse}));
+    EXPECT_TRUE(doc->getObjectsBySelector("defs .c").empty());
+
+    // Clone children of <use> are never returned, whether or not the selector names a class or
+    // an element.
+    auto original = doc->getObjectById("P");
+    EXPECT_EQ(doc->getObjectsBySelector("#P"), (Objects{original}));
+    EXPECT_EQ(doc->getObjectsBySelector("path"), (Objects{original}));
+    for (auto object : doc->getObjectsBySelector("*")) {
+        EXPECT_FALSE(object->cloned);
+    }
+
+    // Deleted objects leave the indexes.
+    ellipse->deleteObject();
+    EXPECT_EQ(doc->getObjectsByClass("c"), (Objects{circle, line}));
+    EXPECT_TRUE(doc->getObjectsByElement("ellipse").empty());
+}
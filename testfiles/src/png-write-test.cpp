@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the PNG exporters in helper/png-write.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <cstring>
+#include <memory>
+
+#include <gtest/gtest.h>
+#include <glib/gstdio.h>
+#include <glibmm/fileutils.h>
+
+#include <src/document.h>
+#include <src/helper/png-write.h>
+#include <src/inkscape.h>
+#include <src/object/sp-item.h>
+
+namespace {
+
+char const *const svg_a = R"A(
+<svg xmlns="http://www.w3.org/2000/svg" width="100" height="80">
+  <defs>
+    <filter id="blur"><feGaussianBlur stdDeviation="3"/></filter>
+  </defs>
+  <rect id="r1" x="10" y="10" width="50" height="40" fill="#3060c0"/>
+  <circle id="c1" cx="60" cy="45" r="20" fill="#e04020" opacity="0.7" filter="url(#blur)"/>
+  <text id="t1" x="5" y="75" font-size="12">Export</text>
+</svg>)A";
+
+char const *const svg_b = R"A(
+<svg xmlns="http://www.w3.org/2000/svg" width="64" height="64">
+  <path id="p1" d="M 4,4 60,10 30,60 Z" fill="#20a040" stroke="black" stroke-width="2"/>
+</svg>)A";
+
+class PngWriteTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if (!Inkscape::Application::exists()) {
+            Inkscape::Application::create(false);
+        }
+    }
+
+    void TearDown() override
+    {
+        for (auto const &path : files) {
+            g_unlink(path.c_str());
+        }
+    }
+
+    std::string filename(std::string const &name)
+    {
+        auto path = "PngWriteTest_" + name + ".png";
+        files.push_back(path);
+        return path;
+    }
+
+    static std::unique_ptr<SPDocument> open(char const *svg)
+    {
+        return std::unique_ptr<SPDocument>(SPDocument::createNewDocFromMem(svg, std::strlen(svg), false));
+    }
+
+    static std::string contents(std::string const &path)
+    {
+        try {
+            return Glib::file_get_contents(path);
+        } catch (Glib::FileError const &) {
+            return {};
+        }
+    }
+
+    std::vector<std::string> files;
+};
+
+} // namespace
+
+// Exports queued from several documents and ids render concurrently, but give the same files as
+// exporting them one after another.
+TEST_F(PngWriteTest, QueueMatchesSequentialExport)
+{
+    auto doc_a = open(svg_a);
+    auto doc_b = open(svg_b);
+    ASSERT_TRUE(doc_a && doc_b);
+    doc_a->ensureUpToDate();
+    doc_b->ensureUpToDate();
+
+    struct Export
+    {
+        SPDocument *doc;
+        Geom::Rect area;
+        unsigned long width, height;
+        std::vector<SPItem *> items_only;
+    };
+    auto const item = [] (SPDocument *doc, char const *id) { return cast<SPItem>(doc->getObjectById(id)); };
+    std::vector<Export> const exports = {
+        { doc_a.get(), Geom::Rect(0, 0, 100, 80), 100, 80, {} },
+        { doc_a.get(), Geom::Rect(0, 0, 100, 80), 250, 200, {} },
+        { doc_a.get(), Geom::Rect(30, 15, 90, 75), 120, 120, { item(doc_a.get(), "c1") } },
+        { doc_b.get(), Geom::Rect(0, 0, 64, 64), 128, 128, {} },
+        { doc_b.get(), Geom::Rect(0, 0, 64, 64), 31, 17, {} },
+    };
+
+    PngExportQueue queue(3, std::size_t{1} << 30, 0);
+    for (std::size_t i = 0; i < exports.size(); i++) {
+        auto const &e = exports[i];
+        queue.add(e.doc, filename("queued" + std::to_string(i)), e.area, e.width, e.height, 96, 96,
+                  0xffffff00, e.items_only);
+    }
+    EXPECT_EQ(queue.finish(), 0);
+
+    for (std::size_t i = 0; i < exports.size(); i++) {
+        auto const &e = exports[i];
+        auto const sequential = filename("sequential" + std::to_string(i));
+        ASSERT_EQ(sp_export_png_file(e.doc, sequential.c_str(), e.area, e.width, e.height, 96, 96, 0xffffff00,
+                                     nullptr, nullptr, true, e.items_only),
+                  EXPORT_OK);
+        auto const expected = contents(sequential);
+        ASSERT_FALSE(expected.empty());
+        EXPECT_EQ(contents(files[i]), expected) << "export " << i;
+    }
+}
+
+// A full queue blocks the caller until there is room, and finish() reports failed exports.
+TEST_F(PngWriteTest, QueueReportsFailures)
+{
+    auto doc = open(svg_b);
+    ASSERT_TRUE(doc);
+
+    PngExportQueue queue(1, 1, 0); // Room for one export at a time.
+    auto const area = Geom::Rect(0, 0, 64, 64);
+    queue.add(doc.get(), filename("ok"), area, 64, 64, 96, 96, 0);
+    queue.add(doc.get(), "PngWriteTest_no_such_directory/out.png", area, 64, 64, 96, 96, 0);
+    queue.add(doc.get(), filename("ok2"), area, 64, 64, 96, 96, 0);
+    EXPECT_EQ(queue.finish(), 1);
+    EXPECT_FALSE(contents(files[0]).empty());
+    EXPECT_FALSE(contents(files[1]).empty());
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the job protocol and document cache of the export server in io/render-server.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <gtest/gtest.h>
+#include <glib/gstdio.h>
+
+#include <src/document.h>
+#include <src/inkscape.h>
+#include <src/io/file-export-cmd.h>
+#include <src/io/render-server.h>
+
+using Inkscape::RenderDocumentCache;
+using Inkscape::RenderServer;
+
+TEST(RenderServerTest, ParseJob)
+{
+    InkFileExportCmd job;
+    std::string file;
+    EXPECT_EQ(RenderServer::parse_job("file:a.svg; export-id:icon; export-dpi : 192;export-filename:C:\\out\\icon.png; export-id-only",
+                                      job, file), "");
+    EXPECT_EQ(file, "a.svg");
+    EXPECT_EQ(job.export_id, "icon");
+    EXPECT_DOUBLE_EQ(job.export_dpi, 192);
+    EXPECT_EQ(job.export_filename, "C:\\out\\icon.png"); // Only split at the first colon.
+    EXPECT_TRUE(job.export_id_only);
+
+    InkFileExportCmd unknown;
+    EXPECT_EQ(RenderServer::parse_job("file:a.svg; export-filename:a.png; export-foo:1", unknown, file),
+              "unknown option export-foo");
+
+    InkFileExportCmd invalid;
+    EXPECT_EQ(RenderServer::parse_job("file:a.svg; export-filename:a.png; export-width:wide", invalid, file),
+              "invalid value for export-width");
+
+    InkFileExportCmd no_file;
+    file.clear();
+    EXPECT_EQ(RenderServer::parse_job("export-filename:a.png", no_file, file), "no file given");
+
+    InkFileExportCmd no_output;
+    EXPECT_EQ(RenderServer::parse_job("file:a.svg", no_output, file), "no export-filename given");
+
+    InkFileExportCmd png;
+    EXPECT_EQ(RenderServer::parse_job("file:a.svg; export-filename:a.png; export-png-threads:4; "
+                                      "export-png-color-mode:Gray_8; export-png-use-dithering:false", png, file), "");
+    EXPECT_EQ(png.export_png_threads, 4);
+    EXPECT_EQ(png.export_png_color_mode, "Gray_8");
+    EXPECT_FALSE(png.export_png_use_dithering);
+}
+
+TEST(RenderServerTest, SeedJob)
+{
+    InkFileExportCmd defaults;
+    defaults.export_filename = "server.png";
+    defaults.export_id = "server";
+    defaults.export_dpi = 300;
+    defaults.export_png_threads = 8;
+    defaults.export_png_use_dithering = false;
+    defaults.export_png_color_mode = "RGB_8";
+
+    InkFileExportCmd job;
+    RenderServer::seed_job(job, defaults);
+    std::string file;
+    EXPECT_EQ(RenderServer::parse_job("file:a.svg; export-filename:a.png; export-png-threads:2", job, file), "");
+
+    // Given by the job.
+    EXPECT_EQ(job.export_filename, "a.png");
+    EXPECT_EQ(job.export_png_threads, 2);
+    // Not inherited, as it names what to export.
+    EXPECT_TRUE(job.export_id.empty());
+    // Inherited from the server.
+    EXPECT_DOUBLE_EQ(job.export_dpi, 300);
+    EXPECT_FALSE(job.export_png_use_dithering);
+    EXPECT_EQ(job.export_png_color_mode, "RGB_8");
+}
+
+TEST(RenderServerTest, KeepsDocument)
+{
+    auto const keeps = [] (Glib::ustring const &line) {
+        InkFileExportCmd job;
+        std::string file;
+        EXPECT_EQ(RenderServer::parse_job(line, job, file), "");
+        return RenderServer::keeps_document(job);
+    };
+
+    EXPECT_TRUE(keeps("file:a.svg; export-filename:out/a.PNG"));
+    EXPECT_TRUE(keeps("file:a.svg; export-filename:out/a; export-type:png"));
+    EXPECT_FALSE(keeps("file:a.svg; export-filename:a.svg"));
+    EXPECT_FALSE(keeps("file:a.svg; export-filename:a.pdf"));
+    EXPECT_FALSE(keeps("file:a.svg; export-filename:a; export-type:png,svg"));
+    EXPECT_FALSE(keeps("file:a.svg; export-filename:out.d/a")); // SVG by default.
+}
+
+class RenderDocumentCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if (!Inkscape::Application::exists()) {
+            Inkscape::Application::create(false);
+        }
+    }
+
+    void TearDown() override
+    {
+        for (auto const &path : files) {
+            g_unlink(path.c_str());
+        }
+    }
+
+    std::string write(std::string const &name, int width)
+    {
+        auto path = "RenderDocumentCacheTest_" + name + ".svg";
+        auto const content = "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" + std::to_string(width) + "\" height=\"10\"/>";
+        g_file_set_contents(path.c_str(), content.c_str(), content.size(), nullptr);
+        files.push_back(path);
+        return path;
+    }
+
+    RenderDocumentCache make_cache(std::size_t max_documents)
+    {
+        return RenderDocumentCache(
+            [this] (std::string const &path) {
+                opened++;
+                return SPDocument::createNewDoc(path.c_str(), false);
+            },
+            [this] (SPDocument *document) {
+                closed++;
+                delete document;
+            },
+            max_documents);
+    }
+
+    std::vector<std::string> files;
+    int opened = 0;
+    int closed = 0;
+};
+
+TEST_F(RenderDocumentCacheTest, ReusesUnchangedDocuments)
+{
+    auto const a = write("a", 10);
+    std::string error;
+    {
+        auto cache = make_cache(4);
+        auto doc = cache.get(a, error);
+        ASSERT_TRUE(doc);
+        EXPECT_EQ(cache.get(a, error), doc);
+        EXPECT_EQ(opened, 1);
+
+        // Changed on disk: parsed again.
+        write("a", 1000);
+        ASSERT_TRUE(cache.get(a, error));
+        EXPECT_EQ(opened, 2);
+        EXPECT_EQ(closed, 1);
+
+        // Rewritten with the same size within the same second: parsed again.
+        g_usleep(50000);
+        write("a", 2000);
+        ASSERT_TRUE(cache.get(a, error));
+        EXPECT_EQ(opened, 3);
+        EXPECT_EQ(closed, 2);
+
+        cache.evict(a);
+        EXPECT_EQ(cache.size(), 0u);
+        EXPECT_EQ(closed, 3);
+
+        EXPECT_FALSE(cache.get("RenderDocumentCacheTest_missing.svg", error));
+        EXPECT_FALSE(error.empty());
+
+        ASSERT_TRUE(cache.get(a, error));
+    }
+    // Closed with the cache.
+    EXPECT_EQ(closed, opened);
+}
+
+TEST_F(RenderDocumentCacheTest, ClosesLeastRecentlyUsed)
+{
+    auto const a = write("a", 10);
+    auto const b = write("b", 10);
+    auto const c = write("c", 10);
+    std::string error;
+
+    auto cache = make_cache(2);
+    auto doc_a = cache.get(a, error);
+    cache.get(b, error);
+    EXPECT_EQ(cache.get(a, error), doc_a);
+    cache.get(c, error); // Closes b, used less recently than a.
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(closed, 1);
+
+    EXPECT_EQ(cache.get(a, error), doc_a);
+    EXPECT_EQ(opened, 3);
+    cache.get(b, error);
+    EXPECT_EQ(opened, 4);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -15,8 +15,10 @@
 #include <doc-per-case-test.h>
 
 #include <src/style.h>
+#include <src/style-rule-index.h>
 #include <src/object/sp-root.h>
 #include <src/object/sp-style-elem.h>
+#include <src/xml/croco-node-iface.h>
 
 using namespace Inkscape;
 using namespace Inkscape::XML;
@@ -69,3 +71,69 @@ TEST_F(ObjectTest, StyleElems) {
         EXPECT_EQ(style->fill.get_value(), Glib::ustring("#008000"));
     }
 }
+
+/*
+ * The rule index must give every element the same properties as libcroco's own matching.
+ */
+TEST_F(ObjectTest, StyleRuleIndex) {
+    char const *docString = R"A(
+<svg xmlns="http://www.w3.org/2000/svg">
+  <style>
+    * { stroke-width: 2; }
+    rect { fill: red; opacity: 0.5; }
+    .a { fill: green; }
+    .a.b, #r3 { fill: blue !important; stroke: black; }
+    g > .b { opacity: 0.25; }
+    g rect:first-child { stroke-linecap: round; }
+    [data-x] { stroke-dasharray: 1 2; }
+  </style>
+  <style>
+    rect.c, circle { fill: yellow; }
+    #g2 .a { stroke: white; }
+  </style>
+  <g id="g1">
+    <rect id="r1" class="a"/>
+    <rect id="r2" class="a b"/>
+    <rect id="r3" class=" b  a "/>
+    <rect id="r4" class="c" data-x="1"/>
+    <circle id="c1" class="b"/>
+  </g>
+  <g id="g2">
+    <rect id="r5" class="a"/>
+    <rect id="r6" class="a"/>
+    <text id="t1" class="a">x<tspan id="s1" class="b">y</tspan></text>
+  </g>
+</svg>)A";
+    doc.reset(SPDocument::createNewDocFromMem(docString, static_cast<int>(strlen(docString)), false));
+    ASSERT_TRUE(doc != nullptr);
+
+    auto sel_eng = cr_sel_eng_new(&Inkscape::XML::croco_node_iface);
+    auto &index = doc->getStyleRuleIndex();
+
+    auto const dump = [] (CRPropList *props) {
+        std::vector<CRDeclaration *> decls;
+        for (auto cur = props; cur; cur = cr_prop_list_get_next(cur)) {
+            CRDeclaration *decl = nullptr;
+            cr_prop_list_get_decl(cur, &decl);
+            decls.push_back(decl);
+        }
+        cr_prop_list_destroy(props);
+        return decls;
+    };
+
+    // Twice, the second time from the remembered matches.
+    for (int pass = 0; pass < 2; pass++) {
+        for (auto id : {"g1", "r1", "r2", "r3", "r4", "c1", "g2", "r5", "r6", "t1", "s1"}) {
+            auto repr = doc->getObjectById(id)->getRepr();
+
+            CRPropList *expected = nullptr;
+            cr_sel_eng_get_matched_properties_from_cascade(sel_eng, doc->getStyleCascade(), repr, &expected);
+            CRPropList *actual = nullptr;
+            EXPECT_EQ(index.getMatchedProperties(sel_eng, repr, &actual), CR_OK);
+
+            EXPECT_EQ(dump(actual), dump(expected)) << id;
+        }
+    }
+
+    cr_sel_eng_destroy(sel_eng);
+}
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the surface pool in display/surface-pool.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <cstring>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <cairo.h>
+#include <gtest/gtest.h>
+#include <src/display/surface-pool.h>
+
+using Inkscape::SurfacePool;
+
+namespace {
+
+void fill(cairo_surface_t *surface, unsigned char value)
+{
+    std::memset(cairo_image_surface_get_data(surface), value,
+                cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface));
+    cairo_surface_mark_dirty(surface);
+}
+
+bool is_clear(cairo_surface_t *surface)
+{
+    auto const data = cairo_image_surface_get_data(surface);
+    int const size = cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface);
+    for (int i = 0; i < size; ++i) {
+        if (data[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(SurfacePoolTest, ReusesBuffers)
+{
+    // Run on a fresh thread, so that its pool starts out empty.
+    std::thread([] {
+        SurfacePool::reset_stats();
+
+        auto a = SurfacePool::create(CAIRO_FORMAT_ARGB32, 300, 200);
+        ASSERT_EQ(cairo_surface_status(a), CAIRO_STATUS_SUCCESS);
+        EXPECT_TRUE(is_clear(a));
+        fill(a, 0xff);
+        auto const data = cairo_image_surface_get_data(a);
+        cairo_surface_destroy(a);
+
+        // Slightly smaller sizes fall into the same bucket, and must come back cleared.
+        auto b = SurfacePool::create(CAIRO_FORMAT_ARGB32, 299, 199);
+        EXPECT_EQ(cairo_image_surface_get_data(b), data);
+        EXPECT_EQ(cairo_image_surface_get_width(b), 299);
+        EXPECT_EQ(cairo_image_surface_get_height(b), 199);
+        EXPECT_TRUE(is_clear(b));
+
+        // While b is alive, its buffer is not handed out again.
+        auto c = SurfacePool::create(CAIRO_FORMAT_ARGB32, 300, 200);
+        EXPECT_NE(cairo_image_surface_get_data(c), data);
+
+        // Much larger sizes use a different bucket.
+        auto d = SurfacePool::create(CAIRO_FORMAT_A8, 1000, 1000);
+        EXPECT_EQ(cairo_image_surface_get_format(d), CAIRO_FORMAT_A8);
+
+        cairo_surface_destroy(b);
+        cairo_surface_destroy(c);
+        cairo_surface_destroy(d);
+
+        auto stats = SurfacePool::stats();
+        EXPECT_EQ(stats.hits, 1u);
+        EXPECT_EQ(stats.misses, 3u);
+    }).join();
+}
+
+// Long-lived threads together keep no more than the global limit of idle buffers.
+TEST(SurfacePoolTest, LimitsTotalIdleMemory)
+{
+    std::size_t const before = SurfacePool::idle_bytes();
+    int const per_thread = SurfacePool::max_idle_bytes() / (4 << 20); // Surfaces of 4 MiB.
+    int const num_threads = SurfacePool::max_total_idle_bytes() / SurfacePool::max_idle_bytes() + 2;
+
+    std::promise<void> exit;
+    auto const exiting = exit.get_future().share();
+    std::vector<std::promise<void>> returned(num_threads);
+    std::vector<std::future<void>> all_returned;
+    for (auto &r : returned) {
+        all_returned.push_back(r.get_future());
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([&, i] {
+            std::vector<cairo_surface_t *> surfaces;
+            for (int j = 0; j < per_thread; j++) {
+                surfaces.push_back(SurfacePool::create(CAIRO_FORMAT_ARGB32, 1024, 1024));
+            }
+            for (auto surface : surfaces) {
+                cairo_surface_destroy(surface);
+            }
+            returned[i].set_value();
+            exiting.wait();
+        });
+    }
+
+    for (auto &r : all_returned) {
+        r.wait();
+    }
+    EXPECT_LE(SurfacePool::idle_bytes(), SurfacePool::max_total_idle_bytes());
+    EXPECT_GT(SurfacePool::idle_bytes(), before);
+
+    // Released when the threads exit.
+    exit.set_value();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(SurfacePool::idle_bytes(), before);
+}
+
+TEST(SurfacePoolTest, CreateSimilarKeepsDeviceScale)
+{
+    auto other = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 10, 10);
+    cairo_surface_set_device_scale(other, 2, 2);
+
+    auto similar = SurfacePool::create_similar(other, CAIRO_CONTENT_ALPHA, 50, 30);
+    double x_scale = 0, y_scale = 0;
+    cairo_surface_get_device_scale(similar, &x_scale, &y_scale);
+    EXPECT_EQ(x_scale, 2);
+    EXPECT_EQ(y_scale, 2);
+    EXPECT_EQ(cairo_image_surface_get_format(similar), CAIRO_FORMAT_A8);
+    EXPECT_EQ(cairo_image_surface_get_width(similar), 100);
+    EXPECT_EQ(cairo_image_surface_get_height(similar), 60);
+    EXPECT_TRUE(is_clear(similar));
+
+    cairo_surface_destroy(similar);
+    cairo_surface_destroy(other);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the cache of rendered canvas tiles in ui/widget/canvas/tilecache.h
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2024 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+#include <2geom/transforms.h>
+
+#include <src/ui/widget/canvas/tilecache.h>
+
+using namespace Inkscape::UI::Widget;
+
+namespace {
+
+constexpr int tile_size = 64;
+constexpr std::size_t tile_bytes = 4 * tile_size * tile_size;
+
+Cairo::RefPtr<Cairo::ImageSurface> make_surface(unsigned char value)
+{
+    auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, tile_size, tile_size);
+    surface->flush();
+    std::fill_n(surface->get_data(), surface->get_stride() * tile_size, value);
+    surface->mark_dirty();
+    return surface;
+}
+
+Fragment tile_at(Geom::Affine const &affine, int x, int y)
+{
+    return { affine, Geom::IntRect::from_xywh(x, y, tile_size, tile_size) };
+}
+
+Fragment store_at(Geom::Affine const &affine)
+{
+    return { affine, Geom::IntRect::from_xywh(0, 0, 1024, 1024) };
+}
+
+std::vector<Geom::IntRect> rects(std::vector<TileCache::Tile> const &tiles)
+{
+    std::vector<Geom::IntRect> result;
+    for (auto const &tile : tiles) {
+        result.push_back(tile.fragment.rect);
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(TileCacheTest, FindsTilesOfTheSameAffine)
+{
+    auto const zoom1 = Geom::Affine(Geom::Scale(1));
+    auto const zoom2 = Geom::Affine(Geom::Scale(2));
+
+    TileCache cache;
+    cache.set_max_bytes(16 * tile_bytes);
+    auto const original = make_surface(0x40);
+    cache.insert(tile_at(zoom1, 0, 0), original, {});
+    cache.insert(tile_at(zoom2, 0, 0), make_surface(0x80), {});
+
+    // The cache holds a copy.
+    original->flush();
+    std::fill_n(original->get_data(), original->get_stride() * tile_size, 0xff);
+    original->mark_dirty();
+
+    auto found = cache.find(store_at(zoom1));
+    ASSERT_EQ(found.size(), 1u);
+    EXPECT_EQ(found[0].fragment.rect, tile_at(zoom1, 0, 0).rect);
+    EXPECT_EQ(found[0].surface->get_data()[0], 0x40);
+    EXPECT_FALSE(found[0].outline_surface);
+
+    // Only tiles lying entirely within the store are found.
+    EXPECT_TRUE(cache.find({ zoom1, Geom::IntRect::from_xywh(32, 0, 1024, 1024) }).empty());
+    EXPECT_TRUE(cache.find(store_at(Geom::Scale(3))).empty());
+}
+
+TEST(TileCacheTest, EvictsLeastRecentlyUsed)
+{
+    auto const affine = Geom::Affine();
+
+    TileCache cache;
+    cache.set_max_bytes(2 * tile_bytes);
+    cache.insert(tile_at(affine, 0, 0), make_surface(1), {});
+    cache.insert(tile_at(affine, 64, 0), make_surface(2), {});
+
+    // Finding a tile makes it the most recently used.
+    cache.find({ affine, tile_at(affine, 0, 0).rect });
+    cache.insert(tile_at(affine, 128, 0), make_surface(3), {});
+    EXPECT_EQ(rects(cache.find(store_at(affine))), (std::vector{ tile_at(affine, 128, 0).rect, tile_at(affine, 0, 0).rect }));
+
+    // An outline surface counts too.
+    cache.insert(tile_at(affine, 192, 0), make_surface(4), make_surface(5));
+    EXPECT_EQ(rects(cache.find(store_at(affine))), (std::vector{ tile_at(affine, 192, 0).rect }));
+
+    // Lowering the limit evicts, and zero disables the cache.
+    cache.set_max_bytes(0);
+    EXPECT_TRUE(cache.find(store_at(affine)).empty());
+    cache.insert(tile_at(affine, 0, 0), make_surface(1), {});
+    EXPECT_TRUE(cache.find(store_at(affine)).empty());
+}
+
+TEST(TileCacheTest, NewTilesSupersedeOldOnes)
+{
+    auto const affine = Geom::Affine();
+
+    TileCache cache;
+    cache.set_max_bytes(16 * tile_bytes);
+    cache.insert({ affine, Geom::IntRect::from_xywh(0, 0, 32, 32) }, Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, 32, 32), {});
+    cache.insert(tile_at(affine, 0, 0), make_surface(1), {});
+    EXPECT_EQ(rects(cache.find(store_at(affine))), (std::vector{ tile_at(affine, 0, 0).rect }));
+}
+
+TEST(TileCacheTest, InvalidatesAtEveryAffine)
+{
+    auto const zoom1 = Geom::Affine(Geom::Scale(1));
+    auto const zoom4 = Geom::Affine(Geom::Scale(4));
+
+    TileCache cache;
+    cache.set_max_bytes(16 * tile_bytes);
+    for (int x = 0; x < 4 * tile_size; x += tile_size) {
+        cache.insert(tile_at(zoom1, x, 0), make_surface(1), {});
+    }
+    for (int x = 0; x < 8 * tile_size; x += tile_size) {
+        cache.insert(tile_at(zoom4, x, 0), make_surface(1), {});
+    }
+
+    // At zoom 1, one tile is touched; at zoom 4 the damage is four times as wide, plus a margin.
+    cache.invalidate(Geom::IntRect::from_xywh(70, 10, 20, 20), zoom1);
+    EXPECT_EQ(rects(cache.find(store_at(zoom1))).size(), 3u);
+    for (auto const &rect : rects(cache.find(store_at(zoom1)))) {
+        EXPECT_NE(rect, tile_at(zoom1, 64, 0).rect);
+    }
+    auto const left = rects(cache.find(store_at(zoom4)));
+    EXPECT_EQ(left.size(), 4u);
+    for (auto const &rect : left) {
+        EXPECT_FALSE(rect.intersects(Geom::IntRect(280 - 64, 40 - 64, 360 + 64, 120 + 64)));
+    }
+}
+
+TEST(TileCacheTest, ClearStartsNewGeneration)
+{
+    auto const affine = Geom::Affine();
+
+    TileCache cache;
+    cache.set_max_bytes(16 * tile_bytes);
+    cache.insert(tile_at(affine, 0, 0), make_surface(1), {});
+    auto const generation = cache.generation();
+    cache.clear();
+    EXPECT_NE(cache.generation(), generation);
+    EXPECT_TRUE(cache.find(store_at(affine)).empty());
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -12,8 +12,20 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <zlib.h>
+
 #include "gtest/gtest.h"
+#include "attributes.h"
 #include "xml/repr.h"
+#include "xml/document.h"
 
 TEST(XmlTest, nodeiter)
 {
@@ -72,6 +84,265 @@ TEST(XmlTest, nodeiter)
     ASSERT_EQ(testdoc->root()->findChildPath(path), nullptr);
 }
 
+TEST(XmlTest, AttributeLookup)
+{
+    auto doc = sp_repr_document_new("svg:svg");
+    auto node = doc->createElement("svg:rect");
+
+    node->setAttribute(SPAttr::WIDTH, "10");
+    node->setAttribute(g_quark_from_static_string("height"), "20");
+    EXPECT_STREQ(node->attribute("width"), "10");
+    EXPECT_STREQ(node->attribute(SPAttr::HEIGHT), "20");
+    EXPECT_STREQ(node->attribute(g_quark_from_static_string("width")), "10");
+    EXPECT_EQ(node->attribute("never-interned-attribute-name"), nullptr);
+    EXPECT_EQ(node->attribute(SPAttr::X), nullptr);
+
+    // Enough attributes for the node to index them, then remove some of them again.
+    for (int i = 0; i < 40; i++) {
+        node->setAttribute("data-" + std::to_string(i), std::to_string(i));
+    }
+    for (int i = 0; i < 40; i += 3) {
+        node->removeAttribute("data-" + std::to_string(i));
+    }
+    node->removeAttribute("width");
+    for (int i = 0; i < 40; i++) {
+        auto const value = node->attribute(("data-" + std::to_string(i)).c_str());
+        if (i % 3 == 0) {
+            EXPECT_EQ(value, nullptr) << i;
+        } else {
+            ASSERT_TRUE(value) << i;
+            EXPECT_EQ(std::string(value), std::to_string(i));
+        }
+    }
+    EXPECT_EQ(node->attribute(SPAttr::WIDTH), nullptr);
+    EXPECT_STREQ(node->attribute(SPAttr::HEIGHT), "20");
+
+    // Copies keep working lookups.
+    auto copy = node->duplicate(doc);
+    EXPECT_STREQ(copy->attribute("data-1"), "1");
+    EXPECT_EQ(copy->attribute("data-3"), nullptr);
+
+    Inkscape::GC::release(copy);
+    Inkscape::GC::release(node);
+    Inkscape::GC::release(doc);
+}
+
+namespace {
+
+std::string read_and_save(char const *xml, bool streaming)
+{
+    auto doc = sp_repr_read_mem(xml, std::strlen(xml), SP_SVG_NS_URI, streaming);
+    if (!doc) {
+        return "(null)";
+    }
+    auto result = sp_repr_save_buf(doc).raw();
+    Inkscape::GC::release(doc);
+    return result;
+}
+
+#ifdef __linux__
+long proc_status_kb(char const *key)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind(key, 0) == 0) {
+            return std::stol(line.substr(std::strlen(key)));
+        }
+    }
+    return -1;
+}
+#endif
+
+} // namespace
+
+TEST(XmlTest, StreamingReaderMatchesTree)
+{
+    char const *documents[] = {
+        "",
+        "<svg",
+        "<svg><g>unclosed",
+        "<svg/>",
+        "<?xml version='1.0'?>\n<!-- before -->\n<svg><?pi data?></svg>\n<!-- after -->",
+        R"(<svg xmlns="http://www.w3.org/2000/svg" xmlns:xlink="http://www.w3.org/1999/xlink"
+                xmlns:inkscape="http://www.inkscape.org/namespaces/inkscape" inkscape:version="1.3">
+             <g id="g1" inkscape:label="Layer &amp; 1"><use xlink:href="#r"/></g>
+             <text xml:space="preserve">  <tspan>  a  </tspan>  </text>
+             <text>   </text>
+             <style><![CDATA[ rect { fill: red } ]]><![CDATA[ circle {} ]]></style>
+             <rect id="r" width="1" height="1"/>
+             <unknown:e xmlns:unknown="http://example.org/unknown" unknown:a="1"/>
+             <undeclared:e undeclared:a="1"/>
+           </svg>)",
+        R"(<!DOCTYPE svg [ <!-- in the DTD --> <!ATTLIST svg defaulted CDATA "value"> ]>
+           <svg width="10"/>)",
+        "<svg xmlns=\"http://example.org/not-svg\"><g/></svg>",
+        "<a/><b/>",
+    };
+    for (auto xml : documents) {
+        EXPECT_EQ(read_and_save(xml, true), read_and_save(xml, false)) << xml;
+    }
+}
+
+TEST(XmlTest, StreamingReaderEntities)
+{
+    // The tree reader only keeps the text of an attribute up to the first entity reference.
+    char const *xml = R"(<!DOCTYPE svg [ <!ENTITY e "entity"> ]>
+                         <svg a="x &amp; &e; y"><text>x &e; y</text></svg>)";
+    auto doc = sp_repr_read_mem(xml, std::strlen(xml), SP_SVG_NS_URI);
+    ASSERT_TRUE(doc);
+    EXPECT_STREQ(doc->root()->attribute("a"), "x & entity y");
+    EXPECT_STREQ(doc->root()->firstChild()->firstChild()->content(), "x entity y");
+    Inkscape::GC::release(doc);
+
+    // References within entities are expanded too.
+    char const *nested = R"(<!DOCTYPE svg [ <!ENTITY a "x"> <!ENTITY b "&a;y&amp;&#38;#38;"> ]>
+                            <svg a="&b;"><text>&b;</text></svg>)";
+    doc = sp_repr_read_mem(nested, std::strlen(nested), SP_SVG_NS_URI);
+    ASSERT_TRUE(doc);
+    EXPECT_STREQ(doc->root()->attribute("a"), "xy&&");
+    EXPECT_STREQ(doc->root()->firstChild()->firstChild()->content(), "xy&&");
+    Inkscape::GC::release(doc);
+
+    // But not without limit.
+    std::string laughs = "<!DOCTYPE svg [ <!ENTITY l0 \"lol\">";
+    for (int i = 1; i < 20; i++) {
+        laughs += " <!ENTITY l" + std::to_string(i) + " \"" ;
+        for (int j = 0; j < 4; j++) {
+            laughs += "&l" + std::to_string(i - 1) + ";";
+        }
+        laughs += "\">";
+    }
+    laughs += " ]><svg><text>&l19;</text></svg>";
+    doc = sp_repr_read_mem(laughs.c_str(), laughs.size(), SP_SVG_NS_URI);
+    if (doc) {
+        auto const text = doc->root()->firstChild() ? doc->root()->firstChild()->firstChild() : nullptr;
+        EXPECT_LE(text ? std::strlen(text->content()) : 0, std::size_t{11} << 20);
+        Inkscape::GC::release(doc);
+    }
+}
+
+// Reading from files, compressed or in other encodings, gives the same either way.
+TEST(XmlTest, StreamingReaderMatchesTreeForFiles)
+{
+    auto const tmp = g_dir_make_tmp("xml-test-XXXXXX", nullptr);
+    ASSERT_TRUE(tmp);
+    std::string const dir = tmp;
+    g_free(tmp);
+    std::vector<std::string> files;
+    auto const path = [&] (char const *name) {
+        files.push_back(dir + G_DIR_SEPARATOR_S + name);
+        return files.back();
+    };
+
+    std::string const svg = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                            "<svg xmlns=\"http://www.w3.org/2000/svg\"><text id=\"t\">gr\xc3\xbc\xc3\x9f</text></svg>\n";
+
+    auto const plain = path("plain.svg");
+    g_file_set_contents(plain.c_str(), svg.c_str(), svg.size(), nullptr);
+
+    auto const bom = path("bom.svg");
+    auto const with_bom = "\xef\xbb\xbf" + svg;
+    g_file_set_contents(bom.c_str(), with_bom.c_str(), with_bom.size(), nullptr);
+
+    // Switches the parser to the encoding of the byte order mark.
+    auto const utf16 = path("utf16.svg");
+    {
+        std::string text = svg;
+        text.replace(text.find("UTF-8"), 5, "UTF-16");
+        gsize length = 0;
+        auto const converted = g_convert(text.c_str(), text.size(), "UTF-16LE", "UTF-8", nullptr, &length, nullptr);
+        ASSERT_TRUE(converted);
+        auto const contents = std::string("\xff\xfe") + std::string(converted, length);
+        g_free(converted);
+        g_file_set_contents(utf16.c_str(), contents.c_str(), contents.size(), nullptr);
+    }
+
+    auto const gzipped = path("gzipped.svgz");
+    {
+        auto const gz = gzopen(gzipped.c_str(), "wb");
+        ASSERT_TRUE(gz);
+        gzwrite(gz, svg.c_str(), svg.size());
+        gzclose(gz);
+    }
+
+    // Read through a libxml2 tree after all, which resolves the include relative to the file.
+    auto const part = path("part.svg");
+    std::string const part_svg = "<g xmlns=\"http://www.w3.org/2000/svg\" id=\"included\"/>";
+    g_file_set_contents(part.c_str(), part_svg.c_str(), part_svg.size(), nullptr);
+    auto const xinclude = path("xinclude.svg");
+    std::string const xinclude_svg = "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xi=\"http://www.w3.org/2001/XInclude\">"
+                                     "<rect id=\"before\"/><xi:include href=\"part.svg\"/></svg>";
+    g_file_set_contents(xinclude.c_str(), xinclude_svg.c_str(), xinclude_svg.size(), nullptr);
+
+    auto const read = [] (std::string const &filename, bool streaming) -> std::string {
+        auto doc = sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI, streaming);
+        if (!doc) {
+            return "(null)";
+        }
+        auto result = sp_repr_save_buf(doc).raw();
+        Inkscape::GC::release(doc);
+        return result;
+    };
+
+    auto const expected = read(plain, false);
+    EXPECT_NE(expected.find("gr\xc3\xbc\xc3\x9f"), std::string::npos);
+    for (auto const &file : {plain, bom, utf16, gzipped}) {
+        EXPECT_EQ(read(file, true), expected) << file;
+        EXPECT_EQ(read(file, false), expected) << file;
+    }
+
+    auto const included = read(xinclude, false);
+    EXPECT_NE(included.find("included"), std::string::npos);
+    EXPECT_EQ(read(xinclude, true), included);
+
+    for (auto const &file : files) {
+        g_unlink(file.c_str());
+    }
+    g_rmdir(dir.c_str());
+}
+
+TEST(XmlTest, DISABLED_ReadBenchmark)
+{
+    // Measures loading a large file with and without an intermediate libxml2 tree. Run it by
+    // hand with --gtest_also_run_disabled_tests.
+    gchar *filename = nullptr;
+    int fd = g_file_open_tmp("xml-test-XXXXXX.svg", &filename, nullptr);
+    ASSERT_NE(fd, -1);
+    g_close(fd, nullptr);
+    {
+        std::ofstream out(filename);
+        out << "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:inkscape=\"http://www.inkscape.org/namespaces/inkscape\">\n";
+        for (int i = 0; i < 200000; i++) {
+            out << "<path id=\"path" << i << "\" inkscape:label=\"Road " << i << "\" style=\"fill:none;stroke:#" << std::hex
+                << (i * 2654435761u & 0xffffff) << std::dec << ";stroke-width:0.5\" d=\"M " << i % 1000 << "," << i / 1000
+                << " l 3.5,1.25 2,-0.75 1.5,2 -0.25,3 z\"/>\n";
+        }
+        out << "</svg>\n";
+    }
+
+    for (bool streaming : {false, true}) {
+#ifdef __linux__
+        // Reset the peak resident set size.
+        std::ofstream("/proc/self/clear_refs") << "5";
+        long const rss_before = proc_status_kb("VmRSS:");
+#endif
+        auto start = std::chrono::steady_clock::now();
+        auto doc = sp_repr_read_file(filename, SP_SVG_NS_URI, streaming);
+        std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+        ASSERT_TRUE(doc);
+        std::cout << (streaming ? "[streaming]" : "[tree]") << " load: " << time.count() << " ms";
+#ifdef __linux__
+        std::cout << ", peak memory: " << (proc_status_kb("VmHWM:") - rss_before) / 1024 << " MiB";
+#endif
+        std::cout << std::endl;
+        Inkscape::GC::release(doc);
+    }
+
+    g_unlink(filename);
+    g_free(filename);
+}
+
 /*
   Local Variables:
   mode:c++